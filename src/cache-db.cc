@@ -0,0 +1,667 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "cache-db.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cache.h"
+#include "debug.h"
+#include "digest.h"
+#include "similar.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Sim database format:
+ *-------------------------------------------------------------------
+ *
+ * One file per cache folder holds what the .sim files of that folder hold,
+ * in fixed size records so that it can be mapped and indexed in one pass.
+ *
+ * Header (32 bytes): "GQSIMDB1", byte order mark, record size, reserved \n
+ * Record: hash of the file name (0 for a free record), the file name,
+ * mtime and size of the source, flags of the valid fields, dimensions,
+ * date, content digest and its algorithm, similarity hash and the 32 x 32 RGB grid. \n
+ *
+ * Records are rewritten in place and new ones appended. Free records are
+ * reused. Writers hold an exclusive flock() on the file.
+ */
+
+namespace
+{
+
+constexpr gchar CACHE_DB_MAGIC[8] = {'G', 'Q', 'S', 'I', 'M', 'D', 'B', '1'};
+constexpr guint32 CACHE_DB_BYTE_ORDER = 0x01020304;
+constexpr gsize CACHE_DB_NAME_SIZE = 256;
+constexpr gsize CACHE_DB_MAX_OPEN = 32;
+
+enum CacheDbFlags : guint32 {
+	CACHE_DB_DIMENSIONS = 1 << 0,
+	CACHE_DB_DATE       = 1 << 1,
+	CACHE_DB_DIGEST     = 1 << 2,
+	CACHE_DB_SIMILARITY = 1 << 3
+};
+
+struct CacheDbHeader
+{
+	gchar magic[8];
+	guint32 byte_order;
+	guint32 record_size;
+	guint8 reserved[16];
+};
+
+struct CacheDbRecord
+{
+	guint64 key;
+	gchar name[CACHE_DB_NAME_SIZE];
+	gint64 mtime;
+	gint64 size;
+	guint32 flags;
+	gint32 width;
+	gint32 height;
+	guint32 digest_type; /**< #DigestType as stored, 0 in older records that hold MD5 */
+	gint64 date;
+	guint64 phash;
+	guint8 digest[DIGEST_SIZE];
+	guint8 grid[3][1024];
+};
+
+static_assert(sizeof(CacheDbHeader) == 32);
+static_assert(sizeof(CacheDbRecord) % 8 == 0);
+static_assert(static_cast<guint32>(DigestType::MD5) == 1 && static_cast<guint32>(DigestType::GQ128) == 2,
+              "the digest types are stored in CacheDbRecord::digest_type");
+
+/* FNV-1a, never 0 */
+guint64 cache_db_key(const gchar *name)
+{
+	guint64 hash = 14695981039346656037ULL;
+
+	for (const gchar *p = name; *p; p++)
+		{
+		hash ^= static_cast<guchar>(*p);
+		hash *= 1099511628211ULL;
+		}
+
+	return hash ? hash : 1;
+}
+
+class CacheDb
+{
+public:
+	CacheDb(gint fd, gboolean writable);
+	~CacheDb();
+
+	static std::unique_ptr<CacheDb> open(const gchar *path, gboolean create);
+
+	gboolean same_file(const struct stat &st) const;
+	gboolean is_writable() const { return writable; }
+
+	gboolean find(const gchar *name, CacheDbRecord &record);
+	gboolean write(const CacheDbRecord &record);
+	gboolean erase(const gchar *name);
+	std::vector<std::string> names();
+
+private:
+	gboolean init();
+	gboolean refresh();
+	void rescan();
+	gboolean lookup(guint64 key, const gchar *name, gsize &n);
+	gsize take_free_record();
+
+	gsize count() const
+	{
+		if (map_size < sizeof(CacheDbHeader)) return 0;
+		return (map_size - sizeof(CacheDbHeader)) / sizeof(CacheDbRecord);
+	}
+
+	const CacheDbRecord *record_at(gsize n) const
+	{
+		return reinterpret_cast<const CacheDbRecord *>(map + sizeof(CacheDbHeader) + (n * sizeof(CacheDbRecord)));
+	}
+
+	static off_t offset_of(gsize n)
+	{
+		return sizeof(CacheDbHeader) + (n * sizeof(CacheDbRecord));
+	}
+
+	gint fd;
+	gboolean writable;
+	dev_t dev = 0;
+	ino_t ino = 0;
+
+	guchar *map = nullptr;
+	gsize map_size = 0;
+
+	gsize indexed = 0; /**< records scanned into the index */
+	std::unordered_multimap<guint64, gsize> index;
+	std::vector<gsize> free_records;
+};
+
+CacheDb::CacheDb(gint fd, gboolean writable)
+	: fd(fd)
+	, writable(writable)
+{
+	struct stat st;
+	if (fstat(fd, &st) == 0)
+		{
+		dev = st.st_dev;
+		ino = st.st_ino;
+		}
+}
+
+CacheDb::~CacheDb()
+{
+	if (map) munmap(map, map_size);
+	close(fd);
+}
+
+std::unique_ptr<CacheDb> CacheDb::open(const gchar *path, gboolean create)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	gint fd = ::open(pathl, O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0644);
+	const gboolean writable = (fd >= 0);
+
+	/* a shared cache may be read-only */
+	if (fd < 0 && !create) fd = ::open(pathl, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return nullptr;
+
+	auto db = std::make_unique<CacheDb>(fd, writable);
+
+	if (writable && !db->init())
+		{
+		log_printf("Failed to initialise sim database %s\n", path);
+		return nullptr;
+		}
+
+	if (!db->refresh()) return nullptr;
+
+	return db;
+}
+
+/* Writes the header of a new file, or of one in an unknown format */
+gboolean CacheDb::init()
+{
+	if (flock(fd, LOCK_EX) != 0) return FALSE;
+
+	CacheDbHeader header{};
+	gboolean valid = (pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+	                  memcmp(header.magic, CACHE_DB_MAGIC, sizeof(header.magic)) == 0 &&
+	                  header.byte_order == CACHE_DB_BYTE_ORDER &&
+	                  header.record_size == sizeof(CacheDbRecord));
+
+	if (!valid)
+		{
+		header = {};
+		memcpy(header.magic, CACHE_DB_MAGIC, sizeof(header.magic));
+		header.byte_order = CACHE_DB_BYTE_ORDER;
+		header.record_size = sizeof(CacheDbRecord);
+
+		valid = (ftruncate(fd, 0) == 0 &&
+		         pwrite(fd, &header, sizeof(header), 0) == sizeof(header));
+		}
+
+	flock(fd, LOCK_UN);
+
+	return valid;
+}
+
+gboolean CacheDb::same_file(const struct stat &st) const
+{
+	return st.st_dev == dev && st.st_ino == ino;
+}
+
+/* Maps the file again if its size changed, and indexes the new records */
+gboolean CacheDb::refresh()
+{
+	struct stat st;
+	if (fstat(fd, &st) != 0) return FALSE;
+
+	const auto size = static_cast<gsize>(st.st_size);
+	if (map && size == map_size) return TRUE;
+
+	if (size < sizeof(CacheDbHeader)) return FALSE;
+
+	if (map) munmap(map, map_size);
+	map = static_cast<guchar *>(mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0));
+	if (map == MAP_FAILED)
+		{
+		map = nullptr;
+		map_size = 0;
+		return FALSE;
+		}
+
+	const auto old_count = count();
+	map_size = size;
+
+	const auto *header = reinterpret_cast<const CacheDbHeader *>(map);
+	if (memcmp(header->magic, CACHE_DB_MAGIC, sizeof(header->magic)) != 0 ||
+	    header->byte_order != CACHE_DB_BYTE_ORDER ||
+	    header->record_size != sizeof(CacheDbRecord))
+		{
+		munmap(map, map_size);
+		map = nullptr;
+		map_size = 0;
+		return FALSE;
+		}
+
+	/* another process truncated the file */
+	if (count() < old_count || count() < indexed)
+		{
+		rescan();
+		return TRUE;
+		}
+
+	for (gsize n = indexed; n < count(); n++)
+		{
+		const guint64 key = record_at(n)->key;
+		if (key)
+			{
+			index.emplace(key, n);
+			}
+		else
+			{
+			free_records.push_back(n);
+			}
+		}
+	indexed = count();
+
+	return TRUE;
+}
+
+void CacheDb::rescan()
+{
+	index.clear();
+	free_records.clear();
+	indexed = 0;
+
+	for (gsize n = 0; n < count(); n++)
+		{
+		const guint64 key = record_at(n)->key;
+		if (key)
+			{
+			index.emplace(key, n);
+			}
+		else
+			{
+			free_records.push_back(n);
+			}
+		}
+	indexed = count();
+}
+
+gboolean CacheDb::lookup(guint64 key, const gchar *name, gsize &n)
+{
+	for (gint pass = 0; pass < 2; pass++)
+		{
+		gboolean stale = FALSE;
+
+		const auto range = index.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it)
+			{
+			const CacheDbRecord *record = record_at(it->second);
+			if (record->key != key)
+				{
+				/* another process reused the record */
+				stale = TRUE;
+				continue;
+				}
+
+			if (strncmp(record->name, name, sizeof(record->name)) == 0)
+				{
+				n = it->second;
+				return TRUE;
+				}
+			}
+
+		if (!stale) break;
+
+		rescan();
+		}
+
+	return FALSE;
+}
+
+gsize CacheDb::take_free_record()
+{
+	while (!free_records.empty())
+		{
+		const gsize n = free_records.back();
+		free_records.pop_back();
+
+		if (n < count() && record_at(n)->key == 0) return n;
+		}
+
+	return count();
+}
+
+gboolean CacheDb::find(const gchar *name, CacheDbRecord &record)
+{
+	if (!refresh()) return FALSE;
+
+	gsize n;
+	if (!lookup(cache_db_key(name), name, n)) return FALSE;
+
+	memcpy(&record, record_at(n), sizeof(record));
+
+	return TRUE;
+}
+
+gboolean CacheDb::write(const CacheDbRecord &record)
+{
+	if (!writable || flock(fd, LOCK_EX) != 0) return FALSE;
+
+	gboolean ret = FALSE;
+
+	if (refresh())
+		{
+		gsize n;
+		const gboolean known = lookup(record.key, record.name, n);
+		if (!known) n = take_free_record();
+
+		ret = (pwrite(fd, &record, sizeof(record), offset_of(n)) == sizeof(record));
+
+		if (ret && !known && n < indexed) index.emplace(record.key, n);
+		}
+
+	flock(fd, LOCK_UN);
+
+	/* index an appended record */
+	if (ret) refresh();
+
+	return ret;
+}
+
+gboolean CacheDb::erase(const gchar *name)
+{
+	if (!writable || flock(fd, LOCK_EX) != 0) return FALSE;
+
+	gboolean ret = FALSE;
+	const guint64 key = cache_db_key(name);
+
+	gsize n;
+	if (refresh() && lookup(key, name, n))
+		{
+		static constexpr guint64 free_key = 0;
+		ret = (pwrite(fd, &free_key, sizeof(free_key), offset_of(n)) == sizeof(free_key));
+
+		if (ret)
+			{
+			const auto range = index.equal_range(key);
+			const auto it = std::find_if(range.first, range.second, [n](const auto &entry){ return entry.second == n; });
+			if (it != range.second) index.erase(it);
+
+			free_records.push_back(n);
+			}
+		}
+
+	flock(fd, LOCK_UN);
+
+	return ret;
+}
+
+std::vector<std::string> CacheDb::names()
+{
+	std::vector<std::string> list;
+
+	if (!refresh()) return list;
+
+	rescan();
+	list.reserve(index.size());
+	for (const auto &entry : index)
+		{
+		const CacheDbRecord *record = record_at(entry.second);
+		list.emplace_back(record->name, strnlen(record->name, sizeof(record->name)));
+		}
+
+	return list;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * open databases
+ *-------------------------------------------------------------------
+ */
+
+std::mutex cache_db_mutex;
+std::unordered_map<std::string, std::unique_ptr<CacheDb>> cache_db_open_list;
+
+/* Must be called with cache_db_mutex held */
+CacheDb *cache_db_get(const gchar *path, gboolean create)
+{
+	struct stat st;
+	const gboolean exists = stat_utf8(path, &st);
+
+	auto it = cache_db_open_list.find(path);
+	if (it != cache_db_open_list.end())
+		{
+		/* reuse unless the file was deleted or replaced */
+		if (exists && it->second->same_file(st) && (!create || it->second->is_writable()))
+			{
+			return it->second.get();
+			}
+
+		cache_db_open_list.erase(it);
+		}
+
+	if (!exists && !create) return nullptr;
+
+	std::unique_ptr<CacheDb> db = CacheDb::open(path, create);
+	if (!db) return nullptr;
+
+	if (cache_db_open_list.size() >= CACHE_DB_MAX_OPEN) cache_db_open_list.clear();
+
+	return cache_db_open_list.emplace(path, std::move(db)).first->second.get();
+}
+
+gboolean cache_db_name_valid(const gchar *name)
+{
+	return name && *name && strlen(name) < CACHE_DB_NAME_SIZE;
+}
+
+void cache_db_record_from_data(CacheDbRecord &record, const gchar *name, const struct stat &st, const CacheData &cd)
+{
+	record = {};
+
+	record.key = cache_db_key(name);
+	g_strlcpy(record.name, name, sizeof(record.name));
+	record.mtime = st.st_mtime;
+	record.size = st.st_size;
+
+	if (cd.dimensions)
+		{
+		record.flags |= CACHE_DB_DIMENSIONS;
+		record.width = cd.dimensions->width;
+		record.height = cd.dimensions->height;
+		}
+
+	if (cd.date)
+		{
+		record.flags |= CACHE_DB_DATE;
+		record.date = *cd.date;
+		}
+
+	if (cd.digest)
+		{
+		record.flags |= CACHE_DB_DIGEST;
+		record.digest_type = static_cast<guint32>(cd.digest->type);
+		std::copy(cd.digest->value.cbegin(), cd.digest->value.cend(), record.digest);
+		}
+
+	if (image_sim_filled(cd.similarity.get()))
+		{
+		record.flags |= CACHE_DB_SIMILARITY;
+		record.phash = cd.similarity->phash;
+		std::copy(cd.similarity->avg_r.cbegin(), cd.similarity->avg_r.cend(), record.grid[0]);
+		std::copy(cd.similarity->avg_g.cbegin(), cd.similarity->avg_g.cend(), record.grid[1]);
+		std::copy(cd.similarity->avg_b.cbegin(), cd.similarity->avg_b.cend(), record.grid[2]);
+		}
+}
+
+void cache_db_record_to_data(const CacheDbRecord &record, CacheData &cd)
+{
+	if (record.flags & CACHE_DB_DIMENSIONS)
+		{
+		cd.set_dimensions({record.width, record.height});
+		}
+
+	if (record.flags & CACHE_DB_DATE)
+		{
+		cd.date = record.date;
+		}
+
+	if (record.flags & CACHE_DB_DIGEST)
+		{
+		Digest digest{DigestType::MD5, {}};
+		if (record.digest_type != 0) digest.type = static_cast<DigestType>(record.digest_type);
+		std::copy(std::cbegin(record.digest), std::cend(record.digest), digest.value.begin());
+
+		if (digest.type == DigestType::MD5 || digest.type == DigestType::GQ128) cd.set_digest(digest);
+		}
+
+	if (record.flags & CACHE_DB_SIMILARITY)
+		{
+		ImageSimilarityData sd{};
+		std::copy(std::cbegin(record.grid[0]), std::cend(record.grid[0]), sd.avg_r.begin());
+		std::copy(std::cbegin(record.grid[1]), std::cend(record.grid[1]), sd.avg_g.begin());
+		std::copy(std::cbegin(record.grid[2]), std::cend(record.grid[2]), sd.avg_b.begin());
+		sd.phash = record.phash;
+		sd.filled = true;
+		cd.set_similarity(sd);
+		}
+}
+
+} // namespace
+
+gboolean cache_db_load(const gchar *db, const gchar *source, CacheData &cd)
+{
+	if (!db || !source) return FALSE;
+
+	const gchar *name = filename_from_path(source);
+	if (!cache_db_name_valid(name)) return FALSE;
+
+	struct stat st;
+	if (!stat_utf8(source, &st)) return FALSE;
+
+	CacheDbRecord record;
+	{
+	std::lock_guard<std::mutex> lock(cache_db_mutex);
+
+	CacheDb *cache_db = cache_db_get(db, FALSE);
+	if (!cache_db || !cache_db->find(name, record)) return FALSE;
+	}
+
+	if (record.mtime != st.st_mtime || record.size != st.st_size)
+		{
+		DEBUG_1("sim database record of %s is outdated", source);
+		return FALSE;
+		}
+
+	cache_db_record_to_data(record, cd);
+
+	return TRUE;
+}
+
+gboolean cache_db_save(const gchar *db, const gchar *source, const CacheData &cd)
+{
+	if (!db || !source) return FALSE;
+
+	const gchar *name = filename_from_path(source);
+	if (!cache_db_name_valid(name)) return FALSE;
+
+	struct stat st;
+	if (!stat_utf8(source, &st)) return FALSE;
+
+	CacheDbRecord record;
+	cache_db_record_from_data(record, name, st, cd);
+
+	std::lock_guard<std::mutex> lock(cache_db_mutex);
+
+	CacheDb *cache_db = cache_db_get(db, TRUE);
+
+	return cache_db && cache_db->write(record);
+}
+
+gboolean cache_db_move(const gchar *src_db, const gchar *source, const gchar *dest_db, const gchar *dest)
+{
+	if (!src_db || !source || !dest_db || !dest) return FALSE;
+
+	const gchar *name = filename_from_path(source);
+	const gchar *dest_name = filename_from_path(dest);
+	if (!cache_db_name_valid(name)) return FALSE;
+
+	std::lock_guard<std::mutex> lock(cache_db_mutex);
+
+	CacheDb *cache_db = cache_db_get(src_db, FALSE);
+	if (!cache_db) return FALSE;
+
+	CacheDbRecord record;
+	if (!cache_db->find(name, record)) return FALSE;
+
+	cache_db->erase(name);
+
+	/* a name that does not fit is dropped, the record is stale anyway */
+	if (!cache_db_name_valid(dest_name)) return FALSE;
+
+	record.key = cache_db_key(dest_name);
+	memset(record.name, 0, sizeof(record.name));
+	g_strlcpy(record.name, dest_name, sizeof(record.name));
+
+	CacheDb *dest_cache_db = cache_db_get(dest_db, TRUE);
+
+	return dest_cache_db && dest_cache_db->write(record);
+}
+
+void cache_db_remove(const gchar *db, const gchar *source)
+{
+	if (!db || !source) return;
+
+	const gchar *name = filename_from_path(source);
+	if (!cache_db_name_valid(name)) return;
+
+	std::lock_guard<std::mutex> lock(cache_db_mutex);
+
+	CacheDb *cache_db = cache_db_get(db, FALSE);
+	if (cache_db) cache_db->erase(name);
+}
+
+gint cache_db_purge(const gchar *db, const gchar *folder)
+{
+	if (!db || !folder) return 0;
+
+	std::lock_guard<std::mutex> lock(cache_db_mutex);
+
+	CacheDb *cache_db = cache_db_get(db, FALSE);
+	if (!cache_db) return 0;
+
+	gint count = 0;
+
+	for (const std::string &name : cache_db->names())
+		{
+		g_autofree gchar *source = g_build_filename(folder, name.c_str(), nullptr);
+
+		if (isfile(source) || !cache_db->erase(name.c_str()))
+			{
+			count++;
+			}
+		}
+
+	return count;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
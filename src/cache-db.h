@@ -0,0 +1,49 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef CACHE_DB_H
+#define CACHE_DB_H
+
+#include <glib.h>
+
+struct CacheData;
+
+#define GQ_CACHE_SIM_DB ".sim.db"
+
+/**
+ * @brief Reads the cached data of one file from the sim database of its folder
+ * @param db Path of the database, see cache_find_sim_db_location()
+ * @param source Path of the image
+ * @param[out] cd Receives the dimensions, date, checksum and similarity
+ * @returns FALSE if there is no record or the image changed since it was written
+ *
+ * The database is mapped once per process; later lookups in the same folder
+ * do not touch the disk.
+ */
+gboolean cache_db_load(const gchar *db, const gchar *source, CacheData &cd);
+
+/**
+ * @brief Writes the cached data of one file, replacing any previous record
+ * @returns FALSE if the database could not be created or written
+ */
+gboolean cache_db_save(const gchar *db, const gchar *source, const CacheData &cd);
+
+/**
+ * @brief Moves the record of @a source into the database @a dest_db as @a dest
+ */
+gboolean cache_db_move(const gchar *src_db, const gchar *source, const gchar *dest_db, const gchar *dest);
+
+/**
+ * @brief Deletes the record of @a source, its space is reused by later writes
+ */
+void cache_db_remove(const gchar *db, const gchar *source);
+
+/**
+ * @brief Deletes the records of files that no longer exist in @a folder
+ * @returns The number of live records left
+ */
+gint cache_db_purge(const gchar *db, const gchar *folder);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -21,12 +21,15 @@
 
 #include "cache-loader.h"
 
+#include <algorithm>
 #include <ctime>
+#include <optional>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
 
 #include "cache.h"
+#include "digest.h"
 #include "filedata.h"
 #include "image-load.h"
 #include "metadata.h"
@@ -37,9 +40,127 @@
 
 static gboolean cache_loader_phase2_process(gpointer data);
 
+/**
+ * @brief The similarity data and checksum of one file, computed on a pool thread
+ *
+ * Both go through every pixel or every byte of the file. Done on the main
+ * loop, they would keep loaders of several files from running in parallel.
+ */
+struct CacheLoaderWork
+{
+	CacheLoader *cl; /**< nullptr once the loader is freed, only used on the main loop */
+	GdkPixbuf *pixbuf;
+	gchar *path; /**< of the file to checksum, nullptr if not wanted */
+
+	std::optional<ImageSimilarityData> similarity;
+	std::optional<Digest> digest;
+};
+
+/* shared by all cache loaders, started with the first decoded image */
+static GThreadPool *cache_loader_pool = nullptr;
+
+static gboolean cache_loader_work_done_cb(gpointer data)
+{
+	auto *work = static_cast<CacheLoaderWork *>(data);
+	CacheLoader *cl = work->cl;
+
+	if (cl)
+		{
+		cl->work = nullptr;
+
+		cl->cd->set_similarity(*work->similarity);
+		cl->todo_mask = static_cast<CacheDataType>(cl->todo_mask & ~CACHE_LOADER_SIMILARITY);
+		cl->done_mask = static_cast<CacheDataType>(cl->done_mask | CACHE_LOADER_SIMILARITY);
+
+		/* we have the dimensions via pixbuf */
+		if (!cl->cd->dimensions)
+			{
+			cl->cd->set_dimensions({gdk_pixbuf_get_width(work->pixbuf),
+			                        gdk_pixbuf_get_height(work->pixbuf)});
+			if (cl->todo_mask & CACHE_LOADER_DIMENSIONS)
+				{
+				cl->todo_mask = static_cast<CacheDataType>(cl->todo_mask & ~CACHE_LOADER_DIMENSIONS);
+				cl->done_mask = static_cast<CacheDataType>(cl->done_mask | CACHE_LOADER_DIMENSIONS);
+				}
+			}
+
+		if (work->path)
+			{
+			if (work->digest)
+				{
+				cl->cd->set_digest(*work->digest);
+				cl->done_mask = static_cast<CacheDataType>(cl->done_mask | CACHE_LOADER_DIGEST);
+				}
+			else
+				{
+				cl->error = TRUE;
+				}
+
+			cl->todo_mask = static_cast<CacheDataType>(cl->todo_mask & ~CACHE_LOADER_DIGEST);
+			}
+
+		image_loader_free(cl->il);
+		cl->il = nullptr;
+
+		cl->idle_id = g_idle_add(cache_loader_phase2_process, cl);
+		}
+
+	g_object_unref(work->pixbuf);
+	g_free(work->path);
+	delete work;
+
+	return G_SOURCE_REMOVE;
+}
+
+static void cache_loader_work_run(gpointer data, gpointer)
+{
+	auto *work = static_cast<CacheLoaderWork *>(data);
+
+	work->similarity.emplace(work->pixbuf);
+
+	if (work->path)
+		{
+		if (Digest digest; digest_from_file(work->path, DIGEST_DEFAULT, digest))
+			{
+			work->digest = digest;
+			}
+		}
+
+	g_idle_add(cache_loader_work_done_cb, work);
+}
+
+static void cache_loader_work_start(CacheLoader *cl, GdkPixbuf *pixbuf)
+{
+	if (!cache_loader_pool)
+		{
+		cache_loader_pool = g_thread_pool_new(cache_loader_work_run, nullptr,
+		                                      std::max(1U, g_get_num_processors()), FALSE, nullptr);
+		}
+
+	auto *work = new CacheLoaderWork();
+	work->cl = cl;
+	work->pixbuf = g_object_ref(pixbuf);
+	if ((cl->todo_mask & CACHE_LOADER_DIGEST) &&
+	    (!cl->cd->digest || cl->cd->digest->type != DIGEST_DEFAULT))
+		{
+		work->path = g_strdup(cl->fd->path);
+		}
+
+	cl->work = work;
+	g_thread_pool_push(cache_loader_pool, work, nullptr);
+}
+
 static void cache_loader_phase1_done(CacheLoader *cl, gboolean error)
 {
 	cl->error = error;
+
+	GdkPixbuf *pixbuf = cl->il ? image_loader_get_pixbuf(cl->il) : nullptr;
+	if (!error && pixbuf)
+		{
+		cache_loader_work_start(cl, pixbuf);
+		return;
+		}
+
 	cl->idle_id = g_idle_add(cache_loader_phase2_process, cl);
 }
 
@@ -56,6 +177,7 @@ static gboolean cache_loader_phase1_process(gpointer data)
 	auto *cl = static_cast<CacheLoader *>(data);
 
 	cl->il = image_loader_new(cl->fd);
+	image_loader_set_queue(cl->il, IMAGE_LOADER_QUEUE_BACKGROUND);
 	g_signal_connect(G_OBJECT(cl->il), "error", G_CALLBACK(cache_loader_phase1_done_cb<TRUE>), cl);
 	g_signal_connect(G_OBJECT(cl->il), "done", G_CALLBACK(cache_loader_phase1_done_cb<FALSE>), cl);
 
@@ -121,20 +243,20 @@ static gboolean cache_loader_phase2_process(gpointer data)
 
 		cl->todo_mask = static_cast<CacheDataType>(cl->todo_mask & ~CACHE_LOADER_DIMENSIONS);
 		}
-	else if ((cl->todo_mask & CACHE_LOADER_MD5SUM) &&
-	         !cl->cd->md5sum)
+	else if ((cl->todo_mask & CACHE_LOADER_DIGEST) &&
+	         (!cl->cd->digest || cl->cd->digest->type != DIGEST_DEFAULT))
 		{
-		if (Md5Digest digest; md5_get_digest_from_file_utf8(cl->fd->path, digest))
+		if (Digest digest; digest_from_file(cl->fd->path, DIGEST_DEFAULT, digest))
 			{
-			cl->cd->set_md5sum(digest);
-			cl->done_mask = static_cast<CacheDataType>(cl->done_mask | CACHE_LOADER_MD5SUM);
+			cl->cd->set_digest(digest);
+			cl->done_mask = static_cast<CacheDataType>(cl->done_mask | CACHE_LOADER_DIGEST);
 			}
 		else
 			{
 			cl->error = TRUE;
 			}
 
-		cl->todo_mask = static_cast<CacheDataType>(cl->todo_mask & ~CACHE_LOADER_MD5SUM);
+		cl->todo_mask = static_cast<CacheDataType>(cl->todo_mask & ~CACHE_LOADER_DIGEST);
 		}
 	else if ((cl->todo_mask & CACHE_LOADER_DATE) &&
 	         !cl->cd->date)
@@ -213,6 +335,9 @@ void cache_loader_free(CacheLoader *cl)
 		cl->idle_id = 0;
 		}
 
+	/* the pool thread finishes on its own */
+	if (cl->work) cl->work->cl = nullptr;
+
 	image_loader_free(cl->il);
 
 	file_data_unref(cl->fd);
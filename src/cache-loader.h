@@ -27,6 +27,7 @@
 #include <glib.h>
 
 struct CacheData;
+struct CacheLoaderWork;
 class FileData;
 struct ImageLoader;
 
@@ -34,7 +35,7 @@ enum CacheDataType {
 	CACHE_LOADER_NONE       = 0,
 	CACHE_LOADER_DIMENSIONS = 1 << 0,
 	CACHE_LOADER_DATE       = 1 << 1,
-	CACHE_LOADER_MD5SUM     = 1 << 2,
+	CACHE_LOADER_DIGEST     = 1 << 2,
 	CACHE_LOADER_SIMILARITY = 1 << 3
 };
 
@@ -53,6 +54,7 @@ struct CacheLoader {
 
 	ImageLoader *il;
 	guint idle_id; /**< event source id */
+	CacheLoaderWork *work; /**< similarity data and checksum being computed off the main loop */
 };
 
 
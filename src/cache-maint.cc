@@ -21,15 +21,19 @@
 
 #include "cache-maint.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
 #include <glib-object.h>
 #include <gtk/gtk.h>
 
+#include "cache-db.h"
 #include "cache-loader.h"
 #include "cache.h"
+#include "dupe-index.h"
 #include "filedata.h"
+#include "image-load.h"
 #include "intl.h"
 #include "layout.h"
 #include "main-defines.h"
@@ -37,7 +41,9 @@
 #include "misc.h"
 #include "options.h"
 #include "pixbuf-util.h"
+#include "thumb-pack.h"
 #include "thumb-standard.h"
+#include "thumb-writer.h"
 #include "thumb.h"
 #include "ui-fileops.h"
 #include "ui-misc.h"
@@ -80,7 +86,7 @@ struct CacheOpsData
 {
 	GenericDialog *gd;
 	ThumbLoaderStd *tl;
-	CacheLoader *cl;
+	GList *loaders; /**< thumbnail or cache loaders running */
 	GSourceFunc destroy_func; /* Used by the command line prog. functions */
 	GtkApplication *app;
 
@@ -107,12 +113,43 @@ struct CacheOpsData
 	gboolean recurse;
 
 	gboolean remote;
+	gint jobs; /**< loaders run at once, 0 is one per processor core */
+	gint jobs_raised; /**< image loader workers raised for this run, 0 if none */
 
 	guint idle_id; /* event source id */
 };
 
 constexpr gint PURGE_DIALOG_WIDTH = 400;
 
+guint cache_manager_jobs(const CacheOpsData *cd)
+{
+	if (cd->jobs > 0) return cd->jobs;
+
+	return std::max(1U, g_get_num_processors());
+}
+
+/**
+ * @brief Lets the image loaders decode as many files at once as @a cd runs,
+ * until cache_manager_jobs_stop() when the run is finished or stopped
+ *
+ * Files are read a folder at a time, as loaders become free, so a large
+ * tree starts at once and the files waiting in memory are those of the
+ * folders read so far.
+ */
+void cache_manager_jobs_start(CacheOpsData *cd)
+{
+	cd->jobs_raised = cache_manager_jobs(cd);
+	image_loader_workers_raise(cd->jobs_raised);
+}
+
+void cache_manager_jobs_stop(CacheOpsData *cd)
+{
+	if (!cd->jobs_raised) return;
+
+	image_loader_workers_lower(cd->jobs_raised);
+	cd->jobs_raised = 0;
+}
+
 /* sorry for complexity (cm->done_list), but need it to remove empty dirs */
 CMData *cache_maintain_data_new(gboolean clear, gboolean metadata, gboolean remote)
 {
@@ -156,7 +193,9 @@ void cache_maintain_home_close(CMData *cm)
  */
 static gchar *cache_maintenance_path = nullptr;
 
-static void cache_manager_sim_remote(GtkApplication *app, const gchar *path, gboolean recurse, GSourceFunc destroy_func);
+static gint cache_maintenance_jobs = 0;
+
+static void cache_manager_sim_remote(GtkApplication *app, const gchar *path, gboolean recurse, gint jobs, GSourceFunc destroy_func);
 
 static gboolean cache_maintenance_sim_stop_cb(gpointer data)
 {
@@ -166,6 +205,8 @@ static gboolean cache_maintenance_sim_stop_cb(gpointer data)
 
 	g_free(data);
 
+	thumb_writer_flush();
+
 	exit(EXIT_SUCCESS);
 }
 
@@ -175,7 +216,7 @@ static gboolean cache_maintenance_render_stop_cb(gpointer data)
 
 	cache_maintenance_notification(cd->app, _("Creating sim data…"), TRUE);
 
-	cache_manager_sim_remote(cd->app, cache_maintenance_path, TRUE, cache_maintenance_sim_stop_cb);
+	cache_manager_sim_remote(cd->app, cache_maintenance_path, TRUE, cache_maintenance_jobs, cache_maintenance_sim_stop_cb);
 
 	return G_SOURCE_REMOVE;
 }
@@ -186,12 +227,13 @@ static void cache_maintenance_clean_stop_cb(gpointer data)
 
 
 	cache_maintenance_notification(cm->app,  _("Creating thumbs…"), TRUE);
-	cache_manager_render_remote(cm->app, cache_maintenance_path, TRUE, options->thumbnails.cache_into_dirs, cache_maintenance_render_stop_cb);
+	cache_manager_render_remote(cm->app, cache_maintenance_path, TRUE, options->thumbnails.cache_into_dirs, cache_maintenance_jobs, cache_maintenance_render_stop_cb);
 }
 
-void cache_maintenance(GtkApplication *app, const gchar *path)
+void cache_maintenance(GtkApplication *app, const gchar *path, gint jobs)
 {
 	cache_maintenance_path = g_strdup(path);
+	cache_maintenance_jobs = jobs;
 
 	cache_maintenance_notification(app, _("Cleaning thumbs and sims…"), TRUE);
 
@@ -285,6 +327,12 @@ static gboolean cache_maintain_home_cb(gpointer data)
 			while (work)
 				{
 				auto fd_list = static_cast<FileData *>(work->data);
+				work = work->next;
+
+				/* the sim database and thumbnail pack are checked below */
+				if (!cm->metadata && (strcmp(fd_list->name, GQ_CACHE_SIM_DB) == 0 ||
+				                      strcmp(fd_list->name, GQ_CACHE_THUMB_PACK) == 0)) continue;
+
 				g_autofree gchar *path_buf = g_strdup(fd_list->path);
 
 				gchar *dot = strrchr(path_buf, '.');
@@ -300,8 +348,34 @@ static gboolean cache_maintain_home_cb(gpointer data)
 					{
 					still_have_a_file = TRUE;
 					}
+				}
 
-				work = work->next;
+			g_autofree gchar *db = g_build_filename(fd->path, GQ_CACHE_SIM_DB, nullptr);
+			if (!cm->metadata && isfile(db))
+				{
+				if (!cm->clear && strlen(fd->path) > base_length &&
+				    cache_db_purge(db, fd->path + base_length) > 0)
+					{
+					still_have_a_file = TRUE;
+					}
+				else if (!unlink_file(db))
+					{
+					log_printf("failed to delete:%s\n", db);
+					}
+				}
+
+			g_autofree gchar *pack = g_build_filename(fd->path, GQ_CACHE_THUMB_PACK, nullptr);
+			if (!cm->metadata && isfile(pack))
+				{
+				if (!cm->clear && strlen(fd->path) > base_length &&
+				    thumb_pack_purge(pack, fd->path + base_length) > 0)
+					{
+					still_have_a_file = TRUE;
+					}
+				else if (!unlink_file(pack))
+					{
+					log_printf("failed to delete:%s\n", pack);
+					}
 				}
 			}
 		}
@@ -482,6 +556,34 @@ static void cache_maint_moved(FileData *fd)
 	cache_move(CacheType::SIM);
 	cache_move(CacheType::METADATA);
 
+	g_autofree gchar *src_db = cache_find_sim_db_location(src);
+	if (src_db)
+		{
+		g_autofree gchar *dest_base = cache_create_location(CacheType::SIM, dest);
+		g_autofree gchar *dest_db = dest_base ? g_build_filename(dest_base, GQ_CACHE_SIM_DB, nullptr) : nullptr;
+
+		if (!cache_db_move(src_db, src, dest_db, dest))
+			{
+			/* stale or missing */
+			cache_db_remove(src_db, src);
+			}
+		}
+
+	g_autofree gchar *src_pack = cache_find_thumb_pack_location(src);
+	if (src_pack)
+		{
+		g_autofree gchar *dest_base = cache_create_location(CacheType::THUMB, dest);
+		g_autofree gchar *dest_pack = dest_base ? g_build_filename(dest_base, GQ_CACHE_THUMB_PACK, nullptr) : nullptr;
+
+		if (!thumb_pack_move(src_pack, src, dest_pack, dest))
+			{
+			/* stale or missing */
+			thumb_pack_remove(src_pack, src);
+			}
+		}
+
+	dupe_match_index_file_moved(src, dest);
+
 	if (options->thumbnails.enable_caching && options->thumbnails.spec_standard)
 		thumb_std_maint_moved(src, dest);
 }
@@ -503,6 +605,14 @@ static void cache_maint_removed(FileData *fd)
 	cache_remove(CacheType::SIM);
 	cache_remove(CacheType::METADATA);
 
+	g_autofree gchar *db = cache_find_sim_db_location(fd->path);
+	if (db) cache_db_remove(db, fd->path);
+
+	g_autofree gchar *pack = cache_find_thumb_pack_location(fd->path);
+	if (pack) thumb_pack_remove(pack, fd->path);
+
+	dupe_match_index_file_removed(fd->path);
+
 	if (options->thumbnails.enable_caching && options->thumbnails.spec_standard)
 		thumb_std_maint_removed(fd->path);
 }
@@ -560,8 +670,10 @@ static void cache_manager_render_reset(CacheOpsData *cd)
 	file_data_list_free(cd->list_dir);
 	cd->list_dir = nullptr;
 
-	thumb_loader_free(reinterpret_cast<ThumbLoader *>(cd->tl));
-	cd->tl = nullptr;
+	g_list_free_full(cd->loaders, reinterpret_cast<GDestroyNotify>(thumb_loader_free));
+	cd->loaders = nullptr;
+
+	cache_manager_jobs_stop(cd);
 }
 
 static void cache_manager_render_close_cb(GenericDialog *, gpointer data)
@@ -624,68 +736,78 @@ static void cache_manager_render_folder(CacheOpsData *cd, FileData *dir_fd)
 	cd->list_dir = g_list_concat(list_d, cd->list_dir);
 }
 
-static gboolean cache_manager_render_file(CacheOpsData *cd);
+static void cache_manager_render_fill(CacheOpsData *cd);
 
-static void cache_manager_render_thumb_done_cb(ThumbLoader *, gpointer data)
+static void cache_manager_render_thumb_done_cb(ThumbLoader *tl, gpointer data)
 {
 	auto cd = static_cast<CacheOpsData *>(data);
 
-	thumb_loader_free(reinterpret_cast<ThumbLoader *>(cd->tl));
-	cd->tl = nullptr;
+	cd->loaders = g_list_remove(cd->loaders, tl);
+	thumb_loader_free(tl);
 
-	while (cache_manager_render_file(cd));
+	cache_manager_render_fill(cd);
 }
 
-static gboolean cache_manager_render_file(CacheOpsData *cd)
+static void cache_manager_render_file(CacheOpsData *cd, FileData *fd)
 {
-	if (cd->list)
-		{
-		FileData *fd;
-		gint success;
-
-		fd = static_cast<FileData *>(cd->list->data);
-		cd->list = g_list_remove(cd->list, fd);
-
-		cd->tl = reinterpret_cast<ThumbLoaderStd *>(thumb_loader_new(options->thumbnails.size.width, options->thumbnails.size.height));
-		thumb_loader_set_callbacks(reinterpret_cast<ThumbLoader *>(cd->tl),
-					   cache_manager_render_thumb_done_cb,
-					   cache_manager_render_thumb_done_cb,
-					   nullptr, cd);
-		thumb_loader_set_cache(reinterpret_cast<ThumbLoader *>(cd->tl), TRUE, cd->local, TRUE);
-		success = thumb_loader_start(reinterpret_cast<ThumbLoader *>(cd->tl), fd);
-		if (success)
-			{
-			if (!cd->remote)
-				{
-				entry_set_text(GTK_ENTRY(cd->progress), fd->path);
-				cd->count_done = cd->count_done + 1;
-				gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(cd->progress_bar), static_cast<gdouble>(cd->count_done) / cd->count_total);
-				}
-			}
-		else
-			{
-			thumb_loader_free(reinterpret_cast<ThumbLoader *>(cd->tl));
-			cd->tl = nullptr;
-			}
+	ThumbLoader *tl = thumb_loader_new(options->thumbnails.size.width, options->thumbnails.size.height);
+	thumb_loader_set_callbacks(tl,
+				   cache_manager_render_thumb_done_cb,
+				   cache_manager_render_thumb_done_cb,
+				   nullptr, cd);
+	thumb_loader_set_cache(tl, TRUE, cd->local, TRUE);
 
-		file_data_unref(fd);
+	cd->loaders = g_list_prepend(cd->loaders, tl);
+	if (!thumb_loader_start(tl, fd))
+		{
+		cd->loaders = g_list_remove(cd->loaders, tl);
+		thumb_loader_free(tl);
+		return;
+		}
 
-		return (!success);
+	if (!cd->remote)
+		{
+		entry_set_text(GTK_ENTRY(cd->progress), fd->path);
+		cd->count_done = cd->count_done + 1;
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(cd->progress_bar), static_cast<gdouble>(cd->count_done) / cd->count_total);
 		}
-	if (cd->list_dir)
+}
+
+/**
+ * @brief Starts loaders until cd->jobs of them run, finishes when none is left
+ */
+static void cache_manager_render_fill(CacheOpsData *cd)
+{
+	const guint jobs = cache_manager_jobs(cd);
+
+	while (g_list_length(cd->loaders) < jobs)
 		{
-		FileData *fd;
+		if (cd->list)
+			{
+			auto fd = static_cast<FileData *>(cd->list->data);
+			cd->list = g_list_remove(cd->list, fd);
 
-		fd = static_cast<FileData *>(cd->list_dir->data);
-		cd->list_dir = g_list_remove(cd->list_dir, fd);
+			cache_manager_render_file(cd, fd);
 
-		cache_manager_render_folder(cd, fd);
+			file_data_unref(fd);
+			}
+		else if (cd->list_dir)
+			{
+			auto fd = static_cast<FileData *>(cd->list_dir->data);
+			cd->list_dir = g_list_remove(cd->list_dir, fd);
 
-		file_data_unref(fd);
+			cache_manager_render_folder(cd, fd);
 
-		return TRUE;
+			file_data_unref(fd);
+			}
+		else
+			{
+			break;
+			}
 		}
 
+	if (cd->loaders) return;
+
 	if (!cd->remote)
 		{
 		entry_set_text(GTK_ENTRY(cd->progress), _("done"));
@@ -696,8 +818,6 @@ static gboolean cache_manager_render_file(CacheOpsData *cd)
 		{
 		g_idle_add(cd->destroy_func, cd);
 		}
-
-	return FALSE;
 }
 
 static void cache_manager_render_start_cb(GenericDialog *, gpointer data)
@@ -707,7 +827,7 @@ static void cache_manager_render_start_cb(GenericDialog *, gpointer data)
 
 	if(!cd->remote)
 		{
-		if (cd->list || !gtk_widget_get_sensitive(cd->button_start)) return;
+		if (cd->list || cd->loaders || !gtk_widget_get_sensitive(cd->button_start)) return;
 		}
 
 	g_autofree gchar *path = remove_trailing_slash((gtk_editable_get_text(GTK_EDITABLE(cd->entry))));
@@ -746,7 +866,8 @@ static void cache_manager_render_start_cb(GenericDialog *, gpointer data)
 		g_list_free(list_total);
 		cd->count_done = 0;
 
-		while (cache_manager_render_file(cd));
+		cache_manager_jobs_start(cd);
+		cache_manager_render_fill(cd);
 		}
 }
 
@@ -766,8 +887,9 @@ static void cache_manager_render_start_render_remote(CacheOpsData *cd, const gch
 		dir_fd = file_data_new_dir(path);
 		cache_manager_render_folder(cd, dir_fd);
 		file_data_unref(dir_fd);
-		while (cache_manager_render_file(cd))
-			;
+
+		cache_manager_jobs_start(cd);
+		cache_manager_render_fill(cd);
 		}
 }
 
@@ -810,6 +932,10 @@ static void cache_manager_render_dialog(GtkWidget *widget, const gchar *path)
 	button = pref_checkbox_new_int(cd->group, _("Store thumbnails local to source images"), FALSE, &cd->local);
 	gtk_widget_set_sensitive(button, options->thumbnails.spec_standard);
 
+	button = pref_spin_new_int(cd->group, _("Files at a time:"), nullptr,
+				   0, 64, 1, options->thumbnails.loaders, &cd->jobs);
+	gtk_widget_set_tooltip_text(button, _("The number of files loaded at the same time. 0 is one per processor core."));
+
 	pref_line(cd->gd->vbox, PREF_PAD_SPACE);
 	hbox = pref_box_new(cd->gd->vbox, FALSE, GTK_ORIENTATION_HORIZONTAL, PREF_PAD_SPACE);
 
@@ -839,17 +965,19 @@ static void cache_manager_render_dialog(GtkWidget *widget, const gchar *path)
  * @param path Path to image folder
  * @param recurse
  * @param local Create thumbnails in same folder as images
+ * @param jobs Thumbnails created at a time, 0 is one per processor core
  * @param destroy_func Function called when idle loop function terminates
  *
  *
  */
-void cache_manager_render_remote(GtkApplication *app, const gchar *path, gboolean recurse, gboolean local, GSourceFunc destroy_func)
+void cache_manager_render_remote(GtkApplication *app, const gchar *path, gboolean recurse, gboolean local, gint jobs, GSourceFunc destroy_func)
 {
 	CacheOpsData *cd;
 
 	cd = g_new0(CacheOpsData, 1);
 	cd->recurse = recurse;
 	cd->local = local;
+	cd->jobs = jobs;
 	cd->remote = TRUE;
 	cd->destroy_func = destroy_func;
 	cd->app = app;
@@ -999,6 +1127,8 @@ static void cache_manager_standard_clean_start(CacheOpsData *cd)
 
 	cd->list = get_thumbnails_folder_files(THUMB_FOLDER_NORMAL);
 	cd->list = g_list_concat(cd->list, get_thumbnails_folder_files(THUMB_FOLDER_LARGE));
+	cd->list = g_list_concat(cd->list, get_thumbnails_folder_files(THUMB_FOLDER_XLARGE));
+	cd->list = g_list_concat(cd->list, get_thumbnails_folder_files(THUMB_FOLDER_XXLARGE));
 	cd->list = g_list_concat(cd->list, get_thumbnails_folder_files(THUMB_FOLDER_FAIL));
 
 	cd->count_total = g_list_length(cd->list);
@@ -1155,7 +1285,7 @@ static GtkWidget *cache_manager_location_label(GtkWidget *group, const gchar *su
 	return label;
 }
 
-static gboolean cache_manager_sim_file(CacheOpsData *cd);
+static void cache_manager_sim_fill(CacheOpsData *cd);
 
 static void cache_manager_sim_reset(CacheOpsData *cd)
 {
@@ -1165,8 +1295,10 @@ static void cache_manager_sim_reset(CacheOpsData *cd)
 	file_data_list_free(cd->list_dir);
 	cd->list_dir = nullptr;
 
-	cache_loader_free(cd->cl);
-	cd->cl = nullptr;
+	g_list_free_full(cd->loaders, reinterpret_cast<GDestroyNotify>(cache_loader_free));
+	cd->loaders = nullptr;
+
+	cache_manager_jobs_stop(cd);
 }
 
 static void cache_manager_sim_close_cb(GenericDialog *, gpointer data)
@@ -1223,14 +1355,14 @@ static void cache_manager_sim_folder(CacheOpsData *cd, FileData *dir_fd)
 	cd->list_dir = g_list_concat(list_d, cd->list_dir);
 }
 
-static void cache_manager_sim_file_done_cb(CacheLoader *, gint, gpointer data)
+static void cache_manager_sim_file_done_cb(CacheLoader *cl, gint, gpointer data)
 {
 	auto cd = static_cast<CacheOpsData *>(data);
 
-	cache_loader_free(cd->cl);
-	cd->cl = nullptr;
+	cd->loaders = g_list_remove(cd->loaders, cl);
+	cache_loader_free(cl);
 
-	while (cache_manager_sim_file(cd));
+	cache_manager_sim_fill(cd);
 }
 
 static void cache_manager_sim_start_sim_remote(GtkApplication *, CacheOpsData *cd, const gchar *user_path)
@@ -1249,8 +1381,9 @@ static void cache_manager_sim_start_sim_remote(GtkApplication *, CacheOpsData *c
 		dir_fd = file_data_new_dir(path);
 		cache_manager_sim_folder(cd, dir_fd);
 		file_data_unref(dir_fd);
-		while (cache_manager_sim_file(cd))
-			;
+
+		cache_manager_jobs_start(cd);
+		cache_manager_sim_fill(cd);
 		}
 }
 
@@ -1258,16 +1391,18 @@ static void cache_manager_sim_start_sim_remote(GtkApplication *, CacheOpsData *c
  * @brief Generate .sim files
  * @param path Path to image folder
  * @param recurse
+ * @param jobs Files loaded at a time, 0 is one per processor core
  * @param destroy_func Function called when idle loop function terminates
  *
  *
  */
-static void cache_manager_sim_remote(GtkApplication *app, const gchar *path, gboolean recurse, GSourceFunc destroy_func)
+static void cache_manager_sim_remote(GtkApplication *app, const gchar *path, gboolean recurse, gint jobs, GSourceFunc destroy_func)
 {
 	CacheOpsData *cd;
 
 	cd = g_new0(CacheOpsData, 1);
 	cd->recurse = recurse;
+	cd->jobs = jobs;
 	cd->remote = TRUE;
 	cd->destroy_func = destroy_func;
 	cd->app = app;
@@ -1275,45 +1410,54 @@ static void cache_manager_sim_remote(GtkApplication *app, const gchar *path, gbo
 	cache_manager_sim_start_sim_remote(app, cd, path);
 }
 
-static gboolean cache_manager_sim_file(CacheOpsData *cd)
+static void cache_manager_sim_file(CacheOpsData *cd, FileData *fd)
 {
-	CacheDataType load_mask;
+	auto load_mask = static_cast<CacheDataType>(CACHE_LOADER_DIMENSIONS | CACHE_LOADER_DATE | CACHE_LOADER_DIGEST | CACHE_LOADER_SIMILARITY);
+	CacheLoader *cl = cache_loader_new(fd, load_mask, (cache_manager_sim_file_done_cb), cd);
+	if (cl) cd->loaders = g_list_prepend(cd->loaders, cl);
 
-	if (cd->list)
+	cd->count_done = cd->count_done + 1;
+	if (!cd->remote)
 		{
-		FileData *fd;
-		fd = static_cast<FileData *>(cd->list->data);
-		cd->list = g_list_remove(cd->list, fd);
+		entry_set_text(GTK_ENTRY(cd->progress), fd->path);
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(cd->progress_bar), static_cast<gdouble>(cd->count_done) / cd->count_total);
+		}
+}
 
-		load_mask = static_cast<CacheDataType>(CACHE_LOADER_DIMENSIONS | CACHE_LOADER_DATE | CACHE_LOADER_MD5SUM | CACHE_LOADER_SIMILARITY);
-		cd->cl = cache_loader_new(fd, load_mask, (cache_manager_sim_file_done_cb), cd);
+/**
+ * @brief Starts loaders until cd->jobs of them run, finishes when none is left
+ */
+static void cache_manager_sim_fill(CacheOpsData *cd)
+{
+	const guint jobs = cache_manager_jobs(cd);
 
-		if (!cd->remote)
+	while (g_list_length(cd->loaders) < jobs)
+		{
+		if (cd->list)
 			{
-			entry_set_text(GTK_ENTRY(cd->progress), fd->path);
+			auto fd = static_cast<FileData *>(cd->list->data);
+			cd->list = g_list_remove(cd->list, fd);
+
+			cache_manager_sim_file(cd, fd);
+
+			file_data_unref(fd);
 			}
+		else if (cd->list_dir)
+			{
+			auto fd = static_cast<FileData *>(cd->list_dir->data);
+			cd->list_dir = g_list_remove(cd->list_dir, fd);
 
-		file_data_unref(fd);
-		cd->count_done = cd->count_done + 1;
-		if (!cd->remote)
+			cache_manager_sim_folder(cd, fd);
+
+			file_data_unref(fd);
+			}
+		else
 			{
-			gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(cd->progress_bar), static_cast<gdouble>(cd->count_done) / cd->count_total);
+			break;
 			}
-
-		return FALSE;
 		}
-	if (cd->list_dir)
-		{
-		FileData *fd;
 
-		fd = static_cast<FileData *>(cd->list_dir->data);
-		cd->list_dir = g_list_remove(cd->list_dir, fd);
-
-		cache_manager_sim_folder(cd, fd);
-		file_data_unref(fd);
-
-		return TRUE;
-		}
+	if (cd->loaders) return;
 
 	if (!cd->remote)
 		{
@@ -1326,8 +1470,6 @@ static gboolean cache_manager_sim_file(CacheOpsData *cd)
 		{
 		g_idle_add(cd->destroy_func, cd);
 		}
-
-	return FALSE;
 }
 
 static void cache_manager_sim_start_cb(GenericDialog *, gpointer data)
@@ -1337,7 +1479,7 @@ static void cache_manager_sim_start_cb(GenericDialog *, gpointer data)
 
 	if (!cd->remote)
 		{
-		if (cd->list || !gtk_widget_get_sensitive(cd->button_start)) return;
+		if (cd->list || cd->loaders || !gtk_widget_get_sensitive(cd->button_start)) return;
 		}
 
 	g_autofree gchar *path = remove_trailing_slash((gtk_editable_get_text(GTK_EDITABLE(cd->entry))));
@@ -1376,8 +1518,8 @@ static void cache_manager_sim_start_cb(GenericDialog *, gpointer data)
 		g_list_free(list_total);
 		cd->count_done = 0;
 
-		while (cache_manager_sim_file(cd))
-			;
+		cache_manager_jobs_start(cd);
+		cache_manager_sim_fill(cd);
 		}
 }
 
@@ -1413,6 +1555,10 @@ static void cache_manager_sim_load_dialog(GtkWidget *widget, const gchar *path)
 	cd->entry = tab_completion_new(hbox, path);
 	tab_completion_add_select_button(cd->entry, _("Select folder"), TRUE, nullptr, nullptr, nullptr);
 
+	GtkWidget *spin = pref_spin_new_int(cd->group, _("Files at a time:"), nullptr,
+					    0, 64, 1, options->thumbnails.loaders, &cd->jobs);
+	gtk_widget_set_tooltip_text(spin, _("The number of files loaded at the same time. 0 is one per processor core."));
+
 	pref_line(cd->gd->vbox, PREF_PAD_SPACE);
 	hbox = pref_box_new(cd->gd->vbox, FALSE, GTK_ORIENTATION_HORIZONTAL, PREF_PAD_SPACE);
 
@@ -34,8 +34,8 @@ void cache_manager_show();
 
 void cache_maintain_home_remote(GtkApplication *app, gboolean metadata, gboolean clear, GDestroyNotify func);
 void cache_manager_standard_process_remote(gboolean clear);
-void cache_manager_render_remote(GtkApplication *app, const gchar *path, gboolean recurse, gboolean local, GSourceFunc destroy_func);
-void cache_maintenance(GtkApplication *app, const gchar *path);
+void cache_manager_render_remote(GtkApplication *app, const gchar *path, gboolean recurse, gboolean local, gint jobs, GSourceFunc destroy_func);
+void cache_maintenance(GtkApplication *app, const gchar *path, gint jobs);
 
 void cache_maintenance_notification(GtkApplication *app, const gchar *message, gboolean show_quit_button);
 
@@ -32,10 +32,11 @@
 
 #include <config.h>
 
+#include "cache-db.h"
 #include "main-defines.h"
-#include "md5-util.h"
 #include "options.h"
 #include "similar.h"
+#include "thumb-pack.h"
 #include "thumb-standard.h"
 #include "ui-fileops.h"
 
@@ -50,7 +51,7 @@
  * #comment \n
  * Dimensions=[<width> x <height>] \n
  * Date=[<value in time_t format, or -1 if no embedded date>] \n
- * MD5sum=[<32 character ascii text digest>] \n
+ * Digest=[<algorithm>:<32 character ascii text digest>] \n
  * SimilarityGrid[32 x 32]=<3072 bytes of data (1024 pixels in RGB format, 1 pixel is 24bits)>
  *
  * The first line (9 bytes) indicates it is a SIMcache format file. (new line char must exist) \n
@@ -58,6 +59,14 @@
  * All data lines should end with a new line char. \n
  * Format is very strict, data must begin with the char immediately following '='. \n
  * Currently SimilarityGrid is always assumed to be 32 x 32 RGB. \n
+ * The perceptual hash of the grid is computed when it is read, a
+ * SimilarityHash line written by earlier versions is skipped. \n
+ * MD5 digests are written as MD5sum=[<32 character ascii text digest>], which
+ * is also what older versions read and write. \n
+ *
+ * With options->thumbnails.sim_database the same data is kept in one
+ * database per folder instead, see cache-db.cc. Existing .sim files are
+ * read when the database has no record, and their data is moved into it.
  */
 
 namespace
@@ -189,11 +198,18 @@ bool CacheData::write_date(GString *gstring) const
 	return true;
 }
 
-bool CacheData::write_md5sum(GString *gstring) const
+bool CacheData::write_digest(GString *gstring) const
 {
-	if (!md5sum) return false;
+	if (!digest) return false;
 
-	g_string_append_printf(gstring, "MD5sum=[%s]\n", md5_digest_to_text(*md5sum).c_str());
+	if (digest->type == DigestType::MD5)
+		{
+		g_string_append_printf(gstring, "MD5sum=[%s]\n", digest_to_text(*digest).c_str());
+		}
+	else
+		{
+		g_string_append_printf(gstring, "Digest=[%s:%s]\n", digest_type_to_text(digest->type), digest_to_text(*digest).c_str());
+		}
 
 	return true;
 }
@@ -212,6 +228,20 @@ bool CacheData::write_similarity(GString *gstring) const
 }
 
 void CacheData::save(const gchar *source) const
+{
+	if (options->thumbnails.sim_database)
+		{
+		g_autofree gchar *base = cache_create_location(CacheType::SIM, source);
+		if (!base) return;
+
+		g_autofree gchar *db = g_build_filename(base, GQ_CACHE_SIM_DB, nullptr);
+		if (cache_db_save(db, source, *this)) return;
+		}
+
+	save_sim_file(source);
+}
+
+void CacheData::save_sim_file(const gchar *source) const
 {
 	g_autofree gchar *base = cache_create_location(CacheType::SIM, source);
 	if (!base) return;
@@ -225,7 +255,7 @@ void CacheData::save(const gchar *source) const
 
 	write_dimensions(gstring);
 	write_date(gstring);
-	write_md5sum(gstring);
+	write_digest(gstring);
 	write_similarity(gstring);
 
 	secure_save(pathl, gstring->str, gstring->len);
@@ -322,16 +352,32 @@ bool CacheData::read_date(FILE *f, const gchar *buffer, gint s)
 	return true;
 }
 
-bool CacheData::read_md5sum(FILE *f, const gchar *buffer, gint s)
+bool CacheData::read_digest(FILE *f, const gchar *buffer, gint s)
 {
 	if (!f || !buffer) return false;
 
-	if (s < 8 || strncmp("MD5sum", buffer, 6) != 0) return false;
+	if (s >= 8 && strncmp("MD5sum", buffer, 6) == 0)
+		{
+		gchar buf[64];
+		if (!cache_sim_read_buf(f, s, buf, sizeof(buf))) return false;
+
+		if (Digest digest; digest_from_text(buf, DigestType::MD5, digest)) set_digest(digest);
+
+		return true;
+		}
+
+	if (s < 8 || strncmp("Digest", buffer, 6) != 0) return false;
 
 	gchar buf[64];
 	if (!cache_sim_read_buf(f, s, buf, sizeof(buf))) return false;
 
-	if (Md5Digest digest; md5_digest_from_text(buf, digest)) set_md5sum(digest);
+	/* an algorithm unknown to this version is ignored */
+	const gchar *separator = strchr(buf, ':');
+	if (DigestType type;
+	    separator && digest_type_from_text(buf, separator - buf, type))
+		{
+		if (Digest digest; digest_from_text(separator + 1, type, digest)) set_digest(digest);
+		}
 
 	return true;
 }
@@ -377,6 +423,21 @@ bool CacheData::read_similarity(FILE *f, const gchar *buffer, gint s)
 }
 
 bool CacheData::load(const gchar *source)
+{
+	if (!options->thumbnails.sim_database) return load_sim_file(source);
+
+	g_autofree gchar *db = cache_find_sim_db_location(source);
+	if (db && cache_db_load(db, source, *this)) return true;
+
+	if (!load_sim_file(source)) return false;
+
+	/* migrate, the .sim file stays for older versions */
+	save(source);
+
+	return true;
+}
+
+bool CacheData::load_sim_file(const gchar *source)
 {
 	g_autofree gchar *path = cache_find_location(CacheType::SIM, source);
 	if (!path) return false;
@@ -404,7 +465,7 @@ bool CacheData::load(const gchar *source)
 		if (!cache_sim_read_comment(f, buf, s) &&
 		    !read_dimensions(f, buf, s) &&
 		    !read_date(f, buf, s) &&
-		    !read_md5sum(f, buf, s) &&
+		    !read_digest(f, buf, s) &&
 		    !read_similarity(f, buf, s))
 			{
 			if (!cache_sim_read_skipline(f, s)) break;
@@ -417,9 +478,12 @@ bool CacheData::load(const gchar *source)
 			}
 		}
 
+	/* a hash without its grid is not usable */
+	if (!image_sim_filled(similarity.get())) similarity.reset();
+
 	return dimensions
 	    || date
-	    || md5sum
+	    || digest
 	    || similarity;
 }
 
@@ -434,9 +498,9 @@ void CacheData::set_dimensions(GqSize dimensions)
 	this->dimensions = dimensions;
 }
 
-void CacheData::set_md5sum(const Md5Digest &digest)
+void CacheData::set_digest(const Digest &digest)
 {
-	md5sum = digest;
+	this->digest = digest;
 }
 
 void CacheData::set_similarity(const ImageSimilarityData &sd)
@@ -512,6 +576,42 @@ gchar *cache_find_location(CacheType type, const gchar *source)
 	return path;
 }
 
+/* Finds a file kept once per folder next to the cache files of the folder's images */
+static gchar *cache_find_folder_file_location(CacheType type, const gchar *source, const gchar *name)
+{
+	if (!source) return nullptr;
+
+	const CachePathParts cache{type};
+	g_autofree gchar *base = remove_level_from_path(source);
+
+	g_autofree gchar *local = g_build_filename(base, cache.local, name, nullptr);
+	g_autofree gchar *rc = g_build_filename(cache.rc, base, name, nullptr);
+
+	/* try the opposite method if not found */
+	if (cache.use_local_dir)
+		{
+		if (isfile(local)) return g_steal_pointer(&local);
+		if (isfile(rc)) return g_steal_pointer(&rc);
+		}
+	else
+		{
+		if (isfile(rc)) return g_steal_pointer(&rc);
+		if (isfile(local)) return g_steal_pointer(&local);
+		}
+
+	return nullptr;
+}
+
+gchar *cache_find_sim_db_location(const gchar *source)
+{
+	return cache_find_folder_file_location(CacheType::SIM, source, GQ_CACHE_SIM_DB);
+}
+
+gchar *cache_find_thumb_pack_location(const gchar *source)
+{
+	return cache_find_folder_file_location(CacheType::THUMB, source, GQ_CACHE_THUMB_PACK);
+}
+
 gboolean cache_time_valid(const gchar *cache, const gchar *path)
 {
 	struct stat cache_st;
@@ -581,4 +681,15 @@ const gchar *get_metadata_cache_dir()
 	return metadata_cache_dir;
 }
 
+const gchar *get_duplicates_cache_dir()
+{
+#if USE_XDG
+	static gchar *duplicates_cache_dir = g_build_filename(xdg_cache_home_get(), GQ_APPNAME_LC, GQ_CACHE_DUPLICATES, NULL);
+#else
+	static gchar *duplicates_cache_dir = g_build_filename(get_rc_dir(), GQ_CACHE_DUPLICATES, NULL);
+#endif
+
+	return duplicates_cache_dir;
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -30,12 +30,13 @@
 
 #include <glib.h>
 
+#include "digest.h"
 #include "geometry.h"
-#include "md5-util.h"
 #include "similar.h"
 
 #define GQ_CACHE_THUMB		"thumbnails"
 #define GQ_CACHE_METADATA    	"metadata"
+#define GQ_CACHE_DUPLICATES	"duplicates"
 
 #define GQ_CACHE_LOCAL_THUMB    ".thumbnails"
 #define GQ_CACHE_LOCAL_METADATA ".metadata"
@@ -62,24 +63,27 @@ struct CacheData
 	bool load(const gchar *source);
 
 	void set_dimensions(GqSize dimensions);
-	void set_md5sum(const Md5Digest &digest);
+	void set_digest(const Digest &digest);
 	void set_similarity(const ImageSimilarityData &sd);
 
 	std::optional<GqSize> dimensions;
 	std::optional<time_t> date;
-	std::optional<Md5Digest> md5sum;
+	std::optional<Digest> digest; /**< of the file contents */
 	std::unique_ptr<ImageSimilarityData> similarity;
 
 private:
 	bool write_dimensions(GString *gstring) const;
 	bool write_date(GString *gstring) const;
-	bool write_md5sum(GString *gstring) const;
+	bool write_digest(GString *gstring) const;
 	bool write_similarity(GString *gstring) const;
 
 	bool read_dimensions(FILE *f, const gchar *buffer, gint s);
 	bool read_date(FILE *f, const gchar *buffer, gint s);
-	bool read_md5sum(FILE *f, const gchar *buffer, gint s);
+	bool read_digest(FILE *f, const gchar *buffer, gint s);
 	bool read_similarity(FILE *f, const gchar *buffer, gint s);
+
+	void save_sim_file(const gchar *source) const;
+	bool load_sim_file(const gchar *source);
 };
 
 gboolean cache_time_valid(const gchar *cache, const gchar *path);
@@ -87,10 +91,13 @@ gboolean cache_time_valid(const gchar *cache, const gchar *path);
 gchar *cache_create_location(CacheType cache_type, const gchar *source);
 gchar *cache_get_location(CacheType cache_type, const gchar *source);
 gchar *cache_find_location(CacheType type, const gchar *source);
+gchar *cache_find_sim_db_location(const gchar *source);
+gchar *cache_find_thumb_pack_location(const gchar *source);
 
 const gchar *get_thumbnails_cache_dir();
 const gchar *get_thumbnails_standard_cache_dir();
 const gchar *get_metadata_cache_dir();
+const gchar *get_duplicates_cache_dir();
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
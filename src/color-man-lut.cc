@@ -0,0 +1,308 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "color-man-lut.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  include <immintrin.h>
+#  define LUT_HAVE_X86 1
+#else
+#  define LUT_HAVE_X86 0
+#endif
+
+/**
+ * @file
+ *
+ * The grid has GRID_SIZE nodes per channel, blue varying fastest. A node
+ * holds the transformed colour in 8.7 fixed point, which keeps the
+ * products of the interpolation within 16 x 16 bit multiplies.
+ *
+ * Tetrahedral interpolation splits the cube of a grid cell along its grey
+ * diagonal into 6 tetrahedra. Sorting the fractions of the three channels
+ * selects the tetrahedron, whose 4 corners are weighted by the differences
+ * of the sorted fractions. It reads 4 nodes per pixel, where trilinear
+ * interpolation reads 8, and reproduces greys exactly.
+ */
+
+namespace
+{
+
+constexpr gint LUT_FRACTION_ONE = 256;
+constexpr gint LUT_NODE_ONE = 128; /**< node value of one 8 bit step */
+constexpr gint LUT_SHIFT = 15; /**< log2(LUT_FRACTION_ONE * LUT_NODE_ONE) */
+
+constexpr gint LUT_STRIDE_RED = ColorManLut::GRID_SIZE * ColorManLut::GRID_SIZE;
+constexpr gint LUT_STRIDE_GREEN = ColorManLut::GRID_SIZE;
+constexpr gint LUT_STRIDE_BLUE = 1;
+
+/** Regions with fewer pixels are transformed on the calling thread alone */
+constexpr gint64 LUT_PARALLEL_MIN_PIXELS = 512 * 1024;
+constexpr gint LUT_PARALLEL_THREADS_MAX = 8;
+constexpr gint LUT_BAND_HEIGHT = 64;
+
+using Node = ColorManLut::Node;
+using Position = ColorManLut::Position;
+
+/**
+ * @brief The corners of the tetrahedron a pixel falls in, the weights add up to LUT_FRACTION_ONE
+ */
+struct Tetrahedron
+{
+	const Node *corner[4];
+	gint weight[4];
+};
+
+inline Tetrahedron lut_tetrahedron(const Node *nodes, const std::array<Position, 3> &positions, const guchar *p)
+{
+	constexpr gint R = LUT_STRIDE_RED;
+	constexpr gint G = LUT_STRIDE_GREEN;
+	constexpr gint B = LUT_STRIDE_BLUE;
+	constexpr gint ONE = LUT_FRACTION_ONE;
+
+	const gint fr = positions[0].fraction[p[0]];
+	const gint fg = positions[1].fraction[p[1]];
+	const gint fb = positions[2].fraction[p[2]];
+	const Node *c = nodes + positions[0].offset[p[0]] + positions[1].offset[p[1]] + positions[2].offset[p[2]];
+
+	if (fr >= fg)
+		{
+		if (fg >= fb) return {{c, c + R, c + R + G, c + R + G + B}, {ONE - fr, fr - fg, fg - fb, fb}};
+		if (fr >= fb) return {{c, c + R, c + R + B, c + R + G + B}, {ONE - fr, fr - fb, fb - fg, fg}};
+		return {{c, c + B, c + R + B, c + R + G + B}, {ONE - fb, fb - fr, fr - fg, fg}};
+		}
+
+	if (fr >= fb) return {{c, c + G, c + R + G, c + R + G + B}, {ONE - fg, fg - fr, fr - fb, fb}};
+	if (fg >= fb) return {{c, c + G, c + G + B, c + R + G + B}, {ONE - fg, fg - fb, fb - fr, fr}};
+	return {{c, c + B, c + G + B, c + R + G + B}, {ONE - fb, fb - fg, fg - fr, fr}};
+}
+
+using LutKernel = void (*)(const Node *nodes, const std::array<Position, 3> &positions,
+                           guchar *pixels, gint rowstride, gint channels, GdkRectangle region);
+
+void lut_apply_scalar(const Node *nodes, const std::array<Position, 3> &positions,
+                      guchar *pixels, gint rowstride, gint channels, GdkRectangle region)
+{
+	for (gint y = region.y; y < region.y + region.height; y++)
+		{
+		guchar *p = pixels + (static_cast<ptrdiff_t>(y) * rowstride) + (region.x * channels);
+
+		for (gint x = 0; x < region.width; x++)
+			{
+			const Tetrahedron t = lut_tetrahedron(nodes, positions, p);
+
+			for (gint channel = 0; channel < 3; channel++)
+				{
+				const gint sum = (t.corner[0]->value[channel] * t.weight[0]) +
+				                 (t.corner[1]->value[channel] * t.weight[1]) +
+				                 (t.corner[2]->value[channel] * t.weight[2]) +
+				                 (t.corner[3]->value[channel] * t.weight[3]);
+				p[channel] = (sum + (1 << (LUT_SHIFT - 1))) >> LUT_SHIFT;
+				}
+
+			p += channels;
+			}
+		}
+}
+
+#if LUT_HAVE_X86
+/**
+ * Each pair of corners is interleaved with its pair of weights, so that
+ * one multiply-add gives the weighted sum of the pair for all channels.
+ */
+__attribute__((target("sse2")))
+void lut_apply_sse2(const Node *nodes, const std::array<Position, 3> &positions,
+                    guchar *pixels, gint rowstride, gint channels, GdkRectangle region)
+{
+	const __m128i round = _mm_set1_epi32(1 << (LUT_SHIFT - 1));
+
+	for (gint y = region.y; y < region.y + region.height; y++)
+		{
+		guchar *p = pixels + (static_cast<ptrdiff_t>(y) * rowstride) + (region.x * channels);
+
+		for (gint x = 0; x < region.width; x++)
+			{
+			const Tetrahedron t = lut_tetrahedron(nodes, positions, p);
+
+			const __m128i c01 = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(t.corner[0])),
+			                                       _mm_loadl_epi64(reinterpret_cast<const __m128i *>(t.corner[1])));
+			const __m128i c23 = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(t.corner[2])),
+			                                       _mm_loadl_epi64(reinterpret_cast<const __m128i *>(t.corner[3])));
+			const __m128i w01 = _mm_set1_epi32((t.weight[1] << 16) | t.weight[0]);
+			const __m128i w23 = _mm_set1_epi32((t.weight[3] << 16) | t.weight[2]);
+
+			__m128i sum = _mm_add_epi32(_mm_madd_epi16(c01, w01), _mm_madd_epi16(c23, w23));
+			sum = _mm_srai_epi32(_mm_add_epi32(sum, round), LUT_SHIFT);
+			sum = _mm_packs_epi32(sum, sum);
+			sum = _mm_packus_epi16(sum, sum);
+
+			const guint32 rgb = _mm_cvtsi128_si32(sum);
+			p[0] = rgb;
+			p[1] = rgb >> 8;
+			p[2] = rgb >> 16;
+
+			p += channels;
+			}
+		}
+}
+#endif
+
+/**
+ * @brief Selects the fastest kernel the running CPU supports
+ */
+LutKernel lut_kernel()
+{
+	static const LutKernel kernel = []() -> LutKernel
+	{
+#if LUT_HAVE_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse2")) return lut_apply_sse2;
+#endif
+		return lut_apply_scalar;
+	}();
+
+	return kernel;
+}
+
+/**
+ * @brief Transforms the bands of rows of a region on several threads
+ *
+ * Every thread takes the next band not yet taken, the calling thread too.
+ */
+struct LutParallelApply
+{
+	const ColorManLut *lut;
+	guchar *pixels;
+	gint rowstride;
+	gint channels;
+	GdkRectangle region;
+	gint bands;
+	std::atomic<gint> next_band{0};
+
+	void run()
+	{
+		gint band;
+		while ((band = next_band++) < bands)
+			{
+			const gint y = region.y + (band * LUT_BAND_HEIGHT);
+			lut->apply_rows(pixels, rowstride, channels,
+			                {region.x, y, region.width, std::min(LUT_BAND_HEIGHT, region.y + region.height - y)});
+			}
+	}
+
+	static gpointer thread_func(gpointer data)
+	{
+		static_cast<LutParallelApply *>(data)->run();
+		return nullptr;
+	}
+};
+
+void lut_position_init(Position &position, gint stride)
+{
+	for (gint value = 0; value < 256; value++)
+		{
+		const gint grid = ((value * (ColorManLut::GRID_SIZE - 1) * LUT_FRACTION_ONE) + 127) / 255;
+		gint cell = grid / LUT_FRACTION_ONE;
+		gint fraction = grid % LUT_FRACTION_ONE;
+
+		/* the last node has no cell above it */
+		if (cell == ColorManLut::GRID_SIZE - 1)
+			{
+			cell--;
+			fraction = LUT_FRACTION_ONE;
+			}
+
+		position.offset[value] = cell * stride;
+		position.fraction[value] = fraction;
+		}
+}
+
+} // namespace
+
+ColorManLut::ColorManLut(const SampleFunc &sample)
+	: nodes(GRID_SIZE * GRID_SIZE * GRID_SIZE)
+{
+	std::vector<guint16> in(nodes.size() * 3);
+	std::vector<guint16> out(nodes.size() * 3);
+
+	const auto level = [](gint node) { return static_cast<guint16>(((node * 65535) + ((GRID_SIZE - 1) / 2)) / (GRID_SIZE - 1)); };
+
+	guint16 *colour = in.data();
+	for (gint r = 0; r < GRID_SIZE; r++)
+		{
+		for (gint g = 0; g < GRID_SIZE; g++)
+			{
+			for (gint b = 0; b < GRID_SIZE; b++)
+				{
+				colour[0] = level(r);
+				colour[1] = level(g);
+				colour[2] = level(b);
+				colour += 3;
+				}
+			}
+		}
+
+	sample(in.data(), out.data(), nodes.size());
+
+	for (gsize i = 0; i < nodes.size(); i++)
+		{
+		for (gint channel = 0; channel < 3; channel++)
+			{
+			nodes[i].value[channel] = ((out[(i * 3) + channel] * (255 * LUT_NODE_ONE)) + 32767) / 65535;
+			}
+		nodes[i].value[3] = 0;
+		}
+
+	lut_position_init(positions[0], LUT_STRIDE_RED);
+	lut_position_init(positions[1], LUT_STRIDE_GREEN);
+	lut_position_init(positions[2], LUT_STRIDE_BLUE);
+}
+
+void ColorManLut::apply(GdkPixbuf *pixbuf, GdkRectangle region) const
+{
+	const GdkRectangle frame{0, 0, gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf)};
+	if (!gdk_rectangle_intersect(&frame, &region, &region)) return;
+
+	apply(gdk_pixbuf_get_pixels(pixbuf), gdk_pixbuf_get_rowstride(pixbuf), gdk_pixbuf_get_n_channels(pixbuf), region);
+}
+
+void ColorManLut::apply(guchar *pixels, gint rowstride, gint channels, GdkRectangle region) const
+{
+	if (region.width <= 0 || region.height <= 0) return;
+
+	const gint bands = (region.height + LUT_BAND_HEIGHT - 1) / LUT_BAND_HEIGHT;
+	const gint threads = (static_cast<gint64>(region.width) * region.height < LUT_PARALLEL_MIN_PIXELS) ? 1 :
+	                     std::min({static_cast<gint>(g_get_num_processors()), LUT_PARALLEL_THREADS_MAX, bands});
+
+	if (threads <= 1)
+		{
+		apply_rows(pixels, rowstride, channels, region);
+		return;
+		}
+
+	LutParallelApply parallel{this, pixels, rowstride, channels, region, bands};
+	std::vector<GThread *> workers;
+
+	for (gint i = 1; i < threads; i++)
+		{
+		workers.push_back(g_thread_new("color lut", LutParallelApply::thread_func, &parallel));
+		}
+
+	parallel.run();
+
+	for (GThread *worker : workers)
+		{
+		g_thread_join(worker);
+		}
+}
+
+void ColorManLut::apply_rows(guchar *pixels, gint rowstride, gint channels, GdkRectangle region) const
+{
+	lut_kernel()(nodes.data(), positions, pixels, rowstride, channels, region);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
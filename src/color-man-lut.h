@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef COLOR_MAN_LUT_H
+#define COLOR_MAN_LUT_H
+
+#include <array>
+#include <functional>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gdk/gdk.h>
+#include <glib.h>
+
+/**
+ * @brief A 3D lookup table of an 8 bit RGB colour transform
+ *
+ * The transform is sampled once on a grid of GRID_SIZE^3 colours. A pixel
+ * is then interpolated from the 4 corners of the tetrahedron of the grid
+ * cell it falls in, with SIMD where the CPU has it. Large regions are
+ * split across threads.
+ */
+class ColorManLut
+{
+public:
+	static constexpr gint GRID_SIZE = 33;
+
+	/** Transforms @a count 16 bit RGB colours from @a in to @a out */
+	using SampleFunc = std::function<void(const guint16 *in, guint16 *out, gsize count)>;
+
+	explicit ColorManLut(const SampleFunc &sample);
+
+	/**
+	 * @brief Transforms @a region of @a pixbuf in place, alpha is kept
+	 */
+	void apply(GdkPixbuf *pixbuf, GdkRectangle region) const;
+
+	/**
+	 * @brief Transforms @a region of 8 bit RGB or RGBA pixels in place, alpha is kept
+	 */
+	void apply(guchar *pixels, gint rowstride, gint channels, GdkRectangle region) const;
+
+	/** Transforms @a region on the calling thread alone */
+	void apply_rows(guchar *pixels, gint rowstride, gint channels, GdkRectangle region) const;
+
+	/** A transformed colour, 8 bit channels with 7 bits of fraction */
+	struct alignas(8) Node
+	{
+		gint16 value[4];
+	};
+
+	/** Where an 8 bit input channel falls on the grid */
+	struct Position
+	{
+		std::array<gint, 256> offset; /**< of the grid cell, in nodes */
+		std::array<gint16, 256> fraction; /**< within the cell, 0 to 256 */
+	};
+
+private:
+	std::vector<Node> nodes;
+	std::array<Position, 3> positions; /**< of red, green and blue */
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -28,10 +28,12 @@
 
 #include <algorithm>
 #include <cstring>
+#include <memory>
 
 #include <glib-object.h>
 #include <lcms2.h>
 
+#include "color-man-lut.h"
 #include "intl.h"
 #include "layout.h"
 #include "options.h"
@@ -45,25 +47,22 @@ struct ColorMan::Cache {
 	Cache &operator=(const Cache &) = delete;
 	Cache &operator=(Cache &&) = delete;
 
-	void correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const;
+	void correct_region(GdkPixbuf *pixbuf, GdkRectangle region, gint scale) const;
 	[[nodiscard]] ColorManStatus get_status() const;
 
 	cmsHPROFILE   profile_in;
 	cmsHPROFILE   profile_out;
-	cmsHTRANSFORM transform;
+	std::unique_ptr<ColorManLut> lut; /**< of the transform from profile_in to profile_out */
 
 	ColorManProfileType profile_in_type;
 	gchar *profile_in_file;
 
 	ColorManProfileType profile_out_type;
 	gchar *profile_out_file;
-
-	gboolean has_alpha;
 };
 
 ColorMan::Cache::~Cache()
 {
-	if (transform) cmsDeleteTransform(transform);
 	if (profile_in) cmsCloseProfile(profile_in);
 	if (profile_out) cmsCloseProfile(profile_out);
 
@@ -148,8 +147,7 @@ cmsHPROFILE color_man_cache_load_profile(ColorManProfileType type, const gchar *
 }
 
 ColorManCachePtr color_man_cache_new(ColorManProfileType in_type, const gchar *in_file, const ColorManMemData &in_data,
-                                     ColorManProfileType out_type, const gchar *out_file, const ColorManMemData &out_data,
-                                     gboolean has_alpha)
+                                     ColorManProfileType out_type, const gchar *out_file, const ColorManMemData &out_data)
 {
 	g_auto(cmsHPROFILE) profile_in = color_man_cache_load_profile(in_type, in_file, in_data);
 	if (!profile_in)
@@ -165,9 +163,9 @@ ColorManCachePtr color_man_cache_new(ColorManProfileType in_type, const gchar *i
 		return nullptr;
 		}
 
-	const cmsUInt32Number format = has_alpha ? TYPE_RGBA_8 : TYPE_RGB_8;
-	g_auto(cmsHTRANSFORM) transform = cmsCreateTransform(profile_in, format,
-	                                                     profile_out, format,
+	/* only sampled on the grid of the lookup table, at 16 bit for its precision */
+	g_auto(cmsHTRANSFORM) transform = cmsCreateTransform(profile_in, TYPE_RGB_16,
+	                                                     profile_out, TYPE_RGB_16,
 	                                                     options->color_profile.render_intent, 0);
 	if (!transform)
 		{
@@ -177,19 +175,20 @@ ColorManCachePtr color_man_cache_new(ColorManProfileType in_type, const gchar *i
 
 	auto cc = std::make_shared<ColorMan::Cache>();
 
+	cc->lut = std::make_unique<ColorManLut>([transform](const guint16 *in, guint16 *out, gsize count)
+	{
+		cmsDoTransform(transform, in, out, count);
+	});
+
 	cc->profile_in = g_steal_pointer(&profile_in);
 	cc->profile_out = g_steal_pointer(&profile_out);
 
-	cc->transform = g_steal_pointer(&transform);
-
 	cc->profile_in_type = in_type;
 	cc->profile_in_file = g_strdup(in_file);
 
 	cc->profile_out_type = out_type;
 	cc->profile_out_file = g_strdup(out_file);
 
-	cc->has_alpha = has_alpha;
-
 	if (cc->profile_in_type != COLOR_PROFILE_MEM && cc->profile_out_type != COLOR_PROFILE_MEM)
 		{
 		cm_cache_list.push_back(cc);
@@ -204,14 +203,12 @@ void color_man_cache_reset()
 }
 
 ColorManCachePtr color_man_cache_find(ColorManProfileType in_type, const gchar *in_file,
-                                      ColorManProfileType out_type, const gchar *out_file,
-                                      gboolean has_alpha)
+                                      ColorManProfileType out_type, const gchar *out_file)
 {
-	const auto match_cache = [in_type, in_file, out_type, out_file, has_alpha](const ColorManCachePtr &cc)
+	const auto match_cache = [in_type, in_file, out_type, out_file](const ColorManCachePtr &cc)
 	{
 		bool match = (cc->profile_in_type == in_type &&
-		              cc->profile_out_type == out_type &&
-		              cc->has_alpha == has_alpha);
+		              cc->profile_out_type == out_type);
 
 		if (match && cc->profile_in_type == COLOR_PROFILE_FILE)
 			{
@@ -232,15 +229,13 @@ ColorManCachePtr color_man_cache_find(ColorManProfileType in_type, const gchar *
 }
 
 ColorManCachePtr color_man_cache_get(ColorManProfileType in_type, const gchar *in_file, const ColorManMemData &in_data,
-                                     ColorManProfileType out_type, const gchar *out_file, const ColorManMemData &out_data,
-                                     gboolean has_alpha)
+                                     ColorManProfileType out_type, const gchar *out_file, const ColorManMemData &out_data)
 {
-	ColorManCachePtr cc = color_man_cache_find(in_type, in_file, out_type, out_file, has_alpha);
+	ColorManCachePtr cc = color_man_cache_find(in_type, in_file, out_type, out_file);
 	if (cc) return cc;
 
 	return color_man_cache_new(in_type, in_file, in_data,
-	                           out_type, out_file, out_data,
-	                           has_alpha);
+	                           out_type, out_file, out_data);
 }
 
 } // namespace
@@ -254,60 +249,44 @@ ColorManCachePtr color_man_cache_get(ColorManProfileType in_type, const gchar *i
 
 void ColorMan::correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const
 {
-	profile->correct_region(pixbuf, region);
+	profile->correct_region(pixbuf, region, scale);
 }
 
-void ColorMan::Cache::correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const
+void ColorMan::Cache::correct_region(GdkPixbuf *pixbuf, GdkRectangle region, gint scale) const
 {
 	/** @FIXME: region x,y expected to be = 0. Maybe this is not the right place for scaling */
-	const gint scale = scale_factor();
 	region.width = std::min(region.width * scale, gdk_pixbuf_get_width(pixbuf) - region.x);
 	region.height = std::min(region.height * scale, gdk_pixbuf_get_height(pixbuf) - region.y);
 
-	const int step = has_alpha ? 4 : 3;
-	guchar *pix = gdk_pixbuf_get_pixels(pixbuf) + (region.x * step);
-
-	const gint rs = gdk_pixbuf_get_rowstride(pixbuf);
-
-	for (int i = 0; i < region.height; i++)
-		{
-		guchar *pbuf = pix + ((region.y + i) * rs);
-
-		cmsDoTransform(transform, pbuf, pbuf, region.width);
-		}
+	/* the channels of the pixbuf, renderer tiles have no alpha even when the image has */
+	lut->apply(pixbuf, region);
 }
 
-static ColorMan *color_man_new_real(const GdkPixbuf *pixbuf,
-                                    ColorManProfileType input_type, const gchar *input_file,
+static ColorMan *color_man_new_real(ColorManProfileType input_type, const gchar *input_file,
                                     const ColorManMemData &input_data,
                                     ColorManProfileType screen_type, const gchar *screen_file,
                                     const ColorManMemData &screen_data)
 {
 	ColorManCachePtr profile = color_man_cache_get(input_type, input_file, input_data,
-	                                               screen_type, screen_file, screen_data,
-	                                               pixbuf ? gdk_pixbuf_get_has_alpha(pixbuf) : FALSE);
+	                                               screen_type, screen_file, screen_data);
 	if (!profile) return nullptr;
 
-	return new ColorMan(profile);
+	return new ColorMan(profile, scale_factor());
 }
 
-ColorMan *color_man_new(const GdkPixbuf *pixbuf,
-                        ColorManProfileType input_type, const gchar *input_file,
+ColorMan *color_man_new(ColorManProfileType input_type, const gchar *input_file,
                         ColorManProfileType screen_type, const gchar *screen_file,
                         const ColorManMemData &screen_data)
 {
-	return color_man_new_real(pixbuf,
-	                          input_type, input_file, {},
+	return color_man_new_real(input_type, input_file, {},
 	                          screen_type, screen_file, screen_data);
 }
 
-ColorMan *color_man_new_embedded(const GdkPixbuf *pixbuf,
-                                 const ColorManMemData &input_data,
+ColorMan *color_man_new_embedded(const ColorManMemData &input_data,
                                  ColorManProfileType screen_type, const gchar *screen_file,
                                  const ColorManMemData &screen_data)
 {
-	return color_man_new_real(pixbuf,
-	                          COLOR_PROFILE_MEM, nullptr, input_data,
+	return color_man_new_real(COLOR_PROFILE_MEM, nullptr, input_data,
 	                          screen_type, screen_file, screen_data);
 }
 
@@ -371,8 +350,7 @@ const gchar *get_profile_name(const guchar *profile_data, guint profile_len)
 /*** color support not enabled ***/
 
 
-ColorMan *color_man_new(const GdkPixbuf *,
-                        ColorManProfileType, const gchar *,
+ColorMan *color_man_new(ColorManProfileType, const gchar *,
                         ColorManProfileType, const gchar *,
                         const ColorManMemData &)
 {
@@ -380,8 +358,7 @@ ColorMan *color_man_new(const GdkPixbuf *,
 	return nullptr;
 }
 
-ColorMan *color_man_new_embedded(const GdkPixbuf *,
-                                 const ColorManMemData &,
+ColorMan *color_man_new_embedded(const ColorManMemData &,
                                  ColorManProfileType, const gchar *,
                                  const ColorManMemData &)
 {
@@ -46,8 +46,9 @@ struct ColorManStatus {
 struct ColorMan {
 	struct Cache;
 
-	explicit ColorMan(std::shared_ptr<Cache> profile)
+	ColorMan(std::shared_ptr<Cache> profile, gint scale)
 	    : profile(std::move(profile))
+	    , scale(scale)
 	{}
 
 	void correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const;
@@ -55,6 +56,7 @@ struct ColorMan {
 
 private:
 	std::shared_ptr<Cache> profile;
+	gint scale; /**< of the display, read on creation as tiles are corrected on renderer threads */
 };
 
 struct ColorManMemData {
@@ -62,12 +64,10 @@ struct ColorManMemData {
 	guint len = 0;
 };
 
-ColorMan *color_man_new(const GdkPixbuf *pixbuf,
-                        ColorManProfileType input_type, const gchar *input_file,
+ColorMan *color_man_new(ColorManProfileType input_type, const gchar *input_file,
                         ColorManProfileType screen_type, const gchar *screen_file,
                         const ColorManMemData &screen_data);
-ColorMan *color_man_new_embedded(const GdkPixbuf *pixbuf,
-                                 const ColorManMemData &input_data,
+ColorMan *color_man_new_embedded(const ColorManMemData &input_data,
                                  ColorManProfileType screen_type, const gchar *screen_file,
                                  const ColorManMemData &screen_data);
 
@@ -118,6 +118,24 @@ gchar *set_cwd(gchar *filename, GApplicationCommandLine *app_command_line)
 	return temp;
 }
 
+/**
+ * @brief Files loaded at a time by cache rendering
+ * @param command_line_options_dict
+ * @returns The --jobs option, or the thumbnails generated at a time set in Preferences
+ *
+ * 0 is one per processor core.
+ */
+gint command_line_jobs(GVariantDict *command_line_options_dict)
+{
+	const gchar *text;
+	if (!g_variant_dict_lookup(command_line_options_dict, "jobs", "&s", &text))
+		{
+		return options->thumbnails.loaders;
+		}
+
+	return CLAMP((gint)g_ascii_strtoll(text, nullptr, 10), 0, 64);
+}
+
 gboolean close_window_cb(gpointer)
 {
 	if (layout_valid(&lw_id)) layout_menu_close_cb(nullptr, nullptr, lw_id);
@@ -275,7 +293,7 @@ void gq_cache_render(GtkApplication *app, GApplicationCommandLine *, GVariantDic
 	const gchar *text;
 	g_variant_dict_lookup(command_line_options_dict, key->str, "&s", &text);
 
-	cache_manager_render_remote(app, text, recurse, shared, nullptr);
+	cache_manager_render_remote(app, text, recurse, shared, command_line_jobs(command_line_options_dict), nullptr);
 }
 
 void gq_cache_shared(GtkApplication *, GApplicationCommandLine *, GVariantDict *command_line_options_dict, GList *)
@@ -1525,7 +1543,7 @@ void gq_cm_dir(GtkApplication *app, GApplicationCommandLine *app_command_line, G
 		exit(EXIT_FAILURE);
 		}
 
-	cache_maintenance(app, folder_path);
+	cache_maintenance(app, folder_path, command_line_jobs(command_line_options_dict));
 }
 
 CommandLineOptionEntry command_line_options_cache_maintenance[] =
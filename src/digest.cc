@@ -0,0 +1,410 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "digest.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "md5-util.h"
+#include "ui-fileops.h"
+
+static_assert(DIGEST_SIZE == MD5_SIZE);
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * GQ128
+ *-------------------------------------------------------------------
+ *
+ * A 128 bit hash built like XXH3: the input is consumed in 64 byte stripes
+ * by eight 64 bit accumulators, each lane adding a 32 x 32 bit product of
+ * the input mixed with a key and passing the raw input to its neighbour.
+ * The accumulators are scrambled after every block of 16 stripes. A short
+ * last stripe is padded with zeros, and the length is mixed in at the end.
+ *
+ * The keys are derived from a fixed seed, so the results differ from
+ * xxHash itself. Digests are only compared with digests of the same type,
+ * never with those of other programs.
+ *
+ * This is not a cryptographic hash. It detects equal file contents, not
+ * files made to collide.
+ */
+
+namespace
+{
+
+constexpr gsize GQ128_STRIPE_SIZE = 64;
+constexpr gsize GQ128_LANES = GQ128_STRIPE_SIZE / sizeof(guint64);
+constexpr gsize GQ128_STRIPES_PER_BLOCK = 16;
+
+constexpr guint64 PRIME32_1 = 0x9E3779B1U;
+constexpr guint64 PRIME32_2 = 0x85EBCA77U;
+constexpr guint64 PRIME32_3 = 0xC2B2AE3DU;
+constexpr guint64 PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr guint64 PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr guint64 PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr guint64 PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr guint64 PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+struct Gq128Keys
+{
+	guint64 stripe[GQ128_STRIPES_PER_BLOCK][GQ128_LANES];
+	guint64 scramble[GQ128_LANES];
+	guint64 merge[2][GQ128_LANES];
+};
+
+/* splitmix64 */
+constexpr guint64 gq128_key_next(guint64 &state)
+{
+	state += 0x9E3779B97F4A7C15ULL;
+
+	guint64 z = state;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+	return z ^ (z >> 31);
+}
+
+constexpr Gq128Keys gq128_keys_new()
+{
+	Gq128Keys keys{};
+	guint64 state = PRIME64_5;
+
+	for (auto &stripe : keys.stripe)
+		{
+		for (guint64 &key : stripe) key = gq128_key_next(state);
+		}
+	for (guint64 &key : keys.scramble) key = gq128_key_next(state);
+	for (auto &merge : keys.merge)
+		{
+		for (guint64 &key : merge) key = gq128_key_next(state);
+		}
+
+	return keys;
+}
+
+constexpr Gq128Keys GQ128_KEYS = gq128_keys_new();
+
+inline guint64 gq128_read64(const guchar *data)
+{
+	guint64 value;
+	memcpy(&value, data, sizeof(value));
+
+	return GUINT64_FROM_LE(value);
+}
+
+inline void gq128_write64(guchar *data, guint64 value)
+{
+	value = GUINT64_TO_BE(value);
+	memcpy(data, &value, sizeof(value));
+}
+
+/* 64 x 64 bit product, the upper and lower half folded together */
+inline guint64 gq128_mul_fold(guint64 a, guint64 b)
+{
+#ifdef __SIZEOF_INT128__
+	const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+
+	return static_cast<guint64>(product) ^ static_cast<guint64>(product >> 64);
+#else
+	const guint64 lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+	const guint64 hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+	const guint64 lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+	const guint64 hi_hi = (a >> 32) * (b >> 32);
+	const guint64 cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+	const guint64 upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+	const guint64 lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+
+	return lower ^ upper;
+#endif
+}
+
+inline guint64 gq128_avalanche(guint64 h)
+{
+	h ^= h >> 37;
+	h *= 0x165667919E3779F9ULL;
+	h ^= h >> 32;
+
+	return h;
+}
+
+} // namespace
+
+struct DigestContext::Gq128State
+{
+	void accumulate(const guchar *data);
+	void update(const guchar *data, gsize length);
+	Digest finish();
+
+	guint64 acc[GQ128_LANES] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+	                            PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+	guchar pending[GQ128_STRIPE_SIZE];
+	gsize pending_length = 0;
+	gsize stripe = 0; /**< position in the current block */
+	guint64 total_length = 0;
+};
+
+void DigestContext::Gq128State::accumulate(const guchar *data)
+{
+	const guint64 *keys = GQ128_KEYS.stripe[stripe];
+
+	/* Independent lanes, the compiler turns this into vector code */
+	for (gsize lane = 0; lane < GQ128_LANES; lane++)
+		{
+		const guint64 value = gq128_read64(data + (lane * sizeof(guint64)));
+		const guint64 keyed = value ^ keys[lane];
+
+		acc[lane ^ 1] += value;
+		acc[lane] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+		}
+
+	if (++stripe < GQ128_STRIPES_PER_BLOCK) return;
+
+	for (gsize lane = 0; lane < GQ128_LANES; lane++)
+		{
+		acc[lane] ^= acc[lane] >> 47;
+		acc[lane] ^= GQ128_KEYS.scramble[lane];
+		acc[lane] *= PRIME32_1;
+		}
+
+	stripe = 0;
+}
+
+void DigestContext::Gq128State::update(const guchar *data, gsize length)
+{
+	total_length += length;
+
+	if (pending_length > 0)
+		{
+		const gsize fill = std::min(GQ128_STRIPE_SIZE - pending_length, length);
+		memcpy(pending + pending_length, data, fill);
+		pending_length += fill;
+		data += fill;
+		length -= fill;
+
+		if (pending_length < GQ128_STRIPE_SIZE) return;
+
+		accumulate(pending);
+		pending_length = 0;
+		}
+
+	while (length >= GQ128_STRIPE_SIZE)
+		{
+		accumulate(data);
+		data += GQ128_STRIPE_SIZE;
+		length -= GQ128_STRIPE_SIZE;
+		}
+
+	memcpy(pending, data, length);
+	pending_length = length;
+}
+
+Digest DigestContext::Gq128State::finish()
+{
+	if (pending_length > 0)
+		{
+		memset(pending + pending_length, 0, GQ128_STRIPE_SIZE - pending_length);
+		accumulate(pending);
+		pending_length = 0;
+		}
+
+	guint64 lo = total_length * PRIME64_1;
+	guint64 hi = ~(total_length * PRIME64_2);
+
+	for (gsize lane = 0; lane < GQ128_LANES; lane += 2)
+		{
+		lo += gq128_mul_fold(acc[lane] ^ GQ128_KEYS.merge[0][lane], acc[lane + 1] ^ GQ128_KEYS.merge[0][lane + 1]);
+		hi += gq128_mul_fold(acc[lane] ^ GQ128_KEYS.merge[1][lane], acc[lane + 1] ^ GQ128_KEYS.merge[1][lane + 1]);
+		}
+
+	Digest digest{DigestType::GQ128, {}};
+	gq128_write64(digest.value.data(), gq128_avalanche(hi));
+	gq128_write64(digest.value.data() + sizeof(guint64), gq128_avalanche(lo));
+
+	return digest;
+}
+
+DigestContext::DigestContext(DigestType type)
+	: type(type)
+{
+	if (type == DigestType::MD5)
+		{
+		md5 = g_checksum_new(G_CHECKSUM_MD5);
+		}
+	else
+		{
+		gq128 = std::make_unique<Gq128State>();
+		}
+}
+
+DigestContext::~DigestContext()
+{
+	if (md5) g_checksum_free(md5);
+}
+
+void DigestContext::update(const guchar *data, gsize length)
+{
+	if (md5)
+		{
+		g_checksum_update(md5, data, length);
+		}
+	else
+		{
+		gq128->update(data, length);
+		}
+}
+
+Digest DigestContext::finish()
+{
+	if (!md5) return gq128->finish();
+
+	Digest digest{type, {}};
+	gsize digest_size = DIGEST_SIZE;
+	g_checksum_get_digest(md5, digest.value.data(), &digest_size);
+
+	return digest;
+}
+
+namespace
+{
+
+constexpr gsize DIGEST_READ_SIZE = 1024 * 1024;
+constexpr gsize DIGEST_READ_ALIGN = 4096;
+
+struct DigestBufferFree
+{
+	void operator()(guchar *buffer) const { free(buffer); }
+};
+
+/**
+ * @brief Hashes @a length bytes of @a fd starting at @a offset
+ */
+gboolean digest_update_from_fd(DigestContext &context, gint fd, guchar *buffer, gsize buffer_size,
+                               goffset offset, goffset length, const std::atomic<gboolean> *abort)
+{
+	while (length > 0)
+		{
+		if (abort && *abort) return FALSE;
+
+		const gsize size = std::min<goffset>(length, buffer_size);
+		const gssize nb_bytes_read = pread(fd, buffer, size, offset);
+		if (nb_bytes_read < 0 && errno == EINTR) continue;
+		if (nb_bytes_read < 0) return FALSE;
+		if (nb_bytes_read == 0) break; /* file was truncated */
+
+		context.update(buffer, nb_bytes_read);
+		offset += nb_bytes_read;
+		length -= nb_bytes_read;
+		}
+
+	return TRUE;
+}
+
+} // namespace
+
+gboolean digest_from_file(const gchar *path, DigestType type, Digest &digest,
+                          goffset ends, const std::atomic<gboolean> *abort)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+	const gint fd = open(pathl, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return FALSE;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		{
+		close(fd);
+		return FALSE;
+		}
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	const gsize buffer_size = std::clamp<goffset>(st.st_size, 1, DIGEST_READ_SIZE);
+	std::unique_ptr<guchar, DigestBufferFree> buffer(static_cast<guchar *>(
+		aligned_alloc(DIGEST_READ_ALIGN, (buffer_size + DIGEST_READ_ALIGN - 1) / DIGEST_READ_ALIGN * DIGEST_READ_ALIGN)));
+
+	DigestContext context(type);
+	gboolean ret;
+
+	if (ends > 0 && st.st_size > 2 * ends)
+		{
+		ret = buffer &&
+		      digest_update_from_fd(context, fd, buffer.get(), buffer_size, 0, ends, abort) &&
+		      digest_update_from_fd(context, fd, buffer.get(), buffer_size, st.st_size - ends, ends, abort);
+		}
+	else
+		{
+		/* read to the end, the file may have grown */
+		ret = buffer && digest_update_from_fd(context, fd, buffer.get(), buffer_size, 0, G_MAXINT64, abort);
+		}
+
+	close(fd);
+
+	if (!ret) return FALSE;
+
+	digest = context.finish();
+
+	return TRUE;
+}
+
+Digest digest_from_data(DigestType type, const guchar *data, gsize length)
+{
+	DigestContext context(type);
+	context.update(data, length);
+
+	return context.finish();
+}
+
+std::string digest_to_text(const Digest &digest)
+{
+	return md5_digest_to_text(digest.value);
+}
+
+gboolean digest_from_text(const gchar *text, DigestType type, Digest &digest)
+{
+	Digest result{type, {}};
+	if (!md5_digest_from_text(text, result.value)) return FALSE;
+
+	digest = result;
+
+	return TRUE;
+}
+
+const gchar *digest_type_to_text(DigestType type)
+{
+	switch (type)
+		{
+		case DigestType::MD5:
+			return "md5";
+		case DigestType::GQ128:
+			return "gq128";
+		}
+
+	return "";
+}
+
+gboolean digest_type_from_text(const gchar *text, gsize length, DigestType &type)
+{
+	for (const DigestType candidate : {DigestType::MD5, DigestType::GQ128})
+		{
+		const gchar *name = digest_type_to_text(candidate);
+		if (strlen(name) == length && strncmp(name, text, length) == 0)
+			{
+			type = candidate;
+			return TRUE;
+			}
+		}
+
+	return FALSE;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,91 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <glib.h>
+
+inline constexpr gsize DIGEST_SIZE = 16;
+
+/**
+ * @brief The algorithms a content digest can be computed with
+ *
+ * The values are stored in the cache, do not renumber them.
+ */
+enum class DigestType : guint8 {
+	MD5   = 1, /**< Written by older versions, still read from the cache */
+	GQ128 = 2  /**< Fast non-cryptographic 128 bit hash, see digest.cc */
+};
+
+/** The algorithm used for new digests */
+inline constexpr DigestType DIGEST_DEFAULT = DigestType::GQ128;
+
+struct Digest
+{
+	DigestType type;
+	std::array<guchar, DIGEST_SIZE> value;
+
+	bool operator==(const Digest &other) const { return type == other.type && value == other.value; }
+	bool operator!=(const Digest &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Computes a digest from data passed in pieces
+ *
+ * The result does not depend on how the data is split.
+ */
+class DigestContext
+{
+public:
+	explicit DigestContext(DigestType type);
+	~DigestContext();
+
+	DigestContext(const DigestContext &) = delete;
+	DigestContext &operator=(const DigestContext &) = delete;
+
+	void update(const guchar *data, gsize length);
+	Digest finish();
+
+private:
+	struct Gq128State;
+
+	DigestType type;
+	GChecksum *md5 = nullptr;
+	std::unique_ptr<Gq128State> gq128;
+};
+
+/**
+ * @brief Get the digest of a file
+ * @param path UTF-8 path
+ * @param type Algorithm to use
+ * @param[out] digest Receives the result
+ * @param ends If not 0, and the file is larger than twice this size, only
+ * the first and last @a ends bytes are read
+ * @param abort If not NULL, checked between reads
+ * @returns FALSE if the file could not be read, or on abort
+ *
+ * The file is read with large aligned reads, which keeps the hash rather
+ * than the system calls the limit on fast disks.
+ */
+gboolean digest_from_file(const gchar *path, DigestType type, Digest &digest,
+                          goffset ends = 0, const std::atomic<gboolean> *abort = nullptr);
+
+Digest digest_from_data(DigestType type, const guchar *data, gsize length);
+
+/** @returns The digest value as hexadecimal text, without the algorithm */
+std::string digest_to_text(const Digest &digest);
+gboolean digest_from_text(const gchar *text, DigestType type, Digest &digest);
+
+/** @returns The name of the algorithm as written to the cache, e.g. "gq128" */
+const gchar *digest_type_to_text(DigestType type);
+gboolean digest_type_from_text(const gchar *text, gsize length, DigestType &type);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
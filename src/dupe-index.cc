@@ -0,0 +1,341 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "dupe-index.h"
+
+#include <cstring>
+#include <utility>
+
+#include "cache.h"
+#include "debug.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Duplicate index format:
+ *-------------------------------------------------------------------
+ *
+ * "GQDUPIX1", byte order mark, member count, match count \n
+ * For each member: path length, UTF-8 path, size, modification time \n
+ * For each match: member positions a and b, rank \n
+ *
+ * All values are in the byte order of the machine that wrote the file.
+ * One file is kept for each combination of similarity settings.
+ */
+
+namespace
+{
+
+constexpr gchar DUPE_INDEX_MAGIC[8] = {'G', 'Q', 'D', 'U', 'P', 'I', 'X', '1'};
+constexpr guint32 DUPE_INDEX_BYTE_ORDER = 0x01020304;
+constexpr auto DUPE_INDEX_EXT = ".idx";
+
+struct DupeIndexReader
+{
+	template<typename T>
+	gboolean read(T &value)
+	{
+		if (length - offset < sizeof(value)) return FALSE;
+
+		memcpy(&value, data + offset, sizeof(value));
+		offset += sizeof(value);
+
+		return TRUE;
+	}
+
+	gboolean read(std::string &value, gsize size)
+	{
+		if (length - offset < size) return FALSE;
+
+		value.assign(data + offset, size);
+		offset += size;
+
+		return TRUE;
+	}
+
+	/**
+	 * @brief Whether @a count records of at least @a size bytes each fit in the rest of the data
+	 */
+	gboolean fits(guint32 count, gsize size) const
+	{
+		return count <= (length - offset) / size;
+	}
+
+	const gchar *data;
+	gsize length;
+	gsize offset;
+};
+
+/* a member is its path length, path, size and date */
+constexpr gsize DUPE_INDEX_MEMBER_MIN = sizeof(guint32) + sizeof(gint64) + sizeof(gint64);
+constexpr gsize DUPE_INDEX_MATCH_SIZE = sizeof(guint32) + sizeof(guint32) + sizeof(gdouble);
+
+template<typename T>
+void dupe_index_append(GString *out, const T &value)
+{
+	g_string_append_len(out, reinterpret_cast<const gchar *>(&value), sizeof(value));
+}
+
+gchar *dupe_index_path(const std::string &key)
+{
+	g_autofree gchar *name = g_strconcat(key.c_str(), DUPE_INDEX_EXT, nullptr);
+
+	return g_build_filename(get_duplicates_cache_dir(), name, nullptr);
+}
+
+/* File moves waiting to be written, an empty destination for a deletion */
+std::vector<std::pair<std::string, std::string>> dupe_index_pending;
+guint dupe_index_pending_id = 0; /* event source id */
+
+gboolean dupe_index_pending_cb(gpointer)
+{
+	dupe_index_pending_id = 0;
+
+	g_autoptr(GDir) dir = g_dir_open(get_duplicates_cache_dir(), 0, nullptr);
+	if (!dir)
+		{
+		dupe_index_pending.clear();
+		return G_SOURCE_REMOVE;
+		}
+
+	const gchar *name;
+	while ((name = g_dir_read_name(dir)))
+		{
+		if (!g_str_has_suffix(name, DUPE_INDEX_EXT)) continue;
+
+		const std::string key(name, strlen(name) - strlen(DUPE_INDEX_EXT));
+		std::unique_ptr<DupeMatchIndex> index = DupeMatchIndex::load(key);
+		if (index->get_members().empty()) continue;
+
+		for (const auto &change : dupe_index_pending)
+			{
+			if (change.second.empty())
+				{
+				index->removed(change.first.c_str());
+				}
+			else
+				{
+				index->moved(change.first.c_str(), change.second.c_str());
+				}
+			}
+
+		index->save();
+		}
+
+	dupe_index_pending.clear();
+
+	return G_SOURCE_REMOVE;
+}
+
+void dupe_index_pending_add(const gchar *src, const gchar *dest)
+{
+	if (!isdir(get_duplicates_cache_dir())) return;
+
+	dupe_index_pending.emplace_back(src, dest ? dest : "");
+
+	if (!dupe_index_pending_id)
+		{
+		dupe_index_pending_id = g_idle_add_full(G_PRIORITY_LOW, dupe_index_pending_cb, nullptr, nullptr);
+		}
+}
+
+} // namespace
+
+DupeMatchIndex::DupeMatchIndex(std::string key)
+	: key(std::move(key))
+{
+}
+
+std::unique_ptr<DupeMatchIndex> DupeMatchIndex::load(const std::string &key)
+{
+	auto index = std::make_unique<DupeMatchIndex>(key);
+
+	g_autofree gchar *path = dupe_index_path(key);
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	g_autofree gchar *data = nullptr;
+	gsize length;
+	if (!g_file_get_contents(pathl, &data, &length, nullptr)) return index;
+
+	if (!index->parse(data, length))
+		{
+		DEBUG_1("Ignoring damaged duplicates index %s", path);
+		index->clear();
+		}
+
+	return index;
+}
+
+gboolean DupeMatchIndex::parse(const gchar *data, gsize length)
+{
+	DupeIndexReader reader{data, length, 0};
+
+	std::string magic;
+	guint32 byte_order;
+	guint32 member_count;
+	guint32 match_count;
+	if (!reader.read(magic, sizeof(DUPE_INDEX_MAGIC)) ||
+	    memcmp(magic.data(), DUPE_INDEX_MAGIC, sizeof(DUPE_INDEX_MAGIC)) != 0 ||
+	    !reader.read(byte_order) || byte_order != DUPE_INDEX_BYTE_ORDER ||
+	    !reader.read(member_count) || !reader.read(match_count) ||
+	    !reader.fits(member_count, DUPE_INDEX_MEMBER_MIN))
+		{
+		return FALSE;
+		}
+
+	/* the counts are checked against the file size, a damaged one must not allocate much */
+	members.reserve(member_count);
+	for (guint32 i = 0; i < member_count; i++)
+		{
+		guint32 path_length;
+		Member member;
+		if (!reader.read(path_length) ||
+		    !reader.read(member.path, path_length) ||
+		    !reader.read(member.size) ||
+		    !reader.read(member.date))
+			{
+			return FALSE;
+			}
+
+		positions[member.path] = members.size();
+		members.push_back(std::move(member));
+		}
+
+	if (!reader.fits(match_count, DUPE_INDEX_MATCH_SIZE)) return FALSE;
+
+	matches.reserve(match_count);
+	for (guint32 i = 0; i < match_count; i++)
+		{
+		Match match;
+		if (!reader.read(match.a) || !reader.read(match.b) || !reader.read(match.rank) ||
+		    match.a >= member_count || match.b >= member_count)
+			{
+			return FALSE;
+			}
+
+		matches.push_back(match);
+		}
+
+	return TRUE;
+}
+
+gboolean DupeMatchIndex::save() const
+{
+	if (!recursive_mkdir_if_not_exists(get_duplicates_cache_dir(), 0755)) return FALSE;
+
+	g_autoptr(GString) out = g_string_sized_new(64 + (members.size() * 64) + (matches.size() * sizeof(Match)));
+
+	g_string_append_len(out, DUPE_INDEX_MAGIC, sizeof(DUPE_INDEX_MAGIC));
+	dupe_index_append(out, DUPE_INDEX_BYTE_ORDER);
+	dupe_index_append(out, static_cast<guint32>(members.size()));
+	dupe_index_append(out, static_cast<guint32>(matches.size()));
+
+	for (const Member &member : members)
+		{
+		dupe_index_append(out, static_cast<guint32>(member.path.size()));
+		g_string_append_len(out, member.path.data(), member.path.size());
+		dupe_index_append(out, member.size);
+		dupe_index_append(out, member.date);
+		}
+
+	for (const Match &match : matches)
+		{
+		dupe_index_append(out, match.a);
+		dupe_index_append(out, match.b);
+		dupe_index_append(out, match.rank);
+		}
+
+	g_autofree gchar *path = dupe_index_path(key);
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	return secure_save(pathl, out->str, out->len);
+}
+
+gint DupeMatchIndex::find(const gchar *path, gint64 size, gint64 date) const
+{
+	const auto it = positions.find(path);
+	if (it == positions.end()) return -1;
+
+	const Member &member = members[it->second];
+	if (member.size != size || member.date != date) return -1;
+
+	return it->second;
+}
+
+void DupeMatchIndex::clear()
+{
+	members.clear();
+	matches.clear();
+	positions.clear();
+}
+
+guint32 DupeMatchIndex::add_member(const gchar *path, gint64 size, gint64 date)
+{
+	const guint32 position = members.size();
+
+	members.push_back({path, size, date});
+	positions[path] = position;
+
+	return position;
+}
+
+void DupeMatchIndex::add_match(guint32 a, guint32 b, gdouble rank)
+{
+	matches.push_back({a, b, rank});
+}
+
+void DupeMatchIndex::moved(const gchar *src, const gchar *dest)
+{
+	const auto rename = [this](guint32 position, std::string path)
+	{
+		positions.erase(members[position].path);
+		members[position].path = std::move(path);
+		positions[members[position].path] = position;
+	};
+
+	const auto it = positions.find(src);
+	if (it != positions.end())
+		{
+		rename(it->second, dest);
+		return;
+		}
+
+	if (!isdir(dest)) return;
+
+	/* a folder, rename everything below it */
+	const std::string prefix = std::string(src) + G_DIR_SEPARATOR;
+	for (guint32 position = 0; position < members.size(); position++)
+		{
+		const std::string &path = members[position].path;
+		if (path.compare(0, prefix.size(), prefix) != 0) continue;
+
+		rename(position, std::string(dest) + G_DIR_SEPARATOR + path.substr(prefix.size()));
+		}
+}
+
+void DupeMatchIndex::removed(const gchar *path)
+{
+	const auto it = positions.find(path);
+	if (it == positions.end()) return;
+
+	/* never found again, dropped when the index is next written by a check */
+	members[it->second].size = -1;
+}
+
+void dupe_match_index_file_moved(const gchar *src, const gchar *dest)
+{
+	if (!src || !dest) return;
+
+	dupe_index_pending_add(src, dest);
+}
+
+void dupe_match_index_file_removed(const gchar *path)
+{
+	if (!path) return;
+
+	dupe_index_pending_add(path, nullptr);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
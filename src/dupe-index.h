@@ -0,0 +1,82 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DUPE_INDEX_H
+#define DUPE_INDEX_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glib.h>
+
+/**
+ * @brief The similarity matches found by the last duplicate check with one set of settings
+ *
+ * Each pair of members was compared when the index was written, so
+ * matches between members that did not change since need not be searched
+ * again. Only files that are not members have to be compared.
+ */
+class DupeMatchIndex
+{
+public:
+	struct Member
+	{
+		std::string path;
+		gint64 size;
+		gint64 date; /**< modification time */
+	};
+
+	struct Match
+	{
+		guint32 a; /**< position in #members */
+		guint32 b; /**< position in #members */
+		gdouble rank;
+	};
+
+	/**
+	 * @param key Names the settings that produced the matches, used as the file name
+	 */
+	explicit DupeMatchIndex(std::string key);
+
+	/** @returns The stored index, or an empty one if there is none */
+	static std::unique_ptr<DupeMatchIndex> load(const std::string &key);
+	gboolean save() const;
+
+	/** @returns Position of the member, or -1 if it is unknown or was modified */
+	gint find(const gchar *path, gint64 size, gint64 date) const;
+
+	void clear();
+	guint32 add_member(const gchar *path, gint64 size, gint64 date);
+	void add_match(guint32 a, guint32 b, gdouble rank);
+
+	/** A file or folder was moved or renamed */
+	void moved(const gchar *src, const gchar *dest);
+	/** A file was deleted, its matches are dropped */
+	void removed(const gchar *path);
+
+	const std::vector<Member> &get_members() const { return members; }
+	const std::vector<Match> &get_matches() const { return matches; }
+
+private:
+	gboolean parse(const gchar *data, gsize length);
+
+	std::string key;
+	std::vector<Member> members;
+	std::vector<Match> matches;
+	std::unordered_map<std::string, guint32> positions;
+};
+
+/**
+ * @brief Applies file moves to all stored indexes
+ *
+ * Updates are collected and written on idle, so that a large move
+ * rewrites each index only once.
+ */
+void dupe_match_index_file_moved(const gchar *src, const gchar *dest);
+void dupe_match_index_file_removed(const gchar *path);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
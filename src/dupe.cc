@@ -21,12 +21,16 @@
 
 #include "dupe.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cinttypes>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <unordered_map>
+#include <vector>
 
 #include <gdk/gdk.h>
 #include <gio/gio.h>
@@ -38,7 +42,9 @@
 #include "cellrenderericon.h"
 #include "collect.h"
 #include "compat.h"
+#include "digest.h"
 #include "dnd.h"
+#include "dupe-index.h"
 #include "filedata.h"
 #include "history-list.h"
 #include "image-load.h"
@@ -48,12 +54,12 @@
 #include "layout-util.h"
 #include "layout.h"
 #include "main-defines.h"
-#include "md5-util.h"
 #include "menu.h"
 #include "misc.h"
 #include "options.h"
 #include "pixbuf-util.h"
 #include "print.h"
+#include "similar-index.h"
 #include "similar.h"
 #include "thumb.h"
 #include "ui-file-chooser.h"
@@ -118,6 +124,8 @@ constexpr gint DUPE_DEF_HEIGHT = 400;
 
 constexpr gdouble DUPE_PROGRESS_PULSE_STEP = 0.0001;
 
+constexpr goffset DUPE_PARTIAL_SIZE = 64 * 1024; /**< bytes hashed at each end of a file before the whole file */
+
 constexpr auto DUPE_WINDOW_DATA_KEY = "dupe-window";
 
 DupeMatchType param_match_mask;
@@ -125,15 +133,65 @@ GList *dupe_window_list = nullptr;	/**< list of open DupeWindow *s */
 
 } // namespace
 
+/** Used for similarity checks. Built once the similarity data of all
+ * items is available, and read by the comparison threads.
+ */
+struct DupeSimilarityIndex
+{
+	explicit DupeSimilarityIndex(GList *list);
+
+	std::vector<gsize> candidates(const ImageSimilarityTransforms &needle, gdouble min) const;
+
+	std::vector<DupeItem *> items; /**< in list order */
+	std::unordered_map<const DupeItem *, gsize> positions;
+	std::unique_ptr<ImageSimilarityIndex> index;
+	std::unique_ptr<ImageSimilarityHashIndex> hash_index; /**< replaces \a index if the perceptual hash pre-filter is enabled */
+};
+
+DupeSimilarityIndex::DupeSimilarityIndex(GList *list)
+{
+	std::vector<const ImageSimilarityData *> sims;
+
+	for (GList *work = list; work; work = work->next)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+
+		positions[di] = items.size();
+		items.push_back(di);
+		sims.push_back(di->simd.get());
+		}
+
+	if (options->duplicates_hash_prefilter)
+		{
+		hash_index = std::make_unique<ImageSimilarityHashIndex>(sims);
+		}
+	else
+		{
+		index = std::make_unique<ImageSimilarityIndex>(sims);
+		}
+}
+
+std::vector<gsize> DupeSimilarityIndex::candidates(const ImageSimilarityTransforms &needle, gdouble min) const
+{
+	if (hash_index)
+		{
+		return hash_index->candidates(needle, ImageSimilarityHashIndex::radius_for_threshold(min));
+		}
+
+	return index->candidates(needle, min);
+}
+
 /*
  * Well, after adding the 'compare two sets' option things got a little sloppy in here
  * because we have to account for two 'modes' everywhere. (be careful).
  */
 
 static void dupe_match_unlink(DupeItem *a, DupeItem *b);
+static GList *dupe_setup_point_step(DupeWindow *dw, GList *p);
 static DupeItem *dupe_match_find_parent(DupeWindow *dw, DupeItem *child);
 
-static gint dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast);
+static gint dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast, const ImageSimilarityTransforms *b_transforms = nullptr);
+static gdouble dupe_match_sim_threshold(DupeMatchType mask);
 
 static void dupe_thumb_step(DupeWindow *dw);
 static gint dupe_check_cb(gpointer data);
@@ -169,31 +227,24 @@ static void dupe_comparison_func(gpointer d1, gpointer d2)
 {
 	auto dqi = static_cast<DupeQueueItem *>(d1);
 	auto dw = static_cast<DupeWindow *>(d2);
-	DupeSearchMatch *dsm;
-	DupeItem *di;
 	GList *matches = nullptr;
-	gdouble rank = 0;
 
 	if (!dw->abort)
 		{
-		GList *work = dqi->work;
-		while (work)
+		/* The needle is compared against every item, so permute it only once */
+		std::unique_ptr<ImageSimilarityTransforms> needle_transforms;
+		if (dw->match_mask & DUPE_MATCH_SIM)
 			{
-			di = static_cast<DupeItem *>(work->data);
+			needle_transforms = std::make_unique<ImageSimilarityTransforms>(dqi->needle->simd.get());
+			}
 
-			/* forward for second set, back for simple compare */
-			if (dw->second_set)
-				{
-				work = work->next;
-				}
-			else
-				{
-				work = work->prev;
-				}
+		const auto check = [dw, dqi, &needle_transforms, &matches](DupeItem *di)
+		{
+			gdouble rank = 0;
 
-			if (dupe_match(di, dqi->needle, dqi->dw->match_mask, &rank, TRUE))
+			if (dupe_match(di, dqi->needle, dqi->dw->match_mask, &rank, TRUE, needle_transforms.get()))
 				{
-				dsm = g_new0(DupeSearchMatch, 1);
+				auto dsm = g_new0(DupeSearchMatch, 1);
 				dsm->a = di;
 				dsm->b = dqi->needle;
 				dsm->rank = rank;
@@ -201,9 +252,63 @@ static void dupe_comparison_func(gpointer d1, gpointer d2)
 				dsm->index = dqi->index;
 				}
 
-			if (dw->abort)
+			return !dw->abort;
+		};
+
+		if (dw->sim_index)
+			{
+			/* Same order as the list walk below, restricted to the candidates */
+			const DupeSimilarityIndex *sim_index = dw->sim_index;
+			const std::vector<gsize> candidates = sim_index->candidates(*needle_transforms, dupe_match_sim_threshold(dw->match_mask));
+
+			if (dw->second_set)
+				{
+				for (gsize position : candidates)
+					{
+					if (!check(sim_index->items[position])) break;
+					}
+				}
+			else
 				{
-				break;
+				const gsize needle_position = sim_index->positions.at(dqi->needle);
+
+				/* Indexed items are not queued, so the needle also checks those after it */
+				for (auto it = candidates.rbegin(); it != candidates.rend(); ++it)
+					{
+					if (*it > needle_position && !sim_index->items[*it]->indexed) continue;
+					if (!check(sim_index->items[*it])) break;
+					}
+				}
+			}
+		else
+			{
+			GList *work = dqi->work;
+			while (work)
+				{
+				auto di = static_cast<DupeItem *>(work->data);
+
+				/* forward for second set, back for simple compare */
+				if (dw->second_set)
+					{
+					work = work->next;
+					}
+				else
+					{
+					work = work->prev;
+					}
+
+				if (!check(di)) break;
+				}
+
+			if (dw->match_index)
+				{
+				/* Indexed items are not queued, so the needle also checks those after it */
+				for (work = dqi->work->next; work; work = work->next)
+					{
+					auto di = static_cast<DupeItem *>(work->data);
+
+					if (di->indexed && !check(di)) break;
+					}
 				}
 			}
 
@@ -455,9 +560,10 @@ static void dupe_item_read_cache(DupeItem *di)
 		di->dimensions_sum = (di->dimensions.width << 16) + di->dimensions.height;
 		}
 
-	if (!di->md5sum && cd.md5sum)
+	/* digests of another algorithm cannot be compared, they are replaced */
+	if (!di->checksum && cd.digest && cd.digest->type == DIGEST_DEFAULT)
 		{
-		di->md5sum = md5_digest_to_text(cd.md5sum.value());
+		di->checksum = digest_to_text(cd.digest.value());
 		}
 }
 
@@ -468,16 +574,217 @@ static void dupe_item_write_cache(DupeItem *di)
 	CacheData cd{};
 
 	if (!di->dimensions.empty()) cd.set_dimensions(di->dimensions);
-	if (di->md5sum)
+	if (di->checksum)
 		{
-		Md5Digest digest;
-		if (md5_digest_from_text(di->md5sum->c_str(), digest)) cd.set_md5sum(digest);
+		Digest digest;
+		if (digest_from_text(di->checksum->c_str(), DIGEST_DEFAULT, digest)) cd.set_digest(digest);
 		}
 	if (di->simd) cd.set_similarity(*di->simd);
 
 	cd.save(di->fd->path);
 }
 
+/*
+ * ------------------------------------------------------------------
+ * Content checksums
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * @brief Get the digest of a file, or of only its first and last #DUPE_PARTIAL_SIZE bytes
+ * @param path UTF-8 path
+ * @param ends_only Skip the middle of files larger than two #DUPE_PARTIAL_SIZE
+ * @param abort Checked between reads
+ * @returns Digest as a hexadecimal string, empty on error or abort
+ */
+static std::string dupe_checksum_from_file(const gchar *path, gboolean ends_only, const std::atomic<gboolean> *abort = nullptr)
+{
+	Digest digest;
+	if (!digest_from_file(path, DIGEST_DEFAULT, digest, ends_only ? DUPE_PARTIAL_SIZE : 0, abort)) return {};
+
+	return digest_to_text(digest);
+}
+
+/** Used for the checksum and name/content match modes.
+ *
+ * Only files which share their size with another file are read. These are
+ * first hashed at both ends, and only files whose ends also match another
+ * file are hashed in full. Each stage is run on a pool of worker threads,
+ * and step() is polled from the idle loop.
+ *
+ * Items left without a checksum cannot have the same content as any other item.
+ */
+struct DupeChecksumPipeline
+{
+	explicit DupeChecksumPipeline(DupeWindow *dw);
+	~DupeChecksumPipeline();
+
+	gboolean step();
+	gdouble progress() const;
+
+private:
+	enum Stage {
+		STAGE_NONE,
+		STAGE_CACHE,	/**< read checksums from the cache */
+		STAGE_PARTIAL,	/**< hash both ends of files */
+		STAGE_FULL,	/**< hash whole files */
+		STAGE_DONE
+	};
+
+	struct Task
+	{
+		DupeItem *di;
+		std::string partial; /**< digest of both ends of the file */
+	};
+
+	void queue(Task &task);
+	static void worker(gpointer data, gpointer user_data);
+
+	std::vector<std::vector<Task>> groups; /**< items of the same size, each with at least two */
+	Stage stage = STAGE_NONE;
+	GThreadPool *pool;
+	std::atomic<gboolean> abort{FALSE};
+	std::atomic<gint> completed{0}; /**< tasks of the current stage */
+	gint queued = 0; /**< tasks of the current stage */
+};
+
+DupeChecksumPipeline::DupeChecksumPipeline(DupeWindow *dw)
+{
+	std::unordered_map<goffset, std::vector<Task>> sizes;
+
+	for (GList *work = dw->list; work; work = dupe_setup_point_step(dw, work))
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+
+		sizes[di->fd->size].push_back({di, {}});
+		}
+
+	for (auto &size : sizes)
+		{
+		if (size.second.size() > 1) groups.push_back(std::move(size.second));
+		}
+
+	const gint threads = options->threads.duplicates > 0 ? options->threads.duplicates : get_cpu_cores();
+	pool = g_thread_pool_new(worker, this, threads, FALSE, nullptr);
+}
+
+DupeChecksumPipeline::~DupeChecksumPipeline()
+{
+	abort = TRUE;
+	g_thread_pool_free(pool, TRUE, TRUE);
+}
+
+void DupeChecksumPipeline::queue(Task &task)
+{
+	queued++;
+	g_thread_pool_push(pool, &task, nullptr);
+}
+
+void DupeChecksumPipeline::worker(gpointer data, gpointer user_data)
+{
+	auto task = static_cast<Task *>(data);
+	auto pipeline = static_cast<DupeChecksumPipeline *>(user_data);
+	DupeItem *di = task->di;
+
+	switch (pipeline->stage)
+		{
+		case STAGE_CACHE:
+			dupe_item_read_cache(di);
+			break;
+		case STAGE_PARTIAL:
+			task->partial = dupe_checksum_from_file(di->fd->path, TRUE, &pipeline->abort);
+
+			/* Both ends are the whole file */
+			if (di->fd->size <= 2 * DUPE_PARTIAL_SIZE && !task->partial.empty())
+				{
+				di->checksum = task->partial;
+				if (options->thumbnails.enable_caching) dupe_item_write_cache(di);
+				}
+			break;
+		case STAGE_FULL:
+			{
+			std::string checksum = dupe_checksum_from_file(di->fd->path, FALSE, &pipeline->abort);
+			if (pipeline->abort) break;
+
+			di->checksum = std::move(checksum);
+			if (options->thumbnails.enable_caching) dupe_item_write_cache(di);
+			}
+			break;
+		default:
+			break;
+		}
+
+	pipeline->completed++;
+}
+
+/**
+ * @brief Advances to the next stage once the workers have finished the current one
+ * @returns TRUE when all stages are complete
+ *
+ * The stage is only changed while no tasks are queued, so the workers may read it.
+ */
+gboolean DupeChecksumPipeline::step()
+{
+	while (completed == queued && stage != STAGE_DONE)
+		{
+		stage = static_cast<Stage>(stage + 1);
+		completed = 0;
+		queued = 0;
+
+		for (auto &group : groups)
+			{
+			switch (stage)
+				{
+				case STAGE_CACHE:
+					if (!options->thumbnails.enable_caching) break;
+
+					for (auto &task : group)
+						{
+						if (!task.di->checksum) queue(task);
+						}
+					break;
+				case STAGE_PARTIAL:
+					for (auto &task : group)
+						{
+						if (!task.di->checksum) queue(task);
+						}
+					break;
+				case STAGE_FULL:
+					{
+					/* A file may have the same content as any checksum already known */
+					const auto known = std::any_of(group.cbegin(), group.cend(), [](const Task &task){ return task.di->checksum.has_value(); });
+
+					std::unordered_map<std::string, gint> partials;
+					for (const auto &task : group)
+						{
+						if (!task.di->checksum && !task.partial.empty()) partials[task.partial]++;
+						}
+
+					for (auto &task : group)
+						{
+						if (task.di->checksum || task.partial.empty()) continue;
+
+						if (known || partials[task.partial] > 1) queue(task);
+						}
+					}
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+	return stage == STAGE_DONE;
+}
+
+/**
+ * @brief Fraction of the current stage completed
+ */
+gdouble DupeChecksumPipeline::progress() const
+{
+	return queued == 0 ? 0.0 : static_cast<gdouble>(completed) / queued;
+}
+
 /*
  * ------------------------------------------------------------------
  * Window list utils
@@ -1287,14 +1594,39 @@ static void dupe_match_rank(DupeWindow *dw)
  * ------------------------------------------------------------------
  */
 
-static gboolean dupe_match_md5sum(DupeItem *a, DupeItem *b)
+static gboolean dupe_match_checksum(DupeItem *a, DupeItem *b)
+{
+	if (!a->checksum) a->checksum = dupe_checksum_from_file(a->fd->path, FALSE);
+	if (!b->checksum) b->checksum = dupe_checksum_from_file(b->fd->path, FALSE);
+
+	return !a->checksum->empty()
+	    && !b->checksum->empty()
+	    && a->checksum == b->checksum;
+}
+
+/**
+ * @brief Whether both items have the same checksum
+ *
+ * Items without a checksum could not be read, or share neither their size
+ * nor their first and last bytes with any other item, so match nothing.
+ */
+static gboolean dupe_match_checksum_equal(const DupeItem *a, const DupeItem *b)
+{
+	return a->checksum && !a->checksum->empty()
+	    && b->checksum && !b->checksum->empty()
+	    && a->checksum == b->checksum;
+}
+
+/**
+ * @brief The minimum similarity, 0.0 to 1.0, of the similarity mode in \a mask
+ */
+static gdouble dupe_match_sim_threshold(DupeMatchType mask)
 {
-	if (!a->md5sum) a->md5sum = md5_text_from_file_utf8(a->fd->path);
-	if (!b->md5sum) b->md5sum = md5_text_from_file_utf8(b->fd->path);
+	if (mask & DUPE_MATCH_SIM_HIGH) return 0.95;
+	if (mask & DUPE_MATCH_SIM_MED) return 0.90;
+	if (mask & DUPE_MATCH_SIM_CUSTOM) return static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
 
-	return !a->md5sum->empty()
-	    && !b->md5sum->empty()
-	    && a->md5sum == b->md5sum;
+	return 0.85;
 }
 
 /**
@@ -1304,12 +1636,13 @@ static gboolean dupe_match_md5sum(DupeItem *a, DupeItem *b)
  * @param[in] mask
  * @param[out] rank
  * @param[in] fast
+ * @param[in] b_transforms precomputed similarity transforms of \a b, or NULL
  * @returns
  *
  * For similarity checks, compute rank - (similarity factor between a and b). \n
  * If rank < user-set sim value, returns FALSE.
  */
-static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast)
+static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast, const ImageSimilarityTransforms *b_transforms)
 {
 	*rank = 0.0;
 
@@ -1335,13 +1668,13 @@ static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble
 		{
 		if (strcmp(a->fd->collate_key_name, b->fd->collate_key_name) != 0) return FALSE;
 
-		return !dupe_match_md5sum(a, b);
+		return !dupe_match_checksum(a, b);
 		}
 	if (mask & DUPE_MATCH_NAME_CI_CONTENT)
 		{
 		if (strcmp(a->fd->collate_key_name_nocase, b->fd->collate_key_name_nocase) != 0) return FALSE;
 
-		return !dupe_match_md5sum(a, b);
+		return !dupe_match_checksum(a, b);
 		}
 	if (mask & DUPE_MATCH_SIZE)
 		{
@@ -1353,7 +1686,7 @@ static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble
 		}
 	if (mask & DUPE_MATCH_SUM)
 		{
-		if (!dupe_match_md5sum(a, b)) return FALSE;
+		if (!dupe_match_checksum(a, b)) return FALSE;
 		}
 	if (mask & DUPE_MATCH_DIM)
 		{
@@ -1364,14 +1697,13 @@ static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble
 	if (mask & DUPE_MATCH_SIM)
 		{
 		gdouble f;
-		gdouble m;
+		const gdouble m = dupe_match_sim_threshold(mask);
 
-		if (mask & DUPE_MATCH_SIM_HIGH) m = 0.95;
-		else if (mask & DUPE_MATCH_SIM_MED) m = 0.90;
-		else if (mask & DUPE_MATCH_SIM_CUSTOM) m = static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
-		else m = 0.85;
-
-		if (fast)
+		if (fast && b_transforms)
+			{
+			f = image_sim_compare_fast(a->simd.get(), *b_transforms, m);
+			}
+		else if (fast)
 			{
 			f = image_sim_compare_fast(a->simd.get(), b->simd.get(), m);
 			}
@@ -1442,7 +1774,7 @@ static DUPE_CHECK_RESULT dupe_match_check(DupeItem *di1, DupeItem *di2, gpointer
 			return DUPE_NO_MATCH;
 			}
 
-		if (di1->md5sum == di2->md5sum)
+		if (dupe_match_checksum_equal(di1, di2))
 			{
 			return DUPE_NAME_MATCH;
 			}
@@ -1454,7 +1786,7 @@ static DUPE_CHECK_RESULT dupe_match_check(DupeItem *di1, DupeItem *di2, gpointer
 			return DUPE_NO_MATCH;
 			}
 
-		if (di1->md5sum == di2->md5sum)
+		if (dupe_match_checksum_equal(di1, di2))
 			{
 			return DUPE_NAME_MATCH;
 			}
@@ -1475,7 +1807,7 @@ static DUPE_CHECK_RESULT dupe_match_check(DupeItem *di1, DupeItem *di2, gpointer
 		}
 	if (mask & DUPE_MATCH_SUM)
 		{
-		if (di1->md5sum != di2->md5sum)
+		if (!dupe_match_checksum_equal(di1, di2))
 			{
 			return DUPE_NO_MATCH;
 			}
@@ -1544,8 +1876,8 @@ static gint dupe_match_binary_search_cb(gconstpointer a, gconstpointer b)
 		}
 	if (mask & DUPE_MATCH_SUM)
 		{
-		if (di1->md5sum < di2->md5sum) return -1;
-		if (di1->md5sum > di2->md5sum) return 1;
+		if (di1->checksum < di2->checksum) return -1;
+		if (di1->checksum > di2->checksum) return 1;
 		return 0;
 		}
 	if (mask & DUPE_MATCH_DIM)
@@ -1606,13 +1938,15 @@ static gint dupe_match_sort_cb(gconstpointer a, gconstpointer b, gpointer data)
 		}
 	if (mask & DUPE_MATCH_SUM)
 		{
-		if (!di1->md5sum || di1->md5sum->empty() ||
-		    !di2->md5sum || di2->md5sum->empty())
+		/* Items without a checksum are placed first, in no particular order */
+		const gboolean valid1 = di1->checksum && !di1->checksum->empty();
+		const gboolean valid2 = di2->checksum && !di2->checksum->empty();
+		if (!valid1 || !valid2)
 			{
-			return -1;
+			return valid1 - valid2;
 			}
 
-		return di1->md5sum->compare(di2->md5sum.value());
+		return di1->checksum->compare(di2->checksum.value());
 		}
 	if (mask & DUPE_MATCH_DIM)
 		{
@@ -1960,6 +2294,15 @@ static void dupe_check_stop(DupeWindow *dw)
 	g_list_free(dw->search_matches);
 	dw->search_matches = nullptr;
 
+	delete dw->sim_index;
+	dw->sim_index = nullptr;
+
+	delete dw->match_index;
+	dw->match_index = nullptr;
+
+	delete dw->checksums;
+	dw->checksums = nullptr;
+
 	if (dw->idle_id || dw->img_loader || dw->thumb_loader)
 		{
 		g_clear_handle_id(&dw->idle_id, g_source_remove);
@@ -2056,8 +2399,10 @@ static GList *dupe_setup_point_step(DupeWindow *dw, GList *p)
  * @param list Set1 or set2
  * @returns TRUE/FALSE = not completed/completed
  *
- * Ensures that the DIs contain the MD5SUM or dimensions_sum for all items in
- * the list. One item at a time. Re-enters if not completed.
+ * Ensures that the DIs contain the checksum, where it is needed to tell
+ * them apart, or dimensions_sum for all items in the list. Checksums are
+ * read on worker threads for both sets at once, dimensions one item at
+ * a time. Re-enters if not completed.
  */
 static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
 {
@@ -2066,38 +2411,23 @@ static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
 		return (dw->setup_count == 0) ? 0.0 : static_cast<gdouble>(dw->setup_n - 1) / dw->setup_count;
 	};
 
-	if ((dw->match_mask & DUPE_MATCH_SUM) ||
-	    (dw->match_mask & DUPE_MATCH_NAME_CONTENT) ||
-	    (dw->match_mask & DUPE_MATCH_NAME_CI_CONTENT))
+	if (((dw->match_mask & DUPE_MATCH_SUM) ||
+	     (dw->match_mask & DUPE_MATCH_NAME_CONTENT) ||
+	     (dw->match_mask & DUPE_MATCH_NAME_CI_CONTENT)) &&
+	    !(dw->setup_mask & DUPE_MATCH_SUM))
 		{
-		/* MD5SUM only */
-		if (!dw->setup_point) dw->setup_point = list; // setup_point clear on 1st entry
+		/* checksum only */
+		if (!dw->checksums) dw->checksums = new DupeChecksumPipeline(dw);
 
-		while (dw->setup_point)
+		if (!dw->checksums->step())
 			{
-			auto di = static_cast<DupeItem *>(dw->setup_point->data);
-
-			dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-			dw->setup_n++;
-
-			if (!di->md5sum)
-				{
-				dupe_window_update_progress(dw, _("Reading checksums…"), setup_progress(dw), FALSE);
-
-				if (options->thumbnails.enable_caching)
-					{
-					dupe_item_read_cache(di);
-					if (di->md5sum) return TRUE;
-					}
-
-				di->md5sum = md5_text_from_file_utf8(di->fd->path);
-				if (options->thumbnails.enable_caching)
-					{
-					dupe_item_write_cache(di);
-					}
-				return TRUE;
-				}
+			dupe_window_update_progress(dw, _("Reading checksums…"), dw->checksums->progress(), FALSE);
+			return TRUE;
 			}
+
+		delete dw->checksums;
+		dw->checksums = nullptr;
+		dw->setup_mask = static_cast<DupeMatchType>(dw->setup_mask | DUPE_MATCH_SUM);
 		dupe_setup_reset(dw);
 		}
 
@@ -2146,6 +2476,121 @@ static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
  * Used only for similarity checks\n
  * Sorts search matches on order they were inserted into the pool queue
  */
+/*
+ * ------------------------------------------------------------------
+ * Stored similarity matches
+ * ------------------------------------------------------------------
+ */
+
+/* The settings that change which pairs match */
+static std::string dupe_match_index_key(DupeWindow *dw)
+{
+	g_autofree gchar *key = g_strdup_printf("similarity-%x-%d-%d%d%d",
+	                                        dw->match_mask, options->duplicates_similarity_threshold,
+	                                        options->rot_invariant_sim,
+	                                        options->alternate_similarity_algorithm.enabled,
+	                                        options->alternate_similarity_algorithm.grayscale);
+
+	return key;
+}
+
+/**
+ * @brief Reads the matches of the last check with the same settings
+ *
+ * Items that did not change since are marked as indexed and linked to
+ * their stored matches. Only the other items are compared, against all
+ * items, so adding a few files to a checked folder costs a few rows of
+ * comparisons instead of a full check.
+ */
+static void dupe_match_index_read(DupeWindow *dw)
+{
+	delete dw->match_index;
+	dw->match_index = nullptr;
+	dw->match_index_new = 0;
+
+	for (GList *work = dw->list; work; work = work->next)
+		{
+		static_cast<DupeItem *>(work->data)->indexed = FALSE;
+		}
+
+	if (!(dw->match_mask & DUPE_MATCH_SIM) || dw->second_set || !options->thumbnails.enable_caching) return;
+
+	dw->match_index = DupeMatchIndex::load(dupe_match_index_key(dw)).release();
+
+	std::vector<DupeItem *> items(dw->match_index->get_members().size(), nullptr);
+
+	for (GList *work = dw->list; work; work = work->next)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+
+		const gint position = dw->match_index->find(di->fd->path, di->fd->size, di->fd->date);
+		if (position >= 0 && !items[position])
+			{
+			items[position] = di;
+			di->indexed = TRUE;
+			}
+		else
+			{
+			dw->match_index_new++;
+			}
+		}
+
+	for (const DupeMatchIndex::Match &match : dw->match_index->get_matches())
+		{
+		DupeItem *a = items[match.a];
+		DupeItem *b = items[match.b];
+
+		if (a && b && !dupe_match_link_exists(a, b)) dupe_match_link(a, b, match.rank);
+		}
+
+	DEBUG_1("duplicates index: %d of %d items to compare", dw->match_index_new, g_list_length(dw->list));
+}
+
+/**
+ * @brief Replaces the stored matches with those of the finished check
+ *
+ * Must be called before the matches are ranked, which drops some links.
+ */
+static void dupe_match_index_write(DupeWindow *dw)
+{
+	if (!dw->match_index || dw->match_index_new == 0) return;
+
+	DupeMatchIndex *index = dw->match_index;
+	std::unordered_map<const DupeItem *, guint32> positions;
+
+	index->clear();
+
+	for (GList *work = dw->list; work; work = work->next)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+
+		positions[di] = index->add_member(di->fd->path, di->fd->size, di->fd->date);
+		}
+
+	for (GList *work = dw->list; work; work = work->next)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+		const guint32 a = positions.at(di);
+
+		for (GList *group = di->group; group; group = group->next)
+			{
+			auto dm = static_cast<DupeMatch *>(group->data);
+
+			const auto it = positions.find(dm->di);
+			if (it != positions.end() && it->second > a) index->add_match(a, it->second, dm->rank);
+			}
+		}
+
+	if (!index->save()) log_printf("Failed to save the duplicates index\n");
+
+	/* the list now matches the index */
+	dw->match_index_new = 0;
+	for (GList *work = dw->list; work; work = work->next)
+		{
+		static_cast<DupeItem *>(work->data)->indexed = TRUE;
+		}
+}
+
 static gint sort_func(gconstpointer a, gconstpointer b)
 {
 	return static_cast<const DupeSearchMatch *>(a)->index - static_cast<const DupeSearchMatch *>(b)->index;
@@ -2158,7 +2603,7 @@ static gint sort_func(gconstpointer a, gconstpointer b)
  *
  * Initiated from start, loader done and item remove
  *
- * On first entry generates di->MD5SUM, di->dimensions and sim data,
+ * On first entry generates di->checksum, di->dimensions and sim data,
  * and updates the cache.
  */
 static gboolean dupe_check_cb(gpointer data)
@@ -2187,6 +2632,12 @@ static gboolean dupe_check_cb(gpointer data)
 				return G_SOURCE_CONTINUE;
 				}
 			}
+		if ((dw->match_mask & DUPE_MATCH_SIM) && dw->match_index && dw->match_index_new == 0)
+			{
+			/* All matches are known, the similarity data is not needed */
+			dw->setup_mask = static_cast<DupeMatchType>(dw->setup_mask | DUPE_MATCH_SIM_MED);
+			}
+
 		if ((dw->match_mask & DUPE_MATCH_SIM) &&
 		    !(dw->setup_mask & DUPE_MATCH_SIM_MED) )
 			{
@@ -2214,6 +2665,7 @@ static gboolean dupe_check_cb(gpointer data)
 
 					dw->img_loader = image_loader_new(di->fd);
 					image_loader_set_buffer_size(dw->img_loader, 8);
+					image_loader_set_queue(dw->img_loader, IMAGE_LOADER_QUEUE_BACKGROUND);
 					g_signal_connect(G_OBJECT(dw->img_loader), "error", (GCallback)dupe_loader_done_cb, dw);
 					g_signal_connect(G_OBJECT(dw->img_loader), "done", (GCallback)dupe_loader_done_cb, dw);
 
@@ -2235,6 +2687,14 @@ static gboolean dupe_check_cb(gpointer data)
 			dupe_setup_reset(dw);
 			}
 
+		/* The alternate algorithm is not a distance, so it cannot be indexed */
+		if ((dw->match_mask & DUPE_MATCH_SIM) && !options->alternate_similarity_algorithm.enabled &&
+		    !(dw->match_index && dw->match_index_new == 0))
+			{
+			delete dw->sim_index;
+			dw->sim_index = new DupeSimilarityIndex(dw->second_set ? dw->second_list : dw->list);
+			}
+
 		/* End of setup not done */
 		dupe_window_update_progress(dw, _("Comparing…"), 0.0, FALSE);
 		dw->setup_done = TRUE;
@@ -2288,6 +2748,11 @@ static gboolean dupe_check_cb(gpointer data)
 			dw->search_matches = nullptr;
 			dw->search_matches_sorted = nullptr;
 			dw->setup_count = 0;
+
+			delete dw->sim_index;
+			dw->sim_index = nullptr;
+
+			dupe_match_index_write(dw);
 			}
 		else
 			{
@@ -2319,13 +2784,23 @@ static gboolean dupe_check_cb(gpointer data)
 	/* Setup done - working */
 	if (dw->match_mask & DUPE_MATCH_SIM)
 		{
-		/* This is the similarity comparison */
-		dupe_list_check_match(dw, static_cast<DupeItem *>(dw->working->data), dw->working);
-		dupe_window_update_progress(dw, _("Queuing…"), dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n) / dw->setup_count, FALSE);
-		dw->setup_n++;
-		dw->queue_count++;
+		/* Matches of indexed items with each other are already linked */
+		while (dw->working && static_cast<DupeItem *>(dw->working->data)->indexed)
+			{
+			dw->working = dw->working->prev;
+			dw->setup_n++;
+			}
 
-		dw->working = dw->working->prev; /* Is NULL when complete */
+		if (dw->working)
+			{
+			/* This is the similarity comparison */
+			dupe_list_check_match(dw, static_cast<DupeItem *>(dw->working->data), dw->working);
+			dupe_window_update_progress(dw, _("Queuing…"), dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n) / dw->setup_count, FALSE);
+			dw->setup_n++;
+			dw->queue_count++;
+
+			dw->working = dw->working->prev; /* Is NULL when complete */
+			}
 		}
 	else
 		{
@@ -2344,12 +2819,18 @@ static void dupe_check_start(DupeWindow *dw)
 {
 	dw->setup_done = FALSE;
 
+	/* The list has changed */
+	delete dw->checksums;
+	dw->checksums = nullptr;
+
 	dw->setup_count = g_list_length(dw->list);
 	if (dw->second_set) dw->setup_count += g_list_length(dw->second_list);
 
 	dw->setup_mask = DUPE_MATCH_NONE;
 	dupe_setup_reset(dw);
 
+	dupe_match_index_read(dw);
+
 	dw->working = g_list_last(dw->list);
 
 	dupe_window_update_count(dw, TRUE);
@@ -2390,6 +2871,12 @@ static void dupe_item_remove(DupeWindow *dw, DupeItem *di)
 		{
 		dupe_thumb_step(dw);
 		}
+	if (dw->checksums)
+		{
+		/* restarted with the remaining items on the next idle */
+		delete dw->checksums;
+		dw->checksums = nullptr;
+		}
 	if (dw->setup_point && dw->setup_point->data == di)
 		{
 		dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
@@ -2864,7 +3351,7 @@ static void dupe_display_stats(DupeWindow *dw, DupeItem *di)
 	g_autofree gchar *dimensions_buf = g_strdup_printf("%d x %d", di->dimensions.width, di->dimensions.height);
 	dupe_display_label(gd->vbox, "dimensions:", dimensions_buf);
 
-	dupe_display_label(gd->vbox, "md5sum:", di->md5sum.value_or("not generated"s).c_str());
+	dupe_display_label(gd->vbox, "checksum:", di->checksum.value_or("not generated"s).c_str());
 
 	dupe_display_label(gd->vbox, "thumbprint:", (di->simd) ? "" : "not generated");
 	if (di->simd)
@@ -35,6 +35,9 @@
 
 struct CollectInfo;
 struct CollectionData;
+class DupeMatchIndex;
+struct DupeChecksumPipeline;
+struct DupeSimilarityIndex;
 class FileData;
 struct ImageLoader;
 struct ImageSimilarityData;
@@ -50,7 +53,7 @@ enum DupeMatchType
 	DUPE_MATCH_SIZE = 1 << 1,
 	DUPE_MATCH_DATE = 1 << 2,
 	DUPE_MATCH_DIM  = 1 << 3,	/**< image dimensions */
-	DUPE_MATCH_SUM  = 1 << 4,	/**< MD5sum */
+	DUPE_MATCH_SUM  = 1 << 4,	/**< content checksum */
 	DUPE_MATCH_PATH = 1 << 5,
 	DUPE_MATCH_SIM_HIGH = 1 << 6,	/**< similarity */
 	DUPE_MATCH_SIM_MED  = 1 << 7,
@@ -77,7 +80,7 @@ struct DupeItem
 
 	FileData *fd;
 
-	std::optional<std::string> md5sum;
+	std::optional<std::string> checksum; /**< hexadecimal #DIGEST_DEFAULT of the contents */
 	GqSize dimensions;
 	gint dimensions_sum; /**< Computed as (#DupeItem->dimensions.width << 16) + #DupeItem->dimensions.height */
 
@@ -89,6 +92,8 @@ struct DupeItem
 	gdouble group_rank;	/**< (sum of all child ranks) / n */
 
 	gint second;
+
+	gboolean indexed; /**< its similarity matches with other indexed items were read from the #DupeMatchIndex */
 };
 
 struct DupeMatch
@@ -160,6 +165,10 @@ struct DupeWindow
 	gint thread_count; /**< Incremented each time a similarity check thread item is completed */
 	GMutex thread_count_mutex;
 	gboolean abort; /**< Stop the similarity check thread queue */
+	DupeSimilarityIndex *sim_index; /**< Candidates for similarity checks, NULL to compare against every item */
+	DupeChecksumPipeline *checksums; /**< Checksums being read for the content checks, NULL when idle */
+	DupeMatchIndex *match_index; /**< Stored similarity matches, NULL unless one set is checked for similarity */
+	gint match_index_new; /**< Items that are not in \a match_index and must be compared */
 };
 
 
@@ -232,10 +232,19 @@ static gboolean histmap_idle_cb(gpointer data)
 
 gboolean histmap_start_idle(FileData *fd)
 {
-	if (fd->histmap || !fd->pixbuf) return FALSE;
+	return histmap_start_idle(fd, fd->pixbuf);
+}
+
+/**
+ * @brief Counts the histogram of @a fd from @a pixbuf, for images that
+ * are not loaded whole into FileData::pixbuf
+ */
+gboolean histmap_start_idle(FileData *fd, GdkPixbuf *pixbuf)
+{
+	if (fd->histmap || !pixbuf) return FALSE;
 
 	fd->histmap = histmap_new();
-	fd->histmap->pixbuf = g_object_ref(fd->pixbuf);
+	fd->histmap->pixbuf = g_object_ref(pixbuf);
 	fd->histmap->idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, histmap_idle_cb, fd, nullptr);
 
 	return TRUE;
@@ -40,6 +40,7 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
+	gboolean decodes_whole_buffer() override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
 	gchar **get_format_mime_types() override;
@@ -74,6 +75,11 @@ gboolean ImageLoaderExternal::write(const guchar *, gsize &chunk_size, gsize cou
 	return TRUE;
 }
 
+gboolean ImageLoaderExternal::decodes_whole_buffer()
+{
+	return TRUE;
+}
+
 void ImageLoaderExternal::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
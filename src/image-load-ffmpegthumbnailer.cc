@@ -45,6 +45,7 @@ public:
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
+	gboolean decodes_whole_buffer() override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
 	gchar **get_format_mime_types() override;
@@ -167,6 +168,11 @@ gboolean ImageLoaderFT::write(const guchar *, gsize &chunk_size, gsize count, GE
 	return TRUE;
 }
 
+gboolean ImageLoaderFT::decodes_whole_buffer()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderFT::get_pixbuf()
 {
 	return pixbuf;
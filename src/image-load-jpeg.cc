@@ -444,6 +444,11 @@ gboolean ImageLoaderJpeg::write(const guchar *buf, gsize &chunk_size, gsize coun
 	return TRUE;
 }
 
+gboolean ImageLoaderJpeg::decodes_whole_buffer()
+{
+	return TRUE;
+}
+
 void ImageLoaderJpeg::set_size(int width, int height)
 {
 	requested_width = width;
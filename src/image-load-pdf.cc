@@ -39,6 +39,7 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
+	gboolean decodes_whole_buffer() override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
 	gchar **get_format_mime_types() override;
@@ -114,6 +115,11 @@ gboolean ImageLoaderPDF::write(const guchar *buf, gsize &chunk_size, gsize count
 	return ret;
 }
 
+gboolean ImageLoaderPDF::decodes_whole_buffer()
+{
+	return TRUE;
+}
+
 void ImageLoaderPDF::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
@@ -76,6 +76,7 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
+	gboolean decodes_whole_buffer() override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
 	gchar **get_format_mime_types() override;
@@ -632,6 +633,11 @@ gboolean ImageLoaderPSD::write(const guchar *input_buf, gsize &chunk_size, gsize
 	return FALSE;
 }
 
+gboolean ImageLoaderPSD::decodes_whole_buffer()
+{
+	return TRUE;
+}
+
 /* ------- Geeqie ------------ */
 
 void ImageLoaderPSD::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
@@ -27,9 +27,15 @@
 
 #include "image-load-tiff.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
@@ -51,6 +57,7 @@ public:
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
+	gboolean decodes_whole_buffer() override;
 	GdkPixbuf *get_pixbuf() override;
 	void abort() override;
 	gchar *get_format_name() override;
@@ -187,6 +194,210 @@ private:
 	TIFFErrorHandler error_handler;
 };
 
+/** Pages with fewer pixels are decoded on the loader thread alone */
+constexpr gint64 TIFF_PARALLEL_MIN_PIXELS = 512 * 1024;
+constexpr gint TIFF_PARALLEL_THREADS_MAX = 8;
+
+TIFF *tiff_load_open(GqTiffContext *context)
+{
+	return TIFFClientOpen("libtiff-geeqie", "r", context,
+	                      tiff_load_read, tiff_load_write,
+	                      tiff_load_seek, tiff_load_close,
+	                      tiff_load_size,
+	                      tiff_load_map_file, tiff_load_unmap_file);
+}
+
+/**
+ * @brief Decodes the bands of a TIFF page on several threads
+ *
+ * A band is one strip of a striped page or one row of tiles of a tiled
+ * page. Every thread opens its own TIFF handle on the buffer, takes the
+ * next band not yet taken and writes it straight into the pixel rows.
+ * Strips are left in the byte order of TIFFReadRGBAStrip(), like the
+ * sequential decode does.
+ */
+class TiffParallelDecode
+{
+public:
+	TiffParallelDecode(const guchar *buffer, gsize size, gint page_num, gboolean tiled,
+	                   gint band_width, gint band_height, guchar *pixels, gint width, gint height,
+	                   ImageLoaderBackend::AreaUpdatedCb area_updated_cb, gpointer data, const gboolean &aborted);
+
+	gboolean run(gint threads);
+
+private:
+	static gpointer thread_func(gpointer data);
+	void decode();
+	gboolean read_strip(TIFF *tiff, gint y, gint rows, std::vector<guint32> &work);
+	gboolean read_tiles(TIFF *tiff, gint y, gint rows, std::vector<guint32> &work);
+
+	const guchar *buffer;
+	gsize size;
+	gint page_num;
+	gboolean tiled;
+	gint band_width; /**< tile width, or the image width */
+	gint band_height;
+	gint bands;
+
+	guchar *pixels;
+	gint width;
+	gint height;
+	gint rowstride;
+
+	ImageLoaderBackend::AreaUpdatedCb area_updated_cb;
+	gpointer data;
+	const gboolean &aborted;
+
+	std::atomic<gint> next_band{0};
+	std::atomic<gboolean> failed{FALSE};
+};
+
+TiffParallelDecode::TiffParallelDecode(const guchar *buffer, gsize size, gint page_num, gboolean tiled,
+                                       gint band_width, gint band_height, guchar *pixels, gint width, gint height,
+                                       ImageLoaderBackend::AreaUpdatedCb area_updated_cb, gpointer data, const gboolean &aborted)
+	: buffer(buffer)
+	, size(size)
+	, page_num(page_num)
+	, tiled(tiled)
+	, band_width(band_width)
+	, band_height(band_height)
+	, bands((height + band_height - 1) / band_height)
+	, pixels(pixels)
+	, width(width)
+	, height(height)
+	, rowstride(width * 4)
+	, area_updated_cb(area_updated_cb)
+	, data(data)
+	, aborted(aborted)
+{
+}
+
+/**
+ * @returns FALSE if a band could not be decoded, the bands after it may
+ * be decoded or not
+ */
+gboolean TiffParallelDecode::run(gint threads)
+{
+	std::vector<GThread *> workers;
+
+	threads = std::min(threads, bands);
+	for (gint i = 1; i < threads; i++)
+		{
+		workers.push_back(g_thread_new("tiff decode", thread_func, this));
+		}
+
+	/* the loader thread takes bands too */
+	decode();
+
+	for (GThread *worker : workers)
+		{
+		g_thread_join(worker);
+		}
+
+	return !failed;
+}
+
+gpointer TiffParallelDecode::thread_func(gpointer data)
+{
+	static_cast<TiffParallelDecode *>(data)->decode();
+	return nullptr;
+}
+
+void TiffParallelDecode::decode()
+{
+	GqTiffContext context{buffer, size, 0};
+	TIFF *tiff = tiff_load_open(&context);
+
+	if (!tiff || !TIFFSetDirectory(tiff, page_num))
+		{
+		if (tiff) TIFFClose(tiff);
+		failed = TRUE;
+		return;
+		}
+
+	std::vector<guint32> work(static_cast<gsize>(band_width) * (tiled ? band_height : 1));
+
+	while (!failed && !aborted)
+		{
+		const gint band = next_band++;
+		if (band >= bands) break;
+
+		const gint y = band * band_height;
+		const gint rows = std::min(band_height, height - y);
+
+		if (tiled ? !read_tiles(tiff, y, rows, work) : !read_strip(tiff, y, rows, work))
+			{
+			failed = TRUE;
+			break;
+			}
+
+		area_updated_cb(nullptr, 0, y, width, rows, data);
+		}
+
+	TIFFClose(tiff);
+}
+
+gboolean TiffParallelDecode::read_strip(TIFF *tiff, gint y, gint rows, std::vector<guint32> &work)
+{
+	guchar *strip = pixels + (static_cast<gsize>(y) * rowstride);
+
+	if (!TIFFReadRGBAStrip(tiff, y, reinterpret_cast<guint32 *>(strip))) return FALSE;
+
+	/* TIFFReadRGBAStrip() chooses the lower left corner as the origin */
+	const gsize line_bytes = static_cast<gsize>(width) * sizeof(guint32);
+	for (gint row = 0; row < rows / 2; row++)
+		{
+		guchar *top_line = strip + (static_cast<gsize>(row) * rowstride);
+		guchar *bottom_line = strip + (static_cast<gsize>(rows - row - 1) * rowstride);
+
+		memcpy(work.data(), top_line, line_bytes);
+		memcpy(top_line, bottom_line, line_bytes);
+		memcpy(bottom_line, work.data(), line_bytes);
+		}
+
+	return TRUE;
+}
+
+gboolean TiffParallelDecode::read_tiles(TIFF *tiff, gint y, gint rows, std::vector<guint32> &work)
+{
+	for (gint x = 0; x < width; x += band_width)
+		{
+		if (!TIFFReadRGBATile(tiff, x, y, work.data())) return FALSE;
+
+		/* TIFFReadRGBATile() chooses the lower left corner of the whole tile as the origin */
+		const gint cols = std::min(band_width, width - x);
+		for (gint row = 0; row < rows; row++)
+			{
+			const guint32 *src = work.data() + (static_cast<gsize>(band_height - row - 1) * band_width);
+			guchar *dest = pixels + (static_cast<gsize>(y + row) * rowstride) + (x * 4);
+
+			for (gint col = 0; col < cols; col++)
+				{
+				*dest++ = TIFFGetR(*src);
+				*dest++ = TIFFGetG(*src);
+				*dest++ = TIFFGetB(*src);
+				*dest++ = TIFFGetA(*src);
+				src++;
+				}
+			}
+		}
+
+	return TRUE;
+}
+
+/**
+ * @returns The number of threads to decode a page with, 1 to decode it
+ * on the loader thread alone
+ */
+gint tiff_parallel_threads(gint width, gint height, gint band_height)
+{
+	if (static_cast<gint64>(width) * height < TIFF_PARALLEL_MIN_PIXELS) return 1;
+
+	const gint bands = (height + band_height - 1) / band_height;
+
+	return std::min({static_cast<gint>(g_get_num_processors()), TIFF_PARALLEL_THREADS_MAX, bands});
+}
+
 gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
 {
 	TIFF *tiff;
@@ -201,11 +412,7 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 	TiffLoadLogHandlers log_handlers;
 
 	GqTiffContext context{buf, count, 0};
-	tiff = TIFFClientOpen (	"libtiff-geeqie", "r", &context,
-							tiff_load_read, tiff_load_write,
-							tiff_load_seek, tiff_load_close,
-							tiff_load_size,
-							tiff_load_map_file, tiff_load_unmap_file);
+	tiff = tiff_load_open(&context);
 	if (!tiff)
 		{
 		DEBUG_1("Failed to open TIFF image");
@@ -286,7 +493,35 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 		return FALSE;
 		}
 
-	if (TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &rowsperstrip))
+	guint32 band_width = width;
+	guint32 band_height = 0;
+	const gboolean tiled = TIFFIsTiled(tiff);
+	if (tiled)
+		{
+		TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &band_width);
+		TIFFGetField(tiff, TIFFTAG_TILELENGTH, &band_height);
+		}
+	else if (TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &band_height))
+		{
+		band_height = std::min(band_height, static_cast<guint32>(height));
+		}
+
+	const gint threads = (band_width > 0 && band_height > 0) ? tiff_parallel_threads(width, height, band_height) : 1;
+	if (threads > 1)
+		{
+		DEBUG_1("Decoding TIFF %s of %ux%u on %d threads", tiled ? "tiles" : "strips", band_width, band_height, threads);
+
+		TiffParallelDecode decode(buf, count, page_num, tiled, band_width, band_height,
+		                          pixels, width, height, area_updated_cb, data, aborted);
+
+		/* like the sequential decode, a partly decoded strip image is shown */
+		if (!decode.run(threads) && tiled)
+			{
+			TIFFClose(tiff);
+			return FALSE;
+			}
+		}
+	else if (TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &rowsperstrip))
 		{
 		/* read by strip */
 		ptrdiff_t row;
@@ -372,6 +607,11 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 	return TRUE;
 }
 
+gboolean ImageLoaderTiff::decodes_whole_buffer()
+{
+	return TRUE;
+}
+
 
 void ImageLoaderTiff::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
 {
@@ -422,6 +662,172 @@ gint ImageLoaderTiff::get_page_total()
 	return page_total;
 }
 
+
+/** Decoded tiles or strips larger than this are not worth decoding by region */
+constexpr gsize TIFF_REGION_BLOCK_MAX = 32 * 1024 * 1024;
+/** Bytes of decoded tiles or strips kept for the next requests */
+constexpr gsize TIFF_REGION_CACHE_SIZE = 128 * 1024 * 1024;
+
+/**
+ * @brief Decodes the tiles or strips of a TIFF file as regions are requested
+ *
+ * A block is one tile of a tiled file or one strip of a striped file.
+ * Decoded blocks are kept in most recently used order until they take
+ * more than #TIFF_REGION_CACHE_SIZE bytes. The TIFF handle and the blocks
+ * are shared by all requests, read_region() holds #mutex while using them.
+ */
+class ImageRegionSourceTiff : public ImageRegionSource
+{
+public:
+	ImageRegionSourceTiff(TIFF *tiff, gint width, gint height, gint block_width, gint block_height, gboolean tiled);
+	~ImageRegionSourceTiff() override;
+
+	gint get_width() override;
+	gint get_height() override;
+	gboolean read_region(gint x, gint y, GdkPixbuf *pixbuf) override;
+
+private:
+	struct Block
+	{
+		gint x;
+		gint y;
+		std::vector<guint32> pixels; /**< top row first, TIFFGetR() and friends unpack them */
+	};
+
+	const Block *get_block(gint x, gint y);
+
+	TIFF *tiff;
+	gint width;
+	gint height;
+	gint block_width;
+	gint block_height;
+	gboolean tiled;
+
+	std::list<Block> blocks;
+	std::mutex mutex;
+};
+
+ImageRegionSourceTiff::ImageRegionSourceTiff(TIFF *tiff, gint width, gint height, gint block_width, gint block_height, gboolean tiled)
+	: tiff(tiff)
+	, width(width)
+	, height(height)
+	, block_width(block_width)
+	, block_height(block_height)
+	, tiled(tiled)
+{
+}
+
+ImageRegionSourceTiff::~ImageRegionSourceTiff()
+{
+	TIFFClose(tiff);
+}
+
+gint ImageRegionSourceTiff::get_width()
+{
+	return width;
+}
+
+gint ImageRegionSourceTiff::get_height()
+{
+	return height;
+}
+
+const ImageRegionSourceTiff::Block *ImageRegionSourceTiff::get_block(gint x, gint y)
+{
+	const auto it = std::find_if(blocks.begin(), blocks.end(),
+	                             [x, y](const Block &block) { return block.x == x && block.y == y; });
+	if (it != blocks.end())
+		{
+		blocks.splice(blocks.begin(), blocks, it);
+		return &blocks.front();
+		}
+
+	TiffLoadLogHandlers log_handlers;
+
+	Block block{x, y, std::vector<guint32>(static_cast<gsize>(block_width) * block_height)};
+	gint rows;
+
+	/*
+	 * TIFFReadRGBATile() and TIFFReadRGBAStrip() choose the lower left corner
+	 * as the origin, the rows of a partial tile or strip are at its top.
+	 */
+	if (tiled)
+		{
+		if (!TIFFReadRGBATile(tiff, x, y, block.pixels.data())) return nullptr;
+		rows = block_height;
+		}
+	else
+		{
+		if (!TIFFReadRGBAStrip(tiff, y, block.pixels.data())) return nullptr;
+		rows = std::min(block_height, height - y);
+		}
+
+	for (gint row = 0; row < rows / 2; row++)
+		{
+		std::swap_ranges(block.pixels.begin() + (row * block_width),
+		                 block.pixels.begin() + ((row + 1) * block_width),
+		                 block.pixels.begin() + ((rows - row - 1) * block_width));
+		}
+
+	blocks.push_front(std::move(block));
+
+	const gsize block_size = static_cast<gsize>(block_width) * block_height * sizeof(guint32);
+	while (blocks.size() > 1 && blocks.size() * block_size > TIFF_REGION_CACHE_SIZE)
+		{
+		blocks.pop_back();
+		}
+
+	return &blocks.front();
+}
+
+gboolean ImageRegionSourceTiff::read_region(gint x, gint y, GdkPixbuf *pixbuf)
+{
+	const gint w = std::min(gdk_pixbuf_get_width(pixbuf), width - x);
+	const gint h = std::min(gdk_pixbuf_get_height(pixbuf), height - y);
+	const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+	const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+	guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+	gboolean success = FALSE;
+
+	gdk_pixbuf_fill(pixbuf, 0x000000ff);
+	if (x < 0 || y < 0 || w <= 0 || h <= 0) return FALSE;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (gint by = y - (y % block_height); by < y + h; by += block_height)
+		{
+		for (gint bx = x - (x % block_width); bx < x + w; bx += block_width)
+			{
+			const Block *block = get_block(bx, by);
+			if (!block) continue;
+
+			const gint x1 = std::max(x, bx);
+			const gint y1 = std::max(y, by);
+			const gint x2 = std::min({x + w, bx + block_width, width});
+			const gint y2 = std::min({y + h, by + block_height, height});
+
+			for (gint row = y1; row < y2; row++)
+				{
+				const guint32 *src = block->pixels.data() + (static_cast<gsize>(row - by) * block_width) + (x1 - bx);
+				guchar *dest = pixels + (static_cast<gsize>(row - y) * rowstride) + ((x1 - x) * channels);
+
+				for (gint col = x1; col < x2; col++)
+					{
+					dest[0] = TIFFGetR(*src);
+					dest[1] = TIFFGetG(*src);
+					dest[2] = TIFFGetB(*src);
+					src++;
+					dest += channels;
+					}
+				}
+
+			success = TRUE;
+			}
+		}
+
+	return success;
+}
+
 } // namespace
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_tiff()
@@ -429,4 +835,63 @@ std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_tiff()
 	return std::make_unique<ImageLoaderTiff>();
 }
 
+/**
+ * @brief Opens page @a page_num of the TIFF file at @a path to be decoded by regions
+ * @param path In the filesystem encoding
+ * @returns nullptr if the file cannot be read, or its tiles or strips are too large
+ * for decoding by region to save anything
+ */
+std::unique_ptr<ImageRegionSource> get_image_region_source_tiff(const gchar *path, gint page_num)
+{
+	TiffLoadLogHandlers log_handlers;
+
+	/* libtiff maps the file, opening it does not depend on its size */
+	TIFF *tiff = TIFFOpen(path, "r");
+	if (!tiff) return nullptr;
+
+	guint32 width;
+	guint32 height;
+	guint32 block_width;
+	guint32 block_height;
+	char message[1024];
+
+	if (!TIFFSetDirectory(tiff, page_num) ||
+	    !TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width) ||
+	    !TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height) ||
+	    width == 0 || height == 0 || width > G_MAXINT || height > G_MAXINT ||
+	    !TIFFRGBAImageOK(tiff, message))
+		{
+		TIFFClose(tiff);
+		return nullptr;
+		}
+
+	const gboolean tiled = TIFFIsTiled(tiff);
+	if (tiled)
+		{
+		if (!TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &block_width) ||
+		    !TIFFGetField(tiff, TIFFTAG_TILELENGTH, &block_height))
+			{
+			TIFFClose(tiff);
+			return nullptr;
+			}
+		}
+	else
+		{
+		/* a missing value means a single strip */
+		block_width = width;
+		if (!TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &block_height)) block_height = height;
+		block_height = std::min(block_height, height);
+		}
+
+	if (block_width == 0 || block_height == 0 ||
+	    static_cast<guint64>(block_width) * block_height * sizeof(guint32) > TIFF_REGION_BLOCK_MAX)
+		{
+		DEBUG_1("TIFF blocks of %ux%u are too large to decode by region", block_width, block_height);
+		TIFFClose(tiff);
+		return nullptr;
+		}
+
+	return std::make_unique<ImageRegionSourceTiff>(tiff, width, height, block_width, block_height, tiled);
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
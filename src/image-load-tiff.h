@@ -24,9 +24,13 @@
 
 #include <memory>
 
+#include <glib.h>
+
 struct ImageLoaderBackend;
+struct ImageRegionSource;
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_tiff();
+std::unique_ptr<ImageRegionSource> get_image_region_source_tiff(const gchar *path, gint page_num);
 
 #endif /* IMAGE_LOAD_TIFF_H */
 
@@ -22,11 +22,21 @@
 #include "image-load.h"
 
 #include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#  include <sys/sysmacros.h>
+#endif
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <deque>
+#include <set>
+#include <unordered_map>
 
 #include <config.h>
 
+#include "cache.h"
 #include "exif.h"
 #include "filedata.h"
 #include "geometry.h"
@@ -75,6 +85,7 @@
 #endif
 #include "image-load-webp.h"
 #include "image-load-zxscr.h"
+#include "image-probe.h"
 #include "jpeg-parser.h"
 #include "misc.h"
 #include "options.h"
@@ -89,6 +100,11 @@ enum {
 	IMAGE_LOADER_IDLE_READ_LOOP_COUNT_DEFAULT = 	1
 };
 
+/** Images this large are decoded by regions if they can be, whole they take 256 MiB */
+static constexpr gint64 IMAGE_REGION_SOURCE_MIN_PIXELS = 8192 * 8192;
+/** The regions ImageRegionSource::read_overview() decodes at a time are at least this large */
+static constexpr gint IMAGE_REGION_OVERVIEW_BLOCK = 512;
+
 /* image loader class */
 
 
@@ -108,6 +124,7 @@ static void image_loader_class_init_wrapper(void *data, void *user_data);
 static void image_loader_class_init(ImageLoaderClass *loader_class);
 static void image_loader_finalize(GObject *object);
 static void image_loader_stop(ImageLoader *il);
+static gboolean image_loader_scheduler_cancel(ImageLoader *il);
 
 GType image_loader_get_type()
 {
@@ -152,9 +169,13 @@ static void image_loader_init(GTypeInstance *instance, gpointer)
 	il->requested_height = 0;
 	il->actual_width = 0;
 	il->actual_height = 0;
+	il->source_width = 0;
+	il->source_height = 0;
 	il->shrunk = FALSE;
 
 	il->can_destroy = TRUE;
+	il->queue = IMAGE_LOADER_QUEUE_VISIBLE;
+	il->queued = FALSE;
 
 	il->data_mutex = g_new(GMutex, 1);
 	g_mutex_init(il->data_mutex);
@@ -542,6 +563,8 @@ static void image_loader_size_prepared_cb(gpointer, gint width, gint height, gpo
 	g_mutex_lock(il->data_mutex);
 	il->actual_width = width;
 	il->actual_height = height;
+	il->source_width = width;
+	il->source_height = height;
 	if (il->requested_width < 1 || il->requested_height < 1)
 		{
 		g_mutex_unlock(il->data_mutex);
@@ -597,11 +620,30 @@ static void image_loader_stop_loader(ImageLoader *il)
 		image_loader_sync_pixbuf(il);
 		il->backend.reset(nullptr);
 		}
+
+	/* the JPEG loader reduces by DCT scaling, which may leave the full size */
 	g_mutex_lock(il->data_mutex);
+	if (il->shrunk && il->pixbuf &&
+	    gdk_pixbuf_get_width(il->pixbuf) >= il->source_width &&
+	    gdk_pixbuf_get_height(il->pixbuf) >= il->source_height)
+		{
+		il->shrunk = FALSE;
+		}
 	il->done = TRUE;
 	g_mutex_unlock(il->data_mutex);
 }
 
+#if HAVE_TIFF
+static gboolean image_loader_is_tiff(const guchar *data, gsize size)
+{
+	return size >= 10 &&
+	       (memcmp(data, "MM\0*", 4) == 0 ||
+	        memcmp(data, "MM\0+\0\x08\0\0", 8) == 0 ||
+	        memcmp(data, "II+\0\x08\0\0\0", 8) == 0 ||
+	        memcmp(data, "II*\0", 4) == 0);
+}
+#endif
+
 static void image_loader_setup_loader(ImageLoader *il)
 {
 	gint external_preview = 1;
@@ -710,12 +752,8 @@ static void image_loader_setup_loader(ImageLoader *il)
 		else
 #endif
 #if HAVE_TIFF
-		if (il->bytes_total >= 10 &&
-		    (memcmp(il->mapped_file, "MM\0*", 4) == 0 ||
-		     memcmp(il->mapped_file, "MM\0+\0\x08\0\0", 8) == 0 ||
-		     memcmp(il->mapped_file, "II+\0\x08\0\0\0", 8) == 0 ||
-		     memcmp(il->mapped_file, "II*\0", 4) == 0))
-		     	{
+		if (image_loader_is_tiff(il->mapped_file, il->bytes_total))
+			{
 			DEBUG_1("Using custom tiff loader");
 			il->backend = get_image_loader_backend_tiff();
 			}
@@ -858,10 +896,12 @@ static gboolean image_loader_begin(ImageLoader *il)
 
 	if (il->bytes_total <= il->bytes_read) return FALSE;
 
-	gsize b = std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
-
 	image_loader_setup_loader(il);
 
+	/* no chunk loop and no progress for backends that decode in one go */
+	const gboolean whole_buffer = il->backend->decodes_whole_buffer();
+	gsize b = whole_buffer ? il->bytes_total : std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
+
 	g_assert(il->bytes_read == 0);
 	if (!il->backend->write(il->mapped_file, b, il->bytes_total, &il->error))
 		{
@@ -871,6 +911,8 @@ static gboolean image_loader_begin(ImageLoader *il)
 
 	file_data_set_page_total(il->fd, il->backend->get_page_total());
 
+	if (whole_buffer) b = il->bytes_total;
+
 	il->bytes_read += b;
 
 	/* read until size is known */
@@ -1016,7 +1058,14 @@ static void image_loader_stop(ImageLoader *il)
 
 	g_clear_handle_id(&il->idle_id, g_source_remove);
 
-	if (il->thread)
+	if (il->thread && image_loader_scheduler_cancel(il))
+		{
+		/* never started */
+		g_mutex_lock(il->data_mutex);
+		il->can_destroy = TRUE;
+		g_mutex_unlock(il->data_mutex);
+		}
+	else if (il->thread)
 		{
 		/* stop loader in the other thread */
 		g_mutex_lock(il->data_mutex);
@@ -1105,57 +1154,313 @@ static gboolean image_loader_start_idle(ImageLoader *il)
 /**************************************************************************************/
 /* execution via thread */
 
-static GThreadPool *image_loader_thread_pool = nullptr;
+static constexpr gint IMAGE_LOADER_WORKERS_MIN = 2;
+static constexpr gint IMAGE_LOADER_WORKERS_MAX = 16;
+static constexpr gint IMAGE_LOADER_ROTATIONAL_JOBS = 2;
 
-static GCond *image_loader_prio_cond = nullptr;
-static GMutex *image_loader_prio_mutex = nullptr;
-static gint image_loader_prio_num = 0;
+/**
+ * @brief Runs threaded loads on a bounded set of workers
+ *
+ * Waiting loads are kept in one queue per #ImageLoaderQueue and started
+ * in queue order. A load that is freed before it started is removed from
+ * its queue without ever using a worker.
+ *
+ * One worker is always left to the visible image. Files on rotational
+ * disks are limited to #IMAGE_LOADER_ROTATIONAL_JOBS loads at a time
+ * outside the visible queue, as parallel reads only add seeks there.
+ */
+struct ImageLoaderScheduler
+{
+	GMutex mutex;
+	GCond cond;
 
+	std::deque<ImageLoader *> queues[IMAGE_LOADER_QUEUE_COUNT];
 
-static void image_loader_thread_enter_high()
+	gint workers = 0;
+	gint workers_idle = 0;
+	gint workers_max = 0;
+	gint workers_default = 0; /**< one per processor core */
+	std::multiset<gint> workers_raised; /**< by bulk work that is running */
+
+	gint running_other = 0; /**< loads outside #IMAGE_LOADER_QUEUE_VISIBLE */
+	gint running_rotational = 0; /**< of #running_other, on rotational disks */
+	gint running_foreground = 0; /**< loads low priority loads wait for */
+
+	std::unordered_map<dev_t, gboolean> rotational; /**< by device */
+};
+
+static ImageLoaderScheduler *image_loader_scheduler = nullptr;
+
+static constexpr gboolean image_loader_queue_is_foreground(ImageLoaderQueue queue)
 {
-	g_mutex_lock(image_loader_prio_mutex);
-	image_loader_prio_num++;
-	g_mutex_unlock(image_loader_prio_mutex);
+	return queue == IMAGE_LOADER_QUEUE_VISIBLE || queue == IMAGE_LOADER_QUEUE_READ_AHEAD;
 }
 
-static void image_loader_thread_leave_high()
+/**
+ * @brief Whether the file is on a spinning disk, according to the kernel
+ *
+ * Called with the scheduler mutex held. Unknown devices count as not rotational.
+ */
+static gboolean image_loader_path_is_rotational(ImageLoaderScheduler *sched, const gchar *path)
 {
-	g_mutex_lock(image_loader_prio_mutex);
-	image_loader_prio_num--;
-	if (image_loader_prio_num == 0) g_cond_broadcast(image_loader_prio_cond); /* wake up all low prio threads */
-	g_mutex_unlock(image_loader_prio_mutex);
+	g_autofree gchar *pathl = path_from_utf8(path);
+	struct stat st;
+	if (stat(pathl, &st) != 0) return FALSE;
+
+	const auto it = sched->rotational.find(st.st_dev);
+	if (it != sched->rotational.end()) return it->second;
+
+	gboolean rotational = FALSE;
+#ifdef __linux__
+	const guint dev_major = major(st.st_dev);
+	const guint dev_minor = minor(st.st_dev);
+
+	/* a partition has no queue of its own, it is in the parent disk */
+	for (const gchar *format : {"/sys/dev/block/%u:%u/queue/rotational", "/sys/dev/block/%u:%u/../queue/rotational"})
+		{
+		g_autofree gchar *sys_path = g_strdup_printf(format, dev_major, dev_minor);
+		g_autofree gchar *contents = nullptr;
+		if (g_file_get_contents(sys_path, &contents, nullptr, nullptr))
+			{
+			rotational = (contents[0] == '1');
+			break;
+			}
+		}
+#endif
+
+	sched->rotational[st.st_dev] = rotational;
+
+	return rotational;
 }
 
-static void image_loader_thread_wait_high()
+/**
+ * @brief Takes the next load that may start now from the queues
+ *
+ * Called with the scheduler mutex held.
+ */
+static ImageLoader *image_loader_scheduler_pop(ImageLoaderScheduler *sched)
 {
-	g_mutex_lock(image_loader_prio_mutex);
-	while (image_loader_prio_num)
+	for (gint queue = 0; queue < IMAGE_LOADER_QUEUE_COUNT; queue++)
 		{
-		g_cond_wait(image_loader_prio_cond, image_loader_prio_mutex);
+		auto &jobs = sched->queues[queue];
+
+		for (auto it = jobs.begin(); it != jobs.end(); ++it)
+			{
+			ImageLoader *il = *it;
+
+			if (queue != IMAGE_LOADER_QUEUE_VISIBLE)
+				{
+				if (sched->running_other >= sched->workers_max - 1) return nullptr;
+				if (il->rotational && sched->running_rotational >= IMAGE_LOADER_ROTATIONAL_JOBS) continue;
+				}
+
+			jobs.erase(it);
+			return il;
+			}
 		}
 
-	g_mutex_unlock(image_loader_prio_mutex);
+	return nullptr;
 }
 
+static void image_loader_thread_run(ImageLoader *il);
 
-static void image_loader_thread_run(gpointer data, gpointer)
+static gpointer image_loader_worker(gpointer data)
 {
-	auto il = static_cast<ImageLoader *>(data);
-	gboolean cont;
-	gboolean err;
+	auto sched = static_cast<ImageLoaderScheduler *>(data);
+
+	g_mutex_lock(&sched->mutex);
+	while (TRUE)
+		{
+		ImageLoader *il = image_loader_scheduler_pop(sched);
+		if (!il && sched->workers > sched->workers_max)
+			{
+			/* started for bulk work that has finished */
+			sched->workers--;
+			break;
+			}
+
+		if (!il)
+			{
+			sched->workers_idle++;
+			g_cond_wait(&sched->cond, &sched->mutex);
+			sched->workers_idle--;
+			continue;
+			}
+
+		il->queued = FALSE;
+
+		const gboolean other = (il->queue != IMAGE_LOADER_QUEUE_VISIBLE);
+		const gboolean rotational = other && il->rotational;
+		if (other) sched->running_other++;
+		if (rotational) sched->running_rotational++;
+		if (image_loader_queue_is_foreground(il->queue)) sched->running_foreground++;
+		il->foreground = image_loader_queue_is_foreground(il->queue);
+		g_mutex_unlock(&sched->mutex);
+
+		image_loader_thread_run(il);
+
+		g_mutex_lock(&sched->mutex);
+		if (other) sched->running_other--;
+		if (rotational) sched->running_rotational--;
+
+		/* wake up waiting loads, and workers that were held back by the limits */
+		g_cond_broadcast(&sched->cond);
+		}
+	g_mutex_unlock(&sched->mutex);
+
+	return nullptr;
+}
+
+static ImageLoaderScheduler *image_loader_scheduler_get()
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter(&initialized))
+		{
+		auto sched = new ImageLoaderScheduler();
+		g_mutex_init(&sched->mutex);
+		g_cond_init(&sched->cond);
+		sched->workers_default = CLAMP(g_get_num_processors(), IMAGE_LOADER_WORKERS_MIN, IMAGE_LOADER_WORKERS_MAX);
+		sched->workers_max = sched->workers_default;
+
+		image_loader_scheduler = sched;
+		g_once_init_leave(&initialized, 1);
+		}
 
-	if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
+	return image_loader_scheduler;
+}
+
+static void image_loader_scheduler_push(ImageLoader *il)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler_get();
+
+	g_mutex_lock(&sched->mutex);
+
+	il->rotational = image_loader_path_is_rotational(sched, il->fd->path);
+	il->queued = TRUE;
+	sched->queues[il->queue].push_back(il);
+
+	if (sched->workers_idle == 0 && sched->workers < sched->workers_max)
 		{
-		/* low prio, wait until high prio tasks finishes */
-		image_loader_thread_wait_high();
+		sched->workers++;
+		g_thread_unref(g_thread_new("image-loader", image_loader_worker, sched));
 		}
 	else
 		{
-		/* high prio */
-		image_loader_thread_enter_high();
+		g_cond_broadcast(&sched->cond);
 		}
 
+	DEBUG_1("Image loader workers: %d, %d running", sched->workers, sched->workers - sched->workers_idle);
+
+	g_mutex_unlock(&sched->mutex);
+}
+
+static void image_loader_scheduler_update_max(ImageLoaderScheduler *sched)
+{
+	sched->workers_max = sched->workers_default;
+
+	/* one worker is left to the visible image */
+	if (!sched->workers_raised.empty())
+		{
+		sched->workers_max = std::max(sched->workers_max, *sched->workers_raised.rbegin() + 1);
+		}
+
+	/* workers above the limit leave when they are idle */
+	g_cond_broadcast(&sched->cond);
+}
+
+/**
+ * @brief Lets at least @a count loads outside the visible queue run at the same time
+ *
+ * For bulk work such as creating the cache of a whole archive, where one
+ * worker per processor core up to #IMAGE_LOADER_WORKERS_MAX is too few.
+ * Loads from rotational disks are still limited. Each call is undone by
+ * image_loader_workers_lower() with the same @a count when the work ends.
+ */
+void image_loader_workers_raise(gint count)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler_get();
+
+	g_mutex_lock(&sched->mutex);
+	sched->workers_raised.insert(count);
+	image_loader_scheduler_update_max(sched);
+	g_mutex_unlock(&sched->mutex);
+}
+
+void image_loader_workers_lower(gint count)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler_get();
+
+	g_mutex_lock(&sched->mutex);
+	auto it = sched->workers_raised.find(count);
+	if (it != sched->workers_raised.end()) sched->workers_raised.erase(it);
+	image_loader_scheduler_update_max(sched);
+	g_mutex_unlock(&sched->mutex);
+}
+
+/**
+ * @brief Removes a load that has not started yet
+ * @returns FALSE if it already runs, or has finished
+ */
+static gboolean image_loader_scheduler_cancel(ImageLoader *il)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler;
+	if (!sched) return FALSE;
+
+	g_mutex_lock(&sched->mutex);
+
+	const gboolean queued = il->queued;
+	if (queued)
+		{
+		auto &jobs = sched->queues[il->queue];
+		jobs.erase(std::remove(jobs.begin(), jobs.end(), il), jobs.end());
+		il->queued = FALSE;
+		}
+
+	g_mutex_unlock(&sched->mutex);
+
+	return queued;
+}
+
+static void image_loader_thread_leave_foreground(ImageLoader *il)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler;
+
+	g_mutex_lock(&sched->mutex);
+	if (il->foreground)
+		{
+		il->foreground = FALSE;
+		sched->running_foreground--;
+
+		/* wake up all low priority loads */
+		if (sched->running_foreground == 0) g_cond_broadcast(&sched->cond);
+		}
+	g_mutex_unlock(&sched->mutex);
+}
+
+/**
+ * @brief Pauses a low priority load while the visible image or read ahead load
+ */
+static void image_loader_thread_wait_foreground(ImageLoader *il)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler;
+
+	g_mutex_lock(&sched->mutex);
+	while (sched->running_foreground && !il->foreground)
+		{
+		g_cond_wait(&sched->cond, &sched->mutex);
+		}
+	g_mutex_unlock(&sched->mutex);
+}
+
+static void image_loader_thread_run(ImageLoader *il)
+{
+	gboolean cont;
+	gboolean err;
+
+	/* low prio, wait until high prio tasks finishes */
+	image_loader_thread_wait_foreground(il);
+
 	err = !image_loader_begin(il);
 
 	if (err)
@@ -1172,29 +1477,19 @@ static void image_loader_thread_run(gpointer data, gpointer)
 
 	while (cont && !image_loader_get_is_done(il) && !image_loader_get_stopping(il))
 		{
-		if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
-			{
-			/* low prio, wait until high prio tasks finishes */
-			image_loader_thread_wait_high();
-			}
+		image_loader_thread_wait_foreground(il);
 		cont = image_loader_continue(il);
 		}
 	image_loader_stop_loader(il);
 
-	if (il->idle_priority <= G_PRIORITY_DEFAULT_IDLE)
-		{
-		/* high prio */
-		image_loader_thread_leave_high();
-		}
+	image_loader_thread_leave_foreground(il);
 
 	g_mutex_lock(il->data_mutex);
 	il->can_destroy = TRUE;
 	g_cond_signal(il->can_destroy_cond);
 	g_mutex_unlock(il->data_mutex);
-
 }
 
-
 static gboolean image_loader_start_thread(ImageLoader *il)
 {
 	if (!il) return FALSE;
@@ -1205,19 +1500,9 @@ static gboolean image_loader_start_thread(ImageLoader *il)
 
 	if (!image_loader_setup_source(il)) return FALSE;
 
-        if (!image_loader_thread_pool)
-		{
-		image_loader_thread_pool = g_thread_pool_new(image_loader_thread_run, nullptr, -1, FALSE, nullptr);
-		if (!image_loader_prio_cond) image_loader_prio_cond = g_new(GCond, 1);
-		g_cond_init(image_loader_prio_cond);
-		if (!image_loader_prio_mutex) image_loader_prio_mutex = g_new(GMutex, 1);
-		g_mutex_init(image_loader_prio_mutex);
-		}
-
 	il->can_destroy = FALSE; /* ImageLoader can't be freed until image_loader_thread_run finishes */
 
-	g_thread_pool_push(image_loader_thread_pool, il, nullptr);
-	DEBUG_1("Thread pool num threads: %u", g_thread_pool_get_num_threads(image_loader_thread_pool));
+	image_loader_scheduler_push(il);
 
 	return TRUE;
 }
@@ -1274,7 +1559,41 @@ void image_loader_set_buffer_size(ImageLoader *il, guint count)
 }
 
 /**
- * @brief This only has effect if used before image_loader_start()
+ * @brief Sets the queue of a threaded load, default is #IMAGE_LOADER_QUEUE_VISIBLE
+ *
+ * A load that waits to start is moved to the end of the new queue, so
+ * read ahead can be promoted when its image is shown.
+ */
+void image_loader_set_queue(ImageLoader *il, ImageLoaderQueue queue)
+{
+	if (!il) return;
+
+	ImageLoaderScheduler *sched = image_loader_scheduler;
+	if (!sched || !il->thread)
+		{
+		il->queue = queue;
+		return;
+		}
+
+	g_mutex_lock(&sched->mutex);
+
+	if (il->queued && il->queue != queue)
+		{
+		auto &jobs = sched->queues[il->queue];
+		jobs.erase(std::remove(jobs.begin(), jobs.end(), il), jobs.end());
+		sched->queues[queue].push_back(il);
+		g_cond_broadcast(&sched->cond);
+		}
+
+	/* a running load keeps its place */
+	il->queue = queue;
+
+	g_mutex_unlock(&sched->mutex);
+}
+
+/**
+ * @brief Sets the priority of the signals, and of loads in the main thread
+ * This only has effect if used before image_loader_start()
  * default is G_PRIORITY_DEFAULT_IDLE
  */
 void image_loader_set_priority(ImageLoader *il, gint priority)
@@ -1341,27 +1660,207 @@ gboolean image_loader_get_shrunk(ImageLoader *il)
 
 
 /**
- *  @FIXME this can be rather slow and blocks until the size is known
+ * @brief Gets the size of an image from the similarity cache or the file header
+ * @param decode If the size is found in neither, decode the image,
+ * which can be rather slow and blocks until the size is known
+ *
+ * A size read from the file is saved to the cache.
  */
-gboolean image_load_dimensions(FileData *fd, GqSize &dimensions)
+static gboolean image_load_dimensions_find(FileData *fd, GqSize &dimensions, gboolean decode)
 {
-	ImageLoader *il = image_loader_new(fd);
+	CacheData cd{};
 
-	gboolean success = image_loader_start_idle(il);
+	if (options->thumbnails.enable_caching && cd.load(fd->path) &&
+	    cd.dimensions && cd.dimensions->width > 0 && cd.dimensions->height > 0)
+		{
+		dimensions = cd.dimensions.value();
+		return TRUE;
+		}
 
-	if (success && il->pixbuf)
+	/* The header of a raw file describes its thumbnail, and its EXIF size is
+	 * that of the sensor. Neither is the embedded preview that is decoded. */
+	gboolean success = (fd->format_class != FORMAT_CLASS_RAWIMAGE) &&
+	                   image_probe_dimensions(fd->path, dimensions);
+
+	if (!success && !decode) return FALSE;
+
+	if (!success)
 		{
-		dimensions.width = gdk_pixbuf_get_width(il->pixbuf);
-		dimensions.height = gdk_pixbuf_get_height(il->pixbuf);
+		ImageLoader *il = image_loader_new(fd);
+
+		success = image_loader_start_idle(il) && il->pixbuf;
+
+		if (success)
+			{
+			dimensions.width = gdk_pixbuf_get_width(il->pixbuf);
+			dimensions.height = gdk_pixbuf_get_height(il->pixbuf);
+			}
+
+		image_loader_free(il);
 		}
-	else
+
+	if (!success)
 		{
 		dimensions = {-1, -1};
+		return FALSE;
 		}
 
-	image_loader_free(il);
+	if (options->thumbnails.enable_caching)
+		{
+		cd.set_dimensions(dimensions);
+		cd.save(fd->path);
+		}
+
+	return TRUE;
+}
+
+/**
+ * @brief Gets the size of an image, decoding it only if it cannot be found otherwise
+ *
+ * The size is looked for in the similarity cache, then in the file header.
+ * Only if these fail is the image decoded, which can be rather slow and
+ * blocks until the size is known.
+ */
+gboolean image_load_dimensions(FileData *fd, GqSize &dimensions)
+{
+	return image_load_dimensions_find(fd, dimensions, TRUE);
+}
+
+/**
+ * @brief Gets the size of an image without decoding it
+ * @returns FALSE if neither the similarity cache nor the file header has it
+ *
+ * Quick enough for the main loop, the caller decodes the image otherwise.
+ */
+gboolean image_load_dimensions_probe(FileData *fd, GqSize &dimensions)
+{
+	return image_load_dimensions_find(fd, dimensions, FALSE);
+}
+
+/**
+ * @brief Opens an image to be decoded by regions if it is too large to decode whole
+ * @returns nullptr if the image is smaller than #IMAGE_REGION_SOURCE_MIN_PIXELS
+ * or its format or layout does not allow it, the image loader is used then
+ */
+ImageRegionSource *image_region_source_new(FileData *fd)
+{
+#if HAVE_TIFF
+	if (!fd || options->external_preview.enable) return nullptr;
+
+	g_autofree gchar *pathl = path_from_utf8(fd->path);
+	FILE *file = fopen(pathl, "rb");
+	if (!file) return nullptr;
+
+	guchar header[10];
+	const gsize size = fread(header, 1, sizeof(header), file);
+	fclose(file);
+
+	if (!image_loader_is_tiff(header, size)) return nullptr;
+
+	std::unique_ptr<ImageRegionSource> source = get_image_region_source_tiff(pathl, fd->page_num);
+	if (!source ||
+	    static_cast<gint64>(source->get_width()) * source->get_height() < IMAGE_REGION_SOURCE_MIN_PIXELS)
+		{
+		return nullptr;
+		}
+
+	DEBUG_1("Decoding by region: %s %dx%d", fd->path, source->get_width(), source->get_height());
+	return source.release();
+#else
+	return nullptr;
+#endif
+}
+
+/**
+ * @brief Decodes the whole image, reduced @a shrink times
+ * @param shrink A power of two, each pixel is the average of the @a shrink x @a shrink pixels it covers
+ * @returns nullptr if @a cancelled was set or nothing of the image could be decoded
+ *
+ * The image is decoded in rows of regions, so that the tiles or strips a
+ * source keeps are used up by one row before the next is decoded.
+ */
+GdkPixbuf *ImageRegionSource::read_overview(gint shrink, const std::atomic<bool> &cancelled)
+{
+	const gint width = get_width();
+	const gint height = get_height();
+	const gint size = std::max(IMAGE_REGION_OVERVIEW_BLOCK, shrink);
+
+	GdkPixbuf *overview = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, ((width - 1) / shrink) + 1, ((height - 1) / shrink) + 1);
+	if (!overview) return nullptr;
+
+	GdkPixbuf *region = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, size, size);
+	if (!region)
+		{
+		g_object_unref(overview);
+		return nullptr;
+		}
+
+	const gint overview_rowstride = gdk_pixbuf_get_rowstride(overview);
+	guchar *overview_pixels = gdk_pixbuf_get_pixels(overview);
+	const gint region_rowstride = gdk_pixbuf_get_rowstride(region);
+	const guchar *region_pixels = gdk_pixbuf_get_pixels(region);
+	gboolean success = FALSE;
+
+	for (gint y = 0; y < height && !cancelled; y += size)
+		{
+		for (gint x = 0; x < width && !cancelled; x += size)
+			{
+			/* a region that fails is black */
+			if (read_region(x, y, region))
+				{
+				success = TRUE;
+				}
+			else
+				{
+				gdk_pixbuf_fill(region, 0);
+				}
+
+			const gint w = std::min(size, width - x);
+			const gint h = std::min(size, height - y);
+
+			for (gint box_y = 0; box_y < h; box_y += shrink)
+				{
+				const gint box_h = std::min(shrink, h - box_y);
+				guchar *dest = overview_pixels + (static_cast<gsize>((y + box_y) / shrink) * overview_rowstride) + ((x / shrink) * 3);
+
+				for (gint box_x = 0; box_x < w; box_x += shrink)
+					{
+					const gint box_w = std::min(shrink, w - box_x);
+					const guint64 count = static_cast<guint64>(box_w) * box_h;
+					guint64 sum[3] = {0, 0, 0};
+
+					for (gint row = box_y; row < box_y + box_h; row++)
+						{
+						const guchar *src = region_pixels + (static_cast<gsize>(row) * region_rowstride) + (box_x * 3);
+
+						for (gint col = 0; col < box_w; col++)
+							{
+							sum[0] += src[0];
+							sum[1] += src[1];
+							sum[2] += src[2];
+							src += 3;
+							}
+						}
+
+					for (gint channel = 0; channel < 3; channel++)
+						{
+						dest[channel] = (sum[channel] + (count / 2)) / count;
+						}
+					dest += 3;
+					}
+				}
+			}
+		}
+
+	g_object_unref(region);
+
+	if (cancelled || !success)
+		{
+		g_object_unref(overview);
+		return nullptr;
+		}
 
-	return success;
+	return overview;
 }
 
 void free_pixels(guchar *pixels, gpointer)
@@ -22,6 +22,7 @@
 #ifndef IMAGE_LOAD_H
 #define IMAGE_LOAD_H
 
+#include <atomic>
 #include <memory>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -52,6 +53,48 @@ public:
 	virtual gchar **get_format_mime_types() = 0;
 	virtual void set_page_num(gint /*page_num*/) {};
 	virtual gint get_page_total() { return 0; };
+	/**
+	 * @brief Whether write() decodes the complete file in one call
+	 *
+	 * Such a backend is passed the whole mapped file at once, and the
+	 * file counts as read after that call whatever @a chunk_size is set
+	 * to. Other backends are fed #ImageLoader::read_buffer_size bytes at
+	 * a time.
+	 */
+	virtual gboolean decodes_whole_buffer() { return FALSE; };
+};
+
+/**
+ * @brief Decodes the parts of an image that are asked for
+ *
+ * Used instead of an #ImageLoader for images too large to decode whole,
+ * the regions are requested by the source tiles of a #PixbufRenderer.
+ */
+struct ImageRegionSource
+{
+public:
+	virtual ~ImageRegionSource() = default;
+
+	virtual gint get_width() = 0;
+	virtual gint get_height() = 0;
+	/**
+	 * @brief Fills @a pixbuf with the image region at @a x, @a y
+	 * @returns FALSE if nothing of the region could be decoded
+	 */
+	virtual gboolean read_region(gint x, gint y, GdkPixbuf *pixbuf) = 0;
+
+	GdkPixbuf *read_overview(gint shrink, const std::atomic<bool> &cancelled);
+};
+
+/**
+ * @brief The queues threaded loads wait in, served in this order
+ */
+enum ImageLoaderQueue {
+	IMAGE_LOADER_QUEUE_VISIBLE = 0, /**< the image on screen */
+	IMAGE_LOADER_QUEUE_READ_AHEAD,  /**< the image likely shown next */
+	IMAGE_LOADER_QUEUE_THUMBNAIL,
+	IMAGE_LOADER_QUEUE_BACKGROUND,  /**< cache maintenance, duplicates and search */
+	IMAGE_LOADER_QUEUE_COUNT
 };
 
 enum ImageLoaderPreview {
@@ -81,7 +124,10 @@ struct ImageLoader
 	gint actual_width;
 	gint actual_height;
 
-	gboolean shrunk;
+	gint source_width;  /**< image size before a reduction to the requested size */
+	gint source_height;
+
+	gboolean shrunk;    /**< the pixbuf is smaller than the image */
 
 	gboolean done;
 	guint idle_id; /**< event source id */
@@ -102,6 +148,11 @@ struct ImageLoader
 	GCond *can_destroy_cond;
 	gboolean thread;
 
+	ImageLoaderQueue queue;
+	gboolean queued;     /**< waiting for a worker, guarded by the scheduler */
+	gboolean rotational; /**< file is on a spinning disk */
+	gboolean foreground; /**< running, low priority loads wait for it */
+
 	guchar *mapped_file;
 	gsize read_buffer_size;
 	guint idle_read_loop_count;
@@ -132,8 +183,13 @@ void image_loader_set_buffer_size(ImageLoader *il, guint count);
 
 void image_loader_set_priority(ImageLoader *il, gint priority);
 
+void image_loader_set_queue(ImageLoader *il, ImageLoaderQueue queue);
+
 gboolean image_loader_start(ImageLoader *il);
 
+void image_loader_workers_raise(gint count);
+void image_loader_workers_lower(gint count);
+
 
 GdkPixbuf *image_loader_get_pixbuf(ImageLoader *il);
 gdouble image_loader_get_percent(ImageLoader *il);
@@ -143,6 +199,9 @@ gboolean image_loader_get_shrunk(ImageLoader *il);
 GError *image_loader_dup_error(ImageLoader *il);
 
 gboolean image_load_dimensions(FileData *fd, GqSize &dimensions);
+gboolean image_load_dimensions_probe(FileData *fd, GqSize &dimensions);
+
+ImageRegionSource *image_region_source_new(FileData *fd);
 
 void free_pixels(guchar *pixels, gpointer data);
 
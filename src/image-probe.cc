@@ -0,0 +1,415 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "image-probe.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "ui-fileops.h"
+
+using namespace std::string_view_literals;
+
+namespace
+{
+
+constexpr gsize PROBE_HEADER_SIZE = 32;
+constexpr guint PROBE_MAX_SEGMENTS = 4096; /**< JPEG segments or top level HEIF boxes before giving up */
+constexpr guint64 HEIF_MAX_META_SIZE = 1024 * 1024;
+
+constexpr guint16 TIFF_TAG_IMAGE_WIDTH = 256;
+constexpr guint16 TIFF_TAG_IMAGE_LENGTH = 257;
+constexpr guint16 TIFF_TYPE_SHORT = 3;
+constexpr guint16 TIFF_TYPE_LONG = 4;
+constexpr gsize TIFF_IFD_ENTRY_SIZE = 12;
+
+guint16 get_be16(const guchar *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+guint32 get_be32(const guchar *p)
+{
+	return (static_cast<guint32>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+guint64 get_be64(const guchar *p)
+{
+	return (static_cast<guint64>(get_be32(p)) << 32) | get_be32(p + 4);
+}
+
+guint16 get_le16(const guchar *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+guint32 get_le32(const guchar *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<guint32>(p[3]) << 24);
+}
+
+gboolean probe_read(FILE *fp, goffset offset, guchar *buffer, gsize size)
+{
+	return fseeko(fp, offset, SEEK_SET) == 0 && fread(buffer, 1, size, fp) == size;
+}
+
+gboolean probe_set(GqSize &dimensions, guint64 width, guint64 height)
+{
+	if (width == 0 || height == 0 || width > G_MAXINT || height > G_MAXINT) return FALSE;
+
+	dimensions = {static_cast<gint>(width), static_cast<gint>(height)};
+	return TRUE;
+}
+
+/* Walk the segments up to the first start of frame */
+gboolean probe_jpeg(FILE *fp, GqSize &dimensions)
+{
+	goffset offset = 2;
+	guchar buf[9];
+
+	for (guint i = 0; i < PROBE_MAX_SEGMENTS; i++)
+		{
+		if (!probe_read(fp, offset, buf, 4) || buf[0] != 0xFF) return FALSE;
+
+		const guchar marker = buf[1];
+
+		if (marker == 0xFF)
+			{
+			/* fill byte */
+			offset++;
+			continue;
+			}
+
+		/* markers without a length: TEM, RSTn, SOI */
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+			{
+			offset += 2;
+			continue;
+			}
+
+		/* EOI or SOS before any frame */
+		if (marker == 0xD9 || marker == 0xDA) return FALSE;
+
+		/* SOFn, but not DHT, JPG or DAC */
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+			{
+			if (!probe_read(fp, offset + 4, buf, 5)) return FALSE;
+
+			return probe_set(dimensions, get_be16(buf + 3), get_be16(buf + 1));
+			}
+
+		offset += 2 + get_be16(buf + 2);
+		}
+
+	return FALSE;
+}
+
+gboolean probe_png(const guchar *header, gsize size, GqSize &dimensions)
+{
+	if (size < 24 || memcmp(header + 12, "IHDR", 4) != 0) return FALSE;
+
+	return probe_set(dimensions, get_be32(header + 16), get_be32(header + 20));
+}
+
+/* Size of the first image, from the first IFD */
+gboolean probe_tiff(FILE *fp, const guchar *header, GqSize &dimensions)
+{
+	const gboolean intel = header[0] == 'I';
+	const auto get16 = [intel](const guchar *p) { return intel ? get_le16(p) : get_be16(p); };
+	const auto get32 = [intel](const guchar *p) { return intel ? get_le32(p) : get_be32(p); };
+
+	const guint32 ifd = get32(header + 4);
+
+	guchar count_buf[2];
+	if (!probe_read(fp, ifd, count_buf, sizeof(count_buf))) return FALSE;
+
+	std::vector<guchar> entries(get16(count_buf) * TIFF_IFD_ENTRY_SIZE);
+	if (!probe_read(fp, ifd + 2, entries.data(), entries.size())) return FALSE;
+
+	guint32 width = 0;
+	guint32 height = 0;
+
+	for (gsize i = 0; i < entries.size(); i += TIFF_IFD_ENTRY_SIZE)
+		{
+		const guchar *entry = entries.data() + i;
+		const guint16 type = get16(entry + 2);
+		guint32 value;
+
+		if (type == TIFF_TYPE_SHORT)
+			{
+			value = get16(entry + 8);
+			}
+		else if (type == TIFF_TYPE_LONG)
+			{
+			value = get32(entry + 8);
+			}
+		else
+			{
+			continue;
+			}
+
+		const guint16 tag = get16(entry);
+		if (tag == TIFF_TAG_IMAGE_WIDTH) width = value;
+		else if (tag == TIFF_TAG_IMAGE_LENGTH) height = value;
+		}
+
+	return probe_set(dimensions, width, height);
+}
+
+gboolean probe_webp(const guchar *header, gsize size, GqSize &dimensions)
+{
+	if (size < 30) return FALSE;
+
+	const guchar *chunk = header + 12;
+	const guchar *data = header + 20;
+
+	if (memcmp(chunk, "VP8X", 4) == 0)
+		{
+		/* canvas size minus one, 24 bits each */
+		return probe_set(dimensions, 1 + (get_le32(data + 4) & 0xFFFFFF), 1 + (get_le32(data + 6) >> 8));
+		}
+
+	if (memcmp(chunk, "VP8 ", 4) == 0)
+		{
+		if (data[3] != 0x9D || data[4] != 0x01 || data[5] != 0x2A) return FALSE;
+
+		return probe_set(dimensions, get_le16(data + 6) & 0x3FFF, get_le16(data + 8) & 0x3FFF);
+		}
+
+	if (memcmp(chunk, "VP8L", 4) == 0)
+		{
+		if (data[0] != 0x2F) return FALSE;
+
+		const guint32 bits = get_le32(data + 1);
+		return probe_set(dimensions, 1 + (bits & 0x3FFF), 1 + ((bits >> 14) & 0x3FFF));
+		}
+
+	return FALSE;
+}
+
+struct HeifBox
+{
+	const guchar *type;
+	const guchar *data;
+	gsize size;
+};
+
+/**
+ * @brief Reads the box at \a pos of the \a size bytes at \a data, and steps \a pos past it
+ */
+gboolean heif_box_next(const guchar *data, gsize size, gsize &pos, HeifBox &box)
+{
+	if (size - pos < 8) return FALSE;
+
+	guint64 box_size = get_be32(data + pos);
+	gsize header = 8;
+
+	if (box_size == 1)
+		{
+		if (size - pos < 16) return FALSE;
+		box_size = get_be64(data + pos + 8);
+		header = 16;
+		}
+	else if (box_size == 0)
+		{
+		box_size = size - pos;
+		}
+
+	if (box_size < header || box_size > size - pos) return FALSE;
+
+	box = {data + pos + 4, data + pos + header, static_cast<gsize>(box_size - header)};
+	pos += box_size;
+
+	return TRUE;
+}
+
+/**
+ * @brief Size of the primary item, after the clean aperture and rotation
+ * that the decoder applies
+ */
+gboolean heif_meta_dimensions(const guchar *meta, gsize size, GqSize &dimensions)
+{
+	std::vector<HeifBox> properties;
+	const guchar *ipma = nullptr;
+	gsize ipma_size = 0;
+	guint32 primary = 0;
+	gboolean has_primary = FALSE;
+
+	/* meta is a full box */
+	gsize pos = 4;
+	HeifBox box;
+	while (pos < size && heif_box_next(meta, size, pos, box))
+		{
+		if (memcmp(box.type, "pitm", 4) == 0 && box.size >= 4)
+			{
+			/* 16 bit item ID in version 0, else 32 bit */
+			const gboolean wide_id = box.data[0] != 0;
+			if (box.size < (wide_id ? 8U : 6U)) return FALSE;
+
+			primary = wide_id ? get_be32(box.data + 4) : get_be16(box.data + 4);
+			has_primary = TRUE;
+			}
+		else if (memcmp(box.type, "iprp", 4) == 0)
+			{
+			gsize iprp_pos = 0;
+			HeifBox child;
+			while (heif_box_next(box.data, box.size, iprp_pos, child))
+				{
+				if (memcmp(child.type, "ipco", 4) == 0)
+					{
+					gsize ipco_pos = 0;
+					HeifBox property;
+					while (heif_box_next(child.data, child.size, ipco_pos, property))
+						{
+						properties.push_back(property);
+						}
+					}
+				else if (memcmp(child.type, "ipma", 4) == 0)
+					{
+					ipma = child.data;
+					ipma_size = child.size;
+					}
+				}
+			}
+		}
+
+	if (!has_primary || !ipma || ipma_size < 8) return FALSE;
+
+	const guchar version = ipma[0];
+	const gboolean wide_index = ipma[3] & 1;
+	const gsize id_size = (version < 1) ? 2 : 4;
+	const guint32 entries = get_be32(ipma + 4);
+
+	pos = 8;
+	for (guint32 e = 0; e < entries; e++)
+		{
+		if (ipma_size - pos < id_size + 1) return FALSE;
+
+		const guint32 id = (id_size == 2) ? get_be16(ipma + pos) : get_be32(ipma + pos);
+		const guint count = ipma[pos + id_size];
+		const gsize index_size = wide_index ? 2 : 1;
+		pos += id_size + 1;
+
+		if (ipma_size - pos < count * index_size) return FALSE;
+
+		if (id != primary)
+			{
+			pos += count * index_size;
+			continue;
+			}
+
+		guint64 width = 0;
+		guint64 height = 0;
+
+		for (guint a = 0; a < count; a++, pos += index_size)
+			{
+			const guint index = wide_index ? (get_be16(ipma + pos) & 0x7FFF) : (ipma[pos] & 0x7F);
+			if (index == 0 || index > properties.size()) continue;
+
+			const HeifBox &property = properties[index - 1];
+
+			if (memcmp(property.type, "ispe", 4) == 0 && property.size >= 12)
+				{
+				width = get_be32(property.data + 4);
+				height = get_be32(property.data + 8);
+				}
+			else if (memcmp(property.type, "clap", 4) == 0 && property.size >= 16)
+				{
+				const guint32 width_d = get_be32(property.data + 4);
+				const guint32 height_d = get_be32(property.data + 12);
+				if (width_d == 0 || height_d == 0) return FALSE;
+
+				width = (get_be32(property.data) + (width_d / 2)) / width_d;
+				height = (get_be32(property.data + 8) + (height_d / 2)) / height_d;
+				}
+			else if (memcmp(property.type, "irot", 4) == 0 && property.size >= 1)
+				{
+				if (property.data[0] & 1) std::swap(width, height);
+				}
+			}
+
+		return probe_set(dimensions, width, height);
+		}
+
+	return FALSE;
+}
+
+gboolean probe_heif(FILE *fp, GqSize &dimensions)
+{
+	goffset offset = 0;
+	guchar buf[16];
+
+	for (guint i = 0; i < PROBE_MAX_SEGMENTS; i++)
+		{
+		if (!probe_read(fp, offset, buf, 8)) return FALSE;
+
+		guint64 size = get_be32(buf);
+		guint64 header = 8;
+
+		if (size == 1)
+			{
+			if (!probe_read(fp, offset + 8, buf + 8, 8)) return FALSE;
+			size = get_be64(buf + 8);
+			header = 16;
+			}
+
+		/* a box of size 0 extends to the end of the file, so cannot be followed by meta */
+		if (size < header || size > static_cast<guint64>(G_MAXINT64 - offset)) return FALSE;
+
+		if (memcmp(buf + 4, "meta", 4) == 0)
+			{
+			if (size - header > HEIF_MAX_META_SIZE) return FALSE;
+
+			std::vector<guchar> meta(size - header);
+			if (!probe_read(fp, offset + header, meta.data(), meta.size())) return FALSE;
+
+			return heif_meta_dimensions(meta.data(), meta.size(), dimensions);
+			}
+
+		offset += size;
+		}
+
+	return FALSE;
+}
+
+} // namespace
+
+gboolean image_probe_dimensions(const gchar *path, GqSize &dimensions)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+	g_autoptr(FILE) fp = fopen(pathl, "rb");
+	if (!fp) return FALSE;
+
+	guchar header[PROBE_HEADER_SIZE];
+	const gsize size = fread(header, 1, sizeof(header), fp);
+
+	const auto magic = [&header, size](gsize offset, std::string_view text)
+	{
+		return offset + text.size() <= size && memcmp(header + offset, text.data(), text.size()) == 0;
+	};
+
+	if (magic(0, "\xFF\xD8\xFF"sv)) return probe_jpeg(fp, dimensions);
+	if (magic(0, "\x89PNG\r\n\x1A\n"sv)) return probe_png(header, size, dimensions);
+	if (magic(0, "II*\0"sv) || magic(0, "MM\0*"sv)) return probe_tiff(fp, header, dimensions);
+	if (magic(0, "RIFF"sv) && magic(8, "WEBP"sv)) return probe_webp(header, size, dimensions);
+	if (magic(4, "ftyp"sv)) return probe_heif(fp, dimensions);
+
+	if (magic(0, "8BPS"sv) && size >= 22)
+		{
+		return probe_set(dimensions, get_be32(header + 18), get_be32(header + 14));
+		}
+
+	if (magic(0, "DDS "sv) && size >= 20)
+		{
+		return probe_set(dimensions, get_le32(header + 16), get_le32(header + 12));
+		}
+
+	return FALSE;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,24 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef IMAGE_PROBE_H
+#define IMAGE_PROBE_H
+
+#include <glib.h>
+
+struct GqSize;
+
+/**
+ * @brief Reads the size of an image from the file header, without decoding it
+ * @param path UTF-8 path of the image
+ * @param[out] dimensions Width and height of the image as it is decoded
+ * @returns FALSE if the format is not recognised or the header is damaged
+ *
+ * JPEG, PNG, TIFF, WebP, HEIF/AVIF, PSD and DDS are recognised from their
+ * content, not from the file extension. Only a few small reads are made.
+ */
+gboolean image_probe_dimensions(const gchar *path, GqSize &dimensions);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
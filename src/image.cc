@@ -21,8 +21,12 @@
 
 #include "image.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
+#include <list>
+#include <memory>
 
 #include <cairo.h>
 #include <glib-object.h>
@@ -34,6 +38,7 @@
 #include "filecache.h"
 #include "filedata.h"
 #include "geometry.h"
+#include "histogram.h"
 #include "history-list.h"
 #include "image-load.h"
 #include "intl.h"
@@ -56,6 +61,12 @@ namespace
 
 constexpr gdouble aspect_ratios[5] {0.0, gdouble(1.0), gdouble(4.0) / 3, gdouble(3) / 2, gdouble(16) / 9};
 
+/* images decoded by region, see image_region_begin() */
+constexpr gint IMAGE_REGION_TILE_SIZE = 512;
+constexpr gint IMAGE_REGION_TILE_CACHE = 20; /* source tiles of the renderer, and as many decoded ones */
+/* the overview is reduced by a power of two to no more pixels than this */
+constexpr gint64 IMAGE_REGION_OVERVIEW_PIXELS = 4096 * 4096;
+
 /*
  * SelectionRectangle
  */
@@ -114,12 +125,61 @@ gint rect_x1, rect_x2, rect_y1, rect_y2;
 gint rect_id = 0;
 SelectionRectangle selection_rectangle;
 
+/**
+ * @brief A tile of an ImageRegion, decoded in full resolution
+ */
+struct ImageRegionTile
+{
+	gint x;
+	gint y;
+	GdkPixbuf *pixbuf;
+};
+
+/**
+ * @brief Decodes the overview or a tile of an ImageRegion on the region worker
+ *
+ * The main thread takes the result when it is done, unless the job was
+ * dropped meanwhile.
+ */
+struct ImageRegionJob
+{
+	ImageWindow *imd;               /**< nullptr when cancelled, main thread only */
+	std::atomic<bool> cancelled{false};
+
+	std::shared_ptr<ImageRegionSource> source;
+	gboolean overview;              /**< else the tile at x, y */
+	gint x;
+	gint y;
+	gint shrink;                    /**< of the overview */
+	guint serial;                   /**< later jobs are decoded first */
+	GdkPixbuf *pixbuf = nullptr;    /**< the result, nullptr if it failed */
+};
+
+/* one worker decodes the regions of all windows, created on first use */
+GThreadPool *image_region_pool = nullptr;
+
 } // namespace
 
+/**
+ * @brief An image too large to be loaded whole, decoded by region
+ *
+ * The overview, the whole image reduced, is decoded first; the tiles in
+ * full resolution are decoded as they come into view.
+ */
+struct ImageRegion
+{
+	std::shared_ptr<ImageRegionSource> source; /**< also held by the jobs decoding from it */
+	gint shrink;                               /**< the overview is this many times smaller */
+	GdkPixbuf *overview = nullptr;
+	std::list<ImageRegionJob *> jobs;          /**< queued or running */
+	std::list<ImageRegionTile> tiles;          /**< decoded, the most recently used first */
+};
+
 static GList *image_list = nullptr;
 
 static void image_read_ahead_start(ImageWindow *imd);
 static void image_cache_set(ImageWindow *imd, FileData *fd);
+static void image_load_set_signals(ImageWindow *imd, gboolean override_old_signals);
 
 /*
  *-------------------------------------------------------------------
@@ -514,7 +574,7 @@ static bool image_get_system_screen_profile(const ImageWindow *imd, ColorManMemD
 	return true;
 }
 
-static gboolean image_post_process_color(ImageWindow *imd, gboolean run_in_bg)
+static gboolean image_post_process_color(ImageWindow *imd)
 {
 	ColorMan *cm;
 	ColorManProfileType input_type;
@@ -581,16 +641,14 @@ static gboolean image_post_process_color(ImageWindow *imd, gboolean run_in_bg)
 		input_file = nullptr;
 		}
 
-	const GdkPixbuf *pixbuf = run_in_bg ? image_get_pixbuf(imd) : nullptr;
-
 	if (profile.ptr)
 		{
-		cm = color_man_new_embedded(pixbuf, profile,
+		cm = color_man_new_embedded(profile,
 		                            screen_type, screen_file, screen_profile);
 		}
 	else
 		{
-		cm = color_man_new(pixbuf, input_type, input_file,
+		cm = color_man_new(input_type, input_file,
 		                   screen_type, screen_file, screen_profile);
 		}
 
@@ -695,6 +753,13 @@ void image_alter_orientation(ImageWindow *imd, FileData *fd_n, AlterType type)
 
 	if (imd->image_fd == fd_n && (!options->metadata.write_orientation || options->image.exif_rotate_enable))
 		{
+		/* source tiles are not turned, the image is loaded whole instead */
+		if (imd->region && orientation != EXIF_ORIENTATION_TOP_LEFT)
+			{
+			image_reload(imd);
+			return;
+			}
+
 		imd->orientation = orientation;
 		pixbuf_renderer_set_orientation(PIXBUF_RENDERER(imd->pr), orientation);
 		}
@@ -704,11 +769,13 @@ static void image_set_pixbuf_renderer_post_process_func(ImageWindow *imd)
 {
 	if (imd->cm || imd->desaturate || imd->overunderexposed)
 		{
-		const auto image_post_process_tile_color_cb = [imd](PixbufRenderer *, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
+		/* tiles are post processed on renderer threads, so take the settings by value */
+		const auto image_post_process_tile_color_cb = [cm = imd->cm, desaturate = imd->desaturate, overunderexposed = imd->overunderexposed]
+		                                              (PixbufRenderer *, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
 		{
-			if (imd->cm) imd->cm->correct_region(*pixbuf, {x, y, w, h});
-			if (imd->desaturate) pixbuf_desaturate_rect(*pixbuf, x, y, w, h);
-			if (imd->overunderexposed) pixbuf_highlight_overunderexposed(*pixbuf, x, y, w, h);
+			if (cm) cm->correct_region(*pixbuf, {x, y, w, h});
+			if (desaturate) pixbuf_desaturate_rect(*pixbuf, x, y, w, h);
+			if (overunderexposed) pixbuf_highlight_overunderexposed(*pixbuf, x, y, w, h);
 		};
 		pixbuf_renderer_set_post_process_func(PIXBUF_RENDERER(imd->pr), image_post_process_tile_color_cb, (imd->cm != nullptr) );
 		}
@@ -718,6 +785,31 @@ static void image_set_pixbuf_renderer_post_process_func(ImageWindow *imd)
 		}
 }
 
+/**
+ * @brief Frees imd->cm once the renderer no longer post processes tiles with it
+ */
+static void image_color_man_free(ImageWindow *imd)
+{
+	if (!imd->cm) return;
+
+	pixbuf_renderer_set_post_process_func(PIXBUF_RENDERER(imd->pr), nullptr, FALSE);
+	g_clear_pointer(&imd->cm, delete_cb<ColorMan>);
+	image_set_pixbuf_renderer_post_process_func(imd);
+}
+
+/**
+ * @brief Hands the color manager of @a source over to @a imd
+ */
+static void image_color_man_take(ImageWindow *imd, ImageWindow *source)
+{
+	image_color_man_free(imd);
+	if (!source->cm) return;
+
+	pixbuf_renderer_set_post_process_func(PIXBUF_RENDERER(source->pr), nullptr, FALSE);
+	std::swap(imd->cm, source->cm);
+	image_set_pixbuf_renderer_post_process_func(source);
+}
+
 void image_set_desaturate(ImageWindow *imd, gboolean desaturate)
 {
 	imd->desaturate = desaturate;
@@ -799,6 +891,7 @@ static void image_read_ahead_start(ImageWindow *imd)
 	DEBUG_1("%s read ahead started for :%s", get_exec_time(), imd->read_ahead_fd->path);
 
 	imd->read_ahead_il = image_loader_new(imd->read_ahead_fd);
+	image_loader_set_queue(imd->read_ahead_il, IMAGE_LOADER_QUEUE_READ_AHEAD);
 
 	image_loader_delay_area_ready(imd->read_ahead_il, TRUE); /* we will need the area_ready signals later */
 
@@ -884,7 +977,7 @@ static void image_load_area_ready_cb(ImageLoader *il, const GdkRectangle *area,
 	auto imd = static_cast<ImageWindow *>(data);
 	PixbufRenderer *pr = PIXBUF_RENDERER(imd->pr);
 
-	if (imd->delay_flip &&
+	if ((imd->delay_flip || imd->draft == IMAGE_DRAFT_SHOWN) &&
 	    pr->pixbuf != image_loader_get_pixbuf(il))
 		{
 		return;
@@ -895,12 +988,77 @@ static void image_load_area_ready_cb(ImageLoader *il, const GdkRectangle *area,
 	pixbuf_renderer_area_changed(pr, *area);
 }
 
+/**
+ * @brief Shows the reduced size image of il and starts to load the full size
+ *
+ * The renderer is told loading is done, so the reduced image gets its high
+ * quality pass while the full size loads; the area updates of that load are
+ * not shown until image_load_draft_replace().
+ */
+static void image_load_draft_done(ImageWindow *imd)
+{
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(imd->il);
+
+	DEBUG_1("%s image draft done", get_exec_time());
+
+	g_object_set(imd->pr, "loading", FALSE, NULL);
+
+	if (image_get_pixbuf(imd) != pixbuf)
+		{
+		image_change_pixbuf(imd, pixbuf, image_zoom_get(imd), FALSE);
+		}
+
+	image_loader_free(imd->il);
+
+	imd->draft = IMAGE_DRAFT_SHOWN;
+	imd->il = image_loader_new(imd->image_fd);
+	image_load_set_signals(imd, FALSE);
+
+	if (!image_loader_start(imd->il))
+		{
+		image_loader_free(imd->il);
+		imd->il = nullptr;
+		imd->draft = IMAGE_DRAFT_NONE;
+
+		image_state_unset(imd, IMAGE_STATE_LOADING);
+		}
+}
+
+/**
+ * @brief Replaces the reduced size image on screen by the full size of il
+ *
+ * The tiles of the reduced image stay until they are rendered again, a
+ * fixed zoom is converted to keep the size on screen.
+ */
+static void image_load_draft_replace(ImageWindow *imd)
+{
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(imd->il);
+	const gint width = gdk_pixbuf_get_width(pixbuf);
+	gdouble zoom = image_zoom_get(imd);
+
+	if (zoom != 0.0)
+		{
+		const gdouble scale = image_zoom_get_real(imd) * gdk_pixbuf_get_width(image_get_pixbuf(imd)) / width;
+
+		zoom = (scale < 1.0) ? -1.0 / scale : scale;
+		}
+
+	image_change_pixbuf(imd, pixbuf, zoom, TRUE);
+	image_area_changed(imd, 0, 0, width, gdk_pixbuf_get_height(pixbuf));
+}
+
 static void image_load_done_cb(ImageLoader *, gpointer data)
 {
 	auto imd = static_cast<ImageWindow *>(data);
 
 	DEBUG_1("%s image done", get_exec_time());
 
+	if (imd->draft == IMAGE_DRAFT_LOADING && image_loader_get_shrunk(imd->il) && image_loader_get_pixbuf(imd->il))
+		{
+		image_load_draft_done(imd);
+		return;
+		}
+
 	if (options->image.enable_read_ahead && imd->image_fd && !imd->image_fd->pixbuf && image_loader_get_pixbuf(imd->il))
 		{
 		imd->image_fd->pixbuf = g_object_ref(image_loader_get_pixbuf(imd->il));
@@ -912,12 +1070,22 @@ static void image_load_done_cb(ImageLoader *, gpointer data)
 
 	if (!image_loader_get_pixbuf(imd->il))
 		{
-		GdkPixbuf *pixbuf = pixbuf_fallback(imd->image_fd, 0, 0);
+		/* keep the reduced size image when the full size fails */
+		if (imd->draft != IMAGE_DRAFT_SHOWN)
+			{
+			GdkPixbuf *pixbuf = pixbuf_fallback(imd->image_fd, 0, 0);
 
-		image_change_pixbuf(imd, pixbuf, image_zoom_get(imd), FALSE);
-		g_object_unref(pixbuf);
+			image_change_pixbuf(imd, pixbuf, image_zoom_get(imd), FALSE);
+			g_object_unref(pixbuf);
 
-		imd->unknown = TRUE;
+			imd->unknown = TRUE;
+			}
+		}
+	else if (imd->draft == IMAGE_DRAFT_SHOWN &&
+	    image_get_pixbuf(imd) != image_loader_get_pixbuf(imd->il))
+		{
+		g_object_set(imd->pr, "complete", FALSE, NULL);
+		image_load_draft_replace(imd);
 		}
 	else if (imd->delay_flip &&
 	    image_get_pixbuf(imd) != image_loader_get_pixbuf(imd->il))
@@ -926,6 +1094,7 @@ static void image_load_done_cb(ImageLoader *, gpointer data)
 		image_change_pixbuf(imd, image_loader_get_pixbuf(imd->il), image_zoom_get(imd), FALSE);
 		}
 
+	imd->draft = IMAGE_DRAFT_NONE;
 	image_loader_free(imd->il);
 	imd->il = nullptr;
 
@@ -937,6 +1106,8 @@ static void image_load_size_prepared_cb(ImageLoader *, const GqSize *size, gpoin
 	auto imd = static_cast<ImageWindow *>(data);
 
 	DEBUG_1("image_load_size_cb: %dx%d", size->width, size->height);
+	if (imd->draft == IMAGE_DRAFT_SHOWN) return;
+
 	pixbuf_renderer_set_size_early(PIXBUF_RENDERER(imd->pr), size->width, size->height);
 }
 
@@ -996,6 +1167,7 @@ static gboolean image_read_ahead_check(ImageWindow *imd)
 		{
 		imd->il = imd->read_ahead_il;
 		imd->read_ahead_il = nullptr;
+		image_loader_set_queue(imd->il, IMAGE_LOADER_QUEUE_VISIBLE);
 
 		image_load_set_signals(imd, TRUE);
 
@@ -1027,6 +1199,316 @@ static gboolean image_read_ahead_check(ImageWindow *imd)
 	return FALSE;
 }
 
+/**
+ * @brief The orientation @a fd is shown in, set by the user or read from its metadata
+ */
+static gint image_orientation_read(FileData *fd)
+{
+	if (!fd) return EXIF_ORIENTATION_TOP_LEFT;
+	if (fd->user_orientation) return fd->user_orientation;
+	if (!options->image.exif_rotate_enable) return EXIF_ORIENTATION_TOP_LEFT;
+
+	if (fd->supports_exif_orientation())
+		{
+		fd->exif_orientation = metadata_read_int(fd, ORIENTATION_KEY, EXIF_ORIENTATION_TOP_LEFT);
+		}
+	else
+		{
+		fd->exif_orientation = EXIF_ORIENTATION_TOP_LEFT;
+		}
+
+	return fd->exif_orientation;
+}
+
+static gboolean image_region_job_done_cb(gpointer data);
+
+/**
+ * @brief Orders the region worker queue, the latest job first
+ *
+ * The tiles requested last are those in view now, older ones may have
+ * been scrolled past.
+ */
+static gint image_region_job_compare(gconstpointer a, gconstpointer b, gpointer)
+{
+	const guint serial_a = static_cast<const ImageRegionJob *>(a)->serial;
+	const guint serial_b = static_cast<const ImageRegionJob *>(b)->serial;
+
+	if (serial_a == serial_b) return 0;
+	return (serial_a < serial_b) ? 1 : -1;
+}
+
+static void image_region_job_run(gpointer data, gpointer)
+{
+	auto *job = static_cast<ImageRegionJob *>(data);
+
+	if (job->cancelled)
+		{
+		/* nothing to decode */
+		}
+	else if (job->overview)
+		{
+		job->pixbuf = job->source->read_overview(job->shrink, job->cancelled);
+		}
+	else
+		{
+		job->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, IMAGE_REGION_TILE_SIZE, IMAGE_REGION_TILE_SIZE);
+		if (job->pixbuf && !job->source->read_region(job->x, job->y, job->pixbuf)) g_clear_object(&job->pixbuf);
+		}
+
+	g_idle_add(image_region_job_done_cb, job);
+}
+
+static void image_region_job_queue(ImageWindow *imd, gboolean overview, gint x, gint y)
+{
+	static guint serial = 0;
+
+	auto *job = new ImageRegionJob;
+	job->imd = imd;
+	job->source = imd->region->source;
+	job->overview = overview;
+	job->x = x;
+	job->y = y;
+	job->shrink = imd->region->shrink;
+	job->serial = ++serial;
+
+	if (!image_region_pool)
+		{
+		image_region_pool = g_thread_pool_new(image_region_job_run, nullptr, 1, FALSE, nullptr);
+		g_thread_pool_set_sort_function(image_region_pool, image_region_job_compare, nullptr);
+		}
+
+	imd->region->jobs.push_back(job);
+	g_thread_pool_push(image_region_pool, job, nullptr);
+}
+
+/**
+ * @brief Fills @a pixbuf with the region at @a x, @a y, from the decoded tile
+ *
+ * Until the tile is decoded on the region worker it is scaled up from the
+ * overview; the renderer gets the tile again by image_area_changed() when
+ * it is done.
+ */
+static gboolean image_region_tile_request(ImageWindow *imd, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf)
+{
+	ImageRegion *region = imd->region;
+	if (!region) return FALSE;
+
+	const gint tile_x = ROUND_DOWN(x, IMAGE_REGION_TILE_SIZE);
+	const gint tile_y = ROUND_DOWN(y, IMAGE_REGION_TILE_SIZE);
+	const gint w = std::min(width, gdk_pixbuf_get_width(pixbuf));
+	const gint h = std::min(height, gdk_pixbuf_get_height(pixbuf));
+
+	const auto tile = std::find_if(region->tiles.begin(), region->tiles.end(),
+	                               [tile_x, tile_y](const ImageRegionTile &t){ return t.x == tile_x && t.y == tile_y; });
+	if (tile != region->tiles.end())
+		{
+		region->tiles.splice(region->tiles.begin(), region->tiles, tile);
+		gdk_pixbuf_copy_area(tile->pixbuf, x - tile_x, y - tile_y, w, h, pixbuf, 0, 0);
+		return TRUE;
+		}
+
+	const auto job = std::find_if(region->jobs.begin(), region->jobs.end(),
+	                              [tile_x, tile_y](const ImageRegionJob *j){ return !j->overview && j->x == tile_x && j->y == tile_y; });
+	if (job == region->jobs.end()) image_region_job_queue(imd, FALSE, tile_x, tile_y);
+
+	if (!region->overview) return FALSE;
+
+	gdk_pixbuf_scale(region->overview, pixbuf, 0, 0, w, h,
+	                 -x, -y, region->shrink, region->shrink, GDK_INTERP_BILINEAR);
+	return TRUE;
+}
+
+/**
+ * @brief Cancels decoding a tile the renderer no longer keeps, it is queued again when requested
+ */
+static void image_region_tile_dispose(ImageWindow *imd, gint x, gint y)
+{
+	if (!imd->region) return;
+
+	imd->region->jobs.remove_if([x, y](ImageRegionJob *job)
+	{
+		if (job->overview || job->x != x || job->y != y) return false;
+
+		job->imd = nullptr;
+		job->cancelled = true;
+		return true;
+	});
+}
+
+/**
+ * @brief Shows the image of #ImageWindow::region as source tiles of the renderer
+ *
+ * Zoomed out further than the overview, the renderer scales the overview
+ * like a pixbuf. The tiles are color managed by the post process function,
+ * as image_change_pixbuf() does for pixbufs; a color manager taken over
+ * from another window is kept.
+ */
+static void image_region_begin(ImageWindow *imd)
+{
+	ImageRegion *region = imd->region;
+	const auto tile_request_func = [imd](PixbufRenderer *, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf)
+	{
+		return image_region_tile_request(imd, x, y, width, height, pixbuf);
+	};
+	const auto tile_dispose_func = [imd](PixbufRenderer *, gint x, gint y, gint, gint, GdkPixbuf *)
+	{
+		image_region_tile_dispose(imd, x, y);
+	};
+
+	if (imd->color_profile_enable) image_post_process_color(imd);
+	image_set_pixbuf_renderer_post_process_func(imd);
+
+	/* not left over from the previous image, see image_region_new() */
+	imd->orientation = EXIF_ORIENTATION_TOP_LEFT;
+	PIXBUF_RENDERER(imd->pr)->orientation = EXIF_ORIENTATION_TOP_LEFT;
+
+	pixbuf_renderer_set_tiles(PIXBUF_RENDERER(imd->pr),
+	                          region->source->get_width(), region->source->get_height(),
+	                          IMAGE_REGION_TILE_SIZE, IMAGE_REGION_TILE_SIZE, IMAGE_REGION_TILE_CACHE,
+	                          tile_request_func, tile_dispose_func, region->overview, image_zoom_get(imd));
+}
+
+static void image_region_overview_done(ImageWindow *imd, GdkPixbuf *overview)
+{
+	g_object_set(imd->pr, "loading", FALSE, NULL);
+	image_state_unset(imd, IMAGE_STATE_LOADING);
+
+	if (!overview)
+		{
+		GdkPixbuf *pixbuf = pixbuf_fallback(imd->image_fd, 0, 0);
+		image_change_pixbuf(imd, pixbuf, image_zoom_get(imd), FALSE);
+		g_object_unref(pixbuf);
+
+		imd->unknown = TRUE;
+		return;
+		}
+
+	imd->region->overview = static_cast<GdkPixbuf *>(g_object_ref(overview));
+	image_region_begin(imd);
+
+	histmap_start_idle(imd->image_fd, overview);
+}
+
+static gboolean image_region_job_done_cb(gpointer data)
+{
+	auto *job = static_cast<ImageRegionJob *>(data);
+	ImageWindow *imd = job->imd;
+
+	if (imd)
+		{
+		ImageRegion *region = imd->region;
+		region->jobs.remove(job);
+
+		if (job->overview)
+			{
+			image_region_overview_done(imd, job->pixbuf);
+			}
+		else if (job->pixbuf)
+			{
+			region->tiles.push_front({job->x, job->y, static_cast<GdkPixbuf *>(g_object_ref(job->pixbuf))});
+			if (region->tiles.size() > static_cast<gsize>(IMAGE_REGION_TILE_CACHE))
+				{
+				g_object_unref(region->tiles.back().pixbuf);
+				region->tiles.pop_back();
+				}
+
+			image_area_changed(imd, job->x, job->y, IMAGE_REGION_TILE_SIZE, IMAGE_REGION_TILE_SIZE);
+			}
+		}
+
+	if (job->pixbuf) g_object_unref(job->pixbuf);
+	delete job;
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Opens @a fd to be shown by region, if it is too large to be loaded whole
+ *
+ * The overview is shrunk by the smallest power of two that keeps it within
+ * #IMAGE_REGION_OVERVIEW_PIXELS.
+ */
+static ImageRegion *image_region_new(FileData *fd)
+{
+	/* source tiles are not turned, turned images are loaded whole */
+	if (image_orientation_read(fd) != EXIF_ORIENTATION_TOP_LEFT) return nullptr;
+
+	ImageRegionSource *source = image_region_source_new(fd);
+	if (!source) return nullptr;
+
+	const gint width = source->get_width();
+	const gint height = source->get_height();
+	gint shrink = 1;
+	while (static_cast<gint64>((width - 1) / shrink + 1) * ((height - 1) / shrink + 1) > IMAGE_REGION_OVERVIEW_PIXELS)
+		{
+		shrink *= 2;
+		}
+
+	auto *region = new ImageRegion;
+	region->source.reset(source);
+	region->shrink = shrink;
+
+	return region;
+}
+
+/**
+ * @brief Drops #ImageWindow::region, its running jobs finish on their own and are dropped
+ */
+static void image_region_free(ImageWindow *imd)
+{
+	ImageRegion *region = imd->region;
+	if (!region) return;
+
+	for (ImageRegionJob *job : region->jobs)
+		{
+		job->imd = nullptr;
+		job->cancelled = true;
+		}
+
+	for (const ImageRegionTile &tile : region->tiles)
+		{
+		g_object_unref(tile.pixbuf);
+		}
+
+	if (region->overview) g_object_unref(region->overview);
+	delete region;
+	imd->region = nullptr;
+}
+
+/**
+ * @brief Decodes the overview of #ImageWindow::region on the region worker,
+ * the image is shown when it is done
+ */
+static void image_region_load(ImageWindow *imd)
+{
+	g_object_set(imd->pr, "loading", TRUE, NULL);
+	image_state_set(imd, IMAGE_STATE_LOADING);
+
+	image_region_job_queue(imd, TRUE, 0, 0);
+}
+
+/**
+ * @brief Has il decode an image shown to fit the window at a reduced size first
+ *
+ * The JPEG loader decodes at the DCT scale that still covers the window,
+ * image_load_done_cb() then loads the full size. Other loaders ignore the
+ * requested size and decode the full size at once.
+ */
+static void image_load_draft_request(ImageWindow *imd, FileData *fd)
+{
+	PixbufRenderer *pr = PIXBUF_RENDERER(imd->pr);
+
+	imd->draft = IMAGE_DRAFT_NONE;
+	if (image_zoom_get(imd) != 0.0 || fd->format_class != FORMAT_CLASS_IMAGE) return;
+
+	/* square, to cover the window in any orientation */
+	const gint size = std::max(pr->viewport_width, pr->viewport_height) * gtk_widget_get_scale_factor(imd->pr);
+	if (size < 1) return;
+
+	image_loader_set_requested_size(imd->il, size, size);
+	imd->draft = IMAGE_DRAFT_LOADING;
+}
+
 static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 {
 	DEBUG_1("%s image begin", get_exec_time());
@@ -1057,9 +1539,18 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 		pr->pixbuf = nullptr;
 		}
 
+	imd->region = image_region_new(fd);
+	if (imd->region)
+		{
+		DEBUG_1("by region: %s", imd->image_fd->path);
+		image_region_load(imd);
+		return TRUE;
+		}
+
 	g_object_set(imd->pr, "loading", TRUE, NULL);
 
 	imd->il = image_loader_new(fd);
+	image_load_draft_request(imd, fd);
 
 	image_load_set_signals(imd, FALSE);
 
@@ -1098,8 +1589,11 @@ static void image_reset(ImageWindow *imd)
 
 	image_loader_free(imd->il);
 	imd->il = nullptr;
+	imd->draft = IMAGE_DRAFT_NONE;
 
-	g_clear_pointer(&imd->cm, delete_cb<ColorMan>);
+	image_region_free(imd);
+
+	image_color_man_free(imd);
 
 	image_state_set(imd, IMAGE_STATE_NONE);
 }
@@ -1441,27 +1935,7 @@ void image_change_pixbuf(ImageWindow *imd, GdkPixbuf *pixbuf, gdouble zoom, gboo
 	   here before it is taken over by the renderer. */
 	if (pixbuf) g_object_ref(pixbuf);
 
-	imd->orientation = EXIF_ORIENTATION_TOP_LEFT;
-	if (imd->image_fd)
-		{
-		if (imd->image_fd->user_orientation)
-			{
-			imd->orientation = imd->image_fd->user_orientation;
-			}
-		else if (options->image.exif_rotate_enable)
-			{
-			if (imd->image_fd->supports_exif_orientation())
-				{
-				imd->orientation = metadata_read_int(imd->image_fd, ORIENTATION_KEY, EXIF_ORIENTATION_TOP_LEFT);
-				}
-			else
-				{
-				imd->orientation = EXIF_ORIENTATION_TOP_LEFT;
-				}
-
-			imd->image_fd->exif_orientation = imd->orientation;
-			}
-		}
+	imd->orientation = image_orientation_read(imd->image_fd);
 
 	if (pixbuf)
 		{
@@ -1495,7 +1969,7 @@ void image_change_pixbuf(ImageWindow *imd, GdkPixbuf *pixbuf, gdouble zoom, gboo
 	lw = layout_find_by_image(imd);
 	if (imd->color_profile_enable && lw && !lw->animation)
 		{
-		image_post_process_color(imd, FALSE); /** @todo error handling */
+		image_post_process_color(imd); /** @todo error handling */
 		}
 
 	image_set_pixbuf_renderer_post_process_func(imd);
@@ -1559,6 +2033,26 @@ static void image_loader_sync_data(ImageLoader *il, gpointer old_data, gpointer
 		g_signal_connect(G_OBJECT(il), "done", G_CALLBACK(image_load_done_cb), data);
 }
 
+/* the tile requests the renderer takes over still go to source, they are set up again */
+static void image_region_sync(ImageWindow *imd, ImageWindow *source)
+{
+	image_region_free(imd);
+	if (!source->region) return;
+
+	imd->region = image_region_new(imd->image_fd);
+	if (!imd->region) return;
+
+	if (source->region->overview)
+		{
+		imd->region->overview = static_cast<GdkPixbuf *>(g_object_ref(source->region->overview));
+		image_region_begin(imd);
+		}
+	else
+		{
+		image_region_load(imd);
+		}
+}
+
 /* this is more like a move function
  * it moves most data from source to imd
  */
@@ -1581,6 +2075,8 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 		{
 		imd->il = source->il;
 		source->il = nullptr;
+		imd->draft = source->draft;
+		source->draft = IMAGE_DRAFT_NONE;
 
 		image_loader_sync_data(imd->il, source, imd);
 		}
@@ -1589,11 +2085,7 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 	imd->color_profile_input = source->color_profile_input;
 	imd->color_profile_use_image = source->color_profile_use_image;
 
-	g_clear_pointer(&imd->cm, delete_cb<ColorMan>);
-	if (source->cm)
-		{
-		std::swap(imd->cm, source->cm);
-		}
+	image_color_man_take(imd, source);
 
 	file_data_unref(imd->read_ahead_fd);
 	source->read_ahead_fd = nullptr;
@@ -1604,6 +2096,7 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 	imd->user_stereo = source->user_stereo;
 
 	pixbuf_renderer_move(PIXBUF_RENDERER(imd->pr), PIXBUF_RENDERER(source->pr));
+	image_region_sync(imd, source);
 
 	image_set_pixbuf_renderer_post_process_func(imd);
 }
@@ -1630,11 +2123,7 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 	imd->color_profile_input = source->color_profile_input;
 	imd->color_profile_use_image = source->color_profile_use_image;
 
-	g_clear_pointer(&imd->cm, delete_cb<ColorMan>);
-	if (source->cm)
-		{
-		std::swap(imd->cm, source->cm);
-		}
+	image_color_man_take(imd, source);
 
 	image_loader_free(imd->read_ahead_il);
 	imd->read_ahead_il = source->read_ahead_il;
@@ -1655,6 +2144,7 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 	imd->user_stereo = source->user_stereo;
 
 	pixbuf_renderer_copy(PIXBUF_RENDERER(imd->pr), PIXBUF_RENDERER(source->pr));
+	image_region_sync(imd, source);
 
 	image_set_pixbuf_renderer_post_process_func(imd);
 }
@@ -1669,7 +2159,7 @@ void image_area_changed(ImageWindow *imd, gint x, gint y, gint width, gint heigh
 
 void image_reload(ImageWindow *imd)
 {
-	if (pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr))) return;
+	if (pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr)) && !imd->region) return;
 
 	image_change_complete(imd, image_zoom_get(imd));
 }
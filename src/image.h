@@ -40,6 +40,7 @@ class FileData;
 struct GqMouseButtonEvent;
 struct GqPointerMotionEvent;
 struct ImageLoader;
+struct ImageRegion;
 
 enum AlterType : gint {
 	ALTER_NONE,		/**< do nothing */
@@ -61,6 +62,15 @@ enum ImageState {
 	IMAGE_STATE_DELAY_FLIP	= 1 << 6
 };
 
+/**
+ * @brief Steps of showing an image decoded at a reduced size first
+ */
+enum ImageDraft {
+	IMAGE_DRAFT_NONE = 0,
+	IMAGE_DRAFT_LOADING, /**< il decodes at a reduced size */
+	IMAGE_DRAFT_SHOWN    /**< the reduced size is shown, il decodes the full size */
+};
+
 struct GqScrollEvent
 {
 	gdouble x;
@@ -85,6 +95,8 @@ struct ImageWindow
 
 	ImageLoader *il;        /**< @FIXME image loader should probably go to FileData, but it must first support
 				   sending callbacks to multiple ImageWindows in parallel */
+	ImageRegion *region;  /**< decodes the parts shown of an image too large for #il */
+	ImageDraft draft;
 
 	gint has_frame;  /**< not boolean, see image_new() */
 
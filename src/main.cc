@@ -75,6 +75,7 @@
 #include "options.h"
 #include "pixbuf-util.h"
 #include "third-party/whereami.h"
+#include "thumb-writer.h"
 #include "thumb.h"
 #include "ui-bookmark.h"
 #include "ui-fileops.h"
@@ -172,6 +173,7 @@ GOptionEntry command_line_options[] =
 	{ "grep"                      , 'g', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("filter debug output")                                                         , "<regexp>" },
 #endif
 	{ "id"                        ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("window id for following commands")                                            , "<ID>" },
+	{ "jobs"                      , 'j', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("files loaded at a time by --cache-render, 0 is one per processor core")       , "<N>" },
 	{ "last"                      ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("last image")                                                                  , nullptr },
 	{ "log-file"                  , 'o', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("save log data to file")                                                       , "<file>" },
 	{ "lua"                       ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("run lua script on FILE")                                                      , "<FILE>,<lua script>" },
@@ -196,9 +198,10 @@ GOptionEntry command_line_options[] =
 
 GOptionEntry command_line_options_cache_maintenance[] =
 {
-	{ "cache-maintenance", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("execute cache maintenance recursively on FOLDER"), "<FOLDER>" },
-	{ "quit"             , 'q', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("stop cache maintenance")                         , nullptr },
-	{ nullptr            ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, nullptr                                             , nullptr },
+	{ "cache-maintenance", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("execute cache maintenance recursively on FOLDER")    , "<FOLDER>" },
+	{ "jobs"             , 'j', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("files loaded at a time, 0 is one per processor core"), "<N>" },
+	{ "quit"             , 'q', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("stop cache maintenance")                             , nullptr },
+	{ nullptr            ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, nullptr                                                 , nullptr },
 };
 
 const gchar *get_signal_name(int signo)
@@ -404,6 +407,7 @@ void exit_program_final()
 	layout_editors_reload_finish();
 
 	collect_manager_flush();
+	thumb_writer_flush();
 
 	/* Save the named windows */
 	if (layout_window_count() > 1)
@@ -73,6 +73,7 @@ ConfOptions *conf_options_new()
 	options->dnd_default_action = DND_ACTION_ASK;
 	options->duplicates_similarity_threshold = 99;
 	options->rot_invariant_sim = TRUE;
+	options->duplicates_hash_prefilter = FALSE;
 	options->sort_totals = FALSE;
 	options->rectangle_draw_aspect_ratio = RECTANGLE_DRAW_ASPECT_RATIO_NONE;
 
@@ -147,6 +148,7 @@ ConfOptions *conf_options_new()
 	options->image.zoom_to_fit_allow_expand = FALSE;
 	options->image.zoom_style = ZOOM_GEOMETRIC;
 	options->image.tile_size = 128;
+	options->image.tile_prefetch = 2;
 
 	image_overlay_init(options->image_overlay);
 
@@ -199,13 +201,19 @@ ConfOptions *conf_options_new()
 
 	options->thumbnails.cache_into_dirs = FALSE;
 	options->thumbnails.enable_caching = TRUE;
+	options->thumbnails.sim_database = FALSE;
+	options->thumbnails.packed = FALSE;
+	options->thumbnails.packed_png = TRUE;
 	options->thumbnails.size = { DEFAULT_THUMB_WIDTH, DEFAULT_THUMB_HEIGHT };
 	options->thumbnails.quality = GDK_INTERP_TILES;
 	options->thumbnails.spec_standard = TRUE;
+	options->thumbnails.standard_size_max = 256;
 	options->thumbnails.use_exif = FALSE;
 	options->thumbnails.use_color_management = FALSE;
 	options->thumbnails.use_ft_metadata = TRUE;
 	options->thumbnails.collection_preview = 20;
+	options->thumbnails.loaders = 0;
+	options->thumbnails.png_compression = 6;
 
 	options->tree_descend_subdirs = FALSE;
 	options->view_dir_list_single_click_enter = TRUE;
@@ -117,6 +117,7 @@ struct ConfOptions
 	gboolean duplicates_thumbnails;
 	DupeSelectType duplicates_select_type;
 	gboolean rot_invariant_sim;
+	gboolean duplicates_hash_prefilter; /**< compare only images with near perceptual hashes */
 	gboolean sort_totals;
 
 	gint open_recent_list_maxsize;
@@ -231,6 +232,7 @@ struct ConfOptions
 		GdkRGBA alpha_color_2;
 
 		gint tile_size;
+		gint tile_prefetch;	/**< tiles rendered around the view, 0 disables */
 	} image;
 
 	/* thumbnails */
@@ -238,12 +240,18 @@ struct ConfOptions
 		GqSize size;
 		gboolean enable_caching;
 		gboolean cache_into_dirs;
+		gboolean sim_database; /**< keep sim cache data in one file per folder */
+		gboolean packed; /**< keep the thumbnails of a folder in one file */
+		gboolean packed_png; /**< with #packed, also write the thumbnails as PNG files */
 		gboolean spec_standard;
+		gint standard_size_max; /**< with #spec_standard, the largest size made along with the one shown */
 		GdkInterpType quality;
 		gboolean use_exif;
 		gboolean use_color_management;
 		gboolean use_ft_metadata;
 		gint collection_preview;
+		gint loaders;	/**< thumbnails generated at a time, 0 is one per processor core */
+		gint png_compression;	/**< zlib level of the thumbnail files, lower is faster and larger */
 	} thumbnails;
 
 	/* file filtering */
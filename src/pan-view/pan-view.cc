@@ -925,7 +925,7 @@ static gint pan_layout_update_idle_cb(gpointer data)
 		pixbuf_renderer_set_tiles(PIXBUF_RENDERER(pw->imd->pr), width, height,
 		                          PAN_TILE_SIZE, PAN_TILE_SIZE, 10,
 		                          tile_request_func, tile_dispose_func,
-		                          1.0);
+		                          nullptr, 1.0);
 
 		if (scroll_x == 0 && scroll_y == 0)
 			{
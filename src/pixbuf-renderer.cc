@@ -467,6 +467,7 @@ static void pixbuf_renderer_init(PixbufRenderer *pr)
 
 	pr->source_tiles_enabled = FALSE;
 	pr->source_tiles = nullptr;
+	pr->source_tiles_overview = nullptr;
 
 	pr->orientation = 1;
 
@@ -504,6 +505,7 @@ static void pixbuf_renderer_finalize(GObject *object)
 	pr_birdseye_hide(pr);
 
 	pr_source_tile_free_all(pr);
+	g_clear_object(&pr->source_tiles_overview);
 }
 
 PixbufRenderer *pixbuf_renderer_new()
@@ -1076,6 +1078,7 @@ static void pr_source_tile_free_all(PixbufRenderer *pr)
 static void pr_source_tile_unset(PixbufRenderer *pr)
 {
 	pr_source_tile_free_all(pr);
+	g_clear_object(&pr->source_tiles_overview);
 	pr->source_tiles_enabled = FALSE;
 }
 
@@ -1274,12 +1277,14 @@ static void pr_source_tile_changed(PixbufRenderer *pr, GdkRectangle request_rect
 
 /**
  * @brief Display an on-request array of pixbuf tiles
+ * @param overview The whole image at a reduced size, rendered from instead of the tiles
+ * when zoomed out further than that, may be nullptr
  */
 void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
                                gint tile_width, gint tile_height, gint cache_size,
                                const PixbufRenderer::TileRequestFunc &func_request,
                                const PixbufRenderer::TileDisposeFunc &func_dispose,
-                               gdouble zoom)
+                               GdkPixbuf *overview, gdouble zoom)
 {
 	g_return_if_fail(IS_PIXBUF_RENDERER(pr));
 	g_return_if_fail(tile_width >= 32 && tile_height >= 32);
@@ -1302,6 +1307,8 @@ void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
 	pr->func_tile_request = func_request;
 	pr->func_tile_dispose = func_dispose;
 
+	if (overview) pr->source_tiles_overview = static_cast<GdkPixbuf *>(g_object_ref(overview));
+
 	pr_stereo_temp_disable(pr, TRUE);
 	pr_zoom_sync(pr, zoom, static_cast<PrZoomFlags>(PR_ZOOM_FORCE | PR_ZOOM_NEW), 0, 0);
 }
@@ -2714,6 +2721,10 @@ void pixbuf_renderer_set_post_process_func(PixbufRenderer *pr, const PixbufRende
 {
 	g_return_if_fail(IS_PIXBUF_RENDERER(pr));
 
+	/* tiles being rendered may still use what the old function refers to */
+	pr->renderer->cancel_render(pr->renderer);
+	if (pr->renderer2) pr->renderer2->cancel_render(pr->renderer2);
+
 	pr->func_post_process = func;
 	pr->post_process_slow = func && slow;
 }
@@ -2764,6 +2775,8 @@ void pixbuf_renderer_move(PixbufRenderer *pr, PixbufRenderer *source)
 
 		pr->source_tiles = source->source_tiles;
 		source->source_tiles = nullptr;
+		pr->source_tiles_overview = source->source_tiles_overview;
+		source->source_tiles_overview = nullptr;
 
 		pr_zoom_sync(pr, source->zoom, static_cast<PrZoomFlags>(PR_ZOOM_FORCE | PR_ZOOM_NEW), 0, 0);
 		}
@@ -2816,6 +2829,7 @@ void pixbuf_renderer_copy(PixbufRenderer *pr, PixbufRenderer *source)
 
 		pr->source_tiles = source->source_tiles;
 		source->source_tiles = nullptr;
+		g_set_object(&pr->source_tiles_overview, source->source_tiles_overview);
 
 		pr_zoom_sync(pr, source->zoom, static_cast<PrZoomFlags>(PR_ZOOM_FORCE | PR_ZOOM_NEW), 0, 0);
 		}
@@ -148,6 +148,7 @@ struct RendererFuncs
 	gboolean (*overlay_get)(void *renderer, gint id, GdkPixbuf **pixbuf, gint *x, gint *y);
 
 	void (*stereo_set)(void *renderer, gint stereo_mode); /**< set stereo mode */
+	void (*cancel_render)(void *renderer); /**< stop rendering tiles on other threads */
 
 	void (*free)(void *renderer);
 };
@@ -229,6 +230,7 @@ struct PixbufRenderer
 	GList *source_tiles;	/**< list of active source tiles */
 	gint source_tile_width;
 	gint source_tile_height;
+	GdkPixbuf *source_tiles_overview; /**< the image reduced, rendered from when zoomed out further, may be nullptr */
 
 	using TileRequestFunc = std::function<gboolean(PixbufRenderer *, gint, gint, gint, gint, GdkPixbuf *)>;
 	TileRequestFunc func_tile_request;
@@ -335,7 +337,7 @@ void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
                                gint tile_width, gint tile_height, gint cache_size,
                                const PixbufRenderer::TileRequestFunc &func_request,
                                const PixbufRenderer::TileDisposeFunc &func_dispose,
-                               gdouble zoom);
+                               GdkPixbuf *overview, gdouble zoom);
 void pixbuf_renderer_set_tiles_size(PixbufRenderer *pr, gint width, gint height);
 gint pixbuf_renderer_get_tiles(PixbufRenderer *pr);
 
@@ -0,0 +1,320 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "pixbuf-transform.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "exif.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  include <immintrin.h>
+#  define TRANSFORM_HAVE_X86 1
+#else
+#  define TRANSFORM_HAVE_X86 0
+#endif
+
+/**
+ * @file
+ *
+ * An EXIF orientation maps pixel (x, y) of the unoriented frame to
+ * (origin_x + x * ax + y * bx, origin_y + x * ay + y * by) of the oriented
+ * one, each of ax, ay, bx, by being -1, 0 or 1.
+ *
+ * When rows stay rows both buffers are read and written in order. When the
+ * axes are swapped, rows of the source become columns of the destination:
+ * a plain loop writes one byte run per destination row for every source
+ * pixel and misses the cache on each of them once the image is wider than
+ * a few hundred pixels. The region is therefore copied in square blocks,
+ * whose source and destination rows both stay in the cache.
+ *
+ * Inside a block, 4 byte destinations are copied 4 x 4 pixels at a time
+ * with SSE2: four source rows are loaded, transposed in registers and
+ * stored as four destination rows. 3 byte pixels do not fit the registers,
+ * they take the blocked scalar loop.
+ */
+
+namespace
+{
+
+constexpr gint TRANSFORM_BLOCK_SIZE = 32; /**< pixels per side of the blocks swapped axes are copied in */
+
+struct OrientationMap
+{
+	gint origin_x;
+	gint origin_y;
+	gint ax;
+	gint ay;
+	gint bx;
+	gint by;
+};
+
+OrientationMap orientation_map(gint orientation, gint width, gint height)
+{
+	switch (orientation)
+		{
+		case EXIF_ORIENTATION_TOP_RIGHT:
+			/* mirrored */
+			return {width - 1, 0, -1, 0, 0, 1};
+		case EXIF_ORIENTATION_BOTTOM_RIGHT:
+			/* upside down */
+			return {width - 1, height - 1, -1, 0, 0, -1};
+		case EXIF_ORIENTATION_BOTTOM_LEFT:
+			/* flipped */
+			return {0, height - 1, 1, 0, 0, -1};
+		case EXIF_ORIENTATION_LEFT_TOP:
+			/* flipped and rotated 90 clockwise */
+			return {0, 0, 0, 1, 1, 0};
+		case EXIF_ORIENTATION_RIGHT_TOP:
+			/* rotated -90 (270) */
+			return {height - 1, 0, 0, 1, -1, 0};
+		case EXIF_ORIENTATION_RIGHT_BOTTOM:
+			/* flipped and rotated 90 counter clockwise */
+			return {height - 1, width - 1, 0, -1, -1, 0};
+		case EXIF_ORIENTATION_LEFT_BOTTOM:
+			/* rotated 90 */
+			return {0, width - 1, 0, -1, 1, 0};
+		default:
+			/* normal, the other values are out of range */
+			return {0, 0, 1, 0, 0, 1};
+		}
+}
+
+constexpr gint pixel_size(PixelFormat format)
+{
+	return format == PixelFormat::RGB ? 3 : 4;
+}
+
+struct Transform
+{
+	const guchar *src;
+	gint src_rowstride;
+	guchar *dest;
+	gint dest_rowstride;
+	OrientationMap map;
+};
+
+template<PixelFormat D>
+inline guchar *transform_dest(const Transform &t, gint x, gint y)
+{
+	const OrientationMap &m = t.map;
+
+	return t.dest + (static_cast<ptrdiff_t>(m.origin_y + (x * m.ay) + (y * m.by)) * t.dest_rowstride) +
+	       (static_cast<ptrdiff_t>(m.origin_x + (x * m.ax) + (y * m.bx)) * pixel_size(D));
+}
+
+template<PixelFormat S, PixelFormat D>
+inline void transform_pixel(const guchar *sp, guchar *dp)
+{
+	if constexpr (D == PixelFormat::XRGB32)
+		{
+		const guint32 word = 0xff000000 | (sp[0] << 16) | (sp[1] << 8) | sp[2];
+		memcpy(dp, &word, sizeof(word));
+		}
+	else
+		{
+		memcpy(dp, sp, pixel_size(D));
+		}
+}
+
+template<PixelFormat S, PixelFormat D>
+void transform_region_scalar(const Transform &t, GdkRectangle r)
+{
+	constexpr gint src_size = pixel_size(S);
+	const ptrdiff_t step = (t.map.ax * pixel_size(D)) + (static_cast<ptrdiff_t>(t.map.ay) * t.dest_rowstride);
+
+	for (gint y = r.y; y < r.y + r.height; y++)
+		{
+		const guchar *sp = t.src + (static_cast<ptrdiff_t>(y) * t.src_rowstride) + (r.x * src_size);
+		guchar *dp = transform_dest<D>(t, r.x, y);
+
+		if (S == D && step == src_size)
+			{
+			memcpy(dp, sp, static_cast<size_t>(r.width) * src_size);
+			continue;
+			}
+
+		for (gint i = 0; i < r.width; i++)
+			{
+			transform_pixel<S, D>(sp, dp);
+			sp += src_size;
+			dp += step;
+			}
+		}
+}
+
+#if TRANSFORM_HAVE_X86
+/**
+ * @brief Loads 4 pixels as destination words
+ */
+template<PixelFormat S, PixelFormat D>
+__attribute__((target("sse2")))
+inline __m128i transform_load_sse2(const guchar *sp)
+{
+	if constexpr (S == PixelFormat::RGB)
+		{
+		alignas(16) guint32 words[4];
+		for (guint32 &word : words)
+			{
+			word = 0xff000000 | (sp[0] << 16) | (sp[1] << 8) | sp[2];
+			sp += 3;
+			}
+		return _mm_load_si128(reinterpret_cast<const __m128i *>(words));
+		}
+	else
+		{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sp));
+		if constexpr (D == PixelFormat::RGBA) return v;
+
+		/* r g b a bytes to the b g r 0xff bytes of 0xffrrggbb */
+		const __m128i byte = _mm_set1_epi32(0xff);
+		const __m128i r = _mm_slli_epi32(_mm_and_si128(v, byte), 16);
+		const __m128i g = _mm_and_si128(v, _mm_set1_epi32(0xff00));
+		const __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), byte);
+		return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_set1_epi32(static_cast<gint>(0xff000000))));
+		}
+}
+
+__attribute__((target("sse2")))
+inline __m128i transform_reverse_sse2(__m128i v)
+{
+	return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+template<PixelFormat S, PixelFormat D>
+__attribute__((target("sse2")))
+void transform_region_sse2(const Transform &t, GdkRectangle r)
+{
+	constexpr gint src_size = pixel_size(S);
+	const OrientationMap &m = t.map;
+	const gint width4 = r.width & ~3;
+	const gint height4 = r.height & ~3;
+
+	if (m.ax != 0)
+		{
+		for (gint y = r.y; y < r.y + r.height; y++)
+			{
+			const guchar *sp = t.src + (static_cast<ptrdiff_t>(y) * t.src_rowstride) + (r.x * src_size);
+
+			for (gint x = r.x; x < r.x + width4; x += 4)
+				{
+				__m128i v = transform_load_sse2<S, D>(sp);
+				if (m.ax < 0) v = transform_reverse_sse2(v);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(transform_dest<D>(t, m.ax < 0 ? x + 3 : x, y)), v);
+				sp += 4 * src_size;
+				}
+			}
+
+		transform_region_scalar<S, D>(t, {r.x + width4, r.y, r.width - width4, r.height});
+		return;
+		}
+
+	for (gint y = r.y; y < r.y + height4; y += 4)
+		{
+		const guchar *sp = t.src + (static_cast<ptrdiff_t>(y) * t.src_rowstride) + (r.x * src_size);
+
+		for (gint x = r.x; x < r.x + width4; x += 4)
+			{
+			const __m128i r0 = transform_load_sse2<S, D>(sp);
+			const __m128i r1 = transform_load_sse2<S, D>(sp + t.src_rowstride);
+			const __m128i r2 = transform_load_sse2<S, D>(sp + (2 * t.src_rowstride));
+			const __m128i r3 = transform_load_sse2<S, D>(sp + (3 * t.src_rowstride));
+
+			const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+			const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+			const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+			const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+			/* column i of the source, rows y to y + 3 */
+			__m128i columns[4] = {_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+			                      _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)};
+
+			for (gint i = 0; i < 4; i++)
+				{
+				if (m.bx < 0) columns[i] = transform_reverse_sse2(columns[i]);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(transform_dest<D>(t, x + i, m.bx < 0 ? y + 3 : y)), columns[i]);
+				}
+
+			sp += 4 * src_size;
+			}
+		}
+
+	transform_region_scalar<S, D>(t, {r.x + width4, r.y, r.width - width4, r.height});
+	transform_region_scalar<S, D>(t, {r.x, r.y + height4, width4, r.height - height4});
+}
+
+gboolean transform_have_sse2()
+{
+	static const gboolean sse2 = []()
+	{
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse2") ? TRUE : FALSE;
+	}();
+
+	return sse2;
+}
+#endif
+
+using TransformKernel = void (*)(const Transform &, GdkRectangle);
+
+template<PixelFormat S, PixelFormat D>
+TransformKernel transform_kernel()
+{
+#if TRANSFORM_HAVE_X86
+	if constexpr (D != PixelFormat::RGB)
+		{
+		if (transform_have_sse2()) return transform_region_sse2<S, D>;
+		}
+#endif
+	return transform_region_scalar<S, D>;
+}
+
+} // namespace
+
+gboolean pixbuf_transform_swaps_axes(gint orientation)
+{
+	return orientation_map(orientation, 1, 1).ax == 0;
+}
+
+void pixbuf_transform_region(const PixelBuffer &src, gint width, gint height, GdkRectangle rect,
+                             const PixelBuffer &dest, gint orientation)
+{
+	const GdkRectangle frame{0, 0, width, height};
+	if (!gdk_rectangle_intersect(&frame, &rect, &rect)) return;
+
+	TransformKernel kernel;
+	if (src.format == PixelFormat::RGB && dest.format == PixelFormat::RGB)
+		kernel = transform_kernel<PixelFormat::RGB, PixelFormat::RGB>();
+	else if (src.format == PixelFormat::RGBA && dest.format == PixelFormat::RGBA)
+		kernel = transform_kernel<PixelFormat::RGBA, PixelFormat::RGBA>();
+	else if (src.format == PixelFormat::RGB && dest.format == PixelFormat::XRGB32)
+		kernel = transform_kernel<PixelFormat::RGB, PixelFormat::XRGB32>();
+	else if (src.format == PixelFormat::RGBA && dest.format == PixelFormat::XRGB32)
+		kernel = transform_kernel<PixelFormat::RGBA, PixelFormat::XRGB32>();
+	else
+		g_return_if_reached();
+
+	const Transform t{src.pixels, src.rowstride, dest.pixels, dest.rowstride,
+	                  orientation_map(orientation, width, height)};
+
+	if (t.map.ax != 0)
+		{
+		kernel(t, rect);
+		return;
+		}
+
+	for (gint y = rect.y; y < rect.y + rect.height; y += TRANSFORM_BLOCK_SIZE)
+		{
+		for (gint x = rect.x; x < rect.x + rect.width; x += TRANSFORM_BLOCK_SIZE)
+			{
+			kernel(t, {x, y,
+			           std::min(TRANSFORM_BLOCK_SIZE, rect.x + rect.width - x),
+			           std::min(TRANSFORM_BLOCK_SIZE, rect.y + rect.height - y)});
+			}
+		}
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
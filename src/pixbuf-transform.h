@@ -0,0 +1,51 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef PIXBUF_TRANSFORM_H
+#define PIXBUF_TRANSFORM_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gdk/gdk.h>
+#include <glib.h>
+
+/**
+ * @brief Pixel layouts read and written by the orientation transforms
+ */
+enum class PixelFormat {
+	RGB,    /**< 3 bytes per pixel, a GdkPixbuf without alpha */
+	RGBA,   /**< 4 bytes per pixel, a GdkPixbuf with alpha */
+	XRGB32  /**< native endian 32 bit words, a CAIRO_FORMAT_RGB24 surface; destination only */
+};
+
+/**
+ * @brief An 8 bit pixel buffer the transforms work on
+ */
+struct PixelBuffer
+{
+	guchar *pixels;
+	gint rowstride;
+	PixelFormat format;
+};
+
+/**
+ * @brief Copies a region of a frame to a buffer of the frame in an EXIF orientation
+ * @param src The unoriented frame
+ * @param width,height Size of the unoriented frame
+ * @param rect The region of the frame to copy, the rest of @a dest is not touched
+ * @param dest The oriented frame, height x width for the orientations that swap the axes
+ * @param orientation An #ExifOrientationType, out of range values copy unchanged
+ *
+ * Supported are RGB to RGB, RGBA to RGBA, and either to XRGB32, dropping
+ * alpha. Orientations that swap the axes are copied in blocks that fit in
+ * the cache, 4 byte destinations with SIMD where the CPU has it. The
+ * buffers must not overlap.
+ */
+void pixbuf_transform_region(const PixelBuffer &src, gint width, gint height, GdkRectangle rect,
+                             const PixelBuffer &dest, gint orientation);
+
+/** @returns TRUE if @a orientation swaps width and height */
+gboolean pixbuf_transform_swaps_axes(gint orientation);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
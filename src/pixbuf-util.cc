@@ -22,6 +22,7 @@
 #include "pixbuf-util.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
@@ -45,6 +46,7 @@
 #include "geometry.h"
 #include "gq-color.h"
 #include "main-defines.h"
+#include "pixbuf-transform.h"
 #include "ui-fileops.h"
 #include "ui-misc.h"
 
@@ -347,6 +349,73 @@ gboolean pixbuf_scale_aspect(gint req_w, gint req_h, gint old_w, gint old_h, gin
 	return (new_w != old_w || new_h != old_h);
 }
 
+/**
+ * @brief Returns a pixbuf of half the size of @a src, each pixel the average of 2 x 2 pixels
+ *
+ * Color is weighted by alpha. Odd sizes are rounded up, repeating the last row or column.
+ * Returns nullptr when @a cancelled is set before all rows are done, it is checked once per row.
+ */
+GdkPixbuf *pixbuf_scale_half(const GdkPixbuf *src, const std::atomic<bool> &cancelled)
+{
+	const gint src_width = gdk_pixbuf_get_width(src);
+	const gint src_height = gdk_pixbuf_get_height(src);
+	const gint src_rowstride = gdk_pixbuf_get_rowstride(src);
+	const gint channels = gdk_pixbuf_get_n_channels(src);
+	const gboolean has_alpha = gdk_pixbuf_get_has_alpha(src);
+	const guchar *src_pixels = gdk_pixbuf_get_pixels(src);
+
+	const gint width = (src_width + 1) / 2;
+	const gint height = (src_height + 1) / 2;
+
+	GdkPixbuf *dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+	if (!dest) return nullptr;
+
+	const gint dest_rowstride = gdk_pixbuf_get_rowstride(dest);
+	guchar *dest_pixels = gdk_pixbuf_get_pixels(dest);
+
+	for (gint y = 0; y < height; y++)
+		{
+		if (cancelled)
+			{
+			g_object_unref(dest);
+			return nullptr;
+			}
+
+		const guchar *row0 = src_pixels + (static_cast<gsize>(2 * y) * src_rowstride);
+		const guchar *row1 = (2 * y + 1 < src_height) ? row0 + src_rowstride : row0;
+		guchar *d = dest_pixels + (static_cast<gsize>(y) * dest_rowstride);
+
+		for (gint x = 0; x < width; x++)
+			{
+			const gsize x0 = static_cast<gsize>(2 * x) * channels;
+			const gsize x1 = (2 * x + 1 < src_width) ? x0 + channels : x0;
+			const guchar *p[4] = {row0 + x0, row0 + x1, row1 + x0, row1 + x1};
+
+			if (has_alpha)
+				{
+				const guint alpha = p[0][3] + p[1][3] + p[2][3] + p[3][3];
+				for (gint c = 0; c < 3; c++)
+					{
+					d[c] = alpha ? ((p[0][c] * p[0][3]) + (p[1][c] * p[1][3]) +
+					                (p[2][c] * p[2][3]) + (p[3][c] * p[3][3]) + (alpha / 2)) / alpha : 0;
+					}
+				d[3] = (alpha + 2) / 4;
+				}
+			else
+				{
+				for (gint c = 0; c < 3; c++)
+					{
+					d[c] = (p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4;
+					}
+				}
+
+			d += channels;
+			}
+		}
+
+	return dest;
+}
+
 GdkPixbuf *pixbuf_fallback(FileData *fd, gint requested_width, gint requested_height)
 {
 	GdkPixbuf *pixbuf;
@@ -415,48 +484,27 @@ GdkPixbuf *pixbuf_fallback(FileData *fd, gint requested_width, gint requested_he
  *-----------------------------------------------------------------------------
  */
 
+/**
+ * @brief Copies @a pixbuf to a new pixbuf in an EXIF orientation
+ *
+ * A single pass for every orientation, see pixbuf-transform.cc.
+ */
 GdkPixbuf *pixbuf_apply_orientation(GdkPixbuf *pixbuf, gint orientation)
 {
-	GdkPixbuf *dest = nullptr;
-	g_autoptr(GdkPixbuf) flipped = nullptr;
-
-	switch (orientation)
-		{
-		case EXIF_ORIENTATION_TOP_LEFT:
-			dest = gdk_pixbuf_copy(pixbuf);
-			break;
-		case EXIF_ORIENTATION_TOP_RIGHT:
-			/* mirrored */
-			dest = gdk_pixbuf_flip(pixbuf, TRUE);
-			break;
-		case EXIF_ORIENTATION_BOTTOM_RIGHT:
-			/* upside down */
-			dest = gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_UPSIDEDOWN);
-			break;
-		case EXIF_ORIENTATION_BOTTOM_LEFT:
-			/* flipped */
-			dest = gdk_pixbuf_flip(pixbuf, FALSE);
-			break;
-		case EXIF_ORIENTATION_LEFT_TOP:
-			flipped = gdk_pixbuf_flip(pixbuf, FALSE);
-			dest = gdk_pixbuf_rotate_simple(flipped, GDK_PIXBUF_ROTATE_CLOCKWISE);
-			break;
-		case EXIF_ORIENTATION_RIGHT_TOP:
-			/* rotated -90 (270) */
-			dest = gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_CLOCKWISE);
-			break;
-		case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			flipped = gdk_pixbuf_flip(pixbuf, FALSE);
-			dest = gdk_pixbuf_rotate_simple(flipped, GDK_PIXBUF_ROTATE_COUNTERCLOCKWISE);
-			break;
-		case EXIF_ORIENTATION_LEFT_BOTTOM:
-			/* rotated 90 */
-			dest = gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_COUNTERCLOCKWISE);
-			break;
-		default:
-			dest = gdk_pixbuf_copy(pixbuf);
-			break;
-		}
+	const gint width = gdk_pixbuf_get_width(pixbuf);
+	const gint height = gdk_pixbuf_get_height(pixbuf);
+	const gboolean has_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+	const gboolean swap = pixbuf_transform_swaps_axes(orientation);
+
+	GdkPixbuf *dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8,
+	                                 swap ? height : width, swap ? width : height);
+	if (!dest) return nullptr;
+
+	const PixelFormat format = has_alpha ? PixelFormat::RGBA : PixelFormat::RGB;
+	pixbuf_transform_region({gdk_pixbuf_get_pixels(pixbuf), gdk_pixbuf_get_rowstride(pixbuf), format},
+	                        width, height, {0, 0, width, height},
+	                        {gdk_pixbuf_get_pixels(dest), gdk_pixbuf_get_rowstride(dest), format},
+	                        orientation);
 
 	return dest;
 }
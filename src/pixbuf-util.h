@@ -22,6 +22,8 @@
 #ifndef PIXBUF_UTIL_H
 #define PIXBUF_UTIL_H
 
+#include <atomic>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gdk/gdk.h>
 #include <glib.h>
@@ -41,6 +43,7 @@ GdkPixbuf *pixbuf_fallback(FileData *fd, gint requested_width, gint requested_he
 GdkTexture *pixbuf_to_texture(GdkPixbuf *pixbuf);
 
 gboolean pixbuf_scale_aspect(gint req_w, gint req_h, gint old_w, gint old_h, gint &new_w, gint &new_h);
+GdkPixbuf *pixbuf_scale_half(const GdkPixbuf *src, const std::atomic<bool> &cancelled);
 
 #define PIXBUF_INLINE_ARCHIVE               "gq-icon-archive-file"
 #define PIXBUF_INLINE_BROKEN                "gq-icon-broken"
@@ -397,6 +397,7 @@ static void config_window_apply(const ConfOptions *c_options)
 	options->image.max_autofit_size = c_options->image.max_autofit_size;
 	options->image.max_enlargement_size = c_options->image.max_enlargement_size;
 	options->image.tile_size = c_options->image.tile_size;
+	options->image.tile_prefetch = c_options->image.tile_prefetch;
 	options->progressive_key_scrolling = c_options->progressive_key_scrolling;
 	options->keyboard_scroll_step = c_options->keyboard_scroll_step;
 
@@ -478,6 +479,7 @@ static void config_window_apply(const ConfOptions *c_options)
 
 	options->duplicates_similarity_threshold = c_options->duplicates_similarity_threshold;
 	options->rot_invariant_sim = c_options->rot_invariant_sim;
+	options->duplicates_hash_prefilter = c_options->duplicates_hash_prefilter;
 
 	options->tree_descend_subdirs = c_options->tree_descend_subdirs;
 
@@ -907,6 +909,43 @@ static void add_thumb_size_menu(GtkWidget *table, gint column, gint row, const g
 	gtk_grid_attach(GTK_GRID(table), drop_down, column + 1, row, 1, 1);
 }
 
+static constexpr gint thumb_standard_size_list[] = { 128, 256, 512, 1024 };
+
+static void thumb_standard_size_menu_cb(GtkDropDown *drop_down, GParamSpec *, gpointer data)
+{
+	const guint n = gtk_drop_down_get_selected(drop_down);
+	if (n >= std::size(thumb_standard_size_list)) return;
+
+	auto *option = static_cast<gint *>(data);
+
+	*option = thumb_standard_size_list[n];
+}
+
+static void add_thumb_standard_size_menu(GtkWidget *table, gint column, gint row, const gchar *text, gint option, gint *option_c)
+{
+	pref_table_label(table, column, row, text, GTK_ALIGN_START);
+
+	static const char *strings[] = {
+	    _("Normal (128)"),
+	    _("Normal and large (256)"),
+	    _("Up to x-large (512)"),
+	    _("Up to xx-large (1024)"),
+	    nullptr
+	};
+
+	guint current = 0;
+	while (current < std::size(thumb_standard_size_list) - 1 && option > thumb_standard_size_list[current]) current++;
+
+	GtkWidget *drop_down = gtk_drop_down_new_from_strings(strings);
+	gtk_drop_down_set_selected(GTK_DROP_DOWN(drop_down), current);
+
+	*option_c = option;
+	g_signal_connect(G_OBJECT(drop_down), "notify::selected",
+	                 G_CALLBACK(thumb_standard_size_menu_cb), option_c);
+
+	gtk_grid_attach(GTK_GRID(table), drop_down, column + 1, row, 1, 1);
+}
+
 static void stereo_mode_menu_cb(GtkDropDown *drop_down, GParamSpec *, gpointer data)
 {
 	auto option = static_cast<gint *>(data);
@@ -1822,6 +1861,20 @@ static void config_tab_general(GtkWidget *notebook, ConfOptions *c_options)
 	                     options->thumbnails.spec_standard && !options->thumbnails.cache_into_dirs,
 	                     G_CALLBACK(cache_standard_cb), c_options);
 
+	table = pref_table_new(group_frame, 2, 1, FALSE, FALSE);
+	add_thumb_standard_size_menu(table, 0, 0, _("Sizes made at once:"),
+	                             options->thumbnails.standard_size_max, &c_options->thumbnails.standard_size_max);
+
+	pref_checkbox_new_int(subgroup, _("Keep sim. files of a folder in one database"),
+	                      options->thumbnails.sim_database, &c_options->thumbnails.sim_database);
+
+	ct_button = pref_checkbox_new_int(subgroup, _("Keep thumbnails of a folder in one pack"),
+	                                  options->thumbnails.packed, &c_options->thumbnails.packed);
+
+	button = pref_checkbox_new_int(subgroup, _("Also write thumbnails as PNG files"),
+	                               options->thumbnails.packed_png, &c_options->thumbnails.packed_png);
+	pref_checkbox_link_sensitivity(ct_button, button);
+
 	pref_checkbox_new_int(group, _("Use EXIF thumbnails when available (EXIF thumbnails may be outdated)"),
 			      options->thumbnails.use_exif, &c_options->thumbnails.use_exif);
 
@@ -1833,6 +1886,16 @@ static void config_tab_general(GtkWidget *notebook, ConfOptions *c_options)
 				 options->thumbnails.collection_preview, &c_options->thumbnails.collection_preview);
 	gtk_widget_set_tooltip_text(spin, _("The maximum number of thumbnails shown in a Collection preview montage"));
 
+	spin = pref_spin_new_int(group, _("Generated at a time:"), nullptr,
+				 0, 64, 1,
+				 options->thumbnails.loaders, &c_options->thumbnails.loaders);
+	gtk_widget_set_tooltip_text(spin, _("The number of thumbnails of a folder generated at the same time, the visible ones first. 0 is one per processor core."));
+
+	spin = pref_spin_new_int(group, _("PNG compression level:"), nullptr,
+				 0, 9, 1,
+				 options->thumbnails.png_compression, &c_options->thumbnails.png_compression);
+	gtk_widget_set_tooltip_text(spin, _("The compression of new thumbnail files. Lower levels are written faster but take more space."));
+
 #if HAVE_FFMPEGTHUMBNAILER_METADATA
 	pref_checkbox_new_int(group, _("Use embedded metadata in video files as thumbnails when available"),
 			      options->thumbnails.use_ft_metadata, &c_options->thumbnails.use_ft_metadata);
@@ -2057,6 +2120,13 @@ static void config_tab_image(GtkWidget *notebook, ConfOptions *c_options)
 	gtk_widget_set_tooltip_text(hbox,
 	                            _("This value changes the size of the tiles large images are split into. Increasing the size of the tiles will reduce the tiling effect seen on image changes, but will also slightly increase the delay before the first part of a large image is seen."));
 
+	hbox = pref_box_new(group, FALSE, GTK_ORIENTATION_HORIZONTAL, PREF_PAD_SPACE);
+	pref_spin_new_int(hbox, _("Prefetch"), _("tiles around the view"),
+	                  0, 8, 1,
+	                  options->image.tile_prefetch, &c_options->image.tile_prefetch);
+	gtk_widget_set_tooltip_text(hbox,
+	                            _("When the visible part of the image is drawn, this many rows and columns of tiles around it are rendered in the background, twice as many in the direction of the last scroll. Panning then shows finished pixels at once. 0 disables it."));
+
 	group = pref_group_new(vbox, FALSE, _("Appearance"), GTK_ORIENTATION_VERTICAL);
 
 	pref_checkbox_new_int(group, _("Use custom border color in window mode"),
@@ -3551,6 +3621,7 @@ static void config_tab_toolbar(GtkWidget *notebook, GtkWidget *window, ToolbarTy
 static void config_tab_advanced(GtkWidget *notebook, ConfOptions *c_options)
 {
 	GtkWidget *alternate_checkbox;
+	GtkWidget *checkbox;
 	GtkWidget *dupes_threads_spin;
 	GtkWidget *group;
 	GtkWidget *subgroup;
@@ -3612,6 +3683,13 @@ static void config_tab_advanced(GtkWidget *notebook, ConfOptions *c_options)
 
 	alternate_checkbox = pref_checkbox_new_int(subgroup, _("Use grayscale"), options->alternate_similarity_algorithm.grayscale, &c_options->alternate_similarity_algorithm.grayscale);
 	gtk_widget_set_tooltip_text(alternate_checkbox, _("Reduce fingerprint to grayscale"));
+
+	pref_line(vbox, PREF_PAD_SPACE);
+
+	group = pref_group_new(vbox, FALSE, _("Similarity pre-filter"), GTK_ORIENTATION_VERTICAL);
+
+	checkbox = pref_checkbox_new_int(group, _("Compare only images with similar perceptual hashes"), options->duplicates_hash_prefilter, &c_options->duplicates_hash_prefilter);
+	gtk_widget_set_tooltip_text(checkbox, _("Faster on large sets of images, but some matches may be missed.\nNot used with the alternate algorithm."));
 }
 
 /* stereo tab */
@@ -419,6 +419,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_UINT(*options, duplicates_select_type);
 	WRITE_NL(); WRITE_BOOL(*options, duplicates_thumbnails);
 	WRITE_NL(); WRITE_BOOL(*options, rot_invariant_sim);
+	WRITE_NL(); WRITE_BOOL(*options, duplicates_hash_prefilter);
 	WRITE_NL(); WRITE_BOOL(*options, sort_totals);
 	WRITE_SEPARATOR();
 
@@ -504,18 +505,25 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_COLOR(*options, image.alpha_color_1);
 	WRITE_NL(); WRITE_COLOR(*options, image.alpha_color_2);
 	WRITE_NL(); WRITE_INT(*options, image.tile_size);
+	WRITE_NL(); WRITE_INT(*options, image.tile_prefetch);
 
 	/* Thumbnails Options */
 	WRITE_NL(); WRITE_INT_FULL("thumbnails.max_width", options->thumbnails.size.width);
 	WRITE_NL(); WRITE_INT_FULL("thumbnails.max_height", options->thumbnails.size.height);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.enable_caching);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.cache_into_dirs);
+	WRITE_NL(); WRITE_BOOL(*options, thumbnails.sim_database);
+	WRITE_NL(); WRITE_BOOL(*options, thumbnails.packed);
+	WRITE_NL(); WRITE_BOOL(*options, thumbnails.packed_png);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.spec_standard);
+	WRITE_NL(); WRITE_INT(*options, thumbnails.standard_size_max);
 	WRITE_NL(); WRITE_UINT(*options, thumbnails.quality);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.use_exif);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.use_color_management);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.use_ft_metadata);
 	WRITE_NL(); WRITE_INT(*options, thumbnails.collection_preview);
+	WRITE_NL(); WRITE_INT(*options, thumbnails.loaders);
+	WRITE_NL(); WRITE_INT(*options, thumbnails.png_compression);
 
 	/* File sorting Options */
 	WRITE_NL(); WRITE_BOOL(*options, file_sort.case_sensitive);
@@ -892,6 +900,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_UINT_ENUM_CLAMP(*options, duplicates_select_type, DUPE_SELECT_NONE, DUPE_SELECT_GROUP2)) continue;
 		if (READ_BOOL(*options, duplicates_thumbnails)) continue;
 		if (READ_BOOL(*options, rot_invariant_sim)) continue;
+		if (READ_BOOL(*options, duplicates_hash_prefilter)) continue;
 		if (READ_BOOL(*options, sort_totals)) continue;
 
 		if (READ_BOOL(*options, progressive_key_scrolling)) continue;
@@ -968,6 +977,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_COLOR(*options, image.alpha_color_1)) continue;
 		if (READ_COLOR(*options, image.alpha_color_2)) continue;
 		if (READ_INT(*options, image.tile_size)) continue;
+		if (READ_INT_CLAMP(*options, image.tile_prefetch, 0, 8)) continue;
 
 		/* Thumbnails options */
 		if (READ_INT_CLAMP_FULL("thumbnails.max_width", options->thumbnails.size.width, 16, 512)) continue;
@@ -975,11 +985,17 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 
 		if (READ_BOOL(*options, thumbnails.enable_caching)) continue;
 		if (READ_BOOL(*options, thumbnails.cache_into_dirs)) continue;
+		if (READ_BOOL(*options, thumbnails.sim_database)) continue;
+		if (READ_BOOL(*options, thumbnails.packed)) continue;
+		if (READ_BOOL(*options, thumbnails.packed_png)) continue;
 		if (READ_BOOL(*options, thumbnails.spec_standard)) continue;
+		if (READ_INT_CLAMP(*options, thumbnails.standard_size_max, 128, 1024)) continue;
 		if (READ_UINT_ENUM_CLAMP(*options, thumbnails.quality, GDK_INTERP_NEAREST, GDK_INTERP_BILINEAR)) continue;
 		if (READ_BOOL(*options, thumbnails.use_exif)) continue;
 		if (READ_BOOL(*options, thumbnails.use_color_management)) continue;
 		if (READ_INT(*options, thumbnails.collection_preview)) continue;
+		if (READ_INT_CLAMP(*options, thumbnails.loaders, 0, 64)) continue;
+		if (READ_INT_CLAMP(*options, thumbnails.png_compression, 0, 9)) continue;
 		if (READ_BOOL(*options, thumbnails.use_ft_metadata)) continue;
 
 		/* File sorting options */
@@ -22,11 +22,13 @@
 #include "renderer-tiles.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <utility>
+#include <vector>
 
 #include <cairo.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -37,6 +39,7 @@
 
 #include "options.h"
 #include "pixbuf-renderer.h"
+#include "pixbuf-transform.h"
 
 /* comment this out if not using this from within Geeqie
  * defining GQ_BUILD does these things:
@@ -70,6 +73,8 @@ cairo_surface_t *rt_surface_new(gint width, gint height)
 }
 
 struct QueueData;
+struct RendererTiles;
+struct TileRenderBatch;
 
 enum class TileRender {
 	NONE = 0, /**< do nothing */
@@ -79,8 +84,7 @@ enum class TileRender {
 
 struct ImageTile
 {
-	cairo_surface_t *surface;	/* off screen buffer */
-	GdkPixbuf *pixbuf;	/* pixbuf area for zooming */
+	cairo_surface_t *surface;	/* off screen buffer, rendered to directly */
 	gint x;			/* x offset into image */
 	gint y;			/* y offset into image */
 	gint w;			/* width that is visible (may be less if at edge of image) */
@@ -98,7 +102,9 @@ struct ImageTile
 	QueueData *qd;
 	QueueData *qd2;
 
-	guint size;		/* est. memory used by pixmap and pixbuf */
+	gboolean rendering;	/* surface is rendered by a job of the render batch */
+
+	guint size;		/* est. memory used by the surface */
 };
 
 struct QueueData
@@ -123,6 +129,81 @@ struct OverlayData
 	OverlayRendererFlags flags;
 };
 
+/**
+ * @brief Builds the levels of a pyramid on the pyramid worker
+ *
+ * The main thread hands the levels over to the renderer when they are done,
+ * unless the pyramid was dropped meanwhile.
+ */
+struct PyramidJob
+{
+	RendererTiles *rt;              /**< nullptr when cancelled, main thread only */
+	std::atomic<bool> cancelled{false};
+
+	GdkPixbuf *source;
+	gint first_level;               /**< the first level kept, 1 is half the size of source */
+	gint last_level;
+	GList *levels = nullptr;        /**< first level first */
+};
+
+/**
+ * @brief Scales, orients and post processes the pixels of a tile on a worker thread
+ *
+ * The parameters are taken on the main thread when the job is created, the
+ * worker only touches the scratch buffers of its thread and the memory of
+ * the tile surface.
+ */
+struct TileRenderJob
+{
+	TileRenderBatch *batch;
+	ImageTile *it;
+	GdkRectangle area;	/* of the tile surface */
+
+	GdkPixbuf *src;		/* referenced, pr->pixbuf or a level of the pyramid */
+	guchar *data;		/* of the tile surface, flushed */
+	gint stride;
+	gint tile_width;
+	gint tile_height;
+
+	GdkRectangle pb_rect;
+	gdouble offset_x;
+	gdouble offset_y;
+	gdouble left_offset_x;	/* of the anaglyph right image */
+	gdouble scale_x;
+	gdouble scale_y;
+	GdkInterpType interp_type;
+	gboolean has_alpha;
+	gboolean ignore_alpha;
+	gboolean wide_image;
+	gboolean anaglyph;
+	gint stereo_mode;
+	gint orientation;
+
+	PixbufRenderer *pr;
+	PixbufRenderer::PostProcessFunc post_process;	/* empty when not run on this pass */
+
+	gboolean rendered;	/* set by the worker, read once the batch is done */
+};
+
+/**
+ * @brief The jobs taken from a draw queue in one go
+ *
+ * The main thread draws the tiles when all jobs are done, unless the batch
+ * was cancelled meanwhile.
+ */
+struct TileRenderBatch
+{
+	RendererTiles *rt;		/**< nullptr when cancelled, main thread only */
+	std::atomic<bool> cancelled{false};
+	gboolean prefetch;		/**< renders tiles around the view, not in it */
+
+	std::vector<TileRenderJob> jobs;
+
+	GMutex lock;
+	GCond done;
+	guint running;			/**< jobs not finished yet */
+};
+
 struct RendererTiles
 {
 	RendererFuncs f;
@@ -130,8 +211,10 @@ struct RendererTiles
 
 	gint tile_width;
 	gint tile_height;
-	GList *tiles;		/* list of buffer tiles */
+	GQueue tiles;		/* buffer tiles, most recently used first */
+	GHashTable *tile_index;	/* tile to its link in tiles, looked up by position */
 	gint tile_cache_size;	/* allocated size of pixmaps/pixbufs */
+	GQueue surface_pool;	/* surfaces of freed tiles, for new tiles */
 	GQueue draw_queue;	/* queue of areas to redraw */
 	GQueue draw_queue_2pass;/* queue when 2 pass is enabled */
 
@@ -142,7 +225,11 @@ struct RendererTiles
 	guint draw_idle_id; /* event source id */
 	gboolean draw_pending;
 
-	GdkPixbuf *spare_tile;
+	TileRenderBatch *render_batch;	/* tiles being rendered on worker threads */
+	guint prefetch_idle_id;		/* event source id */
+
+	gint scroll_dx;	/* direction of the last scroll, -1, 0 or 1 */
+	gint scroll_dy;
 
 	gint stereo_mode;
 	gint stereo_off_x;
@@ -150,10 +237,25 @@ struct RendererTiles
 
 	gint x_scroll;  /* allow local adjustment and mirroring */
 	gint y_scroll;
+
+	/* mip pyramid of pr->pixbuf, zoomed out tiles are scaled from its levels */
+	GdkPixbuf *pyramid_source;	/* pixbuf the levels are or will be scaled from */
+	GList *pyramid_levels;		/* halving in size, largest first */
+	gsize pyramid_size;		/* memory used by the levels */
+	PyramidJob *pyramid_job;	/* building the levels */
 };
 
 constexpr size_t COLOR_BYTES = 3; /* rgb */
 
+/* buffers of freed tiles kept for new tiles take at most this */
+constexpr gsize TILE_POOL_SIZE = 8 * 1024 * 1024;
+
+/* tiles taken from a draw queue for each render thread */
+constexpr guint TILE_RENDER_JOBS_PER_THREAD = 4;
+
+/* tiles ahead of the view take at most this part of the tile cache */
+constexpr gint TILE_PREFETCH_CACHE_DIVISOR = 2;
+
 
 inline gint get_right_pixbuf_offset(RendererTiles *rt)
 {
@@ -173,6 +275,8 @@ void rt_queue(RendererTiles *rt, gint x, gint y, gint w, gint h,
               bool clamp, TileRender render, gboolean new_data, bool only_existing);
 
 gboolean rt_queue_draw_idle_cb(gpointer data);
+void rt_render_cancel(RendererTiles *rt);
+void rt_prefetch_schedule(RendererTiles *rt);
 void rt_redraw(RendererTiles *rt, GdkRectangle rect, bool clamp, gboolean new_data);
 
 
@@ -289,21 +393,73 @@ ImageTile *rt_tile_new(gint x, gint y, gint width, gint height)
 	return it;
 }
 
-void rt_tile_free(ImageTile *it)
+guint rt_tile_hash(gconstpointer key)
+{
+	const auto *it = static_cast<const ImageTile *>(key);
+
+	return (static_cast<guint>(it->x) * 73856093U) ^ (static_cast<guint>(it->y) * 19349663U);
+}
+
+gboolean rt_tile_equal(gconstpointer a, gconstpointer b)
+{
+	const auto *it_a = static_cast<const ImageTile *>(a);
+	const auto *it_b = static_cast<const ImageTile *>(b);
+
+	return it_a->x == it_b->x && it_a->y == it_b->y;
+}
+
+gint surface_calc_size(gint width, gint height)
+{
+	return cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, width) * height;
+}
+
+/**
+ * @brief The number of surfaces kept for new tiles
+ */
+guint rt_tile_pool_max(const RendererTiles *rt)
+{
+	return std::max<gsize>(2, TILE_POOL_SIZE / surface_calc_size(rt->tile_width, rt->tile_height));
+}
+
+void rt_tile_pool_clear(RendererTiles *rt)
+{
+	g_queue_clear_full(&rt->surface_pool, reinterpret_cast<GDestroyNotify>(cairo_surface_destroy));
+}
+
+/**
+ * @brief Frees @a it, its surface is kept for new tiles while the pool has room
+ */
+void rt_tile_free(RendererTiles *rt, ImageTile *it)
 {
 	if (!it) return;
 
-	if (it->pixbuf) g_object_unref(it->pixbuf);
-	if (it->surface) cairo_surface_destroy(it->surface);
+	if (it->surface)
+		{
+		if (rt->surface_pool.length < rt_tile_pool_max(rt))
+			{
+			g_queue_push_head(&rt->surface_pool, it->surface);
+			}
+		else
+			{
+			cairo_surface_destroy(it->surface);
+			}
+		}
 
 	g_free(it);
 }
 
 void rt_tile_free_all(RendererTiles *rt)
 {
-	g_list_free_full(rt->tiles, reinterpret_cast<GDestroyNotify>(rt_tile_free));
-	rt->tiles = nullptr;
+	ImageTile *it;
+
+	g_hash_table_remove_all(rt->tile_index);
+	while ((it = static_cast<ImageTile *>(g_queue_pop_head(&rt->tiles))))
+		{
+		rt_tile_free(rt, it);
+		}
 	rt->tile_cache_size = 0;
+
+	rt_tile_pool_clear(rt);
 }
 
 ImageTile *rt_tile_add(RendererTiles *rt, gint x, gint y)
@@ -316,7 +472,8 @@ ImageTile *rt_tile_add(RendererTiles *rt, gint x, gint y)
 	if (it->x + it->w > pr->width) it->w = pr->width - it->x;
 	if (it->y + it->h > pr->height) it->h = pr->height - it->y;
 
-	rt->tiles = g_list_prepend(rt->tiles, it);
+	g_queue_push_head(&rt->tiles, it);
+	g_hash_table_insert(rt->tile_index, it, rt->tiles.head);
 	rt->tile_cache_size += it->size;
 
 	return it;
@@ -342,48 +499,105 @@ void rt_tile_remove(RendererTiles *rt, ImageTile *it)
 		g_free(qd);
 		}
 
-	rt->tiles = g_list_remove(rt->tiles, it);
+	g_queue_delete_link(&rt->tiles, static_cast<GList *>(g_hash_table_lookup(rt->tile_index, it)));
+	g_hash_table_remove(rt->tile_index, it);
 	rt->tile_cache_size -= it->size;
 
-	rt_tile_free(it);
+	rt_tile_free(rt, it);
 }
 
-gint surface_calc_size(gint width, gint height)
-{
-	return cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, width) * height;
-}
-
-void rt_tile_free_space(RendererTiles *rt, guint space, ImageTile *it)
+/**
+ * @brief The memory the surfaces of the tiles may take
+ */
+guint rt_tile_cache_max(const RendererTiles *rt)
 {
-	PixbufRenderer *pr = rt->pr;
-	GList *work;
+	const PixbufRenderer *pr = rt->pr;
 	guint tile_max;
 
-	work = g_list_last(rt->tiles);
-
 	if (pr->source_tiles_enabled && pr->scale < 1.0)
 		{
 		gint tiles;
 
 		tiles = (pr->vis_width / rt->tile_width + 1) * (pr->vis_height / rt->tile_height + 1);
-		const gint tile_memory = surface_calc_size(rt->tile_width, rt->tile_height) +
-		                         (rt->tile_width * rt->tile_height * COLOR_BYTES);
+		const gint tile_memory = surface_calc_size(rt->tile_width, rt->tile_height);
 		tile_max = std::max<gint>(tiles * tile_memory,
 		                          pr->tile_cache_max * 1048576.0 * pr->scale);
 		}
 	else
 		{
+		/* the pyramid takes at most half of the tile cache */
 		tile_max = pr->tile_cache_max * 1048576;
+		tile_max -= std::min<gsize>(rt->pyramid_size, tile_max / 2);
 		}
 
+	return tile_max;
+}
+
+/**
+ * @brief The area of the tiles kept rendered around the view
+ *
+ * The ring is options->image.tile_prefetch tiles wide, twice as wide ahead
+ * of the last scroll. It is narrowed until its tiles fit in their part of
+ * the tile cache, an empty ring leaves the visible area. Source tiles are
+ * not prefetched, see rt_prefetch_enabled().
+ */
+GdkRectangle rt_prefetch_area(const RendererTiles *rt)
+{
+	const PixbufRenderer *pr = rt->pr;
+	const GdkRectangle visible{rt->x_scroll, rt->y_scroll, pr->vis_width, pr->vis_height};
+
+	if (pr->vis_width < 1 || pr->vis_height < 1 || pr->source_tiles_enabled) return visible;
+
+	const gsize budget = rt_tile_cache_max(rt) / TILE_PREFETCH_CACHE_DIVISOR;
+	const gsize tile_memory = surface_calc_size(rt->tile_width, rt->tile_height);
+
+	for (gint ring = std::max(0, options->image.tile_prefetch); ring > 0; ring--)
+		{
+		const gint ring_width = ring * rt->tile_width;
+		const gint ring_height = ring * rt->tile_height;
+
+		const gint x1 = ROUND_DOWN(std::max(0, rt->x_scroll - (ring_width * (rt->scroll_dx < 0 ? 2 : 1))), rt->tile_width);
+		const gint y1 = ROUND_DOWN(std::max(0, rt->y_scroll - (ring_height * (rt->scroll_dy < 0 ? 2 : 1))), rt->tile_height);
+		const gint x2 = std::min(pr->width, rt->x_scroll + pr->vis_width + (ring_width * (rt->scroll_dx > 0 ? 2 : 1)));
+		const gint y2 = std::min(pr->height, rt->y_scroll + pr->vis_height + (ring_height * (rt->scroll_dy > 0 ? 2 : 1)));
+
+		const gsize columns = (ROUND_UP(x2, rt->tile_width) - x1) / rt->tile_width;
+		const gsize rows = (ROUND_UP(y2, rt->tile_height) - y1) / rt->tile_height;
+
+		if (columns * rows * tile_memory <= budget) return {x1, y1, x2 - x1, y2 - y1};
+		}
+
+	return visible;
+}
+
+/**
+ * @brief Whether @a it is in @a area, but not visible
+ */
+gboolean rt_tile_is_prefetched(RendererTiles *rt, ImageTile *it, GdkRectangle area)
+{
+	return (it->x < area.x + area.width && it->x + it->w > area.x &&
+	        it->y < area.y + area.height && it->y + it->h > area.y &&
+	        !rt_tile_is_visible(rt, it));
+}
+
+void rt_tile_free_space(RendererTiles *rt, guint space, ImageTile *it)
+{
+	GList *work;
+
+	work = rt->tiles.tail;
+
+	const guint tile_max = rt_tile_cache_max(rt);
+	const GdkRectangle prefetch_area = rt_prefetch_area(rt);
+
 	while (work && rt->tile_cache_size + space > tile_max)
 		{
 		ImageTile *needle;
 
 		needle = static_cast<ImageTile *>(work->data);
 		work = work->prev;
-		if (needle != it &&
-		    ((!needle->qd && !needle->qd2) || !rt_tile_is_visible(rt, needle))) rt_tile_remove(rt, needle);
+		if (needle != it && !needle->rendering &&
+		    ((!needle->qd && !needle->qd2) || !rt_tile_is_visible(rt, needle)) &&
+		    !rt_tile_is_prefetched(rt, needle, prefetch_area)) rt_tile_remove(rt, needle);
 		}
 }
 
@@ -392,7 +606,9 @@ void rt_tile_invalidate_all(RendererTiles *rt)
 	PixbufRenderer *pr = rt->pr;
 	GList *work;
 
-	work = rt->tiles;
+	rt_render_cancel(rt);
+
+	work = rt->tiles.head;
 	while (work)
 		{
 		ImageTile *it;
@@ -411,22 +627,17 @@ void rt_tile_invalidate_all(RendererTiles *rt)
 
 ImageTile *rt_tile_get(RendererTiles *rt, gint x, gint y, gboolean only_existing)
 {
-	GList *work;
+	ImageTile key{};
 
-	work = rt->tiles;
-	while (work)
-		{
-		ImageTile *it;
+	key.x = x;
+	key.y = y;
 
-		it = static_cast<ImageTile *>(work->data);
-		if (it->x == x && it->y == y)
-			{
-			rt->tiles = g_list_delete_link(rt->tiles, work);
-			rt->tiles = g_list_prepend(rt->tiles, it);
-			return it;
-			}
-
-		work = work->next;
+	auto *work = static_cast<GList *>(g_hash_table_lookup(rt->tile_index, &key));
+	if (work)
+		{
+		g_queue_unlink(&rt->tiles, work);
+		g_queue_push_head_link(&rt->tiles, work);
+		return static_cast<ImageTile *>(work->data);
 		}
 
 	if (only_existing) return nullptr;
@@ -442,24 +653,12 @@ void rt_tile_prepare(RendererTiles *rt, ImageTile *it)
 
 		rt_tile_free_space(rt, size, it);
 
-		it->surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, rt->tile_width, rt->tile_height);
+		it->surface = static_cast<cairo_surface_t *>(g_queue_pop_head(&rt->surface_pool));
+		if (!it->surface) it->surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, rt->tile_width, rt->tile_height);
 
 		it->size += size;
 		rt->tile_cache_size += size;
 		}
-
-	if (!it->pixbuf)
-		{
-		GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->tile_width, rt->tile_height);
-
-		const guint size = gdk_pixbuf_get_rowstride(pixbuf) * rt->tile_height;
-
-		rt_tile_free_space(rt, size, it);
-
-		it->pixbuf = pixbuf;
-		it->size += size;
-		rt->tile_cache_size += size;
-		}
 }
 
 /*
@@ -642,12 +841,6 @@ void rt_scale_factor_changed_cb(GObject *, GParamSpec *, gpointer data)
 	auto *rt = static_cast<RendererTiles *>(data);
 	auto *widget = GTK_WIDGET(rt->pr);
 
-	if (rt->spare_tile)
-		{
-		g_object_unref(rt->spare_tile);
-		rt->spare_tile = nullptr;
-		}
-
 	rt_queue_clear(rt);
 	rt_tile_free_all(rt);
 	g_clear_pointer(&rt->surface, cairo_surface_destroy);
@@ -668,266 +861,86 @@ void rt_scale_factor_changed_cb(GObject *, GParamSpec *, gpointer data)
  *-------------------------------------------------------------------
  */
 
-GdkPixbuf *rt_get_spare_tile(RendererTiles *rt)
+/**
+ * @brief Buffers a thread scales tiles into before storing them to the tile surfaces
+ */
+struct TileScratch
 {
-	if (!rt->spare_tile) rt->spare_tile = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->tile_width, rt->tile_height);
-	return rt->spare_tile;
-}
+	GdkPixbuf *pixbuf;
+	GdkPixbuf *spare;	/* right image of anaglyphs */
+};
 
-void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_scratch_free(gpointer data)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *ip;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint j;
-	gint tw = rt->tile_width;
+	auto *scratch = static_cast<TileScratch *>(data);
 
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
-
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + ((tw - 1) * COLOR_BYTES);
-
-	for (i = y; i < y + h; i++)
-		{
-		sp = spi + (i * srs);
-		ip = dpi - (i * COLOR_BYTES);
-		for (j = x; j < x + w; j++)
-			{
-			dp = ip + (j * drs);
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			}
-		}
-
-	rt->spare_tile = src;
-	*tile = dest;
+	g_clear_object(&scratch->pixbuf);
+	g_clear_object(&scratch->spare);
+	g_free(scratch);
 }
 
-void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
-{
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *ip;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint j;
-	gint th = rt->tile_height;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
+GPrivate rt_tile_scratch_key = G_PRIVATE_INIT(rt_tile_scratch_free);
 
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + ((th - 1) * drs);
+/**
+ * @brief Returns the scratch buffers of the calling thread, at least tile sized
+ */
+TileScratch *rt_tile_scratch_get(gint tile_width, gint tile_height)
+{
+	auto *scratch = static_cast<TileScratch *>(g_private_get(&rt_tile_scratch_key));
 
-	for (i = y; i < y + h; i++)
+	if (!scratch)
 		{
-		sp = spi + (i * srs);
-		ip = dpi + (i * COLOR_BYTES);
-		for (j = x; j < x + w; j++)
-			{
-			dp = ip - (j * drs);
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			}
+		scratch = g_new0(TileScratch, 1);
+		g_private_set(&rt_tile_scratch_key, scratch);
 		}
 
-	rt->spare_tile = src;
-	*tile = dest;
-}
-
-void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
-{
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint j;
-
-	gint tw = rt->tile_width;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
-
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi =  d_pix + ((tw - x - 1) * COLOR_BYTES);
-
-	for (i = y; i < y + h; i++)
+	for (GdkPixbuf **buffer : {&scratch->pixbuf, &scratch->spare})
 		{
-		sp = spi + (i * srs);
-		dp = dpi + (i * drs);
-		for (j = 0; j < w; j++)
+		/* post processing may have replaced it */
+		if (*buffer && (gdk_pixbuf_get_width(*buffer) < tile_width ||
+		                gdk_pixbuf_get_height(*buffer) < tile_height ||
+		                gdk_pixbuf_get_has_alpha(*buffer)))
 			{
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			dp -= COLOR_BYTES;
+			g_clear_object(buffer);
 			}
+
+		if (!*buffer) *buffer = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, tile_width, tile_height);
 		}
 
-	rt->spare_tile = src;
-	*tile = dest;
+	return scratch;
 }
 
-void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+/**
+ * @brief Stores @a rect of @a pixbuf to the xRGB32 memory of a tile surface, in the orientation of the tile
+ * @param rect The region of the unoriented tile, as scaled from the image
+ *
+ * Orienting and converting the pixels take a single pass, only over @a rect.
+ * The caller flushes the surface before, and marks it dirty after.
+ */
+void rt_tile_store(GdkPixbuf *pixbuf, GdkRectangle rect, gint orientation,
+                   guchar *data, gint stride, gint tile_width, gint tile_height)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *dpi;
-	gint i;
-	gint j;
-	gint tw = rt->tile_width;
-	gint th = rt->tile_height;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + ((th - 1) * drs) + ((tw - 1) * COLOR_BYTES);
+	const PixelBuffer src{gdk_pixbuf_get_pixels(pixbuf), gdk_pixbuf_get_rowstride(pixbuf),
+	                      gdk_pixbuf_get_has_alpha(pixbuf) ? PixelFormat::RGBA : PixelFormat::RGB};
 
-	for (i = y; i < y + h; i++)
-		{
-		sp = s_pix + (i * srs) + (x * COLOR_BYTES);
-		dp = dpi - (i * drs) - (x * COLOR_BYTES);
-		for (j = 0; j < w; j++)
-			{
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			dp -= COLOR_BYTES;
-			}
-		}
-
-	rt->spare_tile = src;
-	*tile = dest;
+	pixbuf_transform_region(src, tile_width, tile_height, rect, {data, stride, PixelFormat::XRGB32}, orientation);
 }
 
-void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+/**
+ * @brief The overview of the source tiles if zoomed out further than its size, else nullptr
+ *
+ * Tiles are then scaled from the overview like from pr->pixbuf, instead of
+ * requesting every source tile in view.
+ */
+GdkPixbuf *rt_source_tile_overview(const RendererTiles *rt)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint th = rt->tile_height;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
-
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + ((th - 1) * drs) + (x * COLOR_BYTES);
+	const PixbufRenderer *pr = rt->pr;
+	GdkPixbuf *overview = pr->source_tiles_overview;
 
-	for (i = y; i < y + h; i++)
-		{
-		sp = spi + (i * srs);
-		dp = dpi - (i * drs);
-		memcpy(dp, sp, w * COLOR_BYTES);
-		}
+	if (!overview ||
+	    pr->width > gdk_pixbuf_get_width(overview) || pr->height > gdk_pixbuf_get_height(overview)) return nullptr;
 
-	rt->spare_tile = src;
-	*tile = dest;
-}
-
-void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
-{
-	switch (orientation)
-		{
-		case EXIF_ORIENTATION_TOP_LEFT:
-			/* normal -- nothing to do */
-			break;
-		case EXIF_ORIENTATION_TOP_RIGHT:
-			/* mirrored */
-			{
-				rt_tile_mirror_only(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_BOTTOM_RIGHT:
-			/* upside down */
-			{
-				rt_tile_mirror_and_flip(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_BOTTOM_LEFT:
-			/* flipped */
-			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_LEFT_TOP:
-			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_RIGHT_TOP:
-			/* rotated -90 (270) */
-			{
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_LEFT_BOTTOM:
-			/* rotated 90 */
-			{
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		default:
-			/* The other values are out of range */
-			break;
-		}
+	return overview;
 }
 
 /**
@@ -935,11 +948,12 @@ void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPixbuf **
  *        SourceTiles that the RendererTiles knows how to create/access.
  * @param rt The RendererTiles object.
  * @param it The ImageTile to render.
+ * @param pixbuf The tile sized buffer to render to.
  * @param x,y,w,h The sub-region of the ImageTile to render.
  * @retval TRUE We rendered something that needs to be drawn.
  * @retval FALSE We didn't render anything that needs to be drawn.
  */
-gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
+gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it, GdkPixbuf *pixbuf,
                                gint x, gint y, gint w, gint h,
                                gboolean, gboolean)
 {
@@ -968,7 +982,7 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 
 #if 0
 	// Draws red over draw region, to check for leaks (regions not filled)
-	pixbuf_set_rect_fill(it->pixbuf, x, y, w, h, {255, 0, 0, 255});
+	pixbuf_set_rect_fill(pixbuf, x, y, w, h, {255, 0, 0, 255});
 #endif
 
 	// Since the RendererTiles ImageTiles and PixbufRenderer SourceTiles are different
@@ -999,14 +1013,10 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 			if (st->blank)
 				{
 				// If this SourceTile has no contents, we just paint a black rect
-				// of the appropriate size.
-				cairo_t *cr = cairo_create(it->surface);
-				cairo_rectangle (cr, r.x - st->x, r.y - st->y, r.width, r.height);
-				cairo_set_source_rgb(cr, 0, 0, 0);
-				cairo_fill (cr);
-				cairo_destroy (cr);
-				// TODO(xsdg): We almost certainly need to set draw = TRUE in this branch.
-				// This may explain the smearing that we sometimes get when panning the view while drawing.
+				// of the appropriate size.  The pixbuf is a scratch buffer, so it is
+				// drawn as well.
+				pixbuf_set_rect_fill(pixbuf, r.x - it->x, r.y - it->y, r.width, r.height, {0, 0, 0, 255});
+				draw = TRUE;
 				}
 			else
 				{
@@ -1021,7 +1031,7 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 				// the scale factors.  Then we offset that intermediate image by the offsets.
 				// Next, we clip that offsetted image to the (x,y,w,h) region specified.  And
 				// lastly, we copy the resulting region into the _region with the same
-				// coordinates_ in it->pixbuf.
+				// coordinates_ in pixbuf.
 				//
 				// At this point, recall that we may need to render into ImageTile from multiple
 				// SourceTiles.  The region specified by r accounts for this, and thus,
@@ -1033,7 +1043,7 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 				// coordinates are not necessarily aligned, an offset will be negative if this
 				// SourceTile starts left of or above the ImageTile, positive if it starts in
 				// the middle of the ImageTile, or zero if the left or top edges are aligned.
-				gdk_pixbuf_scale(st->pixbuf, it->pixbuf,
+				gdk_pixbuf_scale(st->pixbuf, pixbuf,
 				                 r.x - it->x, r.y - it->y, r.width, r.height,
 				                 offset_x, offset_y,
 				                 scale_x, scale_y,
@@ -1043,9 +1053,187 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 			}
 		}
 
-	g_list_free(list);
+	g_list_free(list);
+
+	return draw;
+}
+
+/* pixbufs with fewer pixels are scaled from directly */
+constexpr gint64 PYRAMID_MIN_PIXELS = 4 * 1024 * 1024;
+/* the smallest level is the first one no larger than this */
+constexpr gint PYRAMID_MIN_SIZE = 256;
+
+/* one worker builds the pyramids of all renderers, created on first use */
+GThreadPool *rt_pyramid_pool = nullptr;
+
+void rt_pyramid_job_free(PyramidJob *job)
+{
+	g_object_unref(job->source);
+	g_list_free_full(job->levels, g_object_unref);
+	delete job;
+}
+
+gboolean rt_pyramid_done_cb(gpointer data)
+{
+	auto *job = static_cast<PyramidJob *>(data);
+	RendererTiles *rt = job->rt;
+
+	if (rt)
+		{
+		rt->pyramid_job = nullptr;
+		rt->pyramid_levels = job->levels;
+		job->levels = nullptr;
+
+		for (GList *work = rt->pyramid_levels; work; work = work->next)
+			{
+			auto *level = static_cast<GdkPixbuf *>(work->data);
+			rt->pyramid_size += static_cast<gsize>(gdk_pixbuf_get_rowstride(level)) * gdk_pixbuf_get_height(level);
+			}
+
+		DEBUG_1("pyramid of %d levels, %zu bytes", g_list_length(rt->pyramid_levels), rt->pyramid_size);
+		}
+
+	rt_pyramid_job_free(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+void rt_pyramid_build_run(gpointer data, gpointer)
+{
+	auto *job = static_cast<PyramidJob *>(data);
+	const auto unref_unless_kept = [job](GdkPixbuf *level)
+	{
+		if (level && level != job->source && !g_list_find(job->levels, level)) g_object_unref(level);
+	};
+
+	GdkPixbuf *level = job->source;
+	for (gint i = 1; i <= job->last_level && !job->cancelled; i++)
+		{
+		GdkPixbuf *half = pixbuf_scale_half(level, job->cancelled);
+		unref_unless_kept(level);
+
+		level = half;
+		if (!level) break;
+
+		if (i >= job->first_level) job->levels = g_list_append(job->levels, level);
+		}
+	unref_unless_kept(level);
+
+	g_idle_add(rt_pyramid_done_cb, job);
+}
+
+/**
+ * @brief Drops the pyramid, or cancels building it
+ */
+void rt_pyramid_clear(RendererTiles *rt)
+{
+	if (rt->pyramid_job)
+		{
+		rt->pyramid_job->rt = nullptr;
+		rt->pyramid_job->cancelled = true;
+		rt->pyramid_job = nullptr;
+		}
+
+	g_list_free_full(rt->pyramid_levels, g_object_unref);
+	rt->pyramid_levels = nullptr;
+	rt->pyramid_size = 0;
+
+	g_clear_object(&rt->pyramid_source);
+}
+
+/**
+ * @brief Starts building the pyramid of pr->pixbuf on the pyramid worker
+ *
+ * Jobs queue behind the one being built; a cancelled job stops within a row
+ * of the level it is halving, so switching images does not pile up threads.
+ *
+ * The levels that fit in half of the tile cache are kept, the smallest
+ * ones first. Nothing is built while the pixbuf is still being loaded.
+ */
+void rt_pyramid_build(RendererTiles *rt)
+{
+	PixbufRenderer *pr = rt->pr;
+	GdkPixbuf *pixbuf = pr->pixbuf;
+
+	if (pr->loading) return;
+
+	/* also for pixbufs without levels, so they are not looked at again */
+	rt->pyramid_source = static_cast<GdkPixbuf *>(g_object_ref(pixbuf));
+
+	gint width = gdk_pixbuf_get_width(pixbuf);
+	gint height = gdk_pixbuf_get_height(pixbuf);
+	if (static_cast<gint64>(width) * height < PYRAMID_MIN_PIXELS) return;
+
+	const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+	std::vector<gsize> sizes{0};
+	while (std::max(width, height) > PYRAMID_MIN_SIZE)
+		{
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		sizes.push_back(static_cast<gsize>(width) * height * channels);
+		}
+
+	const gsize budget = static_cast<gsize>(pr->tile_cache_max) * 1048576 / 2;
+	const gint last_level = sizes.size() - 1;
+	gint first_level = last_level + 1;
+	for (gsize total = 0; first_level > 1 && total + sizes[first_level - 1] <= budget; first_level--)
+		{
+		total += sizes[first_level - 1];
+		}
+
+	if (first_level > last_level) return;
+
+	auto *job = new PyramidJob;
+	job->rt = rt;
+	job->source = static_cast<GdkPixbuf *>(g_object_ref(pixbuf));
+	job->first_level = first_level;
+	job->last_level = last_level;
+
+	if (!rt_pyramid_pool)
+		{
+		rt_pyramid_pool = g_thread_pool_new(rt_pyramid_build_run, nullptr, 1, FALSE, nullptr);
+		}
+
+	rt->pyramid_job = job;
+	g_thread_pool_push(rt_pyramid_pool, job, nullptr);
+}
+
+/**
+ * @brief Returns the smallest level of the pyramid at least @a scale_x, @a scale_y times the size of pr->pixbuf
+ *
+ * Without such a level this is pr->pixbuf, and the pyramid is started if there is none.
+ * The scales are changed to those from the returned pixbuf.
+ */
+GdkPixbuf *rt_pyramid_get_level(RendererTiles *rt, gdouble &scale_x, gdouble &scale_y)
+{
+	PixbufRenderer *pr = rt->pr;
+
+	if (scale_x > 0.5 || scale_y > 0.5) return pr->pixbuf;
+
+	if (rt->pyramid_source != pr->pixbuf)
+		{
+		rt_pyramid_clear(rt);
+		rt_pyramid_build(rt);
+		return pr->pixbuf;
+		}
+
+	const gdouble width = gdk_pixbuf_get_width(pr->pixbuf);
+	const gdouble height = gdk_pixbuf_get_height(pr->pixbuf);
+	GdkPixbuf *pixbuf = pr->pixbuf;
+
+	for (GList *work = rt->pyramid_levels; work; work = work->next)
+		{
+		auto *level = static_cast<GdkPixbuf *>(work->data);
+		if (gdk_pixbuf_get_width(level) < width * scale_x ||
+		    gdk_pixbuf_get_height(level) < height * scale_y) break;
+
+		pixbuf = level;
+		}
+
+	scale_x *= width / gdk_pixbuf_get_width(pixbuf);
+	scale_y *= height / gdk_pixbuf_get_height(pixbuf);
 
-	return draw;
+	return pixbuf;
 }
 
 /**
@@ -1196,17 +1384,58 @@ gint rt_get_orientation(RendererTiles *rt)
 }
 
 
-void rt_tile_render(RendererTiles *rt, ImageTile *it,
-                    gint x, gint y, gint w, gint h,
-                    gboolean new_data, gboolean fast)
+/**
+ * @brief Renders the pixels of a job to the tile surface, on any thread
+ *
+ * The region is scaled to the scratch buffers of the thread, post processed
+ * there as the post processing is per pixel, and stored to the surface with
+ * its orientation applied.
+ */
+void rt_render_job_pixels(TileRenderJob &job)
+{
+	TileScratch *scratch = rt_tile_scratch_get(job.tile_width, job.tile_height);
+
+	rt_tile_get_region(job.has_alpha, job.ignore_alpha,
+	                   job.src, scratch->pixbuf, job.pb_rect,
+	                   job.offset_x, job.offset_y,
+	                   job.scale_x, job.scale_y,
+	                   job.interp_type,
+	                   job.it->x + job.pb_rect.x, job.it->y + job.pb_rect.y, job.wide_image);
+	if (job.anaglyph)
+		{
+		rt_tile_get_region(job.has_alpha, job.ignore_alpha,
+		                   job.src, scratch->spare, job.pb_rect,
+		                   job.left_offset_x, job.offset_y,
+		                   job.scale_x, job.scale_y,
+		                   job.interp_type,
+		                   job.it->x + job.pb_rect.x, job.it->y + job.pb_rect.y, job.wide_image);
+		pr_create_anaglyph(job.stereo_mode, scratch->pixbuf, scratch->spare, job.pb_rect.x, job.pb_rect.y, job.pb_rect.width, job.pb_rect.height);
+		}
+
+	if (job.post_process) job.post_process(job.pr, &scratch->pixbuf, job.pb_rect.x, job.pb_rect.y, job.pb_rect.width, job.pb_rect.height);
+
+	rt_tile_store(scratch->pixbuf, job.pb_rect, job.orientation, job.data, job.stride, job.tile_width, job.tile_height);
+}
+
+/**
+ * @brief Renders the specified region of @a it
+ * @retval TRUE The pixels are rendered by a job added to @a batch, the tile is drawn when it is done.
+ * @retval FALSE The tile is up to date.
+ *
+ * Blank tiles and source tiles are rendered here, scaling pr->pixbuf or the overview
+ * of the source tiles is left to the jobs.
+ */
+gboolean rt_tile_render(RendererTiles *rt, ImageTile *it,
+                        gint x, gint y, gint w, gint h,
+                        gboolean new_data, gboolean fast, TileRenderBatch *batch)
 {
 	PixbufRenderer *pr = rt->pr;
 	gboolean has_alpha;
-	gboolean draw = FALSE;
 	gint orientation = rt_get_orientation(rt);
 	gboolean wide_image = FALSE;
+	GdkPixbuf *overview = pr->source_tiles_enabled ? rt_source_tile_overview(rt) : nullptr;
 
-	if (it->render_todo == TileRender::NONE && it->surface && !new_data) return;
+	if (it->render_todo == TileRender::NONE && it->surface && !new_data) return FALSE;
 
 	if (it->render_done != TileRender::ALL)
 		{
@@ -1219,7 +1448,7 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 	else if (it->render_todo != TileRender::AREA)
 		{
 		if (!fast) it->render_todo = TileRender::NONE;
-		return;
+		return FALSE;
 		}
 
 	if (!fast) it->render_todo = TileRender::NONE;
@@ -1243,9 +1472,21 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 		cairo_fill (cr);
 		cairo_destroy (cr);
 		}
-	else if (pr->source_tiles_enabled)
+	else if (pr->source_tiles_enabled && !overview)
 		{
-		draw = rt_source_tile_render(rt, it, x, y, w, h, new_data, fast);
+		TileScratch *scratch = rt_tile_scratch_get(rt->tile_width, rt->tile_height);
+
+		if (rt_source_tile_render(rt, it, scratch->pixbuf, x, y, w, h, new_data, fast) && !it->blank)
+			{
+			if (pr->func_post_process && (!pr->post_process_slow || !fast))
+				pr->func_post_process(pr, &scratch->pixbuf, x, y, w, h);
+
+			cairo_surface_flush(it->surface);
+			rt_tile_store(scratch->pixbuf, {x, y, w, h}, EXIF_ORIENTATION_TOP_LEFT,
+			              cairo_image_surface_get_data(it->surface), cairo_image_surface_get_stride(it->surface),
+			              rt->tile_width, rt->tile_height);
+			cairo_surface_mark_dirty_rectangle(it->surface, x, y, w, h);
+			}
 		}
 	else
 		{
@@ -1254,7 +1495,7 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 		gdouble src_x;
 		gdouble src_y;
 
-		if (pr->image_width == 0 || pr->image_height == 0) return;
+		if (pr->image_width == 0 || pr->image_height == 0) return FALSE;
 
 		scale_x = static_cast<gdouble>(pr->width) / pr->image_width;
 		scale_y = static_cast<gdouble>(pr->height) / pr->image_height;
@@ -1281,61 +1522,75 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 				break;
 			}
 
+		/* the offsets are in tile pixels, from the scale of pr->pixbuf */
+		const gdouble right_offset_x = get_right_pixbuf_offset(rt) * scale_x;
+		const gdouble left_offset_x = get_left_pixbuf_offset(rt) * scale_x;
+
+		GdkPixbuf *src;
+		if (overview)
+			{
+			src = overview;
+			scale_x *= static_cast<gdouble>(pr->image_width) / gdk_pixbuf_get_width(overview);
+			scale_y *= static_cast<gdouble>(pr->image_height) / gdk_pixbuf_get_height(overview);
+			}
+		else
+			{
+			src = rt_pyramid_get_level(rt, scale_x, scale_y);
+			}
+
 		/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
 		 * small sizes for anything but GDK_INTERP_NEAREST
 		 */
 		if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) fast = TRUE;
-		if (gdk_pixbuf_get_width(pr->pixbuf) > 32767 ||
-		    gdk_pixbuf_get_height(pr->pixbuf) > 32767) wide_image = TRUE;
-
-		rt_tile_get_region(has_alpha, pr->ignore_alpha,
-		                   pr->pixbuf, it->pixbuf, pb_rect,
-		                   static_cast<gdouble>(0.0) - src_x - (get_right_pixbuf_offset(rt) * scale_x),
-		                   static_cast<gdouble>(0.0) - src_y,
-		                   scale_x, scale_y,
-		                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-		                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
-		if (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
-		    (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0))
-			{
-			GdkPixbuf *right_pb = rt_get_spare_tile(rt);
-			rt_tile_get_region(has_alpha, pr->ignore_alpha,
-			                   pr->pixbuf, right_pb, pb_rect,
-			                   static_cast<gdouble>(0.0) - src_x - (get_left_pixbuf_offset(rt) * scale_x),
-			                   static_cast<gdouble>(0.0) - src_y,
-			                   scale_x, scale_y,
-			                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-			                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
-			pr_create_anaglyph(rt->stereo_mode, it->pixbuf, right_pb, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
-			/* do not care about freeing spare_tile, it will be reused */
-			}
-		rt_tile_apply_orientation(rt, orientation, &it->pixbuf, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
-		draw = TRUE;
+		if (gdk_pixbuf_get_width(src) > 32767 ||
+		    gdk_pixbuf_get_height(src) > 32767) wide_image = TRUE;
+
+		TileRenderJob job{};
+
+		job.batch = batch;
+		job.it = it;
+		job.area = {x, y, w, h};
+		job.src = static_cast<GdkPixbuf *>(g_object_ref(src));
+		cairo_surface_flush(it->surface);
+		job.data = cairo_image_surface_get_data(it->surface);
+		job.stride = cairo_image_surface_get_stride(it->surface);
+		job.tile_width = rt->tile_width;
+		job.tile_height = rt->tile_height;
+		job.pb_rect = pb_rect;
+		job.offset_x = static_cast<gdouble>(0.0) - src_x - right_offset_x;
+		job.offset_y = static_cast<gdouble>(0.0) - src_y;
+		job.left_offset_x = static_cast<gdouble>(0.0) - src_x - left_offset_x;
+		job.scale_x = scale_x;
+		job.scale_y = scale_y;
+		job.interp_type = (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality;
+		job.has_alpha = has_alpha;
+		job.ignore_alpha = pr->ignore_alpha;
+		job.wide_image = wide_image;
+		job.anaglyph = (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
+		                (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0));
+		job.stereo_mode = rt->stereo_mode;
+		job.orientation = orientation;
+		job.pr = pr;
+		if (pr->func_post_process && (!pr->post_process_slow || !fast)) job.post_process = pr->func_post_process;
+
+		it->rendering = TRUE;
+		batch->jobs.push_back(std::move(job));
+
+		return TRUE;
 		}
 
-	if (draw && it->pixbuf && !it->blank)
-		{
-		if (pr->func_post_process && (!pr->post_process_slow || !fast))
-			pr->func_post_process(pr, &it->pixbuf, x, y, w, h);
-
-		cairo_t *cr = cairo_create(it->surface);
-		cairo_rectangle (cr, x, y, w, h);
-		gdk_cairo_set_source_pixbuf(cr, it->pixbuf, 0, 0);
-		cairo_fill(cr);
-
-		cairo_destroy (cr);
-		}
+	return FALSE;
 }
 
-
-void rt_tile_expose(RendererTiles *rt, ImageTile *it,
-                    gint x, gint y, gint w, gint h,
-                    gboolean new_data, gboolean fast)
+/**
+ * @brief Clamps the region of @a it to the visible area
+ * @returns FALSE when none of it is visible
+ */
+gboolean rt_tile_clamp_to_visible(RendererTiles *rt, ImageTile *it,
+                                  gint &x, gint &y, gint &w, gint &h)
 {
 	PixbufRenderer *pr = rt->pr;
-	cairo_t *cr;
 
-	/* clamp to visible */
 	if (it->x + x < rt->x_scroll)
 		{
 		w -= rt->x_scroll - it->x - x;
@@ -1345,7 +1600,7 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		w = rt->x_scroll + pr->vis_width - it->x - x;
 		}
-	if (w < 1) return;
+	if (w < 1) return FALSE;
 	if (it->y + y < rt->y_scroll)
 		{
 		h -= rt->y_scroll - it->y - y;
@@ -1355,9 +1610,18 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		h = rt->y_scroll + pr->vis_height - it->y - y;
 		}
-	if (h < 1) return;
 
-	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+	return h >= 1;
+}
+
+/**
+ * @brief Draws the region of @a it to the window surface, to be presented with the next frame
+ */
+void rt_tile_composite(RendererTiles *rt, ImageTile *it,
+                       gint x, gint y, gint w, gint h)
+{
+	PixbufRenderer *pr = rt->pr;
+	cairo_t *cr;
 
 	cr = cairo_create(rt->surface);
 	cairo_set_source_surface(cr, it->surface, pr->x_offset + (it->x - rt->x_scroll) + rt->stereo_off_x, pr->y_offset + (it->y - rt->y_scroll) + rt->stereo_off_y);
@@ -1368,6 +1632,18 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 	rt->draw_pending = TRUE;
 }
 
+void rt_tile_expose(RendererTiles *rt, ImageTile *it,
+                    gint x, gint y, gint w, gint h,
+                    gboolean new_data, gboolean fast, TileRenderBatch *batch)
+{
+	if (!rt_tile_clamp_to_visible(rt, it, x, y, w, h)) return;
+
+	/* a rendered tile is drawn when its batch is done */
+	if (rt_tile_render(rt, it, x, y, w, h, new_data, fast, batch)) return;
+
+	rt_tile_composite(rt, it, x, y, w, h);
+}
+
 
 gboolean rt_tile_is_visible(RendererTiles *rt, ImageTile *it)
 {
@@ -1458,6 +1734,327 @@ void queue_data_merge(QueueData *parent, const QueueData *qd)
 	parent->new_data |= qd->new_data;
 }
 
+/* shared by all renderers, started with the first batch */
+GThreadPool *rt_render_pool = nullptr;
+
+guint rt_render_threads()
+{
+	return std::max(1U, g_get_num_processors());
+}
+
+void rt_render_batch_free(TileRenderBatch *batch)
+{
+	/* the last job may still hold the lock */
+	g_mutex_lock(&batch->lock);
+	g_mutex_unlock(&batch->lock);
+
+	for (TileRenderJob &job : batch->jobs)
+		{
+		g_object_unref(job.src);
+		}
+
+	g_mutex_clear(&batch->lock);
+	g_cond_clear(&batch->done);
+	delete batch;
+}
+
+/**
+ * @brief Hands the surface written by @a job back to the main thread
+ */
+void rt_render_job_finish(TileRenderJob &job)
+{
+	job.it->rendering = FALSE;
+	cairo_surface_mark_dirty_rectangle(job.it->surface, job.area.x, job.area.y, job.area.width, job.area.height);
+}
+
+gboolean rt_render_batch_done_cb(gpointer data)
+{
+	auto *batch = static_cast<TileRenderBatch *>(data);
+	RendererTiles *rt = batch->rt;
+
+	if (rt)
+		{
+		rt->render_batch = nullptr;
+
+		for (TileRenderJob &job : batch->jobs)
+			{
+			ImageTile *it = job.it;
+			rt_render_job_finish(job);
+
+			/* the view may have scrolled meanwhile */
+			gint x = job.area.x;
+			gint y = job.area.y;
+			gint w = job.area.width;
+			gint h = job.area.height;
+			if (rt_tile_clamp_to_visible(rt, it, x, y, w, h)) rt_tile_composite(rt, it, x, y, w, h);
+			}
+
+		if (g_queue_is_empty(&rt->draw_queue) && g_queue_is_empty(&rt->draw_queue_2pass))
+			{
+			rt_present_pending(rt);
+			if (!batch->prefetch) pr_render_complete_signal(rt->pr);
+			rt_prefetch_schedule(rt);
+			}
+		else
+			{
+			/* show the first pass while the second one is rendered */
+			if (g_queue_is_empty(&rt->draw_queue)) rt_present_pending(rt);
+
+			if (!rt->draw_idle_id) rt_queue_schedule_next_draw(rt, TRUE);
+			}
+		}
+
+	rt_render_batch_free(batch);
+
+	return G_SOURCE_REMOVE;
+}
+
+void rt_render_job_run(gpointer data, gpointer)
+{
+	auto *job = static_cast<TileRenderJob *>(data);
+	TileRenderBatch *batch = job->batch;
+
+	if (!batch->cancelled)
+		{
+		rt_render_job_pixels(*job);
+		job->rendered = TRUE;
+		}
+
+	g_mutex_lock(&batch->lock);
+	batch->running--;
+	if (batch->running == 0)
+		{
+		g_idle_add_full(GDK_PRIORITY_REDRAW, rt_render_batch_done_cb, batch, nullptr);
+		g_cond_broadcast(&batch->done);
+		}
+	g_mutex_unlock(&batch->lock);
+}
+
+TileRenderBatch *rt_render_batch_new(RendererTiles *rt)
+{
+	auto *batch = new TileRenderBatch();
+
+	batch->rt = rt;
+	g_mutex_init(&batch->lock);
+	g_cond_init(&batch->done);
+
+	return batch;
+}
+
+/**
+ * @brief Renders the jobs of @a batch on the render threads
+ */
+void rt_render_batch_start(RendererTiles *rt, TileRenderBatch *batch)
+{
+	if (!rt_render_pool)
+		{
+		rt_render_pool = g_thread_pool_new(rt_render_job_run, nullptr, rt_render_threads(), FALSE, nullptr);
+		}
+
+	rt->render_batch = batch;
+	batch->running = batch->jobs.size();
+
+	for (TileRenderJob &job : batch->jobs)
+		{
+		g_thread_pool_push(rt_render_pool, &job, nullptr);
+		}
+}
+
+/**
+ * @brief Drops the tiles being rendered, they are queued to be rendered again
+ *
+ * Waits for the jobs already running, the others are skipped. The tiles
+ * of a prefetch batch are not queued, those already rendered are kept.
+ */
+void rt_render_cancel(RendererTiles *rt)
+{
+	TileRenderBatch *batch = rt->render_batch;
+
+	if (!batch) return;
+
+	rt->render_batch = nullptr;
+	batch->rt = nullptr;
+	batch->cancelled = true;
+
+	g_mutex_lock(&batch->lock);
+	while (batch->running > 0) g_cond_wait(&batch->done, &batch->lock);
+	g_mutex_unlock(&batch->lock);
+
+	for (TileRenderJob &job : batch->jobs)
+		{
+		ImageTile *it = job.it;
+
+		rt_render_job_finish(job);
+		if (batch->prefetch && job.rendered) continue;
+
+		it->render_done = TileRender::NONE;
+		it->render_todo = TileRender::ALL;
+		if (batch->prefetch) continue;
+
+		auto qd = g_new(QueueData, 1);
+		*qd = {it, 0, 0, it->w, it->h, FALSE};
+		if (it->qd)
+			{
+			queue_data_merge(it->qd, qd);
+			g_free(qd);
+			}
+		else
+			{
+			it->qd = qd;
+			g_queue_push_head(&rt->draw_queue, qd);
+			}
+		}
+
+	if (!batch->prefetch && !rt->draw_idle_id) rt_queue_schedule_next_draw(rt, TRUE);
+}
+
+void renderer_cancel_render(void *renderer)
+{
+	rt_render_cancel(static_cast<RendererTiles *>(renderer));
+}
+
+/*
+ *-------------------------------------------------------------------
+ * prefetch
+ *-------------------------------------------------------------------
+ */
+
+/**
+ * @brief Whether the tiles around the view can be rendered, once the view is drawn
+ *
+ * Not with source tiles, reading those from the image file takes far longer
+ * than rendering a tile and would hold up the tiles that are seen.
+ */
+gboolean rt_prefetch_enabled(RendererTiles *rt)
+{
+	PixbufRenderer *pr = rt->pr;
+
+	return (options->image.tile_prefetch > 0 &&
+	        pr->pixbuf && !pr->source_tiles_enabled && !pr->loading &&
+	        gtk_widget_get_realized(GTK_WIDGET(pr)) &&
+	        !rt->render_batch && !rt->draw_idle_id &&
+	        g_queue_is_empty(&rt->draw_queue) && g_queue_is_empty(&rt->draw_queue_2pass));
+}
+
+/**
+ * @brief Whether @a it has to be rendered to be shown
+ */
+gboolean rt_prefetch_tile_needed(const ImageTile *it)
+{
+	return (!it->rendering &&
+	        (!it->surface || it->render_done != TileRender::ALL || it->render_todo == TileRender::AREA));
+}
+
+struct PrefetchTile
+{
+	gint distance;	/* to the view in tiles, doubled, less one ahead of the last scroll */
+	gint x;
+	gint y;
+};
+
+/**
+ * @brief Renders the next batch of tiles around the view, the nearest first
+ */
+gboolean rt_prefetch_idle_cb(gpointer data)
+{
+	auto rt = static_cast<RendererTiles *>(data);
+	PixbufRenderer *pr = rt->pr;
+
+	if (!rt_prefetch_enabled(rt))
+		{
+		rt->prefetch_idle_id = 0;
+		return G_SOURCE_REMOVE;
+		}
+
+	const GdkRectangle area = rt_prefetch_area(rt);
+	const gint vx1 = rt->x_scroll;
+	const gint vy1 = rt->y_scroll;
+	const gint vx2 = rt->x_scroll + pr->vis_width;
+	const gint vy2 = rt->y_scroll + pr->vis_height;
+
+	std::vector<PrefetchTile> tiles;
+
+	for (gint y = ROUND_DOWN(area.y, rt->tile_height); y < area.y + area.height; y += rt->tile_height)
+		{
+		for (gint x = ROUND_DOWN(area.x, rt->tile_width); x < area.x + area.width; x += rt->tile_width)
+			{
+			ImageTile key{};
+			key.x = x;
+			key.y = y;
+			key.w = std::min(rt->tile_width, pr->width - x);
+			key.h = std::min(rt->tile_height, pr->height - y);
+
+			if (rt_tile_is_visible(rt, &key)) continue;
+
+			auto *work = static_cast<GList *>(g_hash_table_lookup(rt->tile_index, &key));
+			if (work && !rt_prefetch_tile_needed(static_cast<ImageTile *>(work->data))) continue;
+
+			const gint dx = (x + key.w <= vx1) ? 1 + ((vx1 - x - key.w) / rt->tile_width) :
+			                (x >= vx2) ? 1 + ((x - vx2) / rt->tile_width) : 0;
+			const gint dy = (y + key.h <= vy1) ? 1 + ((vy1 - y - key.h) / rt->tile_height) :
+			                (y >= vy2) ? 1 + ((y - vy2) / rt->tile_height) : 0;
+			const gboolean ahead = (rt->scroll_dx < 0 && x < vx1) || (rt->scroll_dx > 0 && x + key.w > vx2) ||
+			                       (rt->scroll_dy < 0 && y < vy1) || (rt->scroll_dy > 0 && y + key.h > vy2);
+
+			tiles.push_back({(2 * std::max(dx, dy)) - (ahead ? 1 : 0), x, y});
+			}
+		}
+
+	if (tiles.empty())
+		{
+		/* all done, until the view changes */
+		rt->prefetch_idle_id = 0;
+		return G_SOURCE_REMOVE;
+		}
+
+	std::stable_sort(tiles.begin(), tiles.end(),
+	                 [](const PrefetchTile &a, const PrefetchTile &b) { return a.distance < b.distance; });
+
+	const guint batch_max = rt_render_threads() * TILE_RENDER_JOBS_PER_THREAD;
+	TileRenderBatch *batch = rt_render_batch_new(rt);
+
+	batch->prefetch = TRUE;
+
+	for (guint i = 0; i < batch_max && i < tiles.size(); i++)
+		{
+		ImageTile *it = rt_tile_get(rt, tiles[i].x, tiles[i].y, FALSE);
+
+		rt_tile_render(rt, it, 0, 0, it->w, it->h, FALSE, FALSE, batch);
+		}
+
+	if (batch->jobs.empty())
+		{
+		rt_render_batch_free(batch);
+		return G_SOURCE_CONTINUE;
+		}
+
+	rt_render_batch_start(rt, batch);
+
+	/* continued when the batch is done */
+	rt->prefetch_idle_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Starts rendering the tiles around the view at low priority
+ */
+void rt_prefetch_schedule(RendererTiles *rt)
+{
+	if (rt->prefetch_idle_id || !rt_prefetch_enabled(rt)) return;
+
+	rt->prefetch_idle_id = g_idle_add_full(G_PRIORITY_LOW, rt_prefetch_idle_cb, rt, nullptr);
+}
+
+/**
+ * @brief Stops rendering the tiles around the view, they are chosen again when the view is drawn
+ */
+void rt_prefetch_cancel(RendererTiles *rt)
+{
+	g_clear_handle_id(&rt->prefetch_idle_id, g_source_remove);
+
+	if (rt->render_batch && rt->render_batch->prefetch) rt_render_cancel(rt);
+}
+
 gboolean rt_queue_draw_idle_cb(gpointer data)
 {
 	auto rt = static_cast<RendererTiles *>(data);
@@ -1466,6 +2063,13 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 	gboolean fast;
 	const gboolean first_pass = !g_queue_is_empty(&rt->draw_queue);
 
+	if (rt->render_batch)
+		{
+		/* continued when the batch is done */
+		rt->draw_idle_id = 0;
+		return G_SOURCE_REMOVE;
+		}
+
 	if ((!pr->pixbuf && !pr->source_tiles_enabled) ||
 	    (g_queue_is_empty(&rt->draw_queue) && g_queue_is_empty(&rt->draw_queue_2pass)) ||
 	    !rt->draw_idle_id)
@@ -1474,12 +2078,12 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 		pr_render_complete_signal(pr);
 
 		rt->draw_idle_id = 0;
+		rt_prefetch_schedule(rt);
 		return G_SOURCE_REMOVE;
 		}
 
 	if (first_pass)
 		{
-		qd = static_cast<QueueData *>(g_queue_peek_head(&rt->draw_queue));
 		fast = (pr->zoom_2pass && ((pr->zoom_quality != GDK_INTERP_NEAREST && pr->scale != 1.0) || pr->post_process_slow));
 		}
 	else
@@ -1492,56 +2096,71 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 			return rt_queue_schedule_next_draw(rt, FALSE);
 			}
 
-		qd = static_cast<QueueData *>(g_queue_peek_head(&rt->draw_queue_2pass));
 		fast = FALSE;
 		}
 
-	if (gtk_widget_get_realized(GTK_WIDGET(pr)))
+	GQueue *queue = first_pass ? &rt->draw_queue : &rt->draw_queue_2pass;
+	TileRenderBatch *batch = rt_render_batch_new(rt);
+	const guint batch_max = rt_render_threads() * TILE_RENDER_JOBS_PER_THREAD;
+
+	for (guint i = 0; i < batch_max && (qd = static_cast<QueueData *>(g_queue_pop_head(queue))); i++)
 		{
-		if (rt_tile_is_visible(rt, qd->it))
+		if (gtk_widget_get_realized(GTK_WIDGET(pr)))
 			{
-			rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
-			}
-		else if (qd->new_data)
-			{
-			/* if new pixel data, and we already have a pixmap, update the tile */
-			qd->it->blank = FALSE;
-			if (qd->it->surface && qd->it->render_done == TileRender::ALL)
+			if (rt_tile_is_visible(rt, qd->it))
+				{
+				rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast, batch);
+				}
+			else if (qd->new_data)
 				{
-				rt_tile_render(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
+				/* if new pixel data, and we already have a pixmap, update the tile */
+				qd->it->blank = FALSE;
+				if (qd->it->surface && qd->it->render_done == TileRender::ALL)
+					{
+					rt_tile_render(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast, batch);
+					}
 				}
 			}
-		}
 
-	if (first_pass)
-		{
-		qd->it->qd = nullptr;
-		g_queue_pop_head(&rt->draw_queue);
-		if (fast)
+		if (first_pass)
 			{
-			if (qd->it->qd2)
+			qd->it->qd = nullptr;
+			if (fast)
 				{
-				queue_data_merge(qd->it->qd2, qd);
-				g_free(qd);
+				if (qd->it->qd2)
+					{
+					queue_data_merge(qd->it->qd2, qd);
+					g_free(qd);
+					}
+				else
+					{
+					qd->it->qd2 = qd;
+					g_queue_push_tail(&rt->draw_queue_2pass, qd);
+					}
 				}
 			else
 				{
-				qd->it->qd2 = qd;
-				g_queue_push_tail(&rt->draw_queue_2pass, qd);
+				g_free(qd);
 				}
 			}
 		else
 			{
+			qd->it->qd2 = nullptr;
 			g_free(qd);
 			}
 		}
-	else
+
+	if (!batch->jobs.empty())
 		{
-		qd->it->qd2 = nullptr;
-		g_queue_pop_head(&rt->draw_queue_2pass);
-		g_free(qd);
+		rt_render_batch_start(rt, batch);
+
+		/* continued when the batch is done */
+		rt->draw_idle_id = 0;
+		return G_SOURCE_REMOVE;
 		}
 
+	rt_render_batch_free(batch);
+
 	if (g_queue_is_empty(&rt->draw_queue) && g_queue_is_empty(&rt->draw_queue_2pass))
 		{
 		/* Present all tiles updated by this render batch in one frame. */
@@ -1549,6 +2168,7 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 		pr_render_complete_signal(pr);
 
 		rt->draw_idle_id = 0;
+		rt_prefetch_schedule(rt);
 		return G_SOURCE_REMOVE;
 		}
 
@@ -1566,6 +2186,9 @@ void rt_queue_data_free(gpointer data)
 
 void rt_queue_clear(RendererTiles *rt)
 {
+	rt_prefetch_cancel(rt);
+	rt_render_cancel(rt);
+
 	g_queue_clear_full(&rt->draw_queue, rt_queue_data_free);
 	g_queue_clear_full(&rt->draw_queue_2pass, rt_queue_data_free);
 
@@ -1668,6 +2291,9 @@ void rt_queue(RendererTiles *rt, gint x, gint y, gint w, gint h,
 
 	rt_sync_scroll(rt);
 
+	/* the view comes first, what is around it is rendered when it is drawn */
+	rt_prefetch_cancel(rt);
+
 	if (pr->width < 1 || pr->height < 1) return;
 
 	gint nx = std::clamp(x, 0, pr->width - 1);
@@ -1696,6 +2322,10 @@ void renderer_scroll(void *renderer, gint x_off, gint y_off)
 	if (rt->stereo_mode & PR_STEREO_MIRROR) x_off = -x_off;
 	if (rt->stereo_mode & PR_STEREO_FLIP) y_off = -y_off;
 
+	/* the tiles ahead are rendered first */
+	rt->scroll_dx = (x_off > 0) - (x_off < 0);
+	rt->scroll_dy = (y_off > 0) - (y_off < 0);
+
 	gint w = pr->vis_width - abs(x_off);
 	gint h = pr->vis_height - abs(y_off);
 
@@ -1759,6 +2389,9 @@ void renderer_area_changed(void *renderer, GdkRectangle src)
 	gint x2;
 	gint y2;
 
+	/* the pixels changed, the pyramid is built again when loading is done */
+	rt_pyramid_clear(rt);
+
 	gint orientation = rt_get_orientation(rt);
 	src.x -= get_right_pixbuf_offset(rt);
 	GdkRectangle rect = pr_coords_map_orientation_reverse(orientation, src,
@@ -1800,7 +2433,13 @@ void rt_redraw(RendererTiles *rt, GdkRectangle rect,
 
 void renderer_update_pixbuf(void *renderer, gboolean)
 {
-	rt_queue_clear(static_cast<RendererTiles *>(renderer));
+	auto rt = static_cast<RendererTiles *>(renderer);
+
+	rt_queue_clear(rt);
+	rt_pyramid_clear(rt);
+
+	rt->scroll_dx = 0;
+	rt->scroll_dy = 0;
 }
 
 void renderer_update_zoom(void *renderer, gboolean lazy)
@@ -1826,7 +2465,7 @@ void renderer_invalidate_region(void *renderer, GdkRectangle region)
 	const gint y1 = ROUND_DOWN(region.y, rt->tile_height);
 	const gint y2 = ROUND_UP(region.y + region.height, rt->tile_height);
 
-	for (GList *work = rt->tiles; work; work = work->next)
+	for (GList *work = rt->tiles.head; work; work = work->next)
 		{
 		auto *it = static_cast<ImageTile *>(work->data);
 
@@ -1888,7 +2527,8 @@ void renderer_free(void *renderer)
 	auto rt = static_cast<RendererTiles *>(renderer);
 	rt_queue_clear(rt);
 	rt_tile_free_all(rt);
-	if (rt->spare_tile) g_object_unref(rt->spare_tile);
+	g_hash_table_destroy(rt->tile_index);
+	rt_pyramid_clear(rt);
 	g_list_free_full(rt->overlay_list, reinterpret_cast<GDestroyNotify>(overlay_data_free));
 	g_clear_pointer(&rt->overlay_buffer, cairo_surface_destroy);
 	g_signal_handlers_disconnect_matched(G_OBJECT(rt->pr), G_SIGNAL_MATCH_DATA,
@@ -2007,12 +2647,15 @@ RendererFuncs *renderer_tiles_new(PixbufRenderer *pr)
 	rt->f.overlay_get = renderer_tiles_overlay_get;
 
 	rt->f.stereo_set = renderer_stereo_set;
+	rt->f.cancel_render = renderer_cancel_render;
 
 	rt->tile_width = options->image.tile_size;
 	rt->tile_height = options->image.tile_size;
 
-	rt->tiles = nullptr;
+	g_queue_init(&rt->tiles);
+	rt->tile_index = g_hash_table_new(rt_tile_hash, rt_tile_equal);
 	rt->tile_cache_size = 0;
+	g_queue_init(&rt->surface_pool);
 	g_queue_init(&rt->draw_queue);
 	g_queue_init(&rt->draw_queue_2pass);
 
@@ -1671,11 +1671,24 @@ static gboolean search_file_do_extra(SearchData *sd, MatchFileData &mfd, gboolea
 		{
 		sd->img_cd = std::make_unique<CacheData>(mfd.fd->path);
 
+		/* The size alone can usually be read from the file header */
+		if (sd->match_dimensions_enable && !sd->img_cd->dimensions &&
+		    !(sd->match_similarity_enable && !sd->img_cd->similarity) &&
+		    !sd->match_broken_enable)
+			{
+			/* A decode would block, that is left to the image loader below */
+			if (GqSize dimensions; image_load_dimensions_probe(mfd.fd, dimensions))
+				{
+				sd->img_cd->set_dimensions(dimensions);
+				}
+			}
+
 		if ((sd->match_dimensions_enable && !sd->img_cd->dimensions) ||
 		    (sd->match_similarity_enable && !sd->img_cd->similarity) ||
 		    sd->match_broken_enable)
 			{
 			sd->img_loader = image_loader_new(mfd.fd);
+			image_loader_set_queue(sd->img_loader, IMAGE_LOADER_QUEUE_BACKGROUND);
 			g_signal_connect(G_OBJECT(sd->img_loader), "error", (GCallback)search_file_load_done_cb, sd);
 			g_signal_connect(G_OBJECT(sd->img_loader), "done", (GCallback)search_file_load_done_cb, sd);
 			if (image_loader_start(sd->img_loader))
@@ -0,0 +1,264 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "similar-index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+
+#include "similar.h"
+
+namespace
+{
+
+constexpr gint SIM_GRID_SIZE = 32;
+constexpr gint COARSE_CELL = SIM_GRID_SIZE / ImageSimilarityIndex::COARSE_GRID;
+constexpr gint COARSE_PLANE = ImageSimilarityIndex::COARSE_GRID * ImageSimilarityIndex::COARSE_GRID;
+constexpr gdouble SIM_MAX_DIFF = 255.0 * 1024.0 * 3.0;
+
+void coarse_plane_fill(const guint8 *plane, guint16 *sums)
+{
+	std::fill(sums, sums + COARSE_PLANE, 0);
+
+	for (gint y = 0; y < SIM_GRID_SIZE; y++)
+		{
+		guint16 *row = sums + ((y / COARSE_CELL) * ImageSimilarityIndex::COARSE_GRID);
+
+		for (gint x = 0; x < SIM_GRID_SIZE; x++)
+			{
+			row[x / COARSE_CELL] += plane[(y * SIM_GRID_SIZE) + x];
+			}
+		}
+}
+
+ImageSimilarityIndex::Coarse coarse_new(const guint8 *r, const guint8 *g, const guint8 *b)
+{
+	ImageSimilarityIndex::Coarse coarse;
+
+	coarse_plane_fill(r, coarse.data());
+	coarse_plane_fill(g, coarse.data() + COARSE_PLANE);
+	coarse_plane_fill(b, coarse.data() + (2 * COARSE_PLANE));
+
+	return coarse;
+}
+
+/* |sum(a) - sum(b)| <= sum(|a - b|) for each block, so this is a lower bound of the full distance */
+guint coarse_distance(const ImageSimilarityIndex::Coarse &a, const ImageSimilarityIndex::Coarse &b)
+{
+	guint distance = 0;
+
+	for (gsize i = 0; i < a.size(); i++)
+		{
+		distance += abs(a[i] - b[i]);
+		}
+
+	return distance;
+}
+
+} // namespace
+
+ImageSimilarityIndex::ImageSimilarityIndex(const std::vector<const ImageSimilarityData *> &items)
+	: coarse(items.size())
+	, root(-1)
+{
+	Work work;
+	work.reserve(items.size());
+
+	for (gsize i = 0; i < items.size(); i++)
+		{
+		const ImageSimilarityData *sd = items[i];
+
+		/* An unfilled fingerprint never matches anything */
+		if (!image_sim_filled(sd)) continue;
+
+		coarse[i] = coarse_new(sd->avg_r.data(), sd->avg_g.data(), sd->avg_b.data());
+		work.emplace_back(i, 0);
+		}
+
+	nodes.reserve(work.size());
+	root = build(work.begin(), work.end());
+}
+
+gint ImageSimilarityIndex::build(Work::iterator begin, Work::iterator end)
+{
+	if (begin == end) return -1;
+
+	const gint node = nodes.size();
+	nodes.push_back({begin->first, 0, -1, -1});
+
+	const Coarse &vantage = coarse[begin->first];
+	for (auto it = begin + 1; it != end; ++it)
+		{
+		it->second = coarse_distance(vantage, coarse[it->first]);
+		}
+
+	auto mid = begin + 1 + ((end - begin - 1) / 2);
+	if (mid != end)
+		{
+		std::nth_element(begin + 1, mid, end, [](const auto &a, const auto &b){ return a.second < b.second; });
+		nodes[node].radius = mid->second;
+		}
+
+	/* nodes may be reallocated by the recursion */
+	const gint inside = build(begin + 1, mid);
+	nodes[node].inside = inside;
+	const gint outside = build(mid, end);
+	nodes[node].outside = outside;
+
+	return node;
+}
+
+void ImageSimilarityIndex::search(gint node, const Coarse &query, guint limit, std::vector<gsize> &found) const
+{
+	while (node >= 0)
+		{
+		const Node &n = nodes[node];
+		const guint distance = coarse_distance(query, coarse[n.item]);
+
+		if (distance <= limit) found.push_back(n.item);
+
+		const bool visit_inside = distance <= static_cast<guint64>(n.radius) + limit;
+		const bool visit_outside = static_cast<guint64>(distance) + limit >= n.radius;
+
+		if (visit_inside && visit_outside)
+			{
+			search(n.inside, query, limit, found);
+			node = n.outside;
+			}
+		else
+			{
+			node = visit_inside ? n.inside : (visit_outside ? n.outside : -1);
+			}
+		}
+}
+
+std::vector<gsize> ImageSimilarityIndex::candidates(const ImageSimilarityTransforms &needle, gdouble min) const
+{
+	std::vector<gsize> found;
+
+	if (!image_sim_filled(needle.sd)) return found;
+
+	/* Round up, the full comparison makes the final decision */
+	const guint limit = std::ceil(std::max(0.0, 1.0 - min) * SIM_MAX_DIFF);
+
+	for (gint t = 0; t < needle.count; t++)
+		{
+		const ImageSimilarityTransforms::Planes &planes = needle.planes[t];
+
+		search(root, coarse_new(planes[0].data(), planes[1].data(), planes[2].data()), limit, found);
+		}
+
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+
+	return found;
+}
+
+ImageSimilarityHashIndex::ImageSimilarityHashIndex(const std::vector<const ImageSimilarityData *> &items)
+	: hashes(items.size())
+	, indexed(items.size())
+{
+	for (gsize i = 0; i < items.size(); i++)
+		{
+		if (!image_sim_filled(items[i])) continue;
+
+		hashes[i] = items[i]->phash;
+		indexed[i] = true;
+		}
+
+	/* counting sort of the items by each chunk */
+	for (gint c = 0; c < CHUNKS; c++)
+		{
+		const auto chunk = [c](guint64 hash) { return (hash >> (c * CHUNK_BITS)) & (CHUNK_VALUES - 1); };
+
+		offsets[c].assign(CHUNK_VALUES + 1, 0);
+		for (gsize i = 0; i < items.size(); i++)
+			{
+			if (indexed[i]) offsets[c][chunk(hashes[i]) + 1]++;
+			}
+
+		for (gsize v = 0; v < CHUNK_VALUES; v++)
+			{
+			offsets[c][v + 1] += offsets[c][v];
+			}
+
+		std::vector<guint32> fill(offsets[c].cbegin(), offsets[c].cend() - 1);
+		buckets[c].resize(offsets[c][CHUNK_VALUES]);
+		for (gsize i = 0; i < items.size(); i++)
+			{
+			if (indexed[i]) buckets[c][fill[chunk(hashes[i])]++] = i;
+			}
+		}
+}
+
+/**
+ * @brief Maps a similarity threshold to a Hamming radius
+ *
+ * A threshold of 95% allows 10 bits. The radius is capped so that at most
+ * 5 bits per chunk are flipped.
+ */
+guint ImageSimilarityHashIndex::radius_for_threshold(gdouble min)
+{
+	return std::clamp<gint>(std::lround((1.0 - min) * 192.0), 0, (CHUNKS * 6) - 1);
+}
+
+void ImageSimilarityHashIndex::search(guint64 hash, guint radius, std::vector<gsize> &found) const
+{
+	const guint chunk_radius = radius / CHUNKS;
+
+	for (gint c = 0; c < CHUNKS; c++)
+		{
+		const guint value = (hash >> (c * CHUNK_BITS)) & (CHUNK_VALUES - 1);
+
+		const auto visit = [this, c, hash, radius, &found](guint bucket)
+		{
+			for (guint32 k = offsets[c][bucket]; k < offsets[c][bucket + 1]; k++)
+				{
+				const guint32 item = buckets[c][k];
+
+				if (static_cast<guint>(__builtin_popcountll(hashes[item] ^ hash)) <= radius)
+					{
+					found.push_back(item);
+					}
+				}
+		};
+
+		/* every bucket within chunk_radius bits of value */
+		const std::function<void(guint, gint, guint)> flip = [&flip, &visit, chunk_radius](guint bucket, gint first_bit, guint flipped)
+		{
+			visit(bucket);
+			if (flipped == chunk_radius) return;
+
+			for (gint bit = first_bit; bit < CHUNK_BITS; bit++)
+				{
+				flip(bucket ^ (1U << bit), bit + 1, flipped + 1);
+				}
+		};
+
+		flip(value, 0, 0);
+		}
+}
+
+std::vector<gsize> ImageSimilarityHashIndex::candidates(const ImageSimilarityTransforms &needle, guint radius) const
+{
+	std::vector<gsize> found;
+
+	if (!image_sim_filled(needle.sd)) return found;
+
+	for (gint t = 0; t < needle.count; t++)
+		{
+		const ImageSimilarityTransforms::Planes &planes = needle.planes[t];
+
+		search(image_sim_phash(planes[0].data(), planes[1].data(), planes[2].data()), radius, found);
+		}
+
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+
+	return found;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
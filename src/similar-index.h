@@ -0,0 +1,101 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SIMILAR_INDEX_H
+#define SIMILAR_INDEX_H
+
+#include <array>
+#include <vector>
+
+#include <glib.h>
+
+struct ImageSimilarityData;
+struct ImageSimilarityTransforms;
+
+/**
+ * @brief Vantage point tree over a set of similarity fingerprints
+ *
+ * The tree is built on a coarse 4 x 4 grid of block sums. The distance
+ * between two coarse grids is never larger than the distance between the
+ * full fingerprints, so a range query returns every image that can reach
+ * the similarity threshold, and usually few others.
+ *
+ * The index is read-only once built, and may be queried from several threads.
+ */
+class ImageSimilarityIndex
+{
+public:
+	explicit ImageSimilarityIndex(const std::vector<const ImageSimilarityData *> &items);
+
+	/**
+	 * @brief Positions in the constructor's list of the items that may
+	 * match \a needle with a similarity of at least \a min
+	 * @returns Ascending positions
+	 */
+	std::vector<gsize> candidates(const ImageSimilarityTransforms &needle, gdouble min) const;
+
+	static constexpr gint COARSE_GRID = 4;
+	using Coarse = std::array<guint16, 3 * COARSE_GRID * COARSE_GRID>;
+
+private:
+	struct Node
+	{
+		gsize item;
+		guint radius; /**< inside subtree is within this distance of \a item, outside is not nearer */
+		gint inside;
+		gint outside;
+	};
+
+	using Work = std::vector<std::pair<gsize, guint>>; /**< item, distance to the current vantage point */
+
+	gint build(Work::iterator begin, Work::iterator end);
+	void search(gint node, const Coarse &query, guint limit, std::vector<gsize> &found) const;
+
+	std::vector<Coarse> coarse;
+	std::vector<Node> nodes;
+	gint root;
+};
+
+/**
+ * @brief Multi-index hash table over the perceptual hashes of fingerprints
+ *
+ * Each 64 bit hash is split into 4 chunks of 16 bits, and each chunk is
+ * indexed separately. Two hashes within Hamming distance d agree to within
+ * d / 4 bits in at least one chunk, so only the few buckets near each chunk
+ * of the query need to be visited.
+ *
+ * Unlike #ImageSimilarityIndex this is approximate: a pair of images can
+ * pass the similarity threshold with hashes further apart than the radius.
+ */
+class ImageSimilarityHashIndex
+{
+public:
+	explicit ImageSimilarityHashIndex(const std::vector<const ImageSimilarityData *> &items);
+
+	/**
+	 * @brief Positions of the items whose hash is within \a radius bits of
+	 * the hash of any transform of \a needle
+	 * @returns Ascending positions
+	 */
+	std::vector<gsize> candidates(const ImageSimilarityTransforms &needle, guint radius) const;
+
+	static guint radius_for_threshold(gdouble min);
+
+private:
+	static constexpr gint CHUNKS = 4;
+	static constexpr gint CHUNK_BITS = 64 / CHUNKS;
+	static constexpr gsize CHUNK_VALUES = 1 << CHUNK_BITS;
+
+	void search(guint64 hash, guint radius, std::vector<gsize> &found) const;
+
+	std::vector<guint64> hashes;
+	std::vector<bool> indexed;
+
+	/** For each chunk, items sorted by the chunk's value with bucket start offsets */
+	std::array<std::vector<guint32>, CHUNKS> buckets;
+	std::array<std::vector<guint32>, CHUNKS> offsets;
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -25,10 +25,25 @@
 #include <cmath>
 #include <cstdlib>
 #include <functional>
+#include <memory>
 #include <vector>
 
 #include "options.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  include <immintrin.h>
+#  define SIMILAR_HAVE_X86 1
+#else
+#  define SIMILAR_HAVE_X86 0
+#endif
+
+#if defined(__ARM_NEON) && !SIMILAR_HAVE_X86
+#  include <arm_neon.h>
+#  define SIMILAR_HAVE_NEON 1
+#else
+#  define SIMILAR_HAVE_NEON 0
+#endif
+
 /**
  * @file
  *
@@ -53,6 +68,16 @@
  *  0.0 for exact opposite images (compare an all black to an all white image) \n
  * generally only a match of > 0.85 are significant at all, and >.95 is useful to
  * find images that have been re-saved to other formats, dimensions, or compression.
+ *
+ * The difference of two fingerprints is a sum of absolute differences over the
+ * three planes. It is computed with SSE2, AVX2 or NEON where available, the
+ * kernel being chosen at runtime. When one image is compared against many others
+ * (as the duplicates window does) build an #ImageSimilarityTransforms for it once,
+ * so that the rotated and mirrored copies are not rebuilt for every comparison.
+ *
+ * Each fingerprint also carries a 64 bit perceptual hash (pHash) of its grid.
+ * Images that are similar have hashes that differ in few bits, which allows
+ * cheap candidate selection before the full comparison.
  */
 
 namespace
@@ -60,6 +85,10 @@ namespace
 
 using ImageSimilarityCheckAbort = std::function<bool(gdouble)>;
 
+constexpr gint SIM_GRID_SIZE = 32;
+constexpr gint SIM_ROW_BLOCK = 4; /**< rows summed between abort checks */
+constexpr gdouble SIM_MAX_DIFF = 255.0 * 1024.0 * 3.0;
+
 void image_sim_channel_equal(ImageSimilarityData::Avg &pix)
 {
 	struct IndexedPix
@@ -86,53 +115,226 @@ void image_sim_channel_equal(ImageSimilarityData::Avg &pix)
 		}
 }
 
+/**
+ * @brief Sum of absolute differences of two byte runs
+ *
+ * \a len is always a multiple of 32.
+ */
+using ImageSimilaritySad = guint (*)(const guint8 *a, const guint8 *b, gsize len);
+
+guint image_sim_sad_scalar(const guint8 *a, const guint8 *b, gsize len)
+{
+	guint sum = 0;
+
+	for (gsize i = 0; i < len; i++)
+		{
+		sum += abs(a[i] - b[i]);
+		}
+
+	return sum;
+}
+
+#if SIMILAR_HAVE_X86
+__attribute__((target("sse2")))
+guint image_sim_sad_sse2(const guint8 *a, const guint8 *b, gsize len)
+{
+	__m128i acc = _mm_setzero_si128();
+
+	for (gsize i = 0; i < len; i += 16)
+		{
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+		}
+
+	acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+
+	return _mm_cvtsi128_si32(acc);
+}
+
+__attribute__((target("avx2")))
+guint image_sim_sad_avx2(const guint8 *a, const guint8 *b, gsize len)
+{
+	__m256i acc = _mm256_setzero_si256();
+
+	for (gsize i = 0; i < len; i += 32)
+		{
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+		}
+
+	__m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+
+	return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+#if SIMILAR_HAVE_NEON
+guint image_sim_sad_neon(const guint8 *a, const guint8 *b, gsize len)
+{
+	guint sum = 0;
+
+	/* 16 bit lanes hold at most 64 steps of 2 * 255 */
+	for (gsize block = 0; block < len; block += 1024)
+		{
+		const gsize block_end = std::min(len, block + 1024);
+		uint16x8_t acc = vdupq_n_u16(0);
+
+		for (gsize i = block; i < block_end; i += 16)
+			{
+			const uint8x16_t va = vld1q_u8(a + i);
+			const uint8x16_t vb = vld1q_u8(b + i);
+			acc = vabal_u8(acc, vget_low_u8(va), vget_low_u8(vb));
+			acc = vabal_u8(acc, vget_high_u8(va), vget_high_u8(vb));
+			}
+
+		const uint64x2_t acc64 = vpaddlq_u32(vpaddlq_u16(acc));
+		sum += vgetq_lane_u64(acc64, 0) + vgetq_lane_u64(acc64, 1);
+		}
+
+	return sum;
+}
+#endif
+
+/**
+ * @brief Selects the fastest kernel the running CPU supports
+ */
+ImageSimilaritySad image_sim_sad_func()
+{
+	static const ImageSimilaritySad sad = []() -> ImageSimilaritySad
+	{
+#if SIMILAR_HAVE_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) return image_sim_sad_avx2;
+		if (__builtin_cpu_supports("sse2")) return image_sim_sad_sse2;
+#elif SIMILAR_HAVE_NEON
+		return image_sim_sad_neon;
+#endif
+		return image_sim_sad_scalar;
+	}();
+
+	return sad;
+}
+
+constexpr gint PHASH_SIZE = 8; /**< the hash uses the lowest 8 x 8 frequencies */
+
+/**
+ * @brief cos((2x + 1) u pi / 64) for the DCT of a 32 wide grid
+ */
+const std::array<std::array<gdouble, SIM_GRID_SIZE>, PHASH_SIZE> &image_sim_dct_table()
+{
+	static const auto table = []()
+	{
+		std::array<std::array<gdouble, SIM_GRID_SIZE>, PHASH_SIZE> t;
+
+		for (gint u = 0; u < PHASH_SIZE; u++)
+			{
+			for (gint x = 0; x < SIM_GRID_SIZE; x++)
+				{
+				t[u][x] = cos(((2 * x) + 1) * u * G_PI / (2 * SIM_GRID_SIZE));
+				}
+			}
+
+		return t;
+	}();
+
+	return table;
+}
+
 /*
  * 4 rotations (0, 90, 180, 270) combined with two mirrors (0, H)
  * generate all possible isometric transformations
  * = 8 tests
  * = change dir of x, change dir of y, exchange x and y = 2^3 = 8
+ *
+ * Cell k of the first image is compared with cell index[k] of the second.
  */
-gdouble image_sim_data_compare_transfo(const ImageSimilarityData *a, const ImageSimilarityData *b, gchar transfo, const ImageSimilarityCheckAbort &check_abort)
-{
-	if (!image_sim_filled(a) || !image_sim_filled(b)) return 0.0;
+using ImageSimilarityPermutation = std::array<guint16, 1024>;
 
-	gint sim = 0.0;
-	gint i2;
-	gint *i;
-	gint j2;
-	gint *j;
+const std::array<ImageSimilarityPermutation, 8> &image_sim_permutations()
+{
+	static const auto permutations = []()
+	{
+		std::array<ImageSimilarityPermutation, 8> p;
 
-	if (transfo & 1) { i = &j2; j = &i2; } else { i = &i2; j = &j2; }
-	for (gint j1 = 0; j1 < 32; j1++)
-		{
-		if (transfo & 2) *j = 31-j1; else *j = j1;
-		for (gint i1 = 0; i1 < 32; i1++)
+		for (gint transfo = 0; transfo < 8; transfo++)
 			{
-			if (transfo & 4) *i = 31-i1; else *i = i1;
-			sim += abs(a->avg_r[(i1*32)+j1] - b->avg_r[(i2*32)+j2]);
-			sim += abs(a->avg_g[(i1*32)+j1] - b->avg_g[(i2*32)+j2]);
-			sim += abs(a->avg_b[(i1*32)+j1] - b->avg_b[(i2*32)+j2]);
-			/* check for abort, if so return 0.0 */
-			if (check_abort(sim)) return 0.0;
+			for (gint i1 = 0; i1 < SIM_GRID_SIZE; i1++)
+				{
+				const gint iv = (transfo & 4) ? (SIM_GRID_SIZE - 1 - i1) : i1;
+
+				for (gint j1 = 0; j1 < SIM_GRID_SIZE; j1++)
+					{
+					const gint jv = (transfo & 2) ? (SIM_GRID_SIZE - 1 - j1) : j1;
+					const gint i2 = (transfo & 1) ? jv : iv;
+					const gint j2 = (transfo & 1) ? iv : jv;
+
+					p[transfo][(i1 * SIM_GRID_SIZE) + j1] = (i2 * SIM_GRID_SIZE) + j2;
+					}
+				}
 			}
+
+		return p;
+	}();
+
+	return permutations;
+}
+
+/**
+ * @brief Compares \a a against the planes \a r, \a g, \a b of the second image, or of one of its transforms
+ *
+ * The abort check runs once per block of #SIM_ROW_BLOCK rows. The sum only
+ * grows, so the result is the same as checking after every cell.
+ */
+gdouble image_sim_data_compare_planes(const ImageSimilarityData *a,
+                                      const ImageSimilarityData::Avg &r, const ImageSimilarityData::Avg &g, const ImageSimilarityData::Avg &b,
+                                      const ImageSimilarityCheckAbort &check_abort)
+{
+	const ImageSimilaritySad sad = image_sim_sad_func();
+	constexpr gsize block_len = SIM_ROW_BLOCK * SIM_GRID_SIZE;
+	guint sim = 0;
+
+	for (gsize offset = 0; offset < std::tuple_size_v<ImageSimilarityData::Avg>; offset += block_len)
+		{
+		sim += sad(a->avg_r.data() + offset, r.data() + offset, block_len);
+		sim += sad(a->avg_g.data() + offset, g.data() + offset, block_len);
+		sim += sad(a->avg_b.data() + offset, b.data() + offset, block_len);
+
+		/* check for abort, if so return 0.0 */
+		if (check_abort(sim)) return 0.0;
 		}
 
-	return 1.0 - (static_cast<gdouble>(sim) / (255.0 * 1024.0 * 3.0));
+	return 1.0 - (static_cast<gdouble>(sim) / SIM_MAX_DIFF);
 }
 
-gdouble image_sim_data_compare(const ImageSimilarityData *a, const ImageSimilarityData *b, const ImageSimilarityCheckAbort &check_abort)
+gdouble image_sim_data_compare(const ImageSimilarityData *a, const ImageSimilarityTransforms &b, const ImageSimilarityCheckAbort &check_abort)
 {
-	gchar max_t = (options->rot_invariant_sim ? 8 : 1);
+	if (!image_sim_filled(a) || !image_sim_filled(b.sd)) return 0.0;
+
 	gdouble max_score = 0;
 
-	for (gchar t = 0; t < max_t; t++)
-	{
-		max_score = std::max(image_sim_data_compare_transfo(a, b, t, check_abort), max_score);
-	}
+	for (gint t = 0; t < b.count; t++)
+		{
+		const ImageSimilarityTransforms::Planes &planes = b.planes[t];
+
+		max_score = std::max(image_sim_data_compare_planes(a, planes[0], planes[1], planes[2], check_abort), max_score);
+		}
 
 	return max_score;
 }
 
+/**
+ * @brief Compares \a a and \a b as they are, when the transforms are not compared
+ */
+gdouble image_sim_data_compare(const ImageSimilarityData *a, const ImageSimilarityData *b, const ImageSimilarityCheckAbort &check_abort)
+{
+	if (!image_sim_filled(a) || !image_sim_filled(b)) return 0.0;
+
+	return image_sim_data_compare_planes(a, b->avg_r, b->avg_g, b->avg_b, check_abort);
+}
+
 } // namespace
 
 static void image_sim_channel_norm(ImageSimilarityData::Avg &pix)
@@ -262,6 +464,7 @@ void ImageSimilarityData::fill_data(GdkPixbuf *pixbuf)
 		h_left -= y_inc;
 		}
 
+	phash = image_sim_phash(avg_r.data(), avg_g.data(), avg_b.data());
 	filled = true;
 }
 
@@ -305,6 +508,7 @@ bool ImageSimilarityData::fill_data(FILE *f)
 			}
 		}
 
+	phash = image_sim_phash(avg_r.data(), avg_g.data(), avg_b.data());
 	filled = true;
 	return true;
 }
@@ -365,28 +569,131 @@ static gdouble alternate_image_sim_compare_fast(const ImageSimilarityData *a, co
 	return (1.0 - ((gdouble)sim / (255.0 * 1024.0 * 4.0)) );
 }
 
+ImageSimilarityTransforms::ImageSimilarityTransforms(const ImageSimilarityData *sd)
+	: sd(sd)
+	, count(options->rot_invariant_sim ? 8 : 1)
+{
+	if (!image_sim_filled(sd)) return;
+
+	const auto &permutations = image_sim_permutations();
+
+	for (gint t = 0; t < count; t++)
+		{
+		const ImageSimilarityPermutation &index = permutations[t];
+
+		for (gsize k = 0; k < index.size(); k++)
+			{
+			planes[t][0][k] = sd->avg_r[index[k]];
+			planes[t][1][k] = sd->avg_g[index[k]];
+			planes[t][2][k] = sd->avg_b[index[k]];
+			}
+		}
+}
+
 gdouble image_sim_compare(ImageSimilarityData *a, ImageSimilarityData *b)
 {
-	return image_sim_data_compare(a, b, [](gdouble){ return false; });
+	if (!options->rot_invariant_sim)
+		{
+		return image_sim_data_compare(a, b, [](gdouble){ return false; });
+		}
+
+	const auto transforms = std::make_unique<ImageSimilarityTransforms>(b);
+
+	return image_sim_data_compare(a, *transforms, [](gdouble){ return false; });
 }
 
 /* this uses a cutoff point so that it can abort early when it gets to
  * a point that can simply no longer make the cut-off point.
  */
 gdouble image_sim_compare_fast(ImageSimilarityData *a, ImageSimilarityData *b, gdouble min)
+{
+	if (options->alternate_similarity_algorithm.enabled)
+		{
+		return alternate_image_sim_compare_fast(a, b, 1.0 - min);
+		}
+
+	if (!options->rot_invariant_sim)
+		{
+		const gdouble max_diff = 1.0 - min;
+
+		return image_sim_data_compare(a, b, [max_diff](gdouble sim){ return (sim / SIM_MAX_DIFF) > max_diff; });
+		}
+
+	const auto transforms = std::make_unique<ImageSimilarityTransforms>(b);
+
+	return image_sim_compare_fast(a, *transforms, min);
+}
+
+gdouble image_sim_compare_fast(const ImageSimilarityData *a, const ImageSimilarityTransforms &b, gdouble min)
 {
 	min = 1.0 - min;
 
 	if (options->alternate_similarity_algorithm.enabled)
 		{
-		return alternate_image_sim_compare_fast(a, b, min);
+		return alternate_image_sim_compare_fast(a, b.sd, min);
 		}
 
-	return image_sim_data_compare(a, b, [min](gdouble sim){ return (sim / (255.0 * 1024.0 * 3.0)) > min; });
+	return image_sim_data_compare(a, b, [min](gdouble sim){ return (sim / SIM_MAX_DIFF) > min; });
 }
 
 bool image_sim_filled(const ImageSimilarityData *sd)
 {
 	return sd && sd->filled;
 }
+
+/**
+ * @brief The pHash of a 32 x 32 grid
+ *
+ * The luminance of the grid is transformed by a DCT. Each of the 64 lowest
+ * frequency coefficients sets one bit if it is above the median of the
+ * coefficients, the DC term excepted.
+ */
+guint64 image_sim_phash(const guint8 *r, const guint8 *g, const guint8 *b)
+{
+	const auto &dct = image_sim_dct_table();
+	std::array<gdouble, 1024> luma;
+
+	for (gsize i = 0; i < luma.size(); i++)
+		{
+		luma[i] = (0.299 * r[i]) + (0.587 * g[i]) + (0.114 * b[i]);
+		}
+
+	/* rows first, then columns, only for the wanted frequencies */
+	std::array<std::array<gdouble, PHASH_SIZE>, SIM_GRID_SIZE> rows{};
+	for (gint y = 0; y < SIM_GRID_SIZE; y++)
+		{
+		for (gint u = 0; u < PHASH_SIZE; u++)
+			{
+			for (gint x = 0; x < SIM_GRID_SIZE; x++)
+				{
+				rows[y][u] += luma[(y * SIM_GRID_SIZE) + x] * dct[u][x];
+				}
+			}
+		}
+
+	std::array<gdouble, PHASH_SIZE * PHASH_SIZE> coeffs{};
+	for (gint v = 0; v < PHASH_SIZE; v++)
+		{
+		for (gint u = 0; u < PHASH_SIZE; u++)
+			{
+			for (gint y = 0; y < SIM_GRID_SIZE; y++)
+				{
+				coeffs[(v * PHASH_SIZE) + u] += rows[y][u] * dct[v][y];
+				}
+			}
+		}
+
+	std::array<gdouble, (PHASH_SIZE * PHASH_SIZE) - 1> ac;
+	std::copy(coeffs.cbegin() + 1, coeffs.cend(), ac.begin());
+	std::nth_element(ac.begin(), ac.begin() + (ac.size() / 2), ac.end());
+	const gdouble median = ac[ac.size() / 2];
+
+	guint64 hash = 0;
+	for (gsize i = 0; i < coeffs.size(); i++)
+		{
+		if (coeffs[i] > median) hash |= G_GUINT64_CONSTANT(1) << i;
+		}
+
+	return hash;
+}
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -45,15 +45,36 @@ struct ImageSimilarityData
 	Avg avg_g;
 	Avg avg_b;
 
+	guint64 phash; /**< perceptual hash of the grid, see image_sim_phash() */
+
 	bool filled;
 };
 
+/**
+ * @brief The fingerprint planes of one image, permuted by each isometric transform
+ *
+ * Build this once for an image that is compared against many others.
+ */
+struct ImageSimilarityTransforms
+{
+	explicit ImageSimilarityTransforms(const ImageSimilarityData *sd);
+
+	using Planes = std::array<ImageSimilarityData::Avg, 3>;
+
+	const ImageSimilarityData *sd;
+	gint count; /**< 8 if rotation invariant, otherwise 1 */
+	std::array<Planes, 8> planes;
+};
+
 
 gdouble image_sim_compare(ImageSimilarityData *a, ImageSimilarityData *b);
 gdouble image_sim_compare_fast(ImageSimilarityData *a, ImageSimilarityData *b, gdouble min);
+gdouble image_sim_compare_fast(const ImageSimilarityData *a, const ImageSimilarityTransforms &b, gdouble min);
 
 bool image_sim_filled(const ImageSimilarityData *sd);
 
+guint64 image_sim_phash(const guint8 *r, const guint8 *g, const guint8 *b);
+
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
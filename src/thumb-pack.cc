@@ -0,0 +1,931 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "thumb-pack.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <gio/gio.h>
+
+#include "cache.h"
+#include "debug.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Thumbnail pack format:
+ *-------------------------------------------------------------------
+ *
+ * One file per cache folder holds the finished thumbnails of that folder,
+ * so that a folder seen before is painted from one mapped file instead of
+ * opening, checking and inflating one PNG per image.
+ *
+ * Header (32 bytes): "GQTHPAK2", byte order mark, record header size, reserved \n
+ * Record: hash of the file name (0 for a deleted record), the file name,
+ * mtime and size of the source, the thumbnail size asked for, the size and
+ * channels of the thumbnail, how its pixels are stored and the size of
+ * them, followed by the stored pixels, padded to 8 bytes. \n
+ *
+ * The pixels are rows of 8 bit RGB or RGBA without padding. Each byte less
+ * the byte of the pixel to its left, as the sub filter of PNG, they are
+ * stored as a raw deflate stream, which takes a bit more than a PNG file
+ * but inflates without the per file cost. Pixels that do not get smaller
+ * that way are stored as they are. A thumbnail that would take more than
+ * THUMB_PACK_DATA_MAX is not packed, it is left to the PNG files or made
+ * again, so that a pack of large thumbnails does not outgrow the PNG files
+ * by far. \n
+ *
+ * Records are appended and deleted in place, a changed thumbnail is
+ * appended again. The space of deleted records is given back by compacting
+ * the pack into a new file once it outweighs the live records. Writers hold
+ * an exclusive flock() on the file, readers a shared one while they index
+ * appended records.
+ */
+
+namespace
+{
+
+constexpr gchar THUMB_PACK_MAGIC[8] = {'G', 'Q', 'T', 'H', 'P', 'A', 'K', '2'};
+constexpr guint32 THUMB_PACK_BYTE_ORDER = 0x01020304;
+constexpr gsize THUMB_PACK_NAME_SIZE = 256;
+constexpr gsize THUMB_PACK_MAX_OPEN = 16;
+constexpr gint THUMB_PACK_SIZE_MAX = 4096; /**< of either side of a thumbnail */
+constexpr guint64 THUMB_PACK_DATA_MAX = 2 * 1024 * 1024; /**< stored pixels of one thumbnail */
+constexpr gint THUMB_PACK_DEFLATE_LEVEL = 1; /**< fast, the filter does most of the work */
+constexpr guint32 THUMB_PACK_RAW = 0;
+constexpr guint32 THUMB_PACK_DEFLATE = 1;
+constexpr gsize THUMB_PACK_COMPACT_MIN = 4 * 1024 * 1024; /**< deleted bytes kept before compacting */
+constexpr gsize THUMB_PACK_MAP_SLACK = 16 * 1024 * 1024; /**< mapped beyond the end, for appended records */
+
+struct ThumbPackHeader
+{
+	gchar magic[8];
+	guint32 byte_order;
+	guint32 record_size;
+	guint8 reserved[16];
+};
+
+struct ThumbPackRecord
+{
+	guint64 key;
+	gchar name[THUMB_PACK_NAME_SIZE];
+	gint64 mtime;
+	gint64 size;
+	gint32 box_width;
+	gint32 box_height;
+	gint32 width;
+	gint32 height;
+	guint32 channels;
+	guint32 compression; /**< THUMB_PACK_RAW or THUMB_PACK_DEFLATE */
+	guint64 data_size; /**< of the stored pixels */
+};
+
+static_assert(sizeof(ThumbPackHeader) == 32);
+static_assert(sizeof(ThumbPackRecord) % 8 == 0);
+
+/* FNV-1a, never 0 */
+guint64 thumb_pack_key(const gchar *name)
+{
+	guint64 hash = 14695981039346656037ULL;
+
+	for (const gchar *p = name; *p; p++)
+		{
+		hash ^= static_cast<guchar>(*p);
+		hash *= 1099511628211ULL;
+		}
+
+	return hash ? hash : 1;
+}
+
+gsize thumb_pack_record_length(const ThumbPackRecord &record)
+{
+	return sizeof(ThumbPackRecord) + ((record.data_size + 7) & ~static_cast<guint64>(7));
+}
+
+/* A record cut short by a crash, or not written yet, is not valid */
+gboolean thumb_pack_record_valid(const ThumbPackRecord &record, gsize available)
+{
+	if (record.width <= 0 || record.width > THUMB_PACK_SIZE_MAX ||
+	    record.height <= 0 || record.height > THUMB_PACK_SIZE_MAX ||
+	    (record.channels != 3 && record.channels != 4)) return FALSE;
+
+	const guint64 pixels_size = static_cast<guint64>(record.width) * record.height * record.channels;
+
+	return ((record.compression == THUMB_PACK_RAW && record.data_size == pixels_size) ||
+	        (record.compression == THUMB_PACK_DEFLATE && record.data_size > 0 && record.data_size < pixels_size)) &&
+	       record.data_size <= THUMB_PACK_DATA_MAX &&
+	       thumb_pack_record_length(record) <= available;
+}
+
+class ThumbPack
+{
+public:
+	ThumbPack(gint fd, gboolean writable);
+	~ThumbPack();
+
+	static std::unique_ptr<ThumbPack> open(const gchar *path, gboolean create);
+
+	gboolean same_file(const struct stat &st) const;
+	gboolean is_writable() const { return writable; }
+	gboolean needs_compacting() const { return dead > THUMB_PACK_COMPACT_MIN && dead > live; }
+	gboolean has_dead() const { return dead > 0; }
+
+	const ThumbPackRecord *find(const gchar *name, gint box_width, gint box_height);
+	std::vector<const ThumbPackRecord *> find_all(const gchar *name);
+	gboolean write(const ThumbPackRecord &record, const guchar *data);
+	gboolean erase(const gchar *name);
+	std::vector<std::string> names();
+	gboolean compact(const gchar *path);
+
+	static const guchar *data_of(const ThumbPackRecord *record)
+	{
+		return reinterpret_cast<const guchar *>(record + 1);
+	}
+
+private:
+	gboolean init();
+	gboolean refresh();
+	void scan(gsize offset);
+	void rescan();
+	std::vector<gsize> lookup(const gchar *name);
+	gboolean erase_at(gsize offset);
+
+	const ThumbPackRecord *record_at(gsize offset) const
+	{
+		return reinterpret_cast<const ThumbPackRecord *>(map + offset);
+	}
+
+	gint fd;
+	gboolean writable;
+	gboolean locked = FALSE; /**< this process holds the exclusive lock */
+	dev_t dev = 0;
+	ino_t ino = 0;
+
+	guchar *map = nullptr;
+	gsize map_length = 0; /**< of the mapping */
+	gsize map_size = 0; /**< of the file, the part of the mapping that can be read */
+
+	gsize indexed = 0; /**< end of the records scanned into the index */
+	gsize live = 0; /**< bytes of live records */
+	gsize dead = 0; /**< bytes of deleted records */
+	std::unordered_multimap<guint64, gsize> index;
+};
+
+ThumbPack::ThumbPack(gint fd, gboolean writable)
+	: fd(fd)
+	, writable(writable)
+{
+	struct stat st;
+	if (fstat(fd, &st) == 0)
+		{
+		dev = st.st_dev;
+		ino = st.st_ino;
+		}
+}
+
+ThumbPack::~ThumbPack()
+{
+	if (map) munmap(map, map_length);
+	close(fd);
+}
+
+std::unique_ptr<ThumbPack> ThumbPack::open(const gchar *path, gboolean create)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	gint fd = ::open(pathl, O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0644);
+	const gboolean writable = (fd >= 0);
+
+	/* a shared cache may be read-only */
+	if (fd < 0 && !create) fd = ::open(pathl, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return nullptr;
+
+	auto pack = std::make_unique<ThumbPack>(fd, writable);
+
+	if (writable && !pack->init())
+		{
+		log_printf("Failed to initialise thumbnail pack %s\n", path);
+		return nullptr;
+		}
+
+	if (!pack->refresh()) return nullptr;
+
+	return pack;
+}
+
+/* Writes the header of a new file, or of one in an unknown format */
+gboolean ThumbPack::init()
+{
+	if (flock(fd, LOCK_EX) != 0) return FALSE;
+
+	ThumbPackHeader header{};
+	gboolean valid = (pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+	                  memcmp(header.magic, THUMB_PACK_MAGIC, sizeof(header.magic)) == 0 &&
+	                  header.byte_order == THUMB_PACK_BYTE_ORDER &&
+	                  header.record_size == sizeof(ThumbPackRecord));
+
+	if (!valid)
+		{
+		header = {};
+		memcpy(header.magic, THUMB_PACK_MAGIC, sizeof(header.magic));
+		header.byte_order = THUMB_PACK_BYTE_ORDER;
+		header.record_size = sizeof(ThumbPackRecord);
+
+		valid = (ftruncate(fd, 0) == 0 &&
+		         pwrite(fd, &header, sizeof(header), 0) == sizeof(header));
+		}
+
+	flock(fd, LOCK_UN);
+
+	return valid;
+}
+
+gboolean ThumbPack::same_file(const struct stat &st) const
+{
+	return st.st_dev == dev && st.st_ino == ino;
+}
+
+/**
+ * @brief Indexes the records appended since the last call
+ *
+ * The file is mapped with some slack, so that it is mapped again only when
+ * the appended records do not fit.
+ */
+gboolean ThumbPack::refresh()
+{
+	struct stat st;
+	if (fstat(fd, &st) != 0) return FALSE;
+	if (map && static_cast<gsize>(st.st_size) == map_size) return TRUE;
+
+	/* do not index a record while it is appended */
+	if (!locked && flock(fd, LOCK_SH) != 0) return FALSE;
+
+	gboolean ret = FALSE;
+
+	if (fstat(fd, &st) == 0 && static_cast<gsize>(st.st_size) >= sizeof(ThumbPackHeader))
+		{
+		const auto size = static_cast<gsize>(st.st_size);
+
+		if (map && size > map_length)
+			{
+			munmap(map, map_length);
+			map = nullptr;
+			}
+
+		if (!map)
+			{
+			map_length = size + THUMB_PACK_MAP_SLACK;
+			map = static_cast<guchar *>(mmap(nullptr, map_length, PROT_READ, MAP_SHARED, fd, 0));
+			if (map == MAP_FAILED) map = nullptr;
+			}
+
+		if (map)
+			{
+			map_size = size;
+
+			const auto *header = reinterpret_cast<const ThumbPackHeader *>(map);
+			ret = (memcmp(header->magic, THUMB_PACK_MAGIC, sizeof(header->magic)) == 0 &&
+			       header->byte_order == THUMB_PACK_BYTE_ORDER &&
+			       header->record_size == sizeof(ThumbPackRecord));
+			}
+		}
+
+	if (ret)
+		{
+		if (indexed == 0)
+			{
+			/* the thumbnails of a folder are usually all shown, read them ahead */
+			madvise(map, map_size, MADV_WILLNEED);
+			rescan();
+			}
+		else if (indexed > map_size)
+			{
+			/* cut short by another process */
+			rescan();
+			}
+		else
+			{
+			scan(indexed);
+			}
+		}
+	else if (map)
+		{
+		munmap(map, map_length);
+		map = nullptr;
+		map_length = 0;
+		map_size = 0;
+		}
+
+	if (!locked) flock(fd, LOCK_UN);
+
+	return ret;
+}
+
+void ThumbPack::scan(gsize offset)
+{
+	while (offset + sizeof(ThumbPackRecord) <= map_size)
+		{
+		const ThumbPackRecord *record = record_at(offset);
+		if (!thumb_pack_record_valid(*record, map_size - offset)) break;
+
+		const gsize length = thumb_pack_record_length(*record);
+		if (record->key)
+			{
+			index.emplace(record->key, offset);
+			live += length;
+			}
+		else
+			{
+			dead += length;
+			}
+
+		offset += length;
+		}
+
+	indexed = offset;
+}
+
+void ThumbPack::rescan()
+{
+	index.clear();
+	live = 0;
+	dead = 0;
+
+	scan(sizeof(ThumbPackHeader));
+}
+
+/* Records of another process deleted since they were indexed are skipped */
+std::vector<gsize> ThumbPack::lookup(const gchar *name)
+{
+	std::vector<gsize> offsets;
+	const guint64 key = thumb_pack_key(name);
+
+	const auto range = index.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it)
+		{
+		const ThumbPackRecord *record = record_at(it->second);
+		if (record->key == key && strncmp(record->name, name, sizeof(record->name)) == 0)
+			{
+			offsets.push_back(it->second);
+			}
+		}
+
+	return offsets;
+}
+
+const ThumbPackRecord *ThumbPack::find(const gchar *name, gint box_width, gint box_height)
+{
+	if (!refresh()) return nullptr;
+
+	for (const gsize offset : lookup(name))
+		{
+		const ThumbPackRecord *record = record_at(offset);
+		if (record->box_width == box_width && record->box_height == box_height) return record;
+		}
+
+	return nullptr;
+}
+
+std::vector<const ThumbPackRecord *> ThumbPack::find_all(const gchar *name)
+{
+	std::vector<const ThumbPackRecord *> records;
+
+	if (!refresh()) return records;
+
+	for (const gsize offset : lookup(name))
+		{
+		records.push_back(record_at(offset));
+		}
+
+	return records;
+}
+
+/* Must be called with the exclusive lock held */
+gboolean ThumbPack::erase_at(gsize offset)
+{
+	const guint64 key = record_at(offset)->key;
+
+	static constexpr guint64 free_key = 0;
+	if (pwrite(fd, &free_key, sizeof(free_key), offset) != sizeof(free_key)) return FALSE;
+
+	const gsize length = thumb_pack_record_length(*record_at(offset));
+	live -= std::min(live, length);
+	dead += length;
+
+	const auto range = index.equal_range(key);
+	const auto it = std::find_if(range.first, range.second, [offset](const auto &entry){ return entry.second == offset; });
+	if (it != range.second) index.erase(it);
+
+	return TRUE;
+}
+
+gboolean ThumbPack::write(const ThumbPackRecord &record, const guchar *data)
+{
+	if (!writable || flock(fd, LOCK_EX) != 0) return FALSE;
+	locked = TRUE;
+
+	gboolean ret = FALSE;
+
+	if (refresh())
+		{
+		for (const gsize offset : lookup(record.name))
+			{
+			const ThumbPackRecord *old = record_at(offset);
+			if (old->box_width == record.box_width && old->box_height == record.box_height) erase_at(offset);
+			}
+
+		/* drop a record cut short by a crash */
+		if (indexed < map_size && ftruncate(fd, indexed) == 0) refresh();
+
+		if (indexed == map_size)
+			{
+			std::vector<guchar> buffer(thumb_pack_record_length(record), 0);
+
+			memcpy(buffer.data(), &record, sizeof(record));
+			memcpy(buffer.data() + sizeof(record), data, record.data_size);
+
+			ret = (pwrite(fd, buffer.data(), buffer.size(), indexed) == static_cast<gssize>(buffer.size()));
+			}
+
+		/* index the appended record */
+		if (ret) refresh();
+		}
+
+	locked = FALSE;
+	flock(fd, LOCK_UN);
+
+	return ret;
+}
+
+gboolean ThumbPack::erase(const gchar *name)
+{
+	if (!writable || flock(fd, LOCK_EX) != 0) return FALSE;
+	locked = TRUE;
+
+	gboolean ret = FALSE;
+
+	if (refresh())
+		{
+		for (const gsize offset : lookup(name))
+			{
+			if (erase_at(offset)) ret = TRUE;
+			}
+		}
+
+	locked = FALSE;
+	flock(fd, LOCK_UN);
+
+	return ret;
+}
+
+std::vector<std::string> ThumbPack::names()
+{
+	std::unordered_set<std::string> unique;
+
+	if (!refresh()) return {};
+
+	rescan();
+	for (const auto &entry : index)
+		{
+		const ThumbPackRecord *record = record_at(entry.second);
+		unique.emplace(record->name, strnlen(record->name, sizeof(record->name)));
+		}
+
+	return {unique.cbegin(), unique.cend()};
+}
+
+/**
+ * @brief Copies the live records into a new file that replaces @a path
+ *
+ * The records keep their order, which is the order the thumbnails were
+ * made in. A process still holding the old file notices the replacement
+ * on its next lookup.
+ */
+gboolean ThumbPack::compact(const gchar *path)
+{
+	if (!writable || flock(fd, LOCK_EX) != 0) return FALSE;
+	locked = TRUE;
+
+	gboolean ret = FALSE;
+	struct stat st;
+
+	/* another process compacted it first */
+	if (stat_utf8(path, &st) && same_file(st) && refresh())
+		{
+		std::vector<gsize> offsets;
+		offsets.reserve(index.size());
+		for (const auto &entry : index) offsets.push_back(entry.second);
+		std::sort(offsets.begin(), offsets.end());
+
+		g_autofree gchar *tmp_path = g_strconcat(path, ".tmp", NULL);
+		unlink_file(tmp_path);
+
+		std::unique_ptr<ThumbPack> dest = ThumbPack::open(tmp_path, TRUE);
+		if (dest)
+			{
+			ret = TRUE;
+			for (const gsize offset : offsets)
+				{
+				const ThumbPackRecord *record = record_at(offset);
+				if (!record->key) continue;
+
+				if (!dest->write(*record, data_of(record)))
+					{
+					ret = FALSE;
+					break;
+					}
+				}
+
+			ret = ret && rename_file(tmp_path, path);
+			}
+
+		if (!ret)
+			{
+			DEBUG_1("thumbnail pack compaction failed: %s", path);
+			unlink_file(tmp_path);
+			}
+		}
+
+	locked = FALSE;
+	flock(fd, LOCK_UN);
+
+	return ret;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * open packs
+ *-------------------------------------------------------------------
+ */
+
+std::mutex thumb_pack_mutex;
+std::unordered_map<std::string, std::unique_ptr<ThumbPack>> thumb_pack_open_list;
+
+/* Must be called with thumb_pack_mutex held */
+ThumbPack *thumb_pack_get(const gchar *path, gboolean create)
+{
+	struct stat st;
+	const gboolean exists = stat_utf8(path, &st);
+
+	auto it = thumb_pack_open_list.find(path);
+	if (it != thumb_pack_open_list.end())
+		{
+		/* reuse unless the file was deleted or replaced */
+		if (exists && it->second->same_file(st) && (!create || it->second->is_writable()))
+			{
+			return it->second.get();
+			}
+
+		thumb_pack_open_list.erase(it);
+		}
+
+	if (!exists && !create) return nullptr;
+
+	std::unique_ptr<ThumbPack> pack = ThumbPack::open(path, create);
+	if (!pack) return nullptr;
+
+	if (thumb_pack_open_list.size() >= THUMB_PACK_MAX_OPEN) thumb_pack_open_list.clear();
+
+	return thumb_pack_open_list.emplace(path, std::move(pack)).first->second.get();
+}
+
+/* Must be called with thumb_pack_mutex held, @a pack is closed */
+void thumb_pack_compact(const gchar *path, ThumbPack *pack)
+{
+	if (pack->compact(path)) thumb_pack_open_list.erase(path);
+}
+
+gboolean thumb_pack_name_valid(const gchar *name)
+{
+	return name && *name && strlen(name) < THUMB_PACK_NAME_SIZE;
+}
+
+void thumb_pack_record_init(ThumbPackRecord &record, const gchar *name)
+{
+	record = {};
+
+	record.key = thumb_pack_key(name);
+	g_strlcpy(record.name, name, sizeof(record.name));
+}
+
+/*
+ *-------------------------------------------------------------------
+ * stored pixels
+ *-------------------------------------------------------------------
+ */
+
+/* Runs all of @a in through @a converter, FALSE if the result does not fit into @a out */
+gboolean thumb_pack_convert(GConverter *converter, const guchar *in, gsize in_size, guchar *out, gsize out_size, gsize &out_length)
+{
+	gsize in_length = 0;
+	out_length = 0;
+
+	while (out_length < out_size)
+		{
+		gsize bytes_read;
+		gsize bytes_written;
+		const GConverterResult result = g_converter_convert(converter, in + in_length, in_size - in_length,
+		                                                    out + out_length, out_size - out_length,
+		                                                    G_CONVERTER_INPUT_AT_END, &bytes_read, &bytes_written, nullptr);
+		if (result == G_CONVERTER_ERROR) return FALSE;
+
+		in_length += bytes_read;
+		out_length += bytes_written;
+		if (result == G_CONVERTER_FINISHED) return TRUE;
+		}
+
+	return FALSE;
+}
+
+/**
+ * @brief Returns the pixels of @a pixbuf as they are stored, sets how in @a record
+ *
+ * The filter leaves the smooth gradients of photos as runs of small numbers,
+ * which deflate far better than the pixels themselves.
+ */
+std::vector<guchar> thumb_pack_encode(GdkPixbuf *pixbuf, ThumbPackRecord &record)
+{
+	const gsize row = static_cast<gsize>(record.width) * record.channels;
+	const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+	const guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+
+	std::vector<guchar> filtered(row * record.height);
+	for (gint y = 0; y < record.height; y++)
+		{
+		const guchar *src = pixels + (static_cast<gsize>(y) * rowstride);
+		guchar *dest = filtered.data() + (y * row);
+
+		memcpy(dest, src, record.channels);
+		for (gsize x = record.channels; x < row; x++)
+			{
+			dest[x] = src[x] - src[x - record.channels];
+			}
+		}
+
+	std::vector<guchar> data(filtered.size());
+	gsize length;
+	g_autoptr(GZlibCompressor) compressor = g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW, THUMB_PACK_DEFLATE_LEVEL);
+
+	if (thumb_pack_convert(G_CONVERTER(compressor), filtered.data(), filtered.size(), data.data(), data.size(), length))
+		{
+		data.resize(length);
+		record.compression = THUMB_PACK_DEFLATE;
+		}
+	else
+		{
+		for (gint y = 0; y < record.height; y++)
+			{
+			memcpy(data.data() + (y * row), pixels + (static_cast<gsize>(y) * rowstride), row);
+			}
+		record.compression = THUMB_PACK_RAW;
+		}
+
+	record.data_size = data.size();
+
+	return data;
+}
+
+/* Writes the stored pixels of @a record into @a pixbuf of its size */
+gboolean thumb_pack_decode(const ThumbPackRecord *record, GdkPixbuf *pixbuf)
+{
+	const gsize row = static_cast<gsize>(record->width) * record->channels;
+	const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+	const guchar *data = ThumbPack::data_of(record);
+	guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+
+	if (record->compression == THUMB_PACK_RAW)
+		{
+		for (gint y = 0; y < record->height; y++)
+			{
+			memcpy(pixels + (static_cast<gsize>(y) * rowstride), data + (y * row), row);
+			}
+
+		return TRUE;
+		}
+
+	/* one byte more, so that the end of the stream fits */
+	std::vector<guchar> filtered((row * record->height) + 1);
+	gsize length;
+	g_autoptr(GZlibDecompressor) decompressor = g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW);
+
+	if (!thumb_pack_convert(G_CONVERTER(decompressor), data, record->data_size, filtered.data(), filtered.size(), length) ||
+	    length != filtered.size() - 1) return FALSE;
+
+	for (gint y = 0; y < record->height; y++)
+		{
+		const guchar *src = filtered.data() + (y * row);
+		guchar *dest = pixels + (static_cast<gsize>(y) * rowstride);
+
+		memcpy(dest, src, record->channels);
+		for (gsize x = record->channels; x < row; x++)
+			{
+			dest[x] = src[x] + dest[x - record->channels];
+			}
+		}
+
+	return TRUE;
+}
+
+} // namespace
+
+GdkPixbuf *thumb_pack_load(const gchar *pack, const gchar *source, gint width, gint height)
+{
+	if (!pack || !source) return nullptr;
+
+	const gchar *name = filename_from_path(source);
+	if (!thumb_pack_name_valid(name)) return nullptr;
+
+	struct stat st;
+	if (!stat_utf8(source, &st)) return nullptr;
+
+	std::lock_guard<std::mutex> lock(thumb_pack_mutex);
+
+	ThumbPack *thumb_pack = thumb_pack_get(pack, FALSE);
+	if (!thumb_pack) return nullptr;
+
+	const ThumbPackRecord *record = thumb_pack->find(name, width, height);
+	if (!record) return nullptr;
+
+	if (record->mtime != st.st_mtime || record->size != st.st_size)
+		{
+		DEBUG_1("thumbnail pack record of %s is outdated", source);
+		return nullptr;
+		}
+
+	GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, record->channels == 4, 8, record->width, record->height);
+	if (!pixbuf) return nullptr;
+
+	if (!thumb_pack_decode(record, pixbuf))
+		{
+		DEBUG_1("thumbnail pack record of %s is damaged", source);
+		g_object_unref(pixbuf);
+		return nullptr;
+		}
+
+	return pixbuf;
+}
+
+gboolean thumb_pack_save(const gchar *pack, const gchar *source, gint width, gint height, GdkPixbuf *pixbuf)
+{
+	if (!pack || !source || !pixbuf) return FALSE;
+
+	const gchar *name = filename_from_path(source);
+	if (!thumb_pack_name_valid(name)) return FALSE;
+
+	const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+	if (gdk_pixbuf_get_colorspace(pixbuf) != GDK_COLORSPACE_RGB ||
+	    gdk_pixbuf_get_bits_per_sample(pixbuf) != 8 ||
+	    (channels != 3 && channels != 4)) return FALSE;
+
+	struct stat st;
+	if (!stat_utf8(source, &st)) return FALSE;
+
+	ThumbPackRecord record;
+	thumb_pack_record_init(record, name);
+	record.mtime = st.st_mtime;
+	record.size = st.st_size;
+	record.box_width = width;
+	record.box_height = height;
+	record.width = gdk_pixbuf_get_width(pixbuf);
+	record.height = gdk_pixbuf_get_height(pixbuf);
+	record.channels = channels;
+
+	if (record.width > THUMB_PACK_SIZE_MAX || record.height > THUMB_PACK_SIZE_MAX) return FALSE;
+
+	const std::vector<guchar> data = thumb_pack_encode(pixbuf, record);
+
+	/* also too large to be packed */
+	if (!thumb_pack_record_valid(record, thumb_pack_record_length(record))) return FALSE;
+
+	std::lock_guard<std::mutex> lock(thumb_pack_mutex);
+
+	ThumbPack *thumb_pack = thumb_pack_get(pack, TRUE);
+	if (!thumb_pack) return FALSE;
+
+	if (!thumb_pack->write(record, data.data())) return FALSE;
+
+	if (thumb_pack->needs_compacting()) thumb_pack_compact(pack, thumb_pack);
+
+	return TRUE;
+}
+
+gboolean thumb_pack_move(const gchar *src_pack, const gchar *source, const gchar *dest_pack, const gchar *dest)
+{
+	if (!src_pack || !source || !dest_pack || !dest) return FALSE;
+
+	const gchar *name = filename_from_path(source);
+	const gchar *dest_name = filename_from_path(dest);
+	if (!thumb_pack_name_valid(name)) return FALSE;
+
+	std::lock_guard<std::mutex> lock(thumb_pack_mutex);
+
+	ThumbPack *thumb_pack = thumb_pack_get(src_pack, FALSE);
+	if (!thumb_pack) return FALSE;
+
+	/* copied out, both may be the same pack */
+	std::vector<std::pair<ThumbPackRecord, std::vector<guchar>>> thumbs;
+	for (const ThumbPackRecord *record : thumb_pack->find_all(name))
+		{
+		const guchar *data = ThumbPack::data_of(record);
+		thumbs.emplace_back(*record, std::vector<guchar>(data, data + record->data_size));
+		}
+
+	if (thumbs.empty()) return FALSE;
+
+	thumb_pack->erase(name);
+
+	/* a name that does not fit is dropped, the thumbnails are made again */
+	if (!thumb_pack_name_valid(dest_name)) return FALSE;
+
+	ThumbPack *dest_thumb_pack = thumb_pack_get(dest_pack, TRUE);
+	if (!dest_thumb_pack) return FALSE;
+
+	gboolean ret = TRUE;
+	for (auto &thumb : thumbs)
+		{
+		ThumbPackRecord &record = thumb.first;
+
+		record.key = thumb_pack_key(dest_name);
+		memset(record.name, 0, sizeof(record.name));
+		g_strlcpy(record.name, dest_name, sizeof(record.name));
+
+		if (!dest_thumb_pack->write(record, thumb.second.data())) ret = FALSE;
+		}
+
+	return ret;
+}
+
+void thumb_pack_remove(const gchar *pack, const gchar *source)
+{
+	if (!pack || !source) return;
+
+	const gchar *name = filename_from_path(source);
+	if (!thumb_pack_name_valid(name)) return;
+
+	std::lock_guard<std::mutex> lock(thumb_pack_mutex);
+
+	ThumbPack *thumb_pack = thumb_pack_get(pack, FALSE);
+	if (thumb_pack) thumb_pack->erase(name);
+}
+
+gint thumb_pack_purge(const gchar *pack, const gchar *folder)
+{
+	if (!pack || !folder) return 0;
+
+	std::lock_guard<std::mutex> lock(thumb_pack_mutex);
+
+	ThumbPack *thumb_pack = thumb_pack_get(pack, FALSE);
+	if (!thumb_pack) return 0;
+
+	gint count = 0;
+
+	for (const std::string &name : thumb_pack->names())
+		{
+		g_autofree gchar *source = g_build_filename(folder, name.c_str(), nullptr);
+
+		if (isfile(source) || !thumb_pack->erase(name.c_str()))
+			{
+			count++;
+			}
+		}
+
+	if (count > 0 && thumb_pack->has_dead()) thumb_pack_compact(pack, thumb_pack);
+
+	return count;
+}
+
+GdkPixbuf *thumb_pack_find(const gchar *source, gint width, gint height)
+{
+	g_autofree gchar *pack = cache_find_thumb_pack_location(source);
+	if (!pack) return nullptr;
+
+	return thumb_pack_load(pack, source, width, height);
+}
+
+gboolean thumb_pack_store(const gchar *source, gint width, gint height, GdkPixbuf *pixbuf)
+{
+	g_autofree gchar *base = cache_create_location(CacheType::THUMB, source);
+	if (!base) return FALSE;
+
+	g_autofree gchar *pack = g_build_filename(base, GQ_CACHE_THUMB_PACK, nullptr);
+
+	return thumb_pack_save(pack, source, width, height, pixbuf);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
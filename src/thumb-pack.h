@@ -0,0 +1,60 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef THUMB_PACK_H
+#define THUMB_PACK_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+#define GQ_CACHE_THUMB_PACK ".thumbs.pack"
+
+/**
+ * @brief Reads the thumbnail of one file from the thumbnail pack of its folder
+ * @param pack Path of the pack, see cache_find_thumb_pack_location()
+ * @param source Path of the image
+ * @param width,height The thumbnail size asked for
+ * @returns A new pixbuf, or nullptr if there is no thumbnail of that size
+ * or the image changed since it was written
+ *
+ * The pack is mapped once per process; later lookups in the same folder
+ * only inflate the pixels of the thumbnail.
+ */
+GdkPixbuf *thumb_pack_load(const gchar *pack, const gchar *source, gint width, gint height);
+
+/**
+ * @brief Writes the thumbnail of one file, replacing any previous one of that size
+ * @returns FALSE if the pack could not be created or written, or the
+ * thumbnail is too large to be packed
+ */
+gboolean thumb_pack_save(const gchar *pack, const gchar *source, gint width, gint height, GdkPixbuf *pixbuf);
+
+/**
+ * @brief Moves the thumbnails of @a source into the pack @a dest_pack as @a dest
+ */
+gboolean thumb_pack_move(const gchar *src_pack, const gchar *source, const gchar *dest_pack, const gchar *dest);
+
+/**
+ * @brief Deletes the thumbnails of @a source, of all sizes
+ */
+void thumb_pack_remove(const gchar *pack, const gchar *source);
+
+/**
+ * @brief Deletes the thumbnails of files that no longer exist in @a folder and compacts the pack
+ * @returns The number of thumbnails left
+ */
+gint thumb_pack_purge(const gchar *pack, const gchar *folder);
+
+/**
+ * @brief Looks up the thumbnail of @a source in the pack of its cache folder
+ */
+GdkPixbuf *thumb_pack_find(const gchar *source, gint width, gint height);
+
+/**
+ * @brief Writes the thumbnail of @a source into the pack of its cache folder, creating it if needed
+ */
+gboolean thumb_pack_store(const gchar *source, gint width, gint height, GdkPixbuf *pixbuf);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,106 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "thumb-queue.h"
+
+#include <algorithm>
+#include <utility>
+
+void ThumbQueue::reset(guint size)
+{
+	taken.assign(size, false);
+	swept.clear();
+	forward = 0;
+	backward = -1;
+	set_visible(0, 0);
+}
+
+/**
+ * @brief Keeps the run the cursors passed, merged with the runs it touches
+ */
+void ThumbQueue::keep_swept()
+{
+	gint run_first = backward + 1;
+	gint run_last = forward - 1;
+	if (run_first > run_last) return;
+
+	auto it = swept.upper_bound(run_last + 1);
+	while (it != swept.begin())
+		{
+		--it;
+		if (it->second < run_first - 1) break;
+
+		run_first = std::min(run_first, it->first);
+		run_last = std::max(run_last, it->second);
+		it = swept.erase(it);
+		}
+
+	swept.emplace(run_first, run_last);
+}
+
+/**
+ * @returns The kept run @a position is in, or nullptr
+ */
+const std::pair<const gint, gint> *ThumbQueue::swept_run(gint position) const
+{
+	auto it = swept.upper_bound(position);
+	if (it == swept.begin()) return nullptr;
+
+	--it;
+	return (it->second >= position) ? &*it : nullptr;
+}
+
+void ThumbQueue::set_visible(guint first_position, guint last_position)
+{
+	if (first_position > last_position) std::swap(first_position, last_position);
+
+	keep_swept();
+
+	const gint end = taken.size();
+
+	first = std::min<gint>(first_position, std::max(0, end - 1));
+	last = std::min<gint>(last_position, end - 1);
+	forward = first;
+	backward = first - 1;
+}
+
+gint ThumbQueue::take(const DoneFunc &done)
+{
+	const gint end = taken.size();
+
+	while (forward < end || backward >= 0)
+		{
+		gint position;
+
+		/* the visible ones, then the nearest side, below first on a tie */
+		if (forward <= last ||
+		    (forward < end && (backward < 0 || forward - last <= first - backward)))
+			{
+			if (const auto *run = swept_run(forward))
+				{
+				forward = run->second + 1;
+				continue;
+				}
+			position = forward++;
+			}
+		else
+			{
+			if (const auto *run = swept_run(backward))
+				{
+				backward = run->first - 1;
+				continue;
+				}
+			position = backward--;
+			}
+
+		if (taken[position]) continue;
+
+		taken[position] = true;
+		if (!done(position)) return position;
+		}
+
+	return -1;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
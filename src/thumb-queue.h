@@ -0,0 +1,60 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef THUMB_QUEUE_H
+#define THUMB_QUEUE_H
+
+#include <functional>
+#include <map>
+#include <vector>
+
+#include <glib.h>
+
+/**
+ * @brief The order thumbnails of a file view are generated in
+ *
+ * Files are known by their position in the view. The visible ones come
+ * first, top to bottom, then the others by their distance to the visible
+ * ones, alternating below and above. Two cursors move away from the
+ * visible positions, so taking the next file costs O(1) amortized. A
+ * scroll moves the cursors, the runs they passed before are kept and
+ * jumped over as a whole, so a scroll costs a lookup per run reached
+ * instead of a step per file already taken.
+ */
+class ThumbQueue
+{
+public:
+	/** Whether the file at a position needs no thumbnail any more */
+	using DoneFunc = std::function<bool(guint position)>;
+
+	/** Forgets what was taken, the positions 0 to @a size - 1 are waiting */
+	void reset(guint size);
+
+	/** The view shows positions @a first to @a last, the waiting positions are ordered again */
+	void set_visible(guint first, guint last);
+
+	/**
+	 * @brief Takes the waiting position nearest to the visible ones
+	 * @returns The position, or -1 when all were taken
+	 *
+	 * Positions @a done returns true for are taken without being returned.
+	 */
+	gint take(const DoneFunc &done);
+
+	guint size() const { return taken.size(); }
+
+private:
+	void keep_swept();
+	const std::pair<const gint, gint> *swept_run(gint position) const;
+
+	std::vector<bool> taken;
+	std::map<gint, gint> swept;	/**< first to last position of the runs passed before, all taken */
+	gint first = 0;
+	gint last = -1;
+	gint forward = 0;	/**< next position at or below #first */
+	gint backward = -1;	/**< next position above #first */
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -38,6 +38,8 @@ struct ImageLoader;
 #define THUMB_FOLDER_LOCAL  ".thumblocal"
 #define THUMB_FOLDER_NORMAL "normal"
 #define THUMB_FOLDER_LARGE  "large"
+#define THUMB_FOLDER_XLARGE "x-large"
+#define THUMB_FOLDER_XXLARGE "xx-large"
 #define THUMB_FOLDER_FAIL   "fail" G_DIR_SEPARATOR_S GQ_APPNAME_LC "-" VERSION
 #define THUMB_NAME_EXTENSION ".png"
 
@@ -75,6 +77,8 @@ struct ThumbLoaderStd
 	Func func_progress;
 
 	gpointer data;
+
+	guint idle_done_id; /**< event source id */
 };
 
 
@@ -0,0 +1,216 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "thumb-writer.h"
+
+#include <unistd.h>
+
+#include <deque>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "debug.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ * Thumbnails are written by one thread, so that inflating a folder of new
+ * thumbnails does not wait on the PNG encoder and on the disk. The queue is
+ * bounded: a loader that runs far ahead of the disk waits in
+ * thumb_writer_save() instead of keeping a copy of every thumbnail.
+ */
+
+namespace
+{
+
+constexpr gint THUMB_WRITER_QUEUE_MAX = 64; /**< thumbnails waiting to be written */
+
+struct ThumbWriterEntry
+{
+	GdkPixbuf *pixbuf;
+	ThumbWriterJob job;
+};
+
+struct ThumbWriter
+{
+	GMutex mutex;
+	GCond cond;
+
+	std::deque<ThumbWriterEntry> queue;
+	gboolean writing = FALSE;
+
+	std::unordered_set<std::string> folders; /**< created or found, only used by the writer thread */
+};
+
+ThumbWriter *thumb_writer = nullptr;
+
+/**
+ * @brief Creates the folder of @a job once per folder
+ *
+ * Checking and creating the folder is most of the cost of a small
+ * thumbnail, and all thumbnails of a folder go to the same cache folder.
+ */
+void thumb_writer_folder(ThumbWriter *writer, const ThumbWriterJob &job)
+{
+	g_autofree gchar *folder = remove_level_from_path(job.path.c_str());
+	if (writer->folders.count(folder) > 0) return;
+
+	mode_t mode = job.folder_mode;
+	if (!job.folder_mode_from.empty())
+		{
+		struct stat st;
+		if (isdir(folder)) mode = 0;
+		else if (stat_utf8(job.folder_mode_from.c_str(), &st)) mode = st.st_mode;
+		else return;
+		}
+
+	if (mode == 0 || recursive_mkdir_if_not_exists(folder, mode))
+		{
+		writer->folders.insert(folder);
+		}
+}
+
+gboolean thumb_writer_write_file(GdkPixbuf *pixbuf, const ThumbWriterJob &job)
+{
+	g_autofree gchar *tmp_path = unique_filename(job.path.c_str(), ".tmp", "_", 2);
+	if (!tmp_path) return FALSE;
+
+	std::vector<gchar *> keys;
+	std::vector<gchar *> values;
+	for (const auto &text : job.text)
+		{
+		keys.push_back(const_cast<gchar *>(text.first.c_str()));
+		values.push_back(const_cast<gchar *>(text.second.c_str()));
+		}
+	const std::string compression = std::to_string(CLAMP(job.compression, 0, 9));
+	keys.push_back(const_cast<gchar *>("compression"));
+	values.push_back(const_cast<gchar *>(compression.c_str()));
+	keys.push_back(nullptr);
+	values.push_back(nullptr);
+
+	g_autofree gchar *pathl = path_from_utf8(tmp_path);
+	gboolean success = gdk_pixbuf_savev(pixbuf, pathl, "png", keys.data(), values.data(), nullptr);
+	if (success)
+		{
+		if (job.mode != 0) chmod(pathl, job.mode);
+		success = rename_file(tmp_path, job.path.c_str());
+		}
+
+	if (!success) unlink(pathl);
+
+	return success;
+}
+
+void thumb_writer_write(ThumbWriter *writer, GdkPixbuf *pixbuf, const ThumbWriterJob &job)
+{
+	g_autofree gchar *folder = remove_level_from_path(job.path.c_str());
+	const gboolean known = (writer->folders.count(folder) > 0);
+
+	thumb_writer_folder(writer, job);
+	gboolean success = thumb_writer_write_file(pixbuf, job);
+
+	if (!success && known)
+		{
+		/* the folder may have been removed meanwhile */
+		writer->folders.erase(folder);
+		thumb_writer_folder(writer, job);
+		success = thumb_writer_write_file(pixbuf, job);
+		}
+
+	if (!success)
+		{
+		DEBUG_1("thumb save failed: %s", job.path.c_str());
+		return;
+		}
+
+	if (!job.time_from.empty()) filetime_set(job.path.c_str(), filetime(job.time_from.c_str()));
+}
+
+gpointer thumb_writer_thread(gpointer data)
+{
+	auto writer = static_cast<ThumbWriter *>(data);
+
+	g_mutex_lock(&writer->mutex);
+	while (TRUE)
+		{
+		if (writer->queue.empty())
+			{
+			g_cond_wait(&writer->cond, &writer->mutex);
+			continue;
+			}
+
+		ThumbWriterEntry entry = std::move(writer->queue.front());
+		writer->queue.pop_front();
+		writer->writing = TRUE;
+		g_cond_broadcast(&writer->cond);
+		g_mutex_unlock(&writer->mutex);
+
+		thumb_writer_write(writer, entry.pixbuf, entry.job);
+		g_object_unref(entry.pixbuf);
+
+		g_mutex_lock(&writer->mutex);
+		writer->writing = FALSE;
+		g_cond_broadcast(&writer->cond);
+		}
+
+	return nullptr;
+}
+
+ThumbWriter *thumb_writer_get()
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter(&initialized))
+		{
+		auto writer = new ThumbWriter();
+		g_mutex_init(&writer->mutex);
+		g_cond_init(&writer->cond);
+		g_thread_unref(g_thread_new("thumb-writer", thumb_writer_thread, writer));
+
+		thumb_writer = writer;
+		g_once_init_leave(&initialized, 1);
+		}
+
+	return thumb_writer;
+}
+
+} // namespace
+
+void thumb_writer_save(GdkPixbuf *pixbuf, ThumbWriterJob job)
+{
+	if (!pixbuf) return;
+
+	ThumbWriter *writer = thumb_writer_get();
+
+	/* the caller may scale or calibrate its pixbuf in place */
+	GdkPixbuf *copy = gdk_pixbuf_copy(pixbuf);
+	if (!copy) return;
+
+	g_mutex_lock(&writer->mutex);
+	while (writer->queue.size() >= THUMB_WRITER_QUEUE_MAX)
+		{
+		g_cond_wait(&writer->cond, &writer->mutex);
+		}
+	writer->queue.push_back({copy, std::move(job)});
+	g_cond_broadcast(&writer->cond);
+	g_mutex_unlock(&writer->mutex);
+}
+
+void thumb_writer_flush()
+{
+	if (!thumb_writer) return;
+
+	ThumbWriter *writer = thumb_writer;
+
+	g_mutex_lock(&writer->mutex);
+	while (!writer->queue.empty() || writer->writing)
+		{
+		g_cond_wait(&writer->cond, &writer->mutex);
+		}
+	g_mutex_unlock(&writer->mutex);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
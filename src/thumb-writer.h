@@ -0,0 +1,46 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef THUMB_WRITER_H
+#define THUMB_WRITER_H
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+/**
+ * @brief How a thumbnail is written as a PNG file
+ */
+struct ThumbWriterJob
+{
+	std::string path; /**< written to a temporary file first, then renamed into place */
+	mode_t mode = 0; /**< of the file, 0 for the default */
+	mode_t folder_mode = S_IRWXU; /**< of the folder of #path, if it is created */
+	std::string folder_mode_from; /**< if set, the folder is created with the mode of this folder, or not at all */
+	std::string time_from; /**< if set, the file gets the modification time of this file */
+	std::vector<std::pair<std::string, std::string>> text; /**< PNG text chunks, as "tEXt::key" and value */
+	gint compression = 6; /**< zlib level, 0 to 9 */
+};
+
+/**
+ * @brief Writes a thumbnail on the writer thread
+ *
+ * The pixels are copied, @a pixbuf can be changed once this returns. Waits
+ * while the writer is THUMB_WRITER_QUEUE_MAX thumbnails behind.
+ */
+void thumb_writer_save(GdkPixbuf *pixbuf, ThumbWriterJob job);
+
+/**
+ * @brief Waits until all thumbnails given to the writer are written
+ */
+void thumb_writer_flush();
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
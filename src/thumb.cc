@@ -23,18 +23,24 @@
 
 #include <cstdio>
 #include <cstring>
+#include <utility>
 
 #include <glib-object.h>
 
+#include <config.h>
+
 #include "cache.h"
 #include "exif.h"
 #include "filedata.h"
 #include "image-load.h"
 #include "intl.h"
+#include "main-defines.h"
 #include "metadata.h"
 #include "options.h"
 #include "pixbuf-util.h"
+#include "thumb-pack.h"
 #include "thumb-standard.h"
+#include "thumb-writer.h"
 #include "ui-fileops.h"
 
 
@@ -77,7 +83,16 @@ static gboolean thumb_loader_save_thumbnail(ThumbLoader *tl, gboolean mark_failu
 	else
 		{
 		DEBUG_1("Saving thumb: %s", cache_path);
-		success = pixbuf_to_file_as_png(tl->fd->thumb_pixbuf, pathl);
+
+		/* written on the writer thread, which also sets the thumb time to that of the source file */
+		ThumbWriterJob job;
+		job.path = cache_path;
+		job.time_from = tl->fd->path;
+		job.text = {{"tEXt::Software", GQ_APPNAME " " VERSION}};
+		job.compression = options->thumbnails.png_compression;
+		thumb_writer_save(tl->fd->thumb_pixbuf, std::move(job));
+
+		return TRUE;
 		}
 
 	if (success)
@@ -206,12 +221,28 @@ static void thumb_loader_done_cb(ImageLoader *il, gpointer data)
 	if (rotated) g_object_unref(rotated);
 
 	/* save it ? */
-	if (tl->cache_enable && save)
+	if (tl->cache_enable && save && (!options->thumbnails.packed || options->thumbnails.packed_png))
 		{
 		thumb_loader_save_thumbnail(tl, FALSE);
 		}
 
+	if (tl->cache_enable && options->thumbnails.packed && tl->fd->thumb_pixbuf)
+		{
+		thumb_pack_store(tl->fd->path, tl->max_w, tl->max_h, tl->fd->thumb_pixbuf);
+		}
+
+	if (tl->func_done) tl->func_done(tl, tl->data);
+}
+
+static gboolean thumb_loader_done_idle_cb(gpointer data)
+{
+	auto tl = static_cast<ThumbLoader *>(data);
+
+	tl->idle_done_id = 0;
+
 	if (tl->func_done) tl->func_done(tl, tl->data);
+
+	return G_SOURCE_REMOVE;
 }
 
 static void thumb_loader_error_cb(ImageLoader *il, gpointer data)
@@ -240,6 +271,7 @@ static void thumb_loader_setup(ThumbLoader *tl, FileData *fd)
 	image_loader_free(tl->il);
 	tl->il = image_loader_new(fd);
 	image_loader_set_priority(tl->il, G_PRIORITY_LOW);
+	image_loader_set_queue(tl->il, IMAGE_LOADER_QUEUE_THUMBNAIL);
 
 	/* this will speed up jpegs by up to 3x in some cases */
 	image_loader_set_requested_size(tl->il, tl->max_w, tl->max_h);
@@ -306,6 +338,20 @@ gboolean thumb_loader_start(ThumbLoader *tl, FileData *fd)
 		return FALSE;
 		}
 
+	GdkPixbuf *packed = (tl->cache_enable && options->thumbnails.packed) ? thumb_pack_find(tl->fd->path, tl->max_w, tl->max_h) : nullptr;
+	if (packed)
+		{
+		DEBUG_1("Found in thumbnail pack:%s", tl->fd->path);
+
+		if (tl->fd->thumb_pixbuf) g_object_unref(tl->fd->thumb_pixbuf);
+		tl->fd->thumb_pixbuf = packed;
+		tl->cache_hit = TRUE;
+
+		/* reported from the main loop, like a loaded thumbnail */
+		tl->idle_done_id = g_idle_add(thumb_loader_done_idle_cb, tl);
+		return TRUE;
+		}
+
 	g_autofree gchar *cache_path = tl->cache_enable ? cache_find_location(CacheType::THUMB, tl->fd->path) : nullptr;
 	if (cache_time_valid(cache_path, tl->fd->path))
 		{
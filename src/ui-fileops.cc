@@ -40,7 +40,6 @@
 #include "intl.h"
 #include "layout.h"
 #include "main-defines.h"
-#include "md5-util.h"
 #include "ui-utildlg.h"
 #include "utilops.h"
 
@@ -811,25 +810,6 @@ gboolean recursive_mkdir_if_not_exists(const gchar *path, mode_t mode)
 	return TRUE;
 }
 
-/* does filename utf8 to filesystem encoding first */
-gboolean md5_get_digest_from_file_utf8(const gchar *path, Md5Digest &digest)
-{
-	g_autofree gchar *pathl = path_from_utf8(path);
-
-	return md5_get_digest_from_file(pathl, digest);
-}
-
-/**
- * @brief Generate md5 string from file,
- * on failure returns newly allocated copy of error_text, error_text may be NULL
- */
-std::string md5_text_from_file_utf8(const gchar *path)
-{
-	g_autofree gchar *pathl = path_from_utf8(path);
-
-	return md5_get_string_from_file(pathl);
-}
-
 /* Download web file
  */
 struct WebData
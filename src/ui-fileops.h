@@ -100,9 +100,6 @@ gboolean file_in_path(const gchar *name);
 
 gboolean recursive_mkdir_if_not_exists(const gchar *path, mode_t mode);
 
-std::string md5_text_from_file_utf8(const gchar *path);
-gboolean md5_get_digest_from_file_utf8(const gchar *path, Md5Digest &digest);
-
 gchar *download_web_file(const gchar *text, gboolean minimized, gpointer data);
 gboolean rmdir_recursive(GFile *file, GCancellable *cancellable, GError **error);
 
@@ -31,7 +31,7 @@
 #include "main-defines.h"
 
 struct LayoutWindow;
-struct ThumbLoader;
+struct ViewFileThumbs;
 
 enum FileViewType : guint {
 	FILEVIEW_LIST,
@@ -82,8 +82,7 @@ struct ViewFile
 
 	/* thumbs updates*/
 	gboolean thumbs_running;
-	ThumbLoader *thumbs_loader;
-	FileData *thumbs_filedata;
+	ViewFileThumbs *thumbs; /**< files waiting for and loading a thumbnail, while running */
 
 	/* marks */
 	gboolean marks_enabled;
@@ -1531,48 +1531,29 @@ void vficon_set_thumb_fd(ViewFile *vf, FileData *fd)
 	gtk_list_store_set(GTK_LIST_STORE(store), &iter, FILE_COLUMN_POINTER, list, -1);
 }
 
-/* Returns the next fd without a loaded pixbuf, so the thumb-loader can load the pixbuf for it. */
-FileData *vficon_thumb_next_fd(ViewFile *vf)
+/* A row holds the list of the files in its columns. */
+gboolean vficon_thumb_visible_range(ViewFile *vf, FileData *&first, FileData *&last)
 {
-	/* First see if there are visible files that don't have a loaded thumb... */
-	if (g_autoptr(GtkTreePath) tpath = nullptr;
-	    gtk_tree_view_get_path_at_pos(GTK_TREE_VIEW(vf->listview), 0, 0, &tpath, nullptr, nullptr, nullptr))
-		{
-		GtkTreeModel *store;
-		GtkTreeIter iter;
-		gboolean valid = TRUE;
-
-		store = gtk_tree_view_get_model(GTK_TREE_VIEW(vf->listview));
-		gtk_tree_model_get_iter(store, &iter, tpath);
-
-		while (valid && tree_view_row_is_visible(GTK_TREE_VIEW(vf->listview), &iter, FALSE))
-			{
-			GList *list;
-			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &list, -1);
+	g_autoptr(GtkTreePath) start_path = nullptr;
+	g_autoptr(GtkTreePath) end_path = nullptr;
 
-			/** @todo (xsdg): for loop here. */
-			for (; list; list = list->next)
-				{
-				auto fd = static_cast<FileData *>(list->data);
-				if (fd && !fd->thumb_pixbuf) return fd;
-				}
+	if (!gtk_tree_view_get_visible_range(GTK_TREE_VIEW(vf->listview), &start_path, &end_path)) return FALSE;
 
-			valid = gtk_tree_model_iter_next(store, &iter);
-			}
-		}
+	GtkTreeModel *store = gtk_tree_view_get_model(GTK_TREE_VIEW(vf->listview));
+	GtkTreeIter iter;
+	GList *list;
 
-	/* Then iterate through the entire list to load all of them. */
-	GList *work;
-	for (work = vf->list; work; work = work->next)
-		{
-		auto fd = static_cast<FileData *>(work->data);
+	if (!gtk_tree_model_get_iter(store, &iter, start_path)) return FALSE;
+	gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &list, -1);
+	if (!list) return FALSE;
+	first = static_cast<FileData *>(list->data);
 
-		// Note: This implementation differs from view-file-list.cc because sidecar files are not
-		// distinct list elements here, as they are in the list view.
-		if (!fd->thumb_pixbuf) return fd;
-		}
+	if (!gtk_tree_model_get_iter(store, &iter, end_path)) return FALSE;
+	gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &list, -1);
+	if (!list) return FALSE;
+	last = static_cast<FileData *>(g_list_last(list)->data);
 
-	return nullptr;
+	return first && last;
 }
 
 void vficon_set_star_fd(ViewFile *vf, FileData *fd)
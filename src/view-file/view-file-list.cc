@@ -1000,60 +1000,23 @@ void vflist_set_thumb_fd(ViewFile *vf, FileData *fd)
 	gtk_tree_store_set(store, &iter, FILE_COLUMN_THUMB, thumb, -1);
 }
 
-FileData *vflist_thumb_next_fd(ViewFile *vf)
+gboolean vflist_thumb_visible_range(ViewFile *vf, FileData *&first, FileData *&last)
 {
-	FileData *fd = nullptr;
-
-	/* first check the visible files */
-
-	if (g_autoptr(GtkTreePath) tpath = nullptr;
-	    gtk_tree_view_get_path_at_pos(GTK_TREE_VIEW(vf->listview), 0, 0, &tpath, nullptr, nullptr, nullptr))
-		{
-		GtkTreeModel *store;
-		GtkTreeIter iter;
-		gboolean valid = TRUE;
-
-		store = gtk_tree_view_get_model(GTK_TREE_VIEW(vf->listview));
-		gtk_tree_model_get_iter(store, &iter, tpath);
-
-		while (!fd && valid && tree_view_row_is_visible(GTK_TREE_VIEW(vf->listview), &iter, FALSE))
-			{
-			FileData *nfd;
-
-			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &nfd, -1);
-
-			if (!nfd->thumb_pixbuf) fd = nfd;
+	g_autoptr(GtkTreePath) start_path = nullptr;
+	g_autoptr(GtkTreePath) end_path = nullptr;
 
-			valid = gtk_tree_model_iter_next(store, &iter);
-			}
-		}
+	if (!gtk_tree_view_get_visible_range(GTK_TREE_VIEW(vf->listview), &start_path, &end_path)) return FALSE;
 
-	/* then find first undone */
+	GtkTreeModel *store = gtk_tree_view_get_model(GTK_TREE_VIEW(vf->listview));
+	GtkTreeIter iter;
 
-	if (!fd)
-		{
-		GList *work = vf->list;
-		while (work && !fd)
-			{
-			auto fd_p = static_cast<FileData *>(work->data);
-			if (!fd_p->thumb_pixbuf)
-				fd = fd_p;
-			else
-				{
-				GList *work2 = fd_p->sidecar_files;
+	if (!gtk_tree_model_get_iter(store, &iter, start_path)) return FALSE;
+	gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &first, -1);
 
-				while (work2 && !fd)
-					{
-					fd_p = static_cast<FileData *>(work2->data);
-					if (!fd_p->thumb_pixbuf) fd = fd_p;
-					work2 = work2->next;
-					}
-				}
-			work = work->next;
-			}
-		}
+	if (!gtk_tree_model_get_iter(store, &iter, end_path)) return FALSE;
+	gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &last, -1);
 
-	return fd;
+	return first && last;
 }
 
 void vflist_set_star_fd(ViewFile *vf, FileData *fd)
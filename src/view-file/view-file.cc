@@ -20,6 +20,10 @@
 
 #include "view-file.h"
 
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
 #include <gdk/gdk.h>
 #include <glib-object.h>
 
@@ -45,6 +49,7 @@
 #include "options.h"
 #include "pixbuf-util.h"
 #include "sort-type.h"
+#include "thumb-queue.h"
 #include "thumb.h"
 #include "trash.h"
 #include "ui-fileops.h"
@@ -1157,6 +1162,8 @@ static void vf_destroy_cb(GtkWidget *, gpointer data)
 		vf->marks_filter_tooltip_id = 0;
 		}
 
+	g_signal_handlers_disconnect_by_data(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(vf->scrolled)), vf);
+
 	if (vf->listview)
 		{
 		g_object_set_data(G_OBJECT(vf->listview), VIEW_FILE_DATA_KEY, nullptr);
@@ -1808,6 +1815,8 @@ void vf_mark_filter_toggle(ViewFile *vf, gint mark)
 	gtk_toggle_button_set_active(filter_button, !gtk_toggle_button_get_active(filter_button));
 }
 
+static void vf_thumb_scroll_cb(GtkAdjustment *adjustment, gpointer data);
+
 ViewFile *vf_new(FileViewType type, FileData *dir_fd)
 {
 	ViewFile *vf;
@@ -1859,6 +1868,9 @@ ViewFile *vf_new(FileViewType type, FileData *dir_fd)
 
 	gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(vf->scrolled), vf->listview);
 
+	g_signal_connect(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(vf->scrolled)), "value-changed",
+	                 G_CALLBACK(vf_thumb_scroll_cb), vf);
+
 	vf_dnd_init(vf);
 
 	if (dir_fd) vf_set_fd(vf, dir_fd);
@@ -1888,21 +1900,34 @@ void vf_thumb_set(ViewFile *vf, gboolean enable)
 }
 
 
-static gboolean vf_thumb_next(ViewFile *vf);
+/**
+ * @brief The thumbnails of a view being generated, several at a time
+ */
+struct ViewFileThumbs
+{
+	struct Loader
+	{
+		ThumbLoader *tl;
+		FileData *fd;
+	};
+
+	std::vector<FileData *> files;	/**< in view order, sidecars after their parent in the list view */
+	std::unordered_map<FileData *, guint> positions;	/**< in #files */
+	ThumbQueue queue;
+	std::vector<Loader> loaders;	/**< in flight */
+
+	gint count;
+	gint done;
+};
+
+static void vf_thumb_fill(ViewFile *vf);
 
 static gdouble vf_thumb_progress(ViewFile *vf)
 {
-	gint count = 0;
-	gint done = 0;
-
-	switch (vf->type)
-	{
-	case FILEVIEW_LIST: vflist_thumb_progress_count(vf->list, count, done); break;
-	case FILEVIEW_ICON: vficon_thumb_progress_count(vf->list, count, done); break;
-	}
+	const ViewFileThumbs *thumbs = vf->thumbs;
 
-	DEBUG_1("thumb progress: %d of %d", done, count);
-	return static_cast<gdouble>(done) / count;
+	DEBUG_1("thumb progress: %d of %d", thumbs->done, thumbs->count);
+	return static_cast<gdouble>(thumbs->done) / thumbs->count;
 }
 
 static gdouble vf_read_metadata_in_idle_progress(ViewFile *vf)
@@ -1940,6 +1965,8 @@ static void vf_thumb_do(ViewFile *vf, FileData *fd)
 {
 	if (!fd) return;
 
+	vf->thumbs->done++;
+
 	vf_set_thumb_fd(vf, fd);
 	vf_thumb_status(vf, vf_thumb_progress(vf), _("Loading thumbs…"));
 }
@@ -1950,10 +1977,15 @@ void vf_thumb_cleanup(ViewFile *vf)
 
 	vf->thumbs_running = FALSE;
 
-	thumb_loader_free(vf->thumbs_loader);
-	vf->thumbs_loader = nullptr;
+	if (!vf->thumbs) return;
 
-	vf->thumbs_filedata = nullptr;
+	for (const ViewFileThumbs::Loader &loader : vf->thumbs->loaders)
+		{
+		thumb_loader_free(loader.tl);
+		}
+
+	delete vf->thumbs;
+	vf->thumbs = nullptr;
 }
 
 void vf_thumb_stop(ViewFile *vf)
@@ -1964,13 +1996,21 @@ void vf_thumb_stop(ViewFile *vf)
 static void vf_thumb_common_cb(ThumbLoader *tl, gpointer data)
 {
 	auto vf = static_cast<ViewFile *>(data);
+	ViewFileThumbs *thumbs = vf->thumbs;
 
-	if (vf->thumbs_filedata && vf->thumbs_loader == tl)
-		{
-		vf_thumb_do(vf, vf->thumbs_filedata);
-		}
+	if (!thumbs) return;
 
-	while (vf_thumb_next(vf));
+	auto loader = std::find_if(thumbs->loaders.begin(), thumbs->loaders.end(),
+	                           [tl](const ViewFileThumbs::Loader &loader) { return loader.tl == tl; });
+	if (loader == thumbs->loaders.end()) return;
+
+	FileData *fd = loader->fd;
+	thumbs->loaders.erase(loader);
+
+	vf_thumb_do(vf, fd);
+	thumb_loader_free(tl);
+
+	vf_thumb_fill(vf);
 }
 
 static void vf_thumb_error_cb(ThumbLoader *tl, gpointer data)
@@ -1983,50 +2023,94 @@ static void vf_thumb_done_cb(ThumbLoader *tl, gpointer data)
 	vf_thumb_common_cb(tl, data);
 }
 
-static gboolean vf_thumb_next(ViewFile *vf)
+/**
+ * @brief The number of thumbnails generated at a time
+ */
+static guint vf_thumb_loaders_max()
 {
-	FileData *fd = nullptr;
+	if (options->thumbnails.loaders > 0) return options->thumbnails.loaders;
 
-	if (!gtk_widget_get_realized(vf->listview))
-		{
-		vf_thumb_status(vf, 0.0, nullptr);
-		return FALSE;
-		}
+	return std::max(1U, g_get_num_processors());
+}
+
+/**
+ * @brief Puts the visible files first in the queue
+ */
+static void vf_thumb_set_visible(ViewFile *vf)
+{
+	ViewFileThumbs *thumbs = vf->thumbs;
+	FileData *first = nullptr;
+	FileData *last = nullptr;
+	gboolean visible = FALSE;
 
 	switch (vf->type)
 	{
-	case FILEVIEW_LIST: fd = vflist_thumb_next_fd(vf); break;
-	case FILEVIEW_ICON: fd = vficon_thumb_next_fd(vf); break;
+	case FILEVIEW_LIST: visible = vflist_thumb_visible_range(vf, first, last); break;
+	case FILEVIEW_ICON: visible = vficon_thumb_visible_range(vf, first, last); break;
 	}
 
-	if (!fd)
+	if (!visible) return;
+
+	const auto first_position = thumbs->positions.find(first);
+	const auto last_position = thumbs->positions.find(last);
+	if (first_position == thumbs->positions.end() || last_position == thumbs->positions.end()) return;
+
+	thumbs->queue.set_visible(first_position->second, last_position->second);
+}
+
+static void vf_thumb_scroll_cb(GtkAdjustment *, gpointer data)
+{
+	auto vf = static_cast<ViewFile *>(data);
+
+	if (vf->thumbs && vf->listview) vf_thumb_set_visible(vf);
+}
+
+/**
+ * @brief Starts loaders for the next files of the queue, until the maximum is in flight
+ */
+static void vf_thumb_fill(ViewFile *vf)
+{
+	ViewFileThumbs *thumbs = vf->thumbs;
+
+	if (!gtk_widget_get_realized(vf->listview))
 		{
-		/* done */
-		vf_thumb_cleanup(vf);
-		return FALSE;
+		vf_thumb_status(vf, 0.0, nullptr);
+		return;
 		}
 
-	vf->thumbs_filedata = fd;
+	const auto done = [thumbs](guint position) { return thumbs->files[position]->thumb_pixbuf != nullptr; };
+	const guint loaders_max = vf_thumb_loaders_max();
 
-	thumb_loader_free(vf->thumbs_loader);
+	while (thumbs->loaders.size() < loaders_max)
+		{
+		const gint position = thumbs->queue.take(done);
+		if (position < 0) break;
 
-	vf->thumbs_loader = thumb_loader_new(options->thumbnails.size.width, options->thumbnails.size.height);
-	thumb_loader_set_callbacks(vf->thumbs_loader,
-				   vf_thumb_done_cb,
-				   vf_thumb_error_cb,
-				   nullptr,
-				   vf);
+		FileData *fd = thumbs->files[position];
+		ThumbLoader *tl = thumb_loader_new(options->thumbnails.size.width, options->thumbnails.size.height);
+		thumb_loader_set_callbacks(tl,
+					   vf_thumb_done_cb,
+					   vf_thumb_error_cb,
+					   nullptr,
+					   vf);
 
-	if (!thumb_loader_start(vf->thumbs_loader, fd))
-		{
-		/* set icon to unknown, continue */
-		DEBUG_1("thumb loader start failed %s", fd->path);
-		vf_thumb_do(vf, fd);
+		thumbs->loaders.push_back({tl, fd});
 
-		return TRUE;
+		if (!thumb_loader_start(tl, fd))
+			{
+			/* set icon to unknown, continue */
+			DEBUG_1("thumb loader start failed %s", fd->path);
+			thumbs->loaders.pop_back();
+			thumb_loader_free(tl);
+			vf_thumb_do(vf, fd);
+			}
 		}
 
-	return FALSE;
+	if (thumbs->loaders.empty())
+		{
+		/* done */
+		vf_thumb_cleanup(vf);
+		}
 }
 
 static void vf_thumb_reset_all(ViewFile *vf)
@@ -2059,7 +2143,33 @@ void vf_thumb_update(ViewFile *vf)
 		thumb_format_changed = FALSE;
 		}
 
-	while (vf_thumb_next(vf));
+	auto *thumbs = new ViewFileThumbs();
+	vf->thumbs = thumbs;
+
+	for (GList *work = vf->list; work; work = work->next)
+		{
+		auto fd = static_cast<FileData *>(work->data);
+
+		thumbs->files.push_back(fd);
+		if (vf->type != FILEVIEW_LIST) continue;
+
+		for (GList *work2 = fd->sidecar_files; work2; work2 = work2->next)
+			{
+			thumbs->files.push_back(static_cast<FileData *>(work2->data));
+			}
+		}
+
+	for (guint i = 0; i < thumbs->files.size(); i++) thumbs->positions[thumbs->files[i]] = i;
+	thumbs->queue.reset(thumbs->files.size());
+
+	switch (vf->type)
+	{
+	case FILEVIEW_LIST: vflist_thumb_progress_count(vf->list, thumbs->count, thumbs->done); break;
+	case FILEVIEW_ICON: vficon_thumb_progress_count(vf->list, thumbs->count, thumbs->done); break;
+	}
+
+	vf_thumb_set_visible(vf);
+	vf_thumb_fill(vf);
 }
 
 void vf_star_cleanup(ViewFile *vf)
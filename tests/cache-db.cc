@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for cache-db.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "cache-db.h"
+#include "cache.h"
+#include "digest.h"
+#include "similar.h"
+#include "temp-dir-test.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+class CacheDbTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+		db = temp_path(GQ_CACHE_SIM_DB);
+	}
+
+	static CacheData cache_data(gint seed)
+	{
+		CacheData cd;
+		cd.set_dimensions({seed, seed + 1});
+		cd.date = seed;
+
+		/* digests of older versions stay readable */
+		Digest digest{seed % 2 ? DigestType::MD5 : DigestType::GQ128, {}};
+		digest.value[0] = seed;
+		cd.set_digest(digest);
+
+		ImageSimilarityData sd{};
+		sd.avg_r[0] = seed;
+		sd.avg_b[1023] = seed;
+		sd.phash = seed;
+		sd.filled = true;
+		cd.set_similarity(sd);
+
+		return cd;
+	}
+
+	std::string db;
+};
+
+TEST_F(CacheDbTest, RoundTrip)
+{
+	std::vector<std::string> paths;
+	for (gint i = 0; i < 100; i++)
+		{
+		paths.push_back(file(std::to_string(i).c_str()));
+		ASSERT_TRUE(cache_db_save(db.c_str(), paths.back().c_str(), cache_data(i)));
+		}
+
+	for (gint i = 0; i < 100; i++)
+		{
+		CacheData cd;
+		ASSERT_TRUE(cache_db_load(db.c_str(), paths[i].c_str(), cd));
+		ASSERT_EQ(GqSize({i, i + 1}), *cd.dimensions);
+		ASSERT_EQ(i, *cd.date);
+		ASSERT_EQ(i, cd.digest->value[0]);
+		ASSERT_EQ(i % 2 ? DigestType::MD5 : DigestType::GQ128, cd.digest->type);
+		ASSERT_TRUE(image_sim_filled(cd.similarity.get()));
+		ASSERT_EQ(i, cd.similarity->avg_r[0]);
+		ASSERT_EQ(i, cd.similarity->avg_b[1023]);
+		ASSERT_EQ(static_cast<guint64>(i), cd.similarity->phash);
+		}
+}
+
+TEST_F(CacheDbTest, ChangedSourceIsNotLoaded)
+{
+	const std::string path = file("a.jpg");
+	ASSERT_TRUE(cache_db_save(db.c_str(), path.c_str(), cache_data(1)));
+
+	file("a.jpg", "a longer image");
+
+	CacheData cd;
+	ASSERT_FALSE(cache_db_load(db.c_str(), path.c_str(), cd));
+	ASSERT_FALSE(cd.dimensions);
+}
+
+TEST_F(CacheDbTest, PartialRecord)
+{
+	const std::string path = file("a.jpg");
+
+	CacheData cd;
+	cd.set_dimensions({640, 480});
+	ASSERT_TRUE(cache_db_save(db.c_str(), path.c_str(), cd));
+
+	CacheData loaded;
+	ASSERT_TRUE(cache_db_load(db.c_str(), path.c_str(), loaded));
+	ASSERT_EQ(GqSize({640, 480}), *loaded.dimensions);
+	ASSERT_FALSE(loaded.date);
+	ASSERT_FALSE(loaded.digest);
+	ASSERT_FALSE(loaded.similarity);
+}
+
+TEST_F(CacheDbTest, MoveRemoveAndReuse)
+{
+	const std::string a = file("a.jpg");
+	const std::string b = file("b.jpg");
+	ASSERT_TRUE(cache_db_save(db.c_str(), a.c_str(), cache_data(1)));
+	ASSERT_TRUE(cache_db_save(db.c_str(), b.c_str(), cache_data(2)));
+
+	const std::string c = temp_path("c.jpg");
+	ASSERT_EQ(0, g_rename(a.c_str(), c.c_str()));
+
+	ASSERT_TRUE(cache_db_move(db.c_str(), a.c_str(), db.c_str(), c.c_str()));
+
+	CacheData cd;
+	ASSERT_TRUE(cache_db_load(db.c_str(), c.c_str(), cd));
+	ASSERT_EQ(1, *cd.date);
+
+	/* the freed record is reused */
+	GStatBuf before;
+	ASSERT_EQ(0, g_stat(db.c_str(), &before));
+
+	cache_db_remove(db.c_str(), b.c_str());
+	ASSERT_TRUE(cache_db_save(db.c_str(), b.c_str(), cache_data(3)));
+
+	GStatBuf after;
+	ASSERT_EQ(0, g_stat(db.c_str(), &after));
+	ASSERT_EQ(before.st_size, after.st_size);
+
+	CacheData cd_b;
+	ASSERT_TRUE(cache_db_load(db.c_str(), b.c_str(), cd_b));
+	ASSERT_EQ(3, *cd_b.date);
+}
+
+TEST_F(CacheDbTest, PurgeDropsMissingFiles)
+{
+	const std::string a = file("a.jpg");
+	const std::string b = file("b.jpg");
+	ASSERT_TRUE(cache_db_save(db.c_str(), a.c_str(), cache_data(1)));
+	ASSERT_TRUE(cache_db_save(db.c_str(), b.c_str(), cache_data(2)));
+
+	g_remove(a.c_str());
+
+	ASSERT_EQ(1, cache_db_purge(db.c_str(), dir));
+
+	CacheData cd;
+	ASSERT_TRUE(cache_db_load(db.c_str(), b.c_str(), cd));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for color-man-lut.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <glib.h>
+
+#include "color-man-lut.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+void sample_identity(const guint16 *in, guint16 *out, gsize count)
+{
+	std::copy(in, in + (count * 3), out);
+}
+
+/* a smooth transform that mixes the channels, as colour space conversions do */
+guint16 mixed(gdouble r, gdouble g, gdouble b, gint channel)
+{
+	const gdouble values[3] = {
+		std::pow((0.8 * r) + (0.2 * g), 1.2),
+		std::pow((0.1 * r) + (0.8 * g) + (0.1 * b), 0.9),
+		std::pow((0.05 * g) + (0.95 * b), 1.1)
+	};
+
+	return std::lround(std::clamp(values[channel], 0.0, 1.0) * 65535);
+}
+
+void sample_mixed(const guint16 *in, guint16 *out, gsize count)
+{
+	for (gsize i = 0; i < count * 3; i += 3)
+		{
+		for (gint channel = 0; channel < 3; channel++)
+			{
+			out[i + channel] = mixed(in[i] / 65535.0, in[i + 1] / 65535.0, in[i + 2] / 65535.0, channel);
+			}
+		}
+}
+
+/* every 8 bit colour, with the alpha channel set to the row */
+std::vector<guchar> all_colours(gint channels)
+{
+	std::vector<guchar> pixels(256 * 256 * 256 * channels);
+
+	guchar *p = pixels.data();
+	for (gint r = 0; r < 256; r++)
+		{
+		for (gint g = 0; g < 256; g++)
+			{
+			for (gint b = 0; b < 256; b++)
+				{
+				p[0] = r;
+				p[1] = g;
+				p[2] = b;
+				if (channels == 4) p[3] = (r * 256) + g;
+				p += channels;
+				}
+			}
+		}
+
+	return pixels;
+}
+
+TEST(ColorManLutTest, IdentityIsExact)
+{
+	const ColorManLut lut(sample_identity);
+
+	for (const gint channels : {3, 4})
+		{
+		const std::vector<guchar> expected = all_colours(channels);
+		std::vector<guchar> pixels = expected;
+
+		/* rows of 256 * 256 pixels, large enough to be split across threads */
+		lut.apply(pixels.data(), 256 * 256 * channels, channels, {0, 0, 256 * 256, 256});
+		ASSERT_EQ(expected, pixels) << channels;
+		}
+}
+
+TEST(ColorManLutTest, CloseToTransform)
+{
+	const ColorManLut lut(sample_mixed);
+
+	/* every third level, 0 and 255 included */
+	constexpr gint levels = 86;
+	std::vector<guchar> pixels;
+	for (gint r = 0; r < levels; r++)
+		{
+		for (gint g = 0; g < levels; g++)
+			{
+			for (gint b = 0; b < levels; b++)
+				{
+				pixels.insert(pixels.end(), {static_cast<guchar>(r * 3), static_cast<guchar>(g * 3), static_cast<guchar>(b * 3)});
+				}
+			}
+		}
+	const std::vector<guchar> original = pixels;
+
+	lut.apply(pixels.data(), levels * 3, 3, {0, 0, levels, levels * levels});
+
+	gint max_error = 0;
+	for (gsize i = 0; i < pixels.size(); i += 3)
+		{
+		for (gint channel = 0; channel < 3; channel++)
+			{
+			const gint expected = ((mixed(original[i] / 255.0, original[i + 1] / 255.0, original[i + 2] / 255.0, channel) * 255) + 32767) / 65535;
+			max_error = std::max(max_error, std::abs(pixels[i + channel] - expected));
+			}
+		}
+
+	ASSERT_LE(max_error, 1);
+}
+
+TEST(ColorManLutTest, Region)
+{
+	const ColorManLut lut(sample_mixed);
+	constexpr gint width = 40;
+	constexpr gint height = 30;
+	constexpr gint rowstride = (width * 4) + 3;
+
+	std::vector<guchar> pixels(rowstride * height);
+	for (gsize i = 0; i < pixels.size(); i++) pixels[i] = i * 7;
+	const std::vector<guchar> original = pixels;
+
+	const GdkRectangle region{5, 7, 20, 11};
+	lut.apply(pixels.data(), rowstride, 4, region);
+
+	for (gint y = 0; y < height; y++)
+		{
+		for (gint x = 0; x < width; x++)
+			{
+			const gsize i = (y * rowstride) + (x * 4);
+			const gboolean inside = x >= region.x && x < region.x + region.width &&
+			                        y >= region.y && y < region.y + region.height;
+
+			ASSERT_EQ(original[i + 3], pixels[i + 3]);
+			if (!inside)
+				{
+				ASSERT_EQ(original[i], pixels[i]);
+				ASSERT_EQ(original[i + 1], pixels[i + 1]);
+				ASSERT_EQ(original[i + 2], pixels[i + 2]);
+				}
+			}
+		}
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
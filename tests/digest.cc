@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for digest.cc
+ *
+ * The benchmark is disabled by default. Run it with
+ *   geeqie --run-unit-tests --gtest_also_run_disabled_tests --gtest_filter='DigestTest.*'
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "digest.h"
+#include "temp-dir-test.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+class DigestTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		data.resize(1024 * 1024 + 17);
+		for (gsize i = 0; i < data.size(); i++) data[i] = (i * 2654435761U) >> 13;
+
+		TempDirTest::SetUp();
+		path = temp_path("data");
+	}
+
+	void write(gsize length)
+	{
+		ASSERT_TRUE(g_file_set_contents(path.c_str(), reinterpret_cast<const gchar *>(data.data()), length, nullptr));
+	}
+
+	std::vector<guchar> data;
+	std::string path;
+};
+
+TEST_F(DigestTest, Md5KnownValue)
+{
+	const Digest digest = digest_from_data(DigestType::MD5, reinterpret_cast<const guchar *>("abc"), 3);
+
+	ASSERT_EQ(DigestType::MD5, digest.type);
+	ASSERT_EQ("900150983cd24fb0d6963f7d28e17f72", digest_to_text(digest));
+}
+
+TEST_F(DigestTest, SplitDoesNotMatter)
+{
+	for (const gsize length : {0, 1, 63, 64, 65, 1023, 1024, 1025, 100000})
+		{
+		const Digest whole = digest_from_data(DigestType::GQ128, data.data(), length);
+
+		DigestContext context(DigestType::GQ128);
+		gsize offset = 0;
+		for (gsize step = 1; offset < length; step = (step * 3) + 1)
+			{
+			const gsize size = std::min(step, length - offset);
+			context.update(data.data() + offset, size);
+			offset += size;
+			}
+
+		ASSERT_EQ(whole, context.finish()) << length;
+		}
+}
+
+TEST_F(DigestTest, EveryByteCounts)
+{
+	const Digest digest = digest_from_data(DigestType::GQ128, data.data(), 4096);
+
+	for (const gsize position : {0, 7, 63, 64, 1000, 4095})
+		{
+		data[position] ^= 1;
+		ASSERT_NE(digest, digest_from_data(DigestType::GQ128, data.data(), 4096)) << position;
+		data[position] ^= 1;
+		}
+
+	/* trailing zeros are not padding */
+	data[4096] = 0;
+	ASSERT_NE(digest, digest_from_data(DigestType::GQ128, data.data(), 4097));
+}
+
+TEST_F(DigestTest, FileMatchesData)
+{
+	write(data.size());
+
+	Digest digest;
+	ASSERT_TRUE(digest_from_file(path.c_str(), DigestType::GQ128, digest));
+	ASSERT_EQ(digest_from_data(DigestType::GQ128, data.data(), data.size()), digest);
+
+	ASSERT_TRUE(digest_from_file(path.c_str(), DigestType::MD5, digest));
+	ASSERT_EQ(digest_from_data(DigestType::MD5, data.data(), data.size()), digest);
+}
+
+TEST_F(DigestTest, FileEnds)
+{
+	constexpr gsize ends = 4096;
+	write(data.size());
+
+	DigestContext context(DigestType::GQ128);
+	context.update(data.data(), ends);
+	context.update(data.data() + data.size() - ends, ends);
+
+	Digest digest;
+	ASSERT_TRUE(digest_from_file(path.c_str(), DigestType::GQ128, digest, ends));
+	ASSERT_EQ(context.finish(), digest);
+
+	/* a small file is read whole */
+	write(2 * ends);
+	ASSERT_TRUE(digest_from_file(path.c_str(), DigestType::GQ128, digest, ends));
+	ASSERT_EQ(digest_from_data(DigestType::GQ128, data.data(), 2 * ends), digest);
+}
+
+TEST_F(DigestTest, TextRoundTrip)
+{
+	const Digest digest = digest_from_data(DigestType::GQ128, data.data(), 100);
+
+	Digest parsed;
+	ASSERT_TRUE(digest_from_text(digest_to_text(digest).c_str(), DigestType::GQ128, parsed));
+	ASSERT_EQ(digest, parsed);
+
+	DigestType type;
+	ASSERT_TRUE(digest_type_from_text("gq128:0123", 5, type));
+	ASSERT_EQ(DigestType::GQ128, type);
+	ASSERT_FALSE(digest_type_from_text("sha1", 4, type));
+}
+
+TEST_F(DigestTest, DISABLED_Benchmark)
+{
+	std::vector<guchar> large(256 * 1024 * 1024);
+	for (gsize i = 0; i < large.size(); i++) large[i] = i * 31;
+
+	for (const DigestType type : {DigestType::MD5, DigestType::GQ128})
+		{
+		const auto start = std::chrono::steady_clock::now();
+		digest_from_data(type, large.data(), large.size());
+		const std::chrono::duration<gdouble> elapsed = std::chrono::steady_clock::now() - start;
+
+		std::cerr << digest_type_to_text(type) << ": "
+		          << (large.size() / (1024.0 * 1024.0)) / elapsed.count() << " MiB/s\n";
+		}
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for dupe-index.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "dupe-index.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+class DupeMatchIndexTest : public t::Test
+{
+    protected:
+	void SetUp() override
+	{
+		a = index.add_member("/photos/a.jpg", 100, 1000);
+		b = index.add_member("/photos/b.jpg", 200, 2000);
+		c = index.add_member("/photos/2024/c.jpg", 300, 3000);
+		index.add_match(a, b, 97.5);
+	}
+
+	DupeMatchIndex index{"test"};
+	guint32 a = 0;
+	guint32 b = 0;
+	guint32 c = 0;
+};
+
+TEST_F(DupeMatchIndexTest, FindsUnchangedMembersOnly)
+{
+	ASSERT_EQ(static_cast<gint>(b), index.find("/photos/b.jpg", 200, 2000));
+
+	ASSERT_EQ(-1, index.find("/photos/b.jpg", 201, 2000));
+	ASSERT_EQ(-1, index.find("/photos/b.jpg", 200, 2001));
+	ASSERT_EQ(-1, index.find("/photos/d.jpg", 200, 2000));
+}
+
+TEST_F(DupeMatchIndexTest, MoveKeepsMatches)
+{
+	index.moved("/photos/a.jpg", "/photos/renamed.jpg");
+
+	ASSERT_EQ(-1, index.find("/photos/a.jpg", 100, 1000));
+	ASSERT_EQ(static_cast<gint>(a), index.find("/photos/renamed.jpg", 100, 1000));
+
+	ASSERT_EQ(1u, index.get_matches().size());
+	ASSERT_EQ(a, index.get_matches().front().a);
+	ASSERT_EQ(b, index.get_matches().front().b);
+}
+
+TEST_F(DupeMatchIndexTest, FolderMoveRenamesMembers)
+{
+	g_autofree gchar *dir = g_dir_make_tmp("geeqie_test_XXXXXX", nullptr);
+	ASSERT_NE(dir, nullptr);
+
+	index.moved("/photos/2024", dir);
+
+	g_autofree gchar *moved = g_build_filename(dir, "c.jpg", nullptr);
+	ASSERT_EQ(static_cast<gint>(c), index.find(moved, 300, 3000));
+	ASSERT_EQ(static_cast<gint>(a), index.find("/photos/a.jpg", 100, 1000));
+
+	g_rmdir(dir);
+}
+
+TEST_F(DupeMatchIndexTest, RemovedMemberIsNotFound)
+{
+	index.removed("/photos/b.jpg");
+
+	ASSERT_EQ(-1, index.find("/photos/b.jpg", 200, 2000));
+	ASSERT_EQ(static_cast<gint>(a), index.find("/photos/a.jpg", 100, 1000));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for image-load-tiff.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib-object.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <tiff.h>
+#include <tiffio.h>
+
+#include "image-load-tiff.h"
+#include "image-load.h"
+#include "temp-dir-test.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+constexpr gint WIDTH = 1000;
+constexpr gint HEIGHT = 700;
+
+guchar pixel(gint x, gint y, gint channel)
+{
+	switch (channel)
+		{
+		case 0: return (x * 7) + (y * 3);
+		case 1: return x ^ y;
+		default: return (y * 5) + x;
+		}
+}
+
+class ImageLoadTiffTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+		path = temp_path("image.tif");
+	}
+
+	/* tile_width 0 writes strips of tile_height rows */
+	void write(gint tile_width, gint tile_height)
+	{
+		TIFF *tiff = TIFFOpen(path.c_str(), "w");
+		ASSERT_NE(tiff, nullptr);
+
+		TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, WIDTH);
+		TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, HEIGHT);
+		TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 8);
+		TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, 3);
+		TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+		TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+		TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE);
+
+		if (tile_width)
+			{
+			TIFFSetField(tiff, TIFFTAG_TILEWIDTH, tile_width);
+			TIFFSetField(tiff, TIFFTAG_TILELENGTH, tile_height);
+
+			std::vector<guchar> tile(tile_width * tile_height * 3);
+			for (gint tile_y = 0; tile_y < HEIGHT; tile_y += tile_height)
+				{
+				for (gint tile_x = 0; tile_x < WIDTH; tile_x += tile_width)
+					{
+					for (gint i = 0; i < tile_width * tile_height * 3; i++)
+						{
+						tile[i] = pixel(tile_x + ((i / 3) % tile_width), tile_y + (i / 3 / tile_width), i % 3);
+						}
+					ASSERT_GE(TIFFWriteTile(tiff, tile.data(), tile_x, tile_y, 0, 0), 0);
+					}
+				}
+			}
+		else
+			{
+			TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, tile_height);
+
+			std::vector<guchar> line(WIDTH * 3);
+			for (gint y = 0; y < HEIGHT; y++)
+				{
+				for (gint i = 0; i < WIDTH * 3; i++) line[i] = pixel(i / 3, y, i % 3);
+				ASSERT_EQ(1, TIFFWriteScanline(tiff, line.data(), y, 0));
+				}
+			}
+
+		TIFFClose(tiff);
+	}
+
+	/* the number of pixels that differ from the image, or are not black outside of it */
+	static gint compare_region(ImageRegionSource *source, gint x, gint y, gint width, gint height)
+	{
+		GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+		if (!source->read_region(x, y, pixbuf))
+			{
+			g_object_unref(pixbuf);
+			return -1;
+			}
+
+		const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+		const guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+		gint wrong = 0;
+
+		for (gint row = 0; row < height; row++)
+			{
+			for (gint col = 0; col < width; col++)
+				{
+				const guchar *p = pixels + (row * rowstride) + (col * 3);
+				const gboolean inside = x + col < WIDTH && y + row < HEIGHT;
+
+				for (gint channel = 0; channel < 3; channel++)
+					{
+					if (p[channel] != (inside ? pixel(x + col, y + row, channel) : 0))
+						{
+						wrong++;
+						break;
+						}
+					}
+				}
+			}
+
+		g_object_unref(pixbuf);
+		return wrong;
+	}
+
+	/* the number of pixels that differ from the image, after decoding the whole file */
+	gint compare_loader(gint &rows_updated)
+	{
+		gchar *contents;
+		gsize length;
+		if (!g_file_get_contents(path.c_str(), &contents, &length, nullptr)) return -1;
+
+		std::unique_ptr<ImageLoaderBackend> loader = get_image_loader_backend_tiff();
+		const auto area_updated_cb = [](gpointer, gint x, gint, gint width, gint height, gpointer data)
+		{
+			if (x == 0 && width == WIDTH) g_atomic_int_add(static_cast<gint *>(data), height);
+		};
+		rows_updated = 0;
+		loader->init(area_updated_cb, [](gpointer, gint, gint, gpointer) {}, &rows_updated);
+
+		gsize chunk_size = 0;
+		const gboolean success = loader->write(reinterpret_cast<guchar *>(contents), chunk_size, length, nullptr);
+		g_free(contents);
+		GdkPixbuf *pixbuf = loader->get_pixbuf();
+		if (!success || !pixbuf) return -1;
+
+		const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+		const guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+		gint wrong = 0;
+
+		for (gint y = 0; y < HEIGHT; y++)
+			{
+			for (gint x = 0; x < WIDTH; x++)
+				{
+				const guchar *p = pixels + (y * rowstride) + (x * 4);
+
+				if (p[0] != pixel(x, y, 0) || p[1] != pixel(x, y, 1) || p[2] != pixel(x, y, 2) || p[3] != 0xff)
+					{
+					wrong++;
+					}
+				}
+			}
+
+		return wrong;
+	}
+
+	static void compare(ImageRegionSource *source)
+	{
+		ASSERT_EQ(WIDTH, source->get_width());
+		ASSERT_EQ(HEIGHT, source->get_height());
+
+		ASSERT_EQ(0, compare_region(source, 0, 0, 512, 512));
+		ASSERT_EQ(0, compare_region(source, 512, 0, 512, 512));
+		ASSERT_EQ(0, compare_region(source, 512, 512, 512, 512));
+		ASSERT_EQ(0, compare_region(source, 100, 37, 200, 150));
+		ASSERT_EQ(0, compare_region(source, 0, 0, 512, 512)); /* from the cache */
+	}
+
+	/* the number of pixels of the overview that differ from the average of the pixels they cover */
+	static gint compare_overview(GdkPixbuf *overview, gint shrink)
+	{
+		const gint rowstride = gdk_pixbuf_get_rowstride(overview);
+		const guchar *pixels = gdk_pixbuf_get_pixels(overview);
+		gint wrong = 0;
+
+		for (gint y = 0; y < gdk_pixbuf_get_height(overview); y++)
+			{
+			for (gint x = 0; x < gdk_pixbuf_get_width(overview); x++)
+				{
+				const guchar *p = pixels + (y * rowstride) + (x * 3);
+				const gint box_w = std::min(shrink, WIDTH - (x * shrink));
+				const gint box_h = std::min(shrink, HEIGHT - (y * shrink));
+
+				for (gint channel = 0; channel < 3; channel++)
+					{
+					gint64 sum = 0;
+					for (gint row = 0; row < box_h; row++)
+						{
+						for (gint col = 0; col < box_w; col++) sum += pixel((x * shrink) + col, (y * shrink) + row, channel);
+						}
+
+					if (p[channel] != (sum + (box_w * box_h / 2)) / (box_w * box_h))
+						{
+						wrong++;
+						break;
+						}
+					}
+				}
+			}
+
+		return wrong;
+	}
+
+	std::string path;
+};
+
+TEST_F(ImageLoadTiffTest, Tiled)
+{
+	write(64, 48);
+
+	std::unique_ptr<ImageRegionSource> source = get_image_region_source_tiff(path.c_str(), 0);
+	ASSERT_TRUE(source);
+	compare(source.get());
+}
+
+TEST_F(ImageLoadTiffTest, Striped)
+{
+	for (const gint rows : {1, 7, HEIGHT})
+		{
+		write(0, rows);
+
+		std::unique_ptr<ImageRegionSource> source = get_image_region_source_tiff(path.c_str(), 0);
+		ASSERT_TRUE(source) << rows;
+		compare(source.get());
+		}
+}
+
+TEST_F(ImageLoadTiffTest, LoaderTiled)
+{
+	for (const gint size : {48, 256})
+		{
+		write(size, size);
+
+		gint rows_updated;
+		ASSERT_EQ(0, compare_loader(rows_updated)) << size;
+		ASSERT_EQ(HEIGHT, rows_updated) << size;
+		}
+}
+
+TEST_F(ImageLoadTiffTest, LoaderStriped)
+{
+	for (const gint rows : {1, 7, HEIGHT})
+		{
+		write(0, rows);
+
+		gint rows_updated;
+		ASSERT_EQ(0, compare_loader(rows_updated)) << rows;
+		ASSERT_EQ(HEIGHT, rows_updated) << rows;
+		}
+}
+
+TEST_F(ImageLoadTiffTest, Overview)
+{
+	write(64, 48);
+
+	std::unique_ptr<ImageRegionSource> source = get_image_region_source_tiff(path.c_str(), 0);
+	ASSERT_TRUE(source);
+
+	std::atomic<bool> cancelled{false};
+	for (const gint shrink : {1, 8, 1024})
+		{
+		GdkPixbuf *overview = source->read_overview(shrink, cancelled);
+		ASSERT_NE(overview, nullptr) << shrink;
+
+		ASSERT_EQ((WIDTH + shrink - 1) / shrink, gdk_pixbuf_get_width(overview)) << shrink;
+		ASSERT_EQ((HEIGHT + shrink - 1) / shrink, gdk_pixbuf_get_height(overview)) << shrink;
+		ASSERT_EQ(0, compare_overview(overview, shrink)) << shrink;
+		g_object_unref(overview);
+		}
+
+	cancelled = true;
+	ASSERT_EQ(nullptr, source->read_overview(8, cancelled));
+}
+
+TEST_F(ImageLoadTiffTest, MissingPage)
+{
+	write(0, 7);
+
+	ASSERT_FALSE(get_image_region_source_tiff(path.c_str(), 1));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for image-probe.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "geometry.h"
+#include "image-probe.h"
+#include "temp-dir-test.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+using namespace std::string_view_literals;
+
+using Bytes = std::vector<guchar>;
+
+void append(Bytes &bytes, std::string_view text)
+{
+	bytes.insert(bytes.end(), text.cbegin(), text.cend());
+}
+
+void append_be16(Bytes &bytes, guint value)
+{
+	bytes.insert(bytes.end(), {static_cast<guchar>(value >> 8), static_cast<guchar>(value)});
+}
+
+void append_be32(Bytes &bytes, guint32 value)
+{
+	append_be16(bytes, value >> 16);
+	append_be16(bytes, value & 0xFFFF);
+}
+
+void append_le16(Bytes &bytes, guint value)
+{
+	bytes.insert(bytes.end(), {static_cast<guchar>(value), static_cast<guchar>(value >> 8)});
+}
+
+void append_le32(Bytes &bytes, guint32 value)
+{
+	append_le16(bytes, value & 0xFFFF);
+	append_le16(bytes, value >> 16);
+}
+
+/* ISO base media box */
+Bytes box(std::string_view type, const Bytes &payload)
+{
+	Bytes bytes;
+	append_be32(bytes, 8 + payload.size());
+	append(bytes, type);
+	bytes.insert(bytes.end(), payload.cbegin(), payload.cend());
+	return bytes;
+}
+
+Bytes operator+(Bytes a, const Bytes &b)
+{
+	a.insert(a.end(), b.cbegin(), b.cend());
+	return a;
+}
+
+class ImageProbeTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+		path = temp_path("image");
+	}
+
+	GqSize probe(const Bytes &bytes)
+	{
+		EXPECT_TRUE(g_file_set_contents(path.c_str(), reinterpret_cast<const gchar *>(bytes.data()), bytes.size(), nullptr));
+
+		GqSize dimensions{0, 0};
+		if (!image_probe_dimensions(path.c_str(), dimensions)) return {-1, -1};
+
+		return dimensions;
+	}
+
+	std::string path;
+};
+
+TEST_F(ImageProbeTest, Jpeg)
+{
+	Bytes bytes{0xFF, 0xD8};
+
+	/* APP0, a fill byte, then a progressive frame */
+	bytes.insert(bytes.end(), {0xFF, 0xE0});
+	append_be16(bytes, 16);
+	bytes.resize(bytes.size() + 14);
+	bytes.insert(bytes.end(), {0xFF, 0xFF, 0xC2});
+	append_be16(bytes, 17);
+	bytes.push_back(8);
+	append_be16(bytes, 480);
+	append_be16(bytes, 640);
+	bytes.resize(bytes.size() + 10);
+
+	ASSERT_EQ(GqSize({640, 480}), probe(bytes));
+}
+
+TEST_F(ImageProbeTest, JpegWithoutFrame)
+{
+	Bytes bytes{0xFF, 0xD8, 0xFF, 0xDA, 0x00, 0x02};
+
+	ASSERT_EQ(GqSize({-1, -1}), probe(bytes));
+}
+
+TEST_F(ImageProbeTest, Png)
+{
+	Bytes bytes;
+	append(bytes, "\x89PNG\r\n\x1A\n");
+	append_be32(bytes, 13);
+	append(bytes, "IHDR");
+	append_be32(bytes, 640);
+	append_be32(bytes, 480);
+	bytes.resize(bytes.size() + 9);
+
+	ASSERT_EQ(GqSize({640, 480}), probe(bytes));
+}
+
+TEST_F(ImageProbeTest, Tiff)
+{
+	Bytes intel;
+	append(intel, "II*\0"sv);
+	append_le32(intel, 8);
+	append_le16(intel, 2);
+	append_le16(intel, 256);
+	append_le16(intel, 3);
+	append_le32(intel, 1);
+	append_le16(intel, 640);
+	append_le16(intel, 0);
+	append_le16(intel, 257);
+	append_le16(intel, 4);
+	append_le32(intel, 1);
+	append_le32(intel, 480);
+
+	ASSERT_EQ(GqSize({640, 480}), probe(intel));
+
+	Bytes motorola;
+	append(motorola, "MM\0*"sv);
+	append_be32(motorola, 8);
+	append_be16(motorola, 2);
+	append_be16(motorola, 257);
+	append_be16(motorola, 3);
+	append_be32(motorola, 1);
+	append_be16(motorola, 480);
+	append_be16(motorola, 0);
+	append_be16(motorola, 256);
+	append_be16(motorola, 4);
+	append_be32(motorola, 1);
+	append_be32(motorola, 640);
+
+	ASSERT_EQ(GqSize({640, 480}), probe(motorola));
+}
+
+TEST_F(ImageProbeTest, WebP)
+{
+	const auto riff = [](std::string_view chunk, const Bytes &payload)
+	{
+		Bytes bytes;
+		append(bytes, "RIFF");
+		append_le32(bytes, 12 + payload.size());
+		append(bytes, "WEBP");
+		append(bytes, chunk);
+		append_le32(bytes, payload.size());
+		return bytes + payload;
+	};
+
+	Bytes lossy{0, 0, 0, 0x9D, 0x01, 0x2A};
+	append_le16(lossy, 640);
+	append_le16(lossy, 480);
+	ASSERT_EQ(GqSize({640, 480}), probe(riff("VP8 ", lossy)));
+
+	Bytes lossless{0x2F};
+	append_le32(lossless, (639) | (479 << 14));
+	lossless.resize(10);
+	ASSERT_EQ(GqSize({640, 480}), probe(riff("VP8L", lossless)));
+
+	Bytes extended(4);
+	extended.insert(extended.end(), {0x7F, 0x02, 0x00, 0xDF, 0x01, 0x00});
+	ASSERT_EQ(GqSize({640, 480}), probe(riff("VP8X", extended)));
+}
+
+TEST_F(ImageProbeTest, Heif)
+{
+	const auto full_box = [](std::string_view type, const Bytes &payload)
+	{
+		return box(type, Bytes(4) + payload);
+	};
+
+	Bytes ftyp;
+	append(ftyp, "heic");
+	append_be32(ftyp, 0);
+	append(ftyp, "mif1heic");
+
+	Bytes pitm;
+	append_be16(pitm, 2);
+
+	Bytes thumbnail;
+	append_be32(thumbnail, 160);
+	append_be32(thumbnail, 120);
+
+	Bytes image;
+	append_be32(image, 640);
+	append_be32(image, 480);
+
+	/* the primary item is rotated by 90 degrees */
+	const Bytes ipco = full_box("ispe", thumbnail) + full_box("ispe", image) + box("irot", {1});
+
+	Bytes ipma;
+	append_be32(ipma, 2);
+	append_be16(ipma, 1);
+	ipma.insert(ipma.end(), {1, 0x81});
+	append_be16(ipma, 2);
+	ipma.insert(ipma.end(), {2, 0x82, 0x03});
+
+	const Bytes meta = full_box("meta", full_box("pitm", pitm) + box("iprp", box("ipco", ipco) + full_box("ipma", ipma)));
+
+	ASSERT_EQ(GqSize({480, 640}), probe(box("ftyp", ftyp) + meta + box("mdat", Bytes(16))));
+}
+
+TEST_F(ImageProbeTest, PsdAndDds)
+{
+	Bytes psd;
+	append(psd, "8BPS");
+	append_be16(psd, 1);
+	psd.resize(psd.size() + 8);
+	append_be32(psd, 480);
+	append_be32(psd, 640);
+	append_be16(psd, 8);
+	append_be16(psd, 3);
+
+	ASSERT_EQ(GqSize({640, 480}), probe(psd));
+
+	Bytes dds;
+	append(dds, "DDS ");
+	append_le32(dds, 124);
+	append_le32(dds, 0x1007);
+	append_le32(dds, 480);
+	append_le32(dds, 640);
+	dds.resize(128);
+
+	ASSERT_EQ(GqSize({640, 480}), probe(dds));
+}
+
+TEST_F(ImageProbeTest, UnknownOrTruncated)
+{
+	Bytes text;
+	append(text, "not an image");
+	ASSERT_EQ(GqSize({-1, -1}), probe(text));
+
+	Bytes png;
+	append(png, "\x89PNG\r\n\x1A\n");
+	ASSERT_EQ(GqSize({-1, -1}), probe(png));
+
+	Bytes tiff;
+	append(tiff, "II*\0"sv);
+	append_le32(tiff, 1000);
+	ASSERT_EQ(GqSize({-1, -1}), probe(tiff));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for pixbuf-transform.cc
+ *
+ * The benchmark is disabled by default, run it with
+ * geeqie --run-unit-tests --gtest_also_run_disabled_tests --gtest_filter='PixbufTransform*'
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <glib.h>
+
+#include "exif.h"
+#include "pixbuf-transform.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+/* odd sizes, to cover the pixels left over by the blocks and the 4 x 4 groups */
+constexpr gint WIDTH = 203;
+constexpr gint HEIGHT = 131;
+
+gint pixel_bytes(PixelFormat format)
+{
+	return format == PixelFormat::RGB ? 3 : 4;
+}
+
+struct Buffer
+{
+	Buffer(gint width, gint height, PixelFormat format)
+		: width(width)
+		, height(height)
+		, rowstride((width * pixel_bytes(format)) + 5) /* not a multiple of the pixel size */
+		, format(format)
+		, data(rowstride * height, 0x5a)
+	{}
+
+	PixelBuffer pixel_buffer() { return {data.data(), rowstride, format}; }
+	guchar *pixel(gint x, gint y) { return data.data() + (y * rowstride) + (x * pixel_bytes(format)); }
+
+	gint width;
+	gint height;
+	gint rowstride;
+	PixelFormat format;
+	std::vector<guchar> data;
+};
+
+Buffer source_buffer(PixelFormat format, gint width = WIDTH, gint height = HEIGHT)
+{
+	Buffer buffer(width, height, format);
+
+	for (gint y = 0; y < height; y++)
+		{
+		for (gint x = 0; x < width; x++)
+			{
+			guchar *p = buffer.pixel(x, y);
+			p[0] = x;
+			p[1] = y;
+			p[2] = x ^ (y * 3);
+			if (format == PixelFormat::RGBA) p[3] = x + y;
+			}
+		}
+
+	return buffer;
+}
+
+/* where pixel (x, y) of a width x height frame goes, written out as in the EXIF specification */
+void oriented_position(gint orientation, gint width, gint height, gint x, gint y, gint &dx, gint &dy)
+{
+	switch (orientation)
+		{
+		case EXIF_ORIENTATION_TOP_RIGHT: dx = width - 1 - x; dy = y; break;
+		case EXIF_ORIENTATION_BOTTOM_RIGHT: dx = width - 1 - x; dy = height - 1 - y; break;
+		case EXIF_ORIENTATION_BOTTOM_LEFT: dx = x; dy = height - 1 - y; break;
+		case EXIF_ORIENTATION_LEFT_TOP: dx = y; dy = x; break;
+		case EXIF_ORIENTATION_RIGHT_TOP: dx = height - 1 - y; dy = x; break;
+		case EXIF_ORIENTATION_RIGHT_BOTTOM: dx = height - 1 - y; dy = width - 1 - x; break;
+		case EXIF_ORIENTATION_LEFT_BOTTOM: dx = y; dy = width - 1 - x; break;
+		default: dx = x; dy = y; break;
+		}
+}
+
+/* the number of pixels of rect not copied as expected, or copied outside of it */
+gint compare(Buffer &src, Buffer &dest, GdkRectangle rect, gint orientation)
+{
+	gint wrong = 0;
+
+	for (gint y = 0; y < src.height; y++)
+		{
+		for (gint x = 0; x < src.width; x++)
+			{
+			gint dx;
+			gint dy;
+			oriented_position(orientation, src.width, src.height, x, y, dx, dy);
+
+			const guchar *s = src.pixel(x, y);
+			const guchar *d = dest.pixel(dx, dy);
+			const gboolean inside = x >= rect.x && x < rect.x + rect.width &&
+			                        y >= rect.y && y < rect.y + rect.height;
+
+			guchar expected[4] = {0x5a, 0x5a, 0x5a, 0x5a};
+			if (inside && dest.format == PixelFormat::XRGB32)
+				{
+				const guint32 word = 0xff000000 | (s[0] << 16) | (s[1] << 8) | s[2];
+				memcpy(expected, &word, sizeof(word));
+				}
+			else if (inside)
+				{
+				memcpy(expected, s, pixel_bytes(dest.format));
+				}
+
+			if (memcmp(d, expected, pixel_bytes(dest.format)) != 0) wrong++;
+			}
+		}
+
+	return wrong;
+}
+
+void check_formats(PixelFormat src_format, PixelFormat dest_format, GdkRectangle rect)
+{
+	Buffer src = source_buffer(src_format);
+
+	for (gint orientation = EXIF_ORIENTATION_TOP_LEFT; orientation <= EXIF_ORIENTATION_LEFT_BOTTOM; orientation++)
+		{
+		const gboolean swap = pixbuf_transform_swaps_axes(orientation);
+		Buffer dest(swap ? HEIGHT : WIDTH, swap ? WIDTH : HEIGHT, dest_format);
+
+		pixbuf_transform_region(src.pixel_buffer(), WIDTH, HEIGHT, rect, dest.pixel_buffer(), orientation);
+		ASSERT_EQ(0, compare(src, dest, rect, orientation)) << orientation;
+		}
+}
+
+TEST(PixbufTransformTest, SwapsAxes)
+{
+	ASSERT_FALSE(pixbuf_transform_swaps_axes(EXIF_ORIENTATION_UNKNOWN));
+	ASSERT_FALSE(pixbuf_transform_swaps_axes(EXIF_ORIENTATION_TOP_LEFT));
+	ASSERT_FALSE(pixbuf_transform_swaps_axes(EXIF_ORIENTATION_BOTTOM_RIGHT));
+	ASSERT_TRUE(pixbuf_transform_swaps_axes(EXIF_ORIENTATION_LEFT_TOP));
+	ASSERT_TRUE(pixbuf_transform_swaps_axes(EXIF_ORIENTATION_RIGHT_TOP));
+	ASSERT_TRUE(pixbuf_transform_swaps_axes(EXIF_ORIENTATION_RIGHT_BOTTOM));
+	ASSERT_TRUE(pixbuf_transform_swaps_axes(EXIF_ORIENTATION_LEFT_BOTTOM));
+}
+
+TEST(PixbufTransformTest, Rgb)
+{
+	check_formats(PixelFormat::RGB, PixelFormat::RGB, {0, 0, WIDTH, HEIGHT});
+}
+
+TEST(PixbufTransformTest, Rgba)
+{
+	check_formats(PixelFormat::RGBA, PixelFormat::RGBA, {0, 0, WIDTH, HEIGHT});
+}
+
+TEST(PixbufTransformTest, RgbToXrgb)
+{
+	check_formats(PixelFormat::RGB, PixelFormat::XRGB32, {0, 0, WIDTH, HEIGHT});
+}
+
+TEST(PixbufTransformTest, RgbaToXrgb)
+{
+	check_formats(PixelFormat::RGBA, PixelFormat::XRGB32, {0, 0, WIDTH, HEIGHT});
+}
+
+TEST(PixbufTransformTest, Region)
+{
+	check_formats(PixelFormat::RGB, PixelFormat::RGB, {5, 70, 130, 33});
+	check_formats(PixelFormat::RGBA, PixelFormat::XRGB32, {67, 3, 1, 101});
+	check_formats(PixelFormat::RGBA, PixelFormat::RGBA, {150, 100, 100, 100}); /* clipped to the frame */
+}
+
+/* the pixel by pixel loop the transforms replace */
+void transform_plain(Buffer &src, Buffer &dest, gint orientation)
+{
+	const gint bytes = pixel_bytes(src.format);
+
+	for (gint y = 0; y < src.height; y++)
+		{
+		for (gint x = 0; x < src.width; x++)
+			{
+			gint dx;
+			gint dy;
+			oriented_position(orientation, src.width, src.height, x, y, dx, dy);
+			memcpy(dest.pixel(dx, dy), src.pixel(x, y), bytes);
+			}
+		}
+}
+
+TEST(PixbufTransformTest, DISABLED_Benchmark)
+{
+	constexpr gint width = 6000;
+	constexpr gint height = 4000;
+	constexpr gint repeat = 5;
+
+	for (const PixelFormat format : {PixelFormat::RGB, PixelFormat::RGBA})
+		{
+		Buffer src = source_buffer(format, width, height);
+
+		for (const gint orientation : {EXIF_ORIENTATION_TOP_LEFT, EXIF_ORIENTATION_BOTTOM_RIGHT, EXIF_ORIENTATION_RIGHT_TOP, EXIF_ORIENTATION_LEFT_BOTTOM})
+			{
+			const gboolean swap = pixbuf_transform_swaps_axes(orientation);
+			Buffer dest(swap ? height : width, swap ? width : height, format);
+
+			gint64 start = g_get_monotonic_time();
+			for (gint i = 0; i < repeat; i++) transform_plain(src, dest, orientation);
+			const gint64 plain = (g_get_monotonic_time() - start) / repeat;
+
+			start = g_get_monotonic_time();
+			for (gint i = 0; i < repeat; i++)
+				{
+				pixbuf_transform_region(src.pixel_buffer(), width, height, {0, 0, width, height}, dest.pixel_buffer(), orientation);
+				}
+			const gint64 blocked = (g_get_monotonic_time() - start) / repeat;
+
+			std::cerr << (format == PixelFormat::RGB ? "RGB " : "RGBA") << " orientation " << orientation
+			          << ": plain " << plain << " us, transform " << blocked << " us\n";
+			}
+		}
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -24,10 +24,141 @@
 
 #include "gtest/gtest.h"
 
+#include <atomic>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib-object.h>
+#include <glib.h>
+
 #include "pixbuf-util.h"
 
 namespace {
 
+// For convenience.
+namespace t = ::testing;
+
+/* pixel x, y gets red x * 10 + y, green 100 + x, blue 200 + y, alpha 255 */
+GdkPixbuf *numbered_pixbuf(gint width, gint height, gboolean has_alpha)
+{
+	GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+	const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+
+	for (gint y = 0; y < height; y++)
+		{
+		guchar *p = gdk_pixbuf_get_pixels(pixbuf) + (static_cast<gsize>(y) * gdk_pixbuf_get_rowstride(pixbuf));
+		for (gint x = 0; x < width; x++, p += channels)
+			{
+			p[0] = (x * 10) + y;
+			p[1] = 100 + x;
+			p[2] = 200 + y;
+			if (has_alpha) p[3] = 255;
+			}
+		}
+
+	return pixbuf;
+}
+
+guchar *pixel(GdkPixbuf *pixbuf, gint x, gint y)
+{
+	return gdk_pixbuf_get_pixels(pixbuf) + (static_cast<gsize>(y) * gdk_pixbuf_get_rowstride(pixbuf)) +
+	       (x * gdk_pixbuf_get_n_channels(pixbuf));
+}
+
+TEST(PixbufUtilTest, ScaleHalfAverages)
+{
+	const std::atomic<bool> cancelled{false};
+	g_autoptr(GdkPixbuf) src = numbered_pixbuf(4, 2, FALSE);
+	g_autoptr(GdkPixbuf) half = pixbuf_scale_half(src, cancelled);
+
+	ASSERT_NE(nullptr, half);
+	ASSERT_EQ(2, gdk_pixbuf_get_width(half));
+	ASSERT_EQ(1, gdk_pixbuf_get_height(half));
+	ASSERT_FALSE(gdk_pixbuf_get_has_alpha(half));
+
+	/* (0 + 10 + 1 + 11) / 4 rounded, (100 + 101 + 100 + 101) / 4 rounded, (200 + 200 + 201 + 201) / 4 rounded */
+	ASSERT_EQ(6, pixel(half, 0, 0)[0]);
+	ASSERT_EQ(101, pixel(half, 0, 0)[1]);
+	ASSERT_EQ(201, pixel(half, 0, 0)[2]);
+	ASSERT_EQ(26, pixel(half, 1, 0)[0]);
+	ASSERT_EQ(103, pixel(half, 1, 0)[1]);
+}
+
+TEST(PixbufUtilTest, ScaleHalfOddSizes)
+{
+	const std::atomic<bool> cancelled{false};
+	g_autoptr(GdkPixbuf) src = numbered_pixbuf(5, 3, FALSE);
+	g_autoptr(GdkPixbuf) half = pixbuf_scale_half(src, cancelled);
+
+	ASSERT_NE(nullptr, half);
+	ASSERT_EQ(3, gdk_pixbuf_get_width(half));
+	ASSERT_EQ(2, gdk_pixbuf_get_height(half));
+
+	/* the last column and row are repeated */
+	ASSERT_EQ(41, pixel(half, 2, 0)[0]);
+	ASSERT_EQ(104, pixel(half, 2, 0)[1]);
+	ASSERT_EQ(7, pixel(half, 0, 1)[0]);
+	ASSERT_EQ(202, pixel(half, 0, 1)[2]);
+	ASSERT_EQ(42, pixel(half, 2, 1)[0]);
+	ASSERT_EQ(202, pixel(half, 2, 1)[2]);
+}
+
+TEST(PixbufUtilTest, ScaleHalfWeightsColorByAlpha)
+{
+	const std::atomic<bool> cancelled{false};
+	g_autoptr(GdkPixbuf) src = numbered_pixbuf(2, 4, TRUE);
+
+	/* one opaque red pixel among transparent ones of another color */
+	for (gint y = 0; y < 2; y++)
+		{
+		for (gint x = 0; x < 2; x++)
+			{
+			guchar *p = pixel(src, x, y);
+			p[0] = 0;
+			p[1] = 255;
+			p[2] = 255;
+			p[3] = 0;
+			}
+		}
+	guchar *red = pixel(src, 1, 1);
+	red[0] = 255;
+	red[1] = 0;
+	red[2] = 0;
+	red[3] = 255;
+
+	/* fully transparent */
+	for (gint y = 2; y < 4; y++)
+		{
+		for (gint x = 0; x < 2; x++) pixel(src, x, y)[3] = 0;
+		}
+
+	g_autoptr(GdkPixbuf) half = pixbuf_scale_half(src, cancelled);
+
+	ASSERT_NE(nullptr, half);
+	ASSERT_TRUE(gdk_pixbuf_get_has_alpha(half));
+	ASSERT_EQ(1, gdk_pixbuf_get_width(half));
+	ASSERT_EQ(2, gdk_pixbuf_get_height(half));
+
+	const guchar *p = pixel(half, 0, 0);
+	ASSERT_EQ(255, p[0]);
+	ASSERT_EQ(0, p[1]);
+	ASSERT_EQ(0, p[2]);
+	ASSERT_EQ(64, p[3]);
+
+	p = pixel(half, 0, 1);
+	ASSERT_EQ(0, p[0]);
+	ASSERT_EQ(0, p[1]);
+	ASSERT_EQ(0, p[2]);
+	ASSERT_EQ(0, p[3]);
+}
+
+TEST(PixbufUtilTest, ScaleHalfCancelled)
+{
+	const std::atomic<bool> cancelled{true};
+	g_autoptr(GdkPixbuf) src = numbered_pixbuf(8, 8, FALSE);
+
+	ASSERT_EQ(nullptr, pixbuf_scale_half(src, cancelled));
+}
+
 }  // anonymous namespace
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for similar.cc
+ *
+ * The benchmark is disabled by default. Run it with
+ *   geeqie --run-unit-tests --gtest_also_run_disabled_tests --gtest_filter='SimilarTest.*'
+ * Set GQ_SIM_BENCH_DIR to a folder of images to also time real fingerprints.
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+#include "options.h"
+#include "similar-index.h"
+#include "similar.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+/* The per-cell implementation that the vector kernels replaced */
+gdouble scalar_compare_transfo(const ImageSimilarityData &a, const ImageSimilarityData &b, gint transfo, gdouble min)
+{
+	gint sim = 0;
+	gint i2;
+	gint *i;
+	gint j2;
+	gint *j;
+
+	if (transfo & 1) { i = &j2; j = &i2; } else { i = &i2; j = &j2; }
+	for (gint j1 = 0; j1 < 32; j1++)
+		{
+		if (transfo & 2) *j = 31-j1; else *j = j1;
+		for (gint i1 = 0; i1 < 32; i1++)
+			{
+			if (transfo & 4) *i = 31-i1; else *i = i1;
+			sim += abs(a.avg_r[(i1*32)+j1] - b.avg_r[(i2*32)+j2]);
+			sim += abs(a.avg_g[(i1*32)+j1] - b.avg_g[(i2*32)+j2]);
+			sim += abs(a.avg_b[(i1*32)+j1] - b.avg_b[(i2*32)+j2]);
+			if (sim / (255.0 * 1024.0 * 3.0) > 1.0 - min) return 0.0;
+			}
+		}
+
+	return 1.0 - (static_cast<gdouble>(sim) / (255.0 * 1024.0 * 3.0));
+}
+
+gdouble scalar_compare(const ImageSimilarityData &a, const ImageSimilarityData &b, gdouble min)
+{
+	gdouble max_score = 0;
+
+	for (gint t = 0; t < (options->rot_invariant_sim ? 8 : 1); t++)
+		{
+		max_score = std::max(scalar_compare_transfo(a, b, t, min), max_score);
+		}
+
+	return max_score;
+}
+
+class SimilarTest : public t::Test
+{
+    protected:
+	void SetUp() override
+	{
+		saved_options = options;
+		options = &test_options;
+		options->rot_invariant_sim = TRUE;
+	}
+
+	void TearDown() override
+	{
+		options = saved_options;
+	}
+
+	/* Noisy variations around a few base images, so that some pairs match */
+	static std::vector<ImageSimilarityData> random_fingerprints(gint count)
+	{
+		std::mt19937 gen(42);
+		std::uniform_int_distribution<gint> base_dist(0, 7);
+		std::uniform_int_distribution<gint> noise_dist(-6, 6);
+
+		std::vector<ImageSimilarityData> bases(8);
+		for (auto &base : bases)
+			{
+			for (gsize k = 0; k < 1024; k++)
+				{
+				base.avg_r[k] = gen();
+				base.avg_g[k] = gen();
+				base.avg_b[k] = gen();
+				}
+			}
+
+		std::vector<ImageSimilarityData> list(count);
+		for (auto &sd : list)
+			{
+			const ImageSimilarityData &base = bases[base_dist(gen)];
+			for (gsize k = 0; k < 1024; k++)
+				{
+				sd.avg_r[k] = CLAMP(base.avg_r[k] + noise_dist(gen), 0, 255);
+				sd.avg_g[k] = CLAMP(base.avg_g[k] + noise_dist(gen), 0, 255);
+				sd.avg_b[k] = CLAMP(base.avg_b[k] + noise_dist(gen), 0, 255);
+				}
+			sd.phash = image_sim_phash(sd.avg_r.data(), sd.avg_g.data(), sd.avg_b.data());
+			sd.filled = true;
+			}
+
+		return list;
+	}
+
+	static std::vector<ImageSimilarityData> folder_fingerprints(const gchar *path)
+	{
+		std::vector<ImageSimilarityData> list;
+
+		g_autoptr(GDir) dir = g_dir_open(path, 0, nullptr);
+		if (!dir) return list;
+
+		const gchar *name;
+		while ((name = g_dir_read_name(dir)))
+			{
+			g_autofree gchar *file = g_build_filename(path, name, nullptr);
+			g_autoptr(GdkPixbuf) pixbuf = gdk_pixbuf_new_from_file(file, nullptr);
+			if (pixbuf) list.emplace_back(pixbuf);
+			}
+
+		return list;
+	}
+
+	static void benchmark(const std::vector<ImageSimilarityData> &list, const gchar *label)
+	{
+		using clock = std::chrono::steady_clock;
+		gdouble scalar_total = 0;
+		gdouble simd_total = 0;
+
+		const auto scalar_start = clock::now();
+		for (const auto &b : list)
+			{
+			for (const auto &a : list) scalar_total += scalar_compare(a, b, 0.85);
+			}
+		const auto scalar_time = clock::now() - scalar_start;
+
+		const auto simd_start = clock::now();
+		for (const auto &b : list)
+			{
+			const ImageSimilarityTransforms transforms(&b);
+			for (const auto &a : list) simd_total += image_sim_compare_fast(&a, transforms, 0.85);
+			}
+		const auto simd_time = clock::now() - simd_start;
+
+		EXPECT_DOUBLE_EQ(scalar_total, simd_total);
+
+		using std::chrono::microseconds;
+		std::cerr << label << ": " << list.size() * list.size() << " compares, scalar "
+		          << std::chrono::duration_cast<microseconds>(scalar_time).count() << " us, vector "
+		          << std::chrono::duration_cast<microseconds>(simd_time).count() << " us\n";
+	}
+
+	ConfOptions test_options{};
+	ConfOptions *saved_options = nullptr;
+};
+
+TEST_F(SimilarTest, MatchesScalarCompare)
+{
+	const std::vector<ImageSimilarityData> list = random_fingerprints(64);
+
+	for (const gboolean rot_invariant : {FALSE, TRUE})
+		{
+		options->rot_invariant_sim = rot_invariant;
+
+		for (const auto &b : list)
+			{
+			const ImageSimilarityTransforms transforms(&b);
+			for (const auto &a : list)
+				{
+				ASSERT_EQ(scalar_compare(a, b, 0.0), image_sim_compare(const_cast<ImageSimilarityData *>(&a), const_cast<ImageSimilarityData *>(&b)));
+				ASSERT_EQ(scalar_compare(a, b, 0.95), image_sim_compare_fast(&a, transforms, 0.95));
+				ASSERT_EQ(scalar_compare(a, b, 0.95), image_sim_compare_fast(const_cast<ImageSimilarityData *>(&a), const_cast<ImageSimilarityData *>(&b), 0.95));
+				}
+			}
+		}
+}
+
+TEST_F(SimilarTest, RotatedCopyMatches)
+{
+	ImageSimilarityData a = random_fingerprints(1).front();
+	ImageSimilarityData b = a;
+
+	/* rotate 90 degrees */
+	for (gint y = 0; y < 32; y++)
+		{
+		for (gint x = 0; x < 32; x++)
+			{
+			b.avg_r[(x * 32) + (31 - y)] = a.avg_r[(y * 32) + x];
+			b.avg_g[(x * 32) + (31 - y)] = a.avg_g[(y * 32) + x];
+			b.avg_b[(x * 32) + (31 - y)] = a.avg_b[(y * 32) + x];
+			}
+		}
+
+	ASSERT_EQ(1.0, image_sim_compare(&a, &b));
+
+	options->rot_invariant_sim = FALSE;
+	ASSERT_GT(1.0, image_sim_compare(&a, &b));
+}
+
+TEST_F(SimilarTest, UnfilledNeverMatches)
+{
+	ImageSimilarityData a = random_fingerprints(1).front();
+	ImageSimilarityData b{};
+
+	ASSERT_EQ(0.0, image_sim_compare(&a, &b));
+	ASSERT_EQ(0.0, image_sim_compare_fast(&a, &b, 0.0));
+}
+
+TEST_F(SimilarTest, IndexFindsEveryMatch)
+{
+	const std::vector<ImageSimilarityData> list = random_fingerprints(200);
+
+	std::vector<const ImageSimilarityData *> items;
+	for (const auto &sd : list) items.push_back(&sd);
+
+	const ImageSimilarityIndex index(items);
+
+	for (gsize i = 0; i < list.size(); i++)
+		{
+		const ImageSimilarityTransforms transforms(&list[i]);
+		const std::vector<gsize> candidates = index.candidates(transforms, 0.95);
+
+		for (gsize j = 0; j < list.size(); j++)
+			{
+			if (image_sim_compare_fast(&list[j], transforms, 0.95) < 0.95) continue;
+
+			ASSERT_TRUE(std::binary_search(candidates.cbegin(), candidates.cend(), j));
+			}
+		}
+}
+
+TEST_F(SimilarTest, HashIndexFindsNearCopy)
+{
+	std::vector<ImageSimilarityData> list = random_fingerprints(100);
+	ImageSimilarityData copy = list.front();
+
+	/* rotate 180 degrees */
+	std::reverse(copy.avg_r.begin(), copy.avg_r.end());
+	std::reverse(copy.avg_g.begin(), copy.avg_g.end());
+	std::reverse(copy.avg_b.begin(), copy.avg_b.end());
+	copy.phash = image_sim_phash(copy.avg_r.data(), copy.avg_g.data(), copy.avg_b.data());
+	list.push_back(copy);
+
+	std::vector<const ImageSimilarityData *> items;
+	for (const auto &sd : list) items.push_back(&sd);
+
+	const ImageSimilarityHashIndex index(items);
+	const ImageSimilarityTransforms transforms(&list.front());
+	const std::vector<gsize> candidates = index.candidates(transforms, ImageSimilarityHashIndex::radius_for_threshold(0.95));
+
+	ASSERT_TRUE(std::binary_search(candidates.cbegin(), candidates.cend(), list.size() - 1));
+}
+
+TEST_F(SimilarTest, DISABLED_Benchmark)
+{
+	benchmark(random_fingerprints(500), "random");
+
+	const gchar *dir = g_getenv("GQ_SIM_BENCH_DIR");
+	if (!dir)
+		{
+		GTEST_SKIP() << "set GQ_SIM_BENCH_DIR to benchmark real fingerprints";
+		}
+
+	benchmark(folder_fingerprints(dir), dir);
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
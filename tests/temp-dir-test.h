@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Test fixture for unit tests that work on files
+ *
+ */
+
+#ifndef TESTS_TEMP_DIR_TEST_H
+#define TESTS_TEMP_DIR_TEST_H
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+/**
+ * @brief Gives each test an empty temporary folder
+ *
+ * The paths handed out by temp_path() and file() are removed after the
+ * test, the last one first, then the folder itself.
+ */
+class TempDirTest : public ::testing::Test
+{
+    protected:
+	void SetUp() override
+	{
+		dir = g_dir_make_tmp("geeqie_test_XXXXXX", nullptr);
+		ASSERT_NE(dir, nullptr);
+	}
+
+	void TearDown() override
+	{
+		for (auto it = files.crbegin(); it != files.crend(); ++it) g_remove(it->c_str());
+		g_rmdir(dir);
+		g_free(dir);
+	}
+
+	/**
+	 * @returns The path of @a name in the temporary folder, removed after the test
+	 */
+	std::string temp_path(const gchar *name)
+	{
+		g_autofree gchar *path = g_build_filename(dir, name, nullptr);
+		files.emplace_back(path);
+		return files.back();
+	}
+
+	/**
+	 * @brief Writes @a contents to @a name in the temporary folder
+	 * @returns The path of the file, removed after the test
+	 */
+	std::string file(const gchar *name, const gchar *contents = "image", gssize length = -1)
+	{
+		std::string path = temp_path(name);
+		EXPECT_TRUE(g_file_set_contents(path.c_str(), contents, length, nullptr));
+		return path;
+	}
+
+	gchar *dir = nullptr;
+	std::vector<std::string> files;
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for thumb-pack.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "temp-dir-test.h"
+#include "thumb-pack.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+class ThumbPackTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+		pack = temp_path(GQ_CACHE_THUMB_PACK);
+	}
+
+	static GdkPixbuf *thumbnail(gint width, gint height, gboolean alpha, gint seed)
+	{
+		GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, alpha, 8, width, height);
+		const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+		const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+		guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+
+		for (gint y = 0; y < height; y++)
+			{
+			for (gint x = 0; x < width * channels; x++)
+				{
+				pixels[(y * rowstride) + x] = seed + (y * 7) + x;
+				}
+			}
+
+		return pixbuf;
+	}
+
+	/* does not deflate */
+	static GdkPixbuf *noise(gint width, gint height, gboolean alpha, guint32 seed)
+	{
+		GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, alpha, 8, width, height);
+		const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+		const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+		guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+		guint32 state = seed;
+
+		for (gint y = 0; y < height; y++)
+			{
+			for (gint x = 0; x < width * channels; x++)
+				{
+				state = (state * 1664525) + 1013904223;
+				pixels[(y * rowstride) + x] = state >> 24;
+				}
+			}
+
+		return pixbuf;
+	}
+
+	static void expect_same(GdkPixbuf *expected, GdkPixbuf *pixbuf)
+	{
+		ASSERT_NE(pixbuf, nullptr);
+		ASSERT_EQ(gdk_pixbuf_get_width(expected), gdk_pixbuf_get_width(pixbuf));
+		ASSERT_EQ(gdk_pixbuf_get_height(expected), gdk_pixbuf_get_height(pixbuf));
+		ASSERT_EQ(gdk_pixbuf_get_has_alpha(expected), gdk_pixbuf_get_has_alpha(pixbuf));
+
+		const gint row = gdk_pixbuf_get_width(expected) * gdk_pixbuf_get_n_channels(expected);
+		for (gint y = 0; y < gdk_pixbuf_get_height(expected); y++)
+			{
+			const guchar *a = gdk_pixbuf_get_pixels(expected) + (y * gdk_pixbuf_get_rowstride(expected));
+			const guchar *b = gdk_pixbuf_get_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf));
+			ASSERT_EQ(std::vector<guchar>(a, a + row), std::vector<guchar>(b, b + row)) << y;
+			}
+	}
+
+	gint64 pack_size() const
+	{
+		GStatBuf st;
+		EXPECT_EQ(0, g_stat(pack.c_str(), &st));
+		return st.st_size;
+	}
+
+	std::string pack;
+};
+
+TEST_F(ThumbPackTest, RoundTrip)
+{
+	std::vector<std::string> paths;
+	std::vector<GdkPixbuf *> thumbs;
+	for (gint i = 0; i < 50; i++)
+		{
+		paths.push_back(file((std::to_string(i) + ".jpg").c_str()));
+		/* odd widths, so that the rowstride of the pixbuf is padded */
+		thumbs.push_back(thumbnail(97 - i, 72, i % 2, i));
+		ASSERT_TRUE(thumb_pack_save(pack.c_str(), paths.back().c_str(), 128, 128, thumbs.back()));
+		}
+
+	for (gint i = 0; i < 50; i++)
+		{
+		g_autoptr(GdkPixbuf) pixbuf = thumb_pack_load(pack.c_str(), paths[i].c_str(), 128, 128);
+		expect_same(thumbs[i], pixbuf);
+		g_object_unref(thumbs[i]);
+		}
+}
+
+TEST_F(ThumbPackTest, ChangedSourceIsNotLoaded)
+{
+	const std::string path = file("a.jpg");
+	g_autoptr(GdkPixbuf) thumb = thumbnail(10, 10, FALSE, 1);
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), path.c_str(), 128, 128, thumb));
+
+	file("a.jpg", "a longer image");
+
+	ASSERT_EQ(nullptr, thumb_pack_load(pack.c_str(), path.c_str(), 128, 128));
+}
+
+TEST_F(ThumbPackTest, SizesAreKeptApart)
+{
+	const std::string path = file("a.jpg");
+	g_autoptr(GdkPixbuf) small = thumbnail(10, 8, FALSE, 1);
+	g_autoptr(GdkPixbuf) large = thumbnail(20, 16, TRUE, 2);
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), path.c_str(), 10, 10, small));
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), path.c_str(), 20, 20, large));
+
+	ASSERT_EQ(nullptr, thumb_pack_load(pack.c_str(), path.c_str(), 30, 30));
+
+	g_autoptr(GdkPixbuf) loaded_small = thumb_pack_load(pack.c_str(), path.c_str(), 10, 10);
+	expect_same(small, loaded_small);
+
+	g_autoptr(GdkPixbuf) loaded_large = thumb_pack_load(pack.c_str(), path.c_str(), 20, 20);
+	expect_same(large, loaded_large);
+}
+
+TEST_F(ThumbPackTest, ReplacedThumbnailsAreCompacted)
+{
+	const std::string a = file("a.jpg");
+	const std::string b = file("b.jpg");
+	g_autoptr(GdkPixbuf) thumb_b = noise(256, 256, TRUE, 2);
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), b.c_str(), 256, 256, thumb_b));
+
+	/* noise, so that the records keep their size */
+	for (gint i = 0; i < 40; i++)
+		{
+		g_autoptr(GdkPixbuf) thumb_a = noise(256, 256, TRUE, i);
+		ASSERT_TRUE(thumb_pack_save(pack.c_str(), a.c_str(), 256, 256, thumb_a));
+
+		g_autoptr(GdkPixbuf) loaded = thumb_pack_load(pack.c_str(), a.c_str(), 256, 256);
+		expect_same(thumb_a, loaded);
+		}
+
+	/* the deleted thumbnails do not pile up */
+	ASSERT_LT(pack_size(), 20 * 256 * 256 * 4);
+
+	g_autoptr(GdkPixbuf) loaded_b = thumb_pack_load(pack.c_str(), b.c_str(), 256, 256);
+	expect_same(thumb_b, loaded_b);
+}
+
+TEST_F(ThumbPackTest, CutShortRecordIsDropped)
+{
+	const std::string a = file("a.jpg");
+	const std::string b = file("b.jpg");
+	g_autoptr(GdkPixbuf) thumb = thumbnail(30, 20, FALSE, 1);
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), a.c_str(), 32, 32, thumb));
+
+	/* a crash while appending */
+	const gint64 size = pack_size();
+	FILE *f = g_fopen(pack.c_str(), "ab");
+	ASSERT_NE(f, nullptr);
+	const std::vector<gchar> partial(100, 1);
+	fwrite(partial.data(), 1, partial.size(), f);
+	fclose(f);
+
+	g_autoptr(GdkPixbuf) loaded_a = thumb_pack_load(pack.c_str(), a.c_str(), 32, 32);
+	expect_same(thumb, loaded_a);
+
+	/* a record of the same length replaces the partial one */
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), b.c_str(), 32, 32, thumb));
+	ASSERT_EQ(size * 2 - 32, pack_size());
+
+	g_autoptr(GdkPixbuf) loaded_b = thumb_pack_load(pack.c_str(), b.c_str(), 32, 32);
+	expect_same(thumb, loaded_b);
+}
+
+TEST_F(ThumbPackTest, PixelsAreCompressed)
+{
+	const std::string path = file("a.jpg");
+	g_autoptr(GdkPixbuf) thumb = thumbnail(256, 256, TRUE, 1);
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), path.c_str(), 256, 256, thumb));
+
+	ASSERT_LT(pack_size(), 256 * 256 * 4 / 10);
+
+	g_autoptr(GdkPixbuf) loaded = thumb_pack_load(pack.c_str(), path.c_str(), 256, 256);
+	expect_same(thumb, loaded);
+}
+
+TEST_F(ThumbPackTest, NoiseIsStoredAsIs)
+{
+	const std::string path = file("a.jpg");
+	g_autoptr(GdkPixbuf) thumb = noise(61, 40, FALSE, 1);
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), path.c_str(), 64, 64, thumb));
+
+	ASSERT_GE(pack_size(), 61 * 40 * 3);
+
+	g_autoptr(GdkPixbuf) loaded = thumb_pack_load(pack.c_str(), path.c_str(), 64, 64);
+	expect_same(thumb, loaded);
+}
+
+TEST_F(ThumbPackTest, LargeThumbnailIsNotPacked)
+{
+	const std::string path = file("a.jpg");
+	g_autoptr(GdkPixbuf) thumb = noise(1024, 1024, TRUE, 1);
+	ASSERT_FALSE(thumb_pack_save(pack.c_str(), path.c_str(), 1024, 1024, thumb));
+
+	ASSERT_EQ(nullptr, thumb_pack_load(pack.c_str(), path.c_str(), 1024, 1024));
+}
+
+TEST_F(ThumbPackTest, MoveAndRemove)
+{
+	const std::string a = file("a.jpg");
+	const std::string b = file("b.jpg");
+	g_autoptr(GdkPixbuf) thumb_a = thumbnail(16, 12, FALSE, 1);
+	g_autoptr(GdkPixbuf) thumb_b = thumbnail(16, 12, FALSE, 2);
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), a.c_str(), 16, 16, thumb_a));
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), b.c_str(), 16, 16, thumb_b));
+
+	const std::string c = temp_path("c.jpg");
+	ASSERT_EQ(0, g_rename(a.c_str(), c.c_str()));
+
+	ASSERT_TRUE(thumb_pack_move(pack.c_str(), a.c_str(), pack.c_str(), c.c_str()));
+
+	g_autoptr(GdkPixbuf) loaded_c = thumb_pack_load(pack.c_str(), c.c_str(), 16, 16);
+	expect_same(thumb_a, loaded_c);
+
+	thumb_pack_remove(pack.c_str(), b.c_str());
+	ASSERT_EQ(nullptr, thumb_pack_load(pack.c_str(), b.c_str(), 16, 16));
+}
+
+TEST_F(ThumbPackTest, PurgeDropsMissingFiles)
+{
+	const std::string a = file("a.jpg");
+	const std::string b = file("b.jpg");
+	g_autoptr(GdkPixbuf) thumb = thumbnail(16, 12, FALSE, 1);
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), a.c_str(), 16, 16, thumb));
+	ASSERT_TRUE(thumb_pack_save(pack.c_str(), b.c_str(), 16, 16, thumb));
+
+	const gint64 size = pack_size();
+	g_remove(a.c_str());
+
+	ASSERT_EQ(1, thumb_pack_purge(pack.c_str(), dir));
+	ASSERT_LT(pack_size(), size);
+
+	g_autoptr(GdkPixbuf) loaded = thumb_pack_load(pack.c_str(), b.c_str(), 16, 16);
+	expect_same(thumb, loaded);
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
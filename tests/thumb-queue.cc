@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for thumb-queue.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <set>
+#include <vector>
+
+#include <glib.h>
+
+#include "thumb-queue.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+bool none_done(guint)
+{
+	return false;
+}
+
+std::vector<gint> take_all(ThumbQueue &queue, const ThumbQueue::DoneFunc &done = none_done)
+{
+	std::vector<gint> order;
+	gint position;
+
+	while ((position = queue.take(done)) >= 0) order.push_back(position);
+
+	return order;
+}
+
+TEST(ThumbQueueTest, Empty)
+{
+	ThumbQueue queue;
+
+	queue.reset(0);
+	ASSERT_EQ(-1, queue.take(none_done));
+
+	queue.set_visible(3, 7);
+	ASSERT_EQ(-1, queue.take(none_done));
+}
+
+TEST(ThumbQueueTest, TopToBottom)
+{
+	ThumbQueue queue;
+
+	queue.reset(5);
+	ASSERT_EQ((std::vector<gint>{0, 1, 2, 3, 4}), take_all(queue));
+}
+
+TEST(ThumbQueueTest, VisibleFirstThenNearest)
+{
+	ThumbQueue queue;
+
+	queue.reset(10);
+	queue.set_visible(4, 5);
+	ASSERT_EQ((std::vector<gint>{4, 5, 6, 3, 7, 2, 8, 1, 9, 0}), take_all(queue));
+}
+
+TEST(ThumbQueueTest, VisibleAtTheEnd)
+{
+	ThumbQueue queue;
+
+	queue.reset(6);
+	queue.set_visible(9, 4);
+	ASSERT_EQ((std::vector<gint>{4, 5, 3, 2, 1, 0}), take_all(queue));
+}
+
+TEST(ThumbQueueTest, DoneAreSkipped)
+{
+	ThumbQueue queue;
+
+	queue.reset(8);
+	queue.set_visible(2, 3);
+	ASSERT_EQ((std::vector<gint>{3, 1, 5, 7}), take_all(queue, [](guint position) { return position % 2 == 0; }));
+}
+
+TEST(ThumbQueueTest, ScrollKeepsTaken)
+{
+	ThumbQueue queue;
+
+	queue.reset(100);
+	queue.set_visible(0, 9);
+
+	std::set<gint> seen;
+	for (gint i = 0; i < 10; i++) seen.insert(queue.take(none_done));
+	ASSERT_EQ(10U, seen.size());
+
+	/* scrolled down, the new visible ones come next */
+	queue.set_visible(50, 59);
+	for (gint expected = 50; expected <= 59; expected++)
+		{
+		ASSERT_EQ(expected, queue.take(none_done));
+		seen.insert(expected);
+		}
+
+	/* scrolled back up, nothing is taken twice */
+	queue.set_visible(5, 14);
+	const std::vector<gint> rest = take_all(queue);
+	ASSERT_EQ(80U, rest.size());
+	ASSERT_EQ(10, rest.front());
+	for (const gint position : rest)
+		{
+		ASSERT_TRUE(seen.insert(position).second) << position;
+		}
+	ASSERT_EQ(100U, seen.size());
+}
+
+TEST(ThumbQueueTest, ScrollBackAndForth)
+{
+	ThumbQueue queue;
+
+	queue.reset(1000);
+
+	std::set<gint> seen;
+	for (gint i = 0; i < 100; i++)
+		{
+		const guint first = (i % 2) ? 900 - (i * 7) : i * 7;
+		queue.set_visible(first, first + 9);
+		for (gint j = 0; j < 5; j++)
+			{
+			const gint position = queue.take(none_done);
+			ASSERT_GE(position, 0);
+			ASSERT_TRUE(seen.insert(position).second) << position;
+			}
+		}
+
+	for (const gint position : take_all(queue))
+		{
+		ASSERT_TRUE(seen.insert(position).second) << position;
+		}
+	ASSERT_EQ(1000U, seen.size());
+}
+
+TEST(ThumbQueueTest, ResetForgetsTaken)
+{
+	ThumbQueue queue;
+
+	queue.reset(3);
+	ASSERT_EQ(3U, take_all(queue).size());
+
+	queue.reset(3);
+	ASSERT_EQ((std::vector<gint>{0, 1, 2}), take_all(queue));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
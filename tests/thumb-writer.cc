@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for thumb-writer.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <string>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "temp-dir-test.h"
+#include "thumb-writer.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+class ThumbWriterTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+		temp_path("cache");
+		folder = temp_path("cache" G_DIR_SEPARATOR_S "thumbs");
+	}
+
+	void TearDown() override
+	{
+		for (const std::string &name : listing()) g_remove(path(name.c_str()).c_str());
+		TempDirTest::TearDown();
+	}
+
+	/* in the thumbnail folder, made by the writer */
+	std::string path(const gchar *name) const
+	{
+		g_autofree gchar *path = g_build_filename(folder.c_str(), name, nullptr);
+		return path;
+	}
+
+	std::vector<std::string> listing() const
+	{
+		std::vector<std::string> names;
+		g_autoptr(GDir) listing = g_dir_open(folder.c_str(), 0, nullptr);
+		const gchar *name;
+		while (listing && (name = g_dir_read_name(listing))) names.emplace_back(name);
+		return names;
+	}
+
+	static GdkPixbuf *thumbnail(gint width, gint height, gint seed)
+	{
+		GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+		gdk_pixbuf_fill(pixbuf, 0x10203000 + seed);
+		return pixbuf;
+	}
+
+	std::string folder;
+};
+
+TEST_F(ThumbWriterTest, ManyThumbnailsInANewFolder)
+{
+	const gint count = 200;
+
+	for (gint i = 0; i < count; i++)
+		{
+		g_autoptr(GdkPixbuf) pixbuf = thumbnail(32, 24, i);
+
+		ThumbWriterJob job;
+		job.path = path((std::to_string(i) + ".png").c_str());
+		job.mode = S_IRUSR | S_IWUSR;
+		job.text = {{"tEXt::Thumb::MTime", std::to_string(i)}};
+		job.compression = i % 10;
+		thumb_writer_save(pixbuf, job);
+
+		/* the writer keeps its own copy */
+		gdk_pixbuf_fill(pixbuf, 0);
+		}
+
+	thumb_writer_flush();
+
+	ASSERT_EQ(static_cast<size_t>(count), listing().size());
+
+	for (gint i = 0; i < count; i++)
+		{
+		const std::string file = path((std::to_string(i) + ".png").c_str());
+
+		GStatBuf st;
+		ASSERT_EQ(0, g_stat(file.c_str(), &st));
+		ASSERT_EQ(static_cast<mode_t>(S_IRUSR | S_IWUSR), st.st_mode & 0777);
+
+		g_autoptr(GdkPixbuf) loaded = gdk_pixbuf_new_from_file(file.c_str(), nullptr);
+		ASSERT_NE(loaded, nullptr);
+		ASSERT_EQ(32, gdk_pixbuf_get_width(loaded));
+		ASSERT_EQ(24, gdk_pixbuf_get_height(loaded));
+		ASSERT_STREQ(std::to_string(i).c_str(), gdk_pixbuf_get_option(loaded, "tEXt::Thumb::MTime"));
+		ASSERT_EQ(0x10, gdk_pixbuf_get_pixels(loaded)[0]);
+		}
+}
+
+TEST_F(ThumbWriterTest, TimeIsCopied)
+{
+	const std::string source = file("a.jpg");
+
+	struct utimbuf ut;
+	ut.actime = ut.modtime = 1000000000;
+	ASSERT_EQ(0, g_utime(source.c_str(), &ut));
+
+	g_autoptr(GdkPixbuf) pixbuf = thumbnail(8, 8, 0);
+	ThumbWriterJob job;
+	job.path = path("a.png");
+	job.time_from = source;
+	thumb_writer_save(pixbuf, job);
+	thumb_writer_flush();
+
+	GStatBuf st;
+	ASSERT_EQ(0, g_stat(job.path.c_str(), &st));
+	ASSERT_EQ(1000000000, st.st_mtime);
+}
+
+TEST_F(ThumbWriterTest, FolderIsCreatedAgain)
+{
+	g_autoptr(GdkPixbuf) pixbuf = thumbnail(8, 8, 0);
+	ThumbWriterJob job;
+	job.path = path("a.png");
+	thumb_writer_save(pixbuf, job);
+	thumb_writer_flush();
+	ASSERT_EQ(0, g_remove(job.path.c_str()));
+
+	/* removed by a cache clean up */
+	ASSERT_EQ(0, g_rmdir(folder.c_str()));
+
+	thumb_writer_save(pixbuf, job);
+	thumb_writer_flush();
+	ASSERT_TRUE(g_file_test(job.path.c_str(), G_FILE_TEST_EXISTS));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */